@@ -2,10 +2,32 @@
 
 #include "Input/AimAssistTargetComponent.h"
 
+#include "Engine/World.h"
+#include "Input/AimAssistTargetSubsystem.h"
 #include "Input/IAimAssistTargetInterface.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(AimAssistTargetComponent)
 
+void UAimAssistTargetComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	if (UAimAssistTargetSubsystem* TargetSubsystem = UWorld::GetSubsystem<UAimAssistTargetSubsystem>(GetWorld()))
+	{
+		TargetSubsystem->RegisterTarget(this);
+	}
+}
+
+void UAimAssistTargetComponent::OnUnregister()
+{
+	if (UAimAssistTargetSubsystem* TargetSubsystem = UWorld::GetSubsystem<UAimAssistTargetSubsystem>(GetWorld()))
+	{
+		TargetSubsystem->UnregisterTarget(this);
+	}
+
+	Super::OnUnregister();
+}
+
 void UAimAssistTargetComponent::GatherTargetOptions(FAimAssistTargetOptions& OutTargetData)
 {
 	if (!TargetData.TargetShapeComponent.IsValid())
@@ -10,8 +10,8 @@
 #include "Components/SkeletalMeshComponent.h"
 #include "Character/LyraHealthComponent.h"
 #include "Input/AimAssistInputModifier.h"
+#include "Input/AimAssistTargetSubsystem.h"
 #include "Player/LyraPlayerState.h"
-#include "Character/LyraHealthComponent.h"
 #include "Input/IAimAssistTargetInterface.h"
 #include "ShooterCoreRuntimeSettings.h"
 
@@ -38,51 +38,6 @@ const FLyraAimAssistTarget* FindTarget(const TArray<FLyraAimAssistTarget>& Targe
 	return FoundTarget;
 }
 
-static bool GatherTargetInfo(const AActor* Actor, const UShapeComponent* ShapeComponent, FTransform& OutTransform, FCollisionShape& OutShape, FVector& OutShapeOrigin)
-{
-	check(Actor);
-	check(ShapeComponent);
-
-	const FCollisionShape TargetShape = ShapeComponent->GetCollisionShape();
-	const bool bIsValidShape = (TargetShape.IsBox() || TargetShape.IsSphere() || TargetShape.IsCapsule());
-
-	if (!bIsValidShape || TargetShape.IsNearlyZero())
-	{
-		return false;
-	}
-
-	FTransform TargetTransform;
-	FVector TargetShapeOrigin(ForceInitToZero);
-
-	if (const ACharacter* TargetCharacter = Cast<ACharacter>(Actor))
-	{
-		if (ShapeComponent == TargetCharacter->GetCapsuleComponent())
-		{
-			// Character capsules don't move smoothly for remote players.  Use the mesh location since it's smoothed out.
-			const USkeletalMeshComponent* TargetMesh = TargetCharacter->GetMesh();
-			check(TargetMesh);
-
-			TargetTransform = TargetMesh->GetComponentTransform();
-			TargetShapeOrigin = -TargetCharacter->GetBaseTranslationOffset();
-		}
-		else
-		{
-			TargetTransform = ShapeComponent->GetComponentTransform();
-		}
-	}
-	else
-	{
-		TargetTransform = ShapeComponent->GetComponentTransform();
-	}
-
-	OutTransform = TargetTransform;
-	OutShape = TargetShape;
-	OutShapeOrigin = TargetShapeOrigin;
-
-	return true;
-}
-
-
 void UAimAssistTargetManagerComponent::GetVisibleTargets(const FAimAssistFilter& Filter, const FAimAssistSettings& Settings, const FAimAssistOwnerViewData& OwnerData, const TArray<FLyraAimAssistTarget>& OldTargets, OUT TArray<FLyraAimAssistTarget>& OutNewTargets)
 {
 	TRACE_CPUPROFILER_EVENT_SCOPE(UAimAssistTargetManagerComponent::GetVisibleTargets);
@@ -118,75 +73,46 @@ void UAimAssistTargetManagerComponent::GetVisibleTargets(const FAimAssistFilter&
 	const FBox2D AssistOuterReticleBounds = OwnerData.ProjectReticleToScreen(Settings.AssistOuterReticleWidth.GetValue(), Settings.AssistOuterReticleHeight.GetValue(), ReticleDepth);
 	const FBox2D TargetingReticleBounds = OwnerData.ProjectReticleToScreen(Settings.TargetingReticleWidth.GetValue(), Settings.TargetingReticleHeight.GetValue(), ReticleDepth);
 
-	static TArray<FOverlapResult> OverlapResults;
-	// Do a world trace on the Aim Assist channel to get any visible targets
+	UAimAssistTargetSubsystem* TargetSubsystem = UWorld::GetSubsystem<UAimAssistTargetSubsystem>(GetWorld());
+	if (!TargetSubsystem)
 	{
-		UWorld* World = GetWorld();
-		
-		OverlapResults.Reset();
+		return;
+	}
 
+	// All requesters this frame share the same snapshot of the registered targets
+	const FAimAssistTargetCache& TargetCache = TargetSubsystem->GetTargetCache();
+
+	// Cull the targets against the viewfinder box in front of the pawn
+	TArray<int32> CandidateIndices;
+	{
 		const FVector PawnLocation = OwnerPawn->GetActorLocation();
-		ECollisionChannel AimAssistChannel = GetAimAssistChannel();
-		FCollisionQueryParams Params(SCENE_QUERY_STAT(AimAssist_QueryTargetsInRange), true);
-		Params.AddIgnoredActor(OwnerPawn);
 
-		// Need to multiply these by 0.5 because MakeBox takes in half extents
-		FCollisionShape BoxShape = FCollisionShape::MakeBox(FVector3f(ReticleDepth * 0.5f, Settings.AssistOuterReticleWidth.GetValue() * 0.5f, Settings.AssistOuterReticleHeight.GetValue() * 0.5f));						
-		World->OverlapMultiByChannel(OUT OverlapResults, PawnLocation, OwnerData.PlayerTransform.GetRotation(), AimAssistChannel, BoxShape, Params);
+		// Need to multiply these by 0.5 because the box is defined by half extents
+		const FVector BoxExtent(ReticleDepth * 0.5f, Settings.AssistOuterReticleWidth.GetValue() * 0.5f, Settings.AssistOuterReticleHeight.GetValue() * 0.5f);
+		TargetCache.GatherTargetsInBox(PawnLocation, OwnerData.PlayerTransform.GetRotation(), BoxExtent, CandidateIndices);
 
 #if ENABLE_DRAW_DEBUG && !UE_BUILD_SHIPPING
 		if(LyraConsoleVariables::bDrawDebugViewfinder)
 		{
-			DrawDebugBox(World, PawnLocation, BoxShape.GetBox(), OwnerData.PlayerTransform.GetRotation(), FColor::Red);	
+			DrawDebugBox(GetWorld(), PawnLocation, BoxExtent, OwnerData.PlayerTransform.GetRotation(), FColor::Red);	
 		}
 #endif
 	}
 
-	// Gather target options from any visibile hit results that implement the IAimAssistTarget interface
-	TArray<FAimAssistTargetOptions> NewTargetData;
-	{
-		for (const FOverlapResult& Overlap : OverlapResults)
-		{
-			TScriptInterface<IAimAssistTaget> TargetActor(Overlap.GetActor());
-			if (TargetActor)
-			{
-				FAimAssistTargetOptions TargetData;
-				TargetActor->GatherTargetOptions(TargetData);
-				NewTargetData.Add(TargetData);
-			}
-			
-			TScriptInterface<IAimAssistTaget> TargetComponent(Overlap.GetComponent());
-			if (TargetComponent)
-			{
-				FAimAssistTargetOptions TargetData;
-				TargetComponent->GatherTargetOptions(TargetData);
-				NewTargetData.Add(TargetData);
-			}			
-		}
-	}
-	
 	// Gather targets that are in front of the player
 	{
-		const FVector PawnLocation = OwnerPawn->GetActorLocation();		
-		
-		for (FAimAssistTargetOptions& AimAssistTarget : NewTargetData)
+		for (const int32 TargetIndex : CandidateIndices)
 		{
-			if (!DoesTargetPassFilter(OwnerData, Filter, AimAssistTarget, TargetRange))
+			if (!DoesTargetPassFilter(OwnerData, Filter, TargetCache, TargetIndex, TargetRange))
 			{
 				continue;
 			}
-			
-			AActor* OwningActor = AimAssistTarget.TargetShapeComponent->GetOwner();
 
-			FTransform TargetTransform;
-			FCollisionShape TargetShape;
-			FVector TargetShapeOrigin;
+			const FAimAssistTargetOptions& AimAssistTarget = TargetCache.Options[TargetIndex];
+			const FTransform& TargetTransform = TargetCache.ShapeTransforms[TargetIndex];
+			const FCollisionShape& TargetShape = TargetCache.Shapes[TargetIndex];
+			const FVector& TargetShapeOrigin = TargetCache.ShapeOrigins[TargetIndex];
 
-			if (!GatherTargetInfo(OwningActor, AimAssistTarget.TargetShapeComponent.Get(), TargetTransform, TargetShape, TargetShapeOrigin))
-			{
-				continue;
-			}
-			
 			const FVector TargetViewLocation = TargetTransform.TransformPositionNoScale(TargetShapeOrigin);
 			const FVector TargetViewVector = (TargetViewLocation - ViewLocation);
 
@@ -276,16 +202,17 @@ void UAimAssistTargetManagerComponent::GetVisibleTargets(const FAimAssistFilter&
 	}
 }
 
-bool UAimAssistTargetManagerComponent::DoesTargetPassFilter(const FAimAssistOwnerViewData& OwnerData, const FAimAssistFilter& Filter, const FAimAssistTargetOptions& Target, const float AcceptableRange) const
+bool UAimAssistTargetManagerComponent::DoesTargetPassFilter(const FAimAssistOwnerViewData& OwnerData, const FAimAssistFilter& Filter, const FAimAssistTargetCache& TargetCache, const int32 TargetIndex, const float AcceptableRange) const
 {
 	const APawn* OwnerPawn = OwnerData.PlayerController ? OwnerData.PlayerController->GetPawn() : nullptr;
+	const FAimAssistTargetOptions& Target = TargetCache.Options[TargetIndex];
 	
 	if (!Target.bIsActive || !OwnerPawn || !Target.TargetShapeComponent.IsValid())
 	{
 		return false;
 	}
 	
-	const AActor* TargetOwningActor = Target.TargetShapeComponent->GetOwner();
+	const AActor* TargetOwningActor = TargetCache.OwningActors[TargetIndex];
 	check(TargetOwningActor);
 	if (TargetOwningActor == OwnerPawn || TargetOwningActor == OwnerPawn->GetInstigator())
 	{
@@ -295,7 +222,7 @@ bool UAimAssistTargetManagerComponent::DoesTargetPassFilter(const FAimAssistOwne
 	const FVector PawnLocation = OwnerPawn->GetActorLocation();
 	
 	// Do a distance check on the given actor
-	const FVector TargetVector = TargetOwningActor->GetActorLocation() - PawnLocation;
+	const FVector TargetVector = FVector(TargetCache.LocationX[TargetIndex], TargetCache.LocationY[TargetIndex], TargetCache.LocationZ[TargetIndex]) - PawnLocation;
 	const float TargetViewDistanceCheck = FVector::DotProduct(OwnerData.ViewForward, TargetVector);
 
 	if ((TargetViewDistanceCheck < 0.0f) || (TargetViewDistanceCheck > AcceptableRange))
@@ -303,30 +230,21 @@ bool UAimAssistTargetManagerComponent::DoesTargetPassFilter(const FAimAssistOwne
 		return false;
 	}
 	
-	if (const ACharacter* TargetCharacter = Cast<ACharacter>(TargetOwningActor))
+	if (TargetCache.IsCharacter[TargetIndex])
 	{
 		// If the given target is on the same team as the owner, then exclude it from the search	
 		if (!Filter.bIncludeSameFriendlyTargets)
 		{
-			if (const ALyraPlayerState* PS = TargetCharacter->GetPlayerState<ALyraPlayerState>())
+			if (TargetCache.HasPlayerState[TargetIndex] && (TargetCache.TeamIds[TargetIndex] == OwnerData.TeamID))
 			{
-				if (PS->GetTeamId() == OwnerData.TeamID)
-				{
-					return false;
-				}
+				return false;
 			}
 		}
 
 		// Exclude dead or dying characters
-		if (Filter.bExcludeDeadOrDying)
+		if (Filter.bExcludeDeadOrDying && TargetCache.IsDeadOrDying[TargetIndex])
 		{
-			if (const ULyraHealthComponent* HealthComponent = ULyraHealthComponent::FindHealthComponent(TargetCharacter))
-			{
-				if (HealthComponent->IsDeadOrDying())
-				{
-					return false;
-				}
-			}	
+			return false;
 		}
 	}
 
@@ -408,6 +326,9 @@ void UAimAssistTargetManagerComponent::DetermineTargetVisibility(FLyraAimAssistT
 	ResponseParams.CollisionResponse.SetResponse(ECC_Pawn, ECR_Ignore);	
 	ResponseParams.CollisionResponse.SetResponse(AimAssistChannel, ECR_Ignore);
 
+	UAimAssistTargetSubsystem* TargetSubsystem = UWorld::GetSubsystem<UAimAssistTargetSubsystem>(World);
+	check(TargetSubsystem);
+
 	if (Target.bIsVisible && Settings.bEnableAsyncVisibilityTrace)
 	{
 		// Query for previous asynchronous trace result.
@@ -431,12 +352,12 @@ void UAimAssistTargetManagerComponent::DetermineTargetVisibility(FLyraAimAssistT
 		// Only start a new asynchronous trace for next frame if the target is still visible.
 		if (Target.bIsVisible)
 		{
-			Target.VisibilityTraceHandle = World->AsyncLineTraceByChannel(EAsyncTraceType::Test, OwnerData.ViewTransform.GetTranslation(), TargetEyeLocation, ECC_Visibility, QueryParams, ResponseParams);
+			Target.VisibilityTraceHandle = TargetSubsystem->RequestAsyncVisibilityTrace(OwnerData.ViewTransform.GetTranslation(), TargetEyeLocation, Target.TargetShapeComponent.Get(), QueryParams, ResponseParams);
 		}
 	}
 	else
 	{
-		Target.bIsVisible = !World->LineTraceTestByChannel(OwnerData.ViewTransform.GetTranslation(), TargetEyeLocation, ECC_Visibility, QueryParams, ResponseParams);
+		Target.bIsVisible = TargetSubsystem->TestVisibility(OwnerData.ViewTransform.GetTranslation(), TargetEyeLocation, Target.TargetShapeComponent.Get(), QueryParams, ResponseParams);
 
 		// Invalidate the async trace handle.
 		Target.VisibilityTraceHandle = FTraceHandle();		
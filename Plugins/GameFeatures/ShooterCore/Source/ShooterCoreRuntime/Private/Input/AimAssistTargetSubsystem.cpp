@@ -0,0 +1,308 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Input/AimAssistTargetSubsystem.h"
+
+#include "Character/LyraHealthComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "Input/AimAssistInputModifier.h"
+#include "Player/LyraPlayerState.h"
+#include "ShooterCoreRuntimeSettings.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(AimAssistTargetSubsystem)
+
+static bool GatherTargetInfo(const AActor* Actor, const UShapeComponent* ShapeComponent, FTransform& OutTransform, FCollisionShape& OutShape, FVector& OutShapeOrigin)
+{
+	check(Actor);
+	check(ShapeComponent);
+
+	const FCollisionShape TargetShape = ShapeComponent->GetCollisionShape();
+	const bool bIsValidShape = (TargetShape.IsBox() || TargetShape.IsSphere() || TargetShape.IsCapsule());
+
+	if (!bIsValidShape || TargetShape.IsNearlyZero())
+	{
+		return false;
+	}
+
+	FTransform TargetTransform;
+	FVector TargetShapeOrigin(ForceInitToZero);
+
+	if (const ACharacter* TargetCharacter = Cast<ACharacter>(Actor))
+	{
+		if (ShapeComponent == TargetCharacter->GetCapsuleComponent())
+		{
+			// Character capsules don't move smoothly for remote players.  Use the mesh location since it's smoothed out.
+			const USkeletalMeshComponent* TargetMesh = TargetCharacter->GetMesh();
+			check(TargetMesh);
+
+			TargetTransform = TargetMesh->GetComponentTransform();
+			TargetShapeOrigin = -TargetCharacter->GetBaseTranslationOffset();
+		}
+		else
+		{
+			TargetTransform = ShapeComponent->GetComponentTransform();
+		}
+	}
+	else
+	{
+		TargetTransform = ShapeComponent->GetComponentTransform();
+	}
+
+	OutTransform = TargetTransform;
+	OutShape = TargetShape;
+	OutShapeOrigin = TargetShapeOrigin;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// FAimAssistTargetCache
+
+void FAimAssistTargetCache::Reset()
+{
+	Options.Reset();
+	OwningActors.Reset();
+	ShapeTransforms.Reset();
+	Shapes.Reset();
+	ShapeOrigins.Reset();
+	BoundsOriginX.Reset();
+	BoundsOriginY.Reset();
+	BoundsOriginZ.Reset();
+	BoundsRadius.Reset();
+	LocationX.Reset();
+	LocationY.Reset();
+	LocationZ.Reset();
+	TeamIds.Reset();
+	IsCharacter.Reset();
+	HasPlayerState.Reset();
+	IsDeadOrDying.Reset();
+}
+
+void FAimAssistTargetCache::GatherTargetsInBox(const FVector& BoxCenter, const FQuat& BoxRotation, const FVector& BoxExtent, TArray<int32>& OutIndices) const
+{
+	const int32 NumTargets = Num();
+	if (NumTargets == 0)
+	{
+		return;
+	}
+
+	const FVector3f AxisX(BoxRotation.GetAxisX());
+	const FVector3f AxisY(BoxRotation.GetAxisY());
+	const FVector3f AxisZ(BoxRotation.GetAxisZ());
+	const FVector3f Center(BoxCenter);
+	const FVector3f Extent(BoxExtent);
+
+	// Branch-free pass over the packed bounds, then compact the survivors
+	TArray<uint8, TInlineAllocator<128>> InBox;
+	InBox.SetNumUninitialized(NumTargets);
+
+	for (int32 Index = 0; Index < NumTargets; ++Index)
+	{
+		const float DX = BoundsOriginX[Index] - Center.X;
+		const float DY = BoundsOriginY[Index] - Center.Y;
+		const float DZ = BoundsOriginZ[Index] - Center.Z;
+		const float Radius = BoundsRadius[Index];
+
+		const float LocalX = FMath::Abs(DX * AxisX.X + DY * AxisX.Y + DZ * AxisX.Z);
+		const float LocalY = FMath::Abs(DX * AxisY.X + DY * AxisY.Y + DZ * AxisY.Z);
+		const float LocalZ = FMath::Abs(DX * AxisZ.X + DY * AxisZ.Y + DZ * AxisZ.Z);
+
+		InBox[Index] = (uint8)((LocalX <= Extent.X + Radius) & (LocalY <= Extent.Y + Radius) & (LocalZ <= Extent.Z + Radius));
+	}
+
+	for (int32 Index = 0; Index < NumTargets; ++Index)
+	{
+		if (InBox[Index])
+		{
+			OutIndices.Add(Index);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// UAimAssistTargetSubsystem
+
+bool UAimAssistTargetSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UAimAssistTargetSubsystem::RegisterTarget(UObject* Target)
+{
+	TWeakInterfacePtr<IAimAssistTaget> TargetInterface(Target);
+	if (TargetInterface.IsValid())
+	{
+		RegisteredTargets.AddUnique(TargetInterface);
+	}
+}
+
+void UAimAssistTargetSubsystem::UnregisterTarget(UObject* Target)
+{
+	RegisteredTargets.RemoveAllSwap([Target](const TWeakInterfacePtr<IAimAssistTaget>& Entry)
+	{
+		return !Entry.IsValid() || (Entry.GetObject() == Target);
+	});
+}
+
+const FAimAssistTargetCache& UAimAssistTargetSubsystem::GetTargetCache()
+{
+	if (TargetCacheFrame != GFrameCounter)
+	{
+		TargetCacheFrame = GFrameCounter;
+		BuildTargetCache();
+	}
+
+	return TargetCache;
+}
+
+void UAimAssistTargetSubsystem::BuildTargetCache()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UAimAssistTargetSubsystem::BuildTargetCache);
+
+	TargetCache.Reset();
+
+	const ECollisionChannel AimAssistChannel = GetDefault<UShooterCoreRuntimeSettings>()->GetAimAssistCollisionChannel();
+
+	for (int32 TargetIndex = RegisteredTargets.Num() - 1; TargetIndex >= 0; --TargetIndex)
+	{
+		IAimAssistTaget* Target = RegisteredTargets[TargetIndex].Get();
+		if (Target == nullptr)
+		{
+			RegisteredTargets.RemoveAtSwap(TargetIndex);
+			continue;
+		}
+
+		FAimAssistTargetOptions Options;
+		Target->GatherTargetOptions(Options);
+
+		const UShapeComponent* ShapeComponent = Options.TargetShapeComponent.Get();
+		const AActor* OwningActor = (ShapeComponent != nullptr) ? ShapeComponent->GetOwner() : nullptr;
+		if (!Options.bIsActive || (OwningActor == nullptr))
+		{
+			continue;
+		}
+
+		// Targets used to be found by an overlap on the aim assist channel, so skip the ones that query would not have returned
+		const UPrimitiveComponent* QueryComponent = Cast<UPrimitiveComponent>(RegisteredTargets[TargetIndex].GetObject());
+		if (QueryComponent == nullptr)
+		{
+			QueryComponent = ShapeComponent;
+		}
+		if (!QueryComponent->IsQueryCollisionEnabled() || (QueryComponent->GetCollisionResponseToChannel(AimAssistChannel) == ECR_Ignore))
+		{
+			continue;
+		}
+
+		FTransform ShapeTransform;
+		FCollisionShape Shape;
+		FVector ShapeOrigin;
+		if (!GatherTargetInfo(OwningActor, ShapeComponent, ShapeTransform, Shape, ShapeOrigin))
+		{
+			continue;
+		}
+
+		int32 TeamId = INDEX_NONE;
+		bool bHasPlayerState = false;
+		bool bIsDeadOrDying = false;
+		const ACharacter* TargetCharacter = Cast<ACharacter>(OwningActor);
+		if (TargetCharacter != nullptr)
+		{
+			if (const ALyraPlayerState* PS = TargetCharacter->GetPlayerState<ALyraPlayerState>())
+			{
+				TeamId = PS->GetTeamId();
+				bHasPlayerState = true;
+			}
+
+			if (const ULyraHealthComponent* HealthComponent = ULyraHealthComponent::FindHealthComponent(TargetCharacter))
+			{
+				bIsDeadOrDying = HealthComponent->IsDeadOrDying();
+			}
+		}
+
+		const FVector Location = OwningActor->GetActorLocation();
+		const FBoxSphereBounds& Bounds = ShapeComponent->Bounds;
+
+		TargetCache.Options.Add(MoveTemp(Options));
+		TargetCache.OwningActors.Add(OwningActor);
+		TargetCache.ShapeTransforms.Add(ShapeTransform);
+		TargetCache.Shapes.Add(Shape);
+		TargetCache.ShapeOrigins.Add(ShapeOrigin);
+		TargetCache.BoundsOriginX.Add((float)Bounds.Origin.X);
+		TargetCache.BoundsOriginY.Add((float)Bounds.Origin.Y);
+		TargetCache.BoundsOriginZ.Add((float)Bounds.Origin.Z);
+		TargetCache.BoundsRadius.Add((float)Bounds.SphereRadius);
+		TargetCache.LocationX.Add((float)Location.X);
+		TargetCache.LocationY.Add((float)Location.Y);
+		TargetCache.LocationZ.Add((float)Location.Z);
+		TargetCache.TeamIds.Add(TeamId);
+		TargetCache.IsCharacter.Add(TargetCharacter != nullptr ? 1 : 0);
+		TargetCache.HasPlayerState.Add(bHasPlayerState ? 1 : 0);
+		TargetCache.IsDeadOrDying.Add(bIsDeadOrDying ? 1 : 0);
+	}
+}
+
+UAimAssistTargetSubsystem::FVisibilityQueryKey UAimAssistTargetSubsystem::MakeVisibilityQueryKey(const FVector& Start, const FVector& End, const UShapeComponent* Target, const FCollisionQueryParams& QueryParams, const FCollisionResponseParams& ResponseParams)
+{
+	FVisibilityQueryKey Key;
+	Key.Start = FIntVector(FMath::RoundToInt(Start.X), FMath::RoundToInt(Start.Y), FMath::RoundToInt(Start.Z));
+	Key.End = FIntVector(FMath::RoundToInt(End.X), FMath::RoundToInt(End.Y), FMath::RoundToInt(End.Z));
+	Key.Target = Target;
+
+	uint32 ParamsHash = GetTypeHash(QueryParams.bTraceComplex);
+	for (const uint32 ActorId : QueryParams.GetIgnoredActors())
+	{
+		ParamsHash = HashCombine(ParamsHash, ActorId);
+	}
+	for (const uint32 ComponentId : QueryParams.GetIgnoredComponents())
+	{
+		ParamsHash = HashCombine(ParamsHash, ComponentId);
+	}
+	const FCollisionResponseContainer& Responses = ResponseParams.CollisionResponse;
+	Key.ParamsHash = FCrc::MemCrc32(Responses.EnumArray, sizeof(Responses.EnumArray), ParamsHash);
+
+	return Key;
+}
+
+void UAimAssistTargetSubsystem::ResetVisibilityQueriesIfNewFrame()
+{
+	if (VisibilityQueryFrame != GFrameCounter)
+	{
+		VisibilityQueryFrame = GFrameCounter;
+		SyncVisibilityResults.Reset();
+		AsyncVisibilityTraces.Reset();
+	}
+}
+
+bool UAimAssistTargetSubsystem::TestVisibility(const FVector& Start, const FVector& End, const UShapeComponent* Target, const FCollisionQueryParams& QueryParams, const FCollisionResponseParams& ResponseParams)
+{
+	ResetVisibilityQueriesIfNewFrame();
+
+	const FVisibilityQueryKey Key = MakeVisibilityQueryKey(Start, End, Target, QueryParams, ResponseParams);
+	if (const bool* ExistingResult = SyncVisibilityResults.Find(Key))
+	{
+		return *ExistingResult;
+	}
+
+	const bool bIsVisible = !GetWorld()->LineTraceTestByChannel(Start, End, ECC_Visibility, QueryParams, ResponseParams);
+	SyncVisibilityResults.Add(Key, bIsVisible);
+
+	return bIsVisible;
+}
+
+FTraceHandle UAimAssistTargetSubsystem::RequestAsyncVisibilityTrace(const FVector& Start, const FVector& End, const UShapeComponent* Target, const FCollisionQueryParams& QueryParams, const FCollisionResponseParams& ResponseParams)
+{
+	ResetVisibilityQueriesIfNewFrame();
+
+	const FVisibilityQueryKey Key = MakeVisibilityQueryKey(Start, End, Target, QueryParams, ResponseParams);
+	if (const FTraceHandle* ExistingHandle = AsyncVisibilityTraces.Find(Key))
+	{
+		return *ExistingHandle;
+	}
+
+	const FTraceHandle Handle = GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Test, Start, End, ECC_Visibility, QueryParams, ResponseParams);
+	AsyncVisibilityTraces.Add(Key, Handle);
+
+	return Handle;
+}
@@ -19,6 +19,11 @@ class SHOOTERCORERUNTIME_API UAimAssistTargetComponent : public UCapsuleComponen
 	GENERATED_BODY()
 
 public:
+
+	//~UActorComponent interface
+	virtual void OnRegister() override;
+	virtual void OnUnregister() override;
+	//~End of UActorComponent interface
 	
 	//~ Begin IAimAssistTaget interface
 	virtual void GatherTargetOptions(OUT FAimAssistTargetOptions& TargetData) override;
@@ -13,14 +13,14 @@ class UObject;
 struct FAimAssistFilter;
 struct FAimAssistOwnerViewData;
 struct FAimAssistSettings;
-struct FAimAssistTargetOptions;
+struct FAimAssistTargetCache;
 struct FCollisionQueryParams;
 struct FLyraAimAssistTarget;
 
 /**
  * The Aim Assist Target Manager Component is used to gather all aim assist targets that are within
- * a given player's view. Targets must implement the IAimAssistTargetInterface and be on the
- * collision channel that is set in the ShooterCoreRuntimeSettings. 
+ * a given player's view. Targets must implement the IAimAssistTargetInterface and be registered with
+ * the UAimAssistTargetSubsystem (UAimAssistTargetComponent does this automatically).
  */
 UCLASS(Blueprintable)
 class SHOOTERCORERUNTIME_API UAimAssistTargetManagerComponent : public UGameStateComponent
@@ -44,7 +44,7 @@ protected:
 	 * Returns true if the given target passes the filter based on the current player owner data.
 	 * False if the given target should be excluded from aim assist calculations 
 	 */
-	bool DoesTargetPassFilter(const FAimAssistOwnerViewData& OwnerData, const FAimAssistFilter& Filter, const FAimAssistTargetOptions& Target, const float AcceptableRange) const;
+	bool DoesTargetPassFilter(const FAimAssistOwnerViewData& OwnerData, const FAimAssistFilter& Filter, const FAimAssistTargetCache& TargetCache, const int32 TargetIndex, const float AcceptableRange) const;
 
 	/** Determine if the given target is visible based on our current view data. */
 	void DetermineTargetVisibility(FLyraAimAssistTarget& Target, const FAimAssistSettings& Settings, const FAimAssistFilter& Filter, const FAimAssistOwnerViewData& OwnerData);
@@ -0,0 +1,133 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CollisionShape.h"
+#include "Input/IAimAssistTargetInterface.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "UObject/WeakInterfacePtr.h"
+#include "WorldCollision.h"
+
+#include "AimAssistTargetSubsystem.generated.h"
+
+class AActor;
+class UObject;
+class UShapeComponent;
+
+/**
+ * A flat snapshot of every registered aim assist target, built at most once per frame and shared by
+ * every aim assist requester. The data used to cull targets is kept in separate arrays so the
+ * per-requester pass is a straight loop over packed floats.
+ */
+struct SHOOTERCORERUNTIME_API FAimAssistTargetCache
+{
+	void Reset();
+
+	int32 Num() const { return Options.Num(); }
+
+	/** Adds the indices of all targets whose bounds overlap the oriented box to OutIndices */
+	void GatherTargetsInBox(const FVector& BoxCenter, const FQuat& BoxRotation, const FVector& BoxExtent, TArray<int32>& OutIndices) const;
+
+	// Per-target data gathered from the IAimAssistTaget interface
+	TArray<FAimAssistTargetOptions> Options;
+	TArray<const AActor*> OwningActors;
+	TArray<FTransform> ShapeTransforms;
+	TArray<FCollisionShape> Shapes;
+	TArray<FVector> ShapeOrigins;
+
+	// Hot data for culling, the bounds of the target shape
+	TArray<float> BoundsOriginX;
+	TArray<float> BoundsOriginY;
+	TArray<float> BoundsOriginZ;
+	TArray<float> BoundsRadius;
+
+	// Location of the owning actor, for the range check
+	TArray<float> LocationX;
+	TArray<float> LocationY;
+	TArray<float> LocationZ;
+
+	// Team of the owning character's player state (only meaningful if HasPlayerState is set)
+	TArray<int32> TeamIds;
+
+	// Non-zero if the owning actor is a character
+	TArray<uint8> IsCharacter;
+
+	// Non-zero if the owning character has a Lyra player state
+	TArray<uint8> HasPlayerState;
+
+	// Non-zero if the owning character is dead or dying
+	TArray<uint8> IsDeadOrDying;
+};
+
+/**
+ * UAimAssistTargetSubsystem
+ *
+ * Keeps track of all aim assist targets in the world and shares per-frame work between everyone that
+ * queries them (multiple local players, and multiple aim assist modifiers per player).
+ */
+UCLASS()
+class SHOOTERCORERUNTIME_API UAimAssistTargetSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Adds an object implementing IAimAssistTaget to the set of targets considered by aim assist */
+	void RegisterTarget(UObject* Target);
+
+	/** Removes a previously registered target */
+	void UnregisterTarget(UObject* Target);
+
+	/** Returns the target cache for the current frame, building it if this is the first request this frame */
+	const FAimAssistTargetCache& GetTargetCache();
+
+	/**
+	 * Returns true if the line is unobstructed. Requests for the same line, target and collision params within a frame share a single trace.
+	 */
+	bool TestVisibility(const FVector& Start, const FVector& End, const UShapeComponent* Target, const FCollisionQueryParams& QueryParams, const FCollisionResponseParams& ResponseParams);
+
+	/**
+	 * Starts an async visibility trace to be read next frame. Requests for the same line, target and collision params within a frame share a single trace.
+	 */
+	FTraceHandle RequestAsyncVisibilityTrace(const FVector& Start, const FVector& End, const UShapeComponent* Target, const FCollisionQueryParams& QueryParams, const FCollisionResponseParams& ResponseParams);
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	void BuildTargetCache();
+	void ResetVisibilityQueriesIfNewFrame();
+
+	struct FVisibilityQueryKey
+	{
+		FIntVector Start;
+		FIntVector End;
+		TObjectKey<UShapeComponent> Target;
+
+		// Hash of the ignored actors and components and the channel responses, traces with different params can't share a result
+		uint32 ParamsHash = 0;
+
+		bool operator==(const FVisibilityQueryKey& Other) const
+		{
+			return (Start == Other.Start) && (End == Other.End) && (Target == Other.Target) && (ParamsHash == Other.ParamsHash);
+		}
+
+		friend uint32 GetTypeHash(const FVisibilityQueryKey& Key)
+		{
+			return HashCombine(HashCombine(HashCombine(GetTypeHash(Key.Start), GetTypeHash(Key.End)), GetTypeHash(Key.Target)), Key.ParamsHash);
+		}
+	};
+
+	static FVisibilityQueryKey MakeVisibilityQueryKey(const FVector& Start, const FVector& End, const UShapeComponent* Target, const FCollisionQueryParams& QueryParams, const FCollisionResponseParams& ResponseParams);
+
+private:
+	TArray<TWeakInterfacePtr<IAimAssistTaget>> RegisteredTargets;
+
+	FAimAssistTargetCache TargetCache;
+	uint64 TargetCacheFrame = MAX_uint64;
+
+	TMap<FVisibilityQueryKey, bool> SyncVisibilityResults;
+	TMap<FVisibilityQueryKey, FTraceHandle> AsyncVisibilityTraces;
+	uint64 VisibilityQueryFrame = MAX_uint64;
+};
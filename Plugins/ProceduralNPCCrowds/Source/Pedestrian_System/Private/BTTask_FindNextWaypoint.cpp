@@ -2,88 +2,144 @@
 
 #include "BTTask_FindNextWaypoint.h"
 #include "BehaviorTree/BlackboardComponent.h"
-#include "Kismet/GameplayStatics.h"
-#include "Kismet/KismetSystemLibrary.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
 #include "AIController.h"
 #include "Engine/EngineTypes.h"
-#include "Kismet/KismetArrayLibrary.h"
 #include "BehaviorTree/BTNode.h"
-#include "AIController.h"
-#include "Kismet/KismetMathLibrary.h"
-#include "NavigationSystem.h"
+#include "PedestrianWaypointGraph.h"
+#include "WaypointQuerySubsystem.h"
 
 
 
 
-EBTNodeResult::Type UBTTask_FindNextWaypoint::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+UBTTask_FindNextWaypoint::UBTTask_FindNextWaypoint()
 {
-	//Start Fvector from "Controlled Pawn" in blueprints
-	const FVector Start = OwnerComp.GetAIOwner()->GetPawn()->GetActorLocation() + OwnerComp.GetAIOwner()->GetPawn()->GetActorForwardVector();
-
-	// End FVector From "Controlled Pawn" in blueprints with parameters for tracedistance and start
-	const FVector End = OwnerComp.GetAIOwner()->GetPawn()->GetActorForwardVector() * TraceDistance + Start;
+	NodeName = TEXT("Find Next Waypoint");
+}
 
+uint16 UBTTask_FindNextWaypoint::GetInstanceMemorySize() const
+{
+	return sizeof(FBTFindNextWaypointMemory);
+}
 
-	//holds no values, just used for sphere trace syntax
-	TArray<AActor*> ActorsToIgnore;
+void UBTTask_FindNextWaypoint::InitializeMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryInit::Type InitType) const
+{
+	FBTFindNextWaypointMemory* MyMemory = reinterpret_cast<FBTFindNextWaypointMemory*>(NodeMemory);
+	MyMemory->RequestId = 0;
+	MyMemory->CurrentNode = INDEX_NONE;
+	MyMemory->PreviousNode = INDEX_NONE;
+}
 
-	//Array of the HitResults from the objects hit
-	TArray<FHitResult> HitArray;
+bool UBTTask_FindNextWaypoint::ChooseNextGraphWaypoint(UBehaviorTreeComponent& OwnerComp, FBTFindNextWaypointMemory& MyMemory, const APawn& Pawn) const
+{
+	if (WaypointGraph == nullptr || WaypointGraph->GetNumNodes() == 0 || !WaypointGraph->IsBuiltForWorld(GetWorld()))
+	{
+		return false;
+	}
 
-	//Setting the object channel to use
-	TArray < TEnumAsByte < EObjectTypeQuery > > nameofobjects;
-	nameofobjects.Add(ObjectToUse);
+	UWaypointQuerySubsystem* WaypointQueries = UWorld::GetSubsystem<UWaypointQuerySubsystem>(GetWorld());
+	UBlackboardComponent* Blackboard = OwnerComp.GetBlackboardComponent();
+	if (WaypointQueries == nullptr || Blackboard == nullptr)
+	{
+		return false;
+	}
 
-	
+	//Snap to the graph the first time, and again if the pedestrian was pushed (or teleported) away from its last waypoint
+	const FVector PawnLocation = Pawn.GetActorLocation();
+	const bool bLostNode = MyMemory.CurrentNode < 0 || MyMemory.CurrentNode >= WaypointGraph->GetNumNodes()
+		|| FVector::DistSquared(PawnLocation, WaypointGraph->GetNodeLocation(MyMemory.CurrentNode)) > FMath::Square(2.0f * WaypointGraph->MaxEdgeDistance);
+	if (bLostNode)
+	{
+		MyMemory.CurrentNode = WaypointGraph->FindClosestNode(PawnLocation);
+		MyMemory.PreviousNode = INDEX_NONE;
+	}
 
-	// Sphere Trace for multi objects with branch check for hit result
-	const bool Hit = UKismetSystemLibrary::SphereTraceMultiForObjects(GetWorld(), Start, End, SphereRadius, nameofobjects, false, ActorsToIgnore, DebugDrawTypes, HitArray, true, FLinearColor::Red, FLinearColor::Green, 1.0f);
+	const FRandomStream& Stream = WaypointQueries->GetRandomStream(&Pawn);
+	const int32 NextNode = WaypointGraph->ChooseNextNode(MyMemory.CurrentNode, MyMemory.PreviousNode, Stream);
+	if (NextNode == INDEX_NONE)
 	{
-		if (Hit)
-		{
-			// Setting the blackboard key to be the vector of the impact point vector.
-			// NOTE: HitArray is getting a random index from the length of the break hit result which converts array to single.
-			OwnerComp.GetBlackboardComponent()->SetValueAsVector(NextWaypointVector.SelectedKeyName, HitArray[rand() % HitArray.Num()].ImpactPoint);
-			
-			
-			return EBTNodeResult::Succeeded;
-		}
-		else
-		{
+		return false;
+	}
 
-			//Start wandering towards nearest PathPoint if did not hit anything with SphereTrace
-			const FVector StartWander = OwnerComp.GetAIOwner()->GetPawn()->GetActorLocation();
-			float radius = 1000;
-			FVector ResultLocation;
-			ANavigationData* NavData = (ANavigationData*)0;
-			FSharedConstNavQueryFilter QueryFilter;
-			TSubclassOf<UNavigationQueryFilter> FilterClass;
+	MyMemory.PreviousNode = MyMemory.CurrentNode;
+	MyMemory.CurrentNode = NextNode;
+
+	Blackboard->SetValueAsVector(NextWaypointVector.SelectedKeyName, WaypointGraph->GetNodeLocation(NextNode));
+	return true;
+}
 
-			//Get Random Reachable point in navigable radius function
-			UNavigationSystemV1::K2_GetRandomLocationInNavigableRadius(GetWorld(), StartWander, ResultLocation, radius, NavData, FilterClass);
+EBTNodeResult::Type UBTTask_FindNextWaypoint::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	FBTFindNextWaypointMemory* MyMemory = reinterpret_cast<FBTFindNextWaypointMemory*>(NodeMemory);
+	MyMemory->RequestId = 0;
 
-			//Set BlackBoard Value for where to go
-			OwnerComp.GetBlackboardComponent()->SetValueAsVector(FindWayPoint.SelectedKeyName, ResultLocation);
+	const AAIController* AIOwner = OwnerComp.GetAIOwner();
+	APawn* Pawn = (AIOwner != nullptr) ? AIOwner->GetPawn() : nullptr;
+	UWaypointQuerySubsystem* WaypointQueries = UWorld::GetSubsystem<UWaypointQuerySubsystem>(GetWorld());
+	if (Pawn == nullptr || WaypointQueries == nullptr)
+	{
+		return EBTNodeResult::Failed;
+	}
 
-		
-			return EBTNodeResult::Succeeded;
-		}
-			
-		
-				return EBTNodeResult::Succeeded;
-			
+	//Walk the baked graph if there is one, no scene queries needed
+	if (ChooseNextGraphWaypoint(OwnerComp, *MyMemory, *Pawn))
+	{
+		return EBTNodeResult::Succeeded;
 	}
 
-		
-	
+	//Start Fvector from "Controlled Pawn" in blueprints
+	const FVector Forward = Pawn->GetActorForwardVector();
+	const FVector Start = Pawn->GetActorLocation() + Forward;
+
+	//Queue the sphere sweep for waypoints, it is issued with every other pedestrian's request this frame and read back next frame
+	FWaypointQueryRequest Request;
+	Request.OwnerComp = &OwnerComp;
+	Request.Task = this;
+	Request.Pawn = Pawn;
+	Request.Start = Start;
+	Request.End = Forward * TraceDistance + Start;
+	Request.SphereRadius = SphereRadius;
+	Request.WanderRadius = WanderRadius;
+	Request.ObjectToUse = ObjectToUse;
+	Request.DebugDrawType = DebugDrawTypes;
+	Request.HitKey = NextWaypointVector.SelectedKeyName;
+	Request.WanderKey = FindWayPoint.SelectedKeyName;
+
+	MyMemory->RequestId = WaypointQueries->RequestWaypoint(Request);
+
+	return EBTNodeResult::InProgress;
 }
 
+EBTNodeResult::Type UBTTask_FindNextWaypoint::AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	FBTFindNextWaypointMemory* MyMemory = reinterpret_cast<FBTFindNextWaypointMemory*>(NodeMemory);
+	if (MyMemory->RequestId != 0)
+	{
+		if (UWaypointQuerySubsystem* WaypointQueries = UWorld::GetSubsystem<UWaypointQuerySubsystem>(GetWorld()))
+		{
+			WaypointQueries->CancelRequest(MyMemory->RequestId);
+		}
+		MyMemory->RequestId = 0;
+	}
 
+	return EBTNodeResult::Aborted;
+}
 
+void UBTTask_FindNextWaypoint::OnWaypointQueryFinished(UBehaviorTreeComponent& OwnerComp, uint32 RequestId, FName Key, const FVector& Location) const
+{
+	//Ignore results for a request that was replaced or cancelled after the result was gathered
+	FBTFindNextWaypointMemory* MyMemory = reinterpret_cast<FBTFindNextWaypointMemory*>(OwnerComp.GetNodeMemory(const_cast<UBTTask_FindNextWaypoint*>(this), OwnerComp.FindInstanceContainingNode(this)));
+	if (MyMemory == nullptr || MyMemory->RequestId != RequestId)
+	{
+		return;
+	}
+	MyMemory->RequestId = 0;
 
-	
-
-
-
-		
+	//Set the blackboard key for where to go (the hit waypoint, or a random navigable point if nothing was hit)
+	if (UBlackboardComponent* Blackboard = OwnerComp.GetBlackboardComponent())
+	{
+		Blackboard->SetValueAsVector(Key, Location);
+	}
 
+	FinishLatentTask(OwnerComp, EBTNodeResult::Succeeded);
+}
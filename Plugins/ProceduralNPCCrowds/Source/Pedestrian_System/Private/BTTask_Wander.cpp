@@ -9,11 +9,29 @@
 #include "Engine/EngineTypes.h"
 #include "BehaviorTree/BTNode.h"
 #include "NavigationSystem.h"
+#include "PedestrianWaypointGraph.h"
+#include "WaypointQuerySubsystem.h"
 
 
 EBTNodeResult::Type UBTTask_Wander::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) {
 
-	const FVector Start = OwnerComp.GetAIOwner()->GetPawn()->GetActorLocation();
+	APawn* Pawn = OwnerComp.GetAIOwner()->GetPawn();
+	const FVector Start = Pawn->GetActorLocation();
+
+	//Hop around the baked graph instead of querying the navmesh
+	UWaypointQuerySubsystem* WaypointQueries = UWorld::GetSubsystem<UWaypointQuerySubsystem>(GetWorld());
+	if (WaypointGraph != nullptr && WaypointQueries != nullptr && WaypointGraph->GetNumNodes() > 0 && WaypointGraph->IsBuiltForWorld(GetWorld()))
+	{
+		const int32 StartNode = WaypointGraph->FindClosestNode(Start);
+		const int32 MaxHops = FMath::Max(FMath::RoundToInt(WanderRadius / WaypointGraph->MaxEdgeDistance), 1);
+		const int32 Node = WaypointGraph->ChooseRandomNearbyNode(StartNode, MaxHops, WaypointQueries->GetRandomStream(Pawn));
+		if (Node != INDEX_NONE)
+		{
+			OwnerComp.GetBlackboardComponent()->SetValueAsVector(RandomLocation.SelectedKeyName, WaypointGraph->GetNodeLocation(Node));
+			return EBTNodeResult::Succeeded;
+		}
+	}
+
 	FVector ResultLocation;
 	ANavigationData* NavData = (ANavigationData*)0;
 	FSharedConstNavQueryFilter QueryFilter;
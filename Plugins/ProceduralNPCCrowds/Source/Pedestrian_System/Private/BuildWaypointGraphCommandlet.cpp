@@ -0,0 +1,93 @@
+//  Copyright (c) 2022 KomodoBit Games. All rights reserved.
+
+
+#include "BuildWaypointGraphCommandlet.h"
+#include "Engine/World.h"
+#include "Misc/PackageName.h"
+#include "PedestrianWaypointGraph.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(BuildWaypointGraphCommandlet)
+
+DEFINE_LOG_CATEGORY_STATIC(LogBuildWaypointGraph, Log, All);
+
+UBuildWaypointGraphCommandlet::UBuildWaypointGraphCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UBuildWaypointGraphCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	FString MapName;
+	FString GraphName;
+	if (!FParse::Value(*Params, TEXT("Map="), MapName) || !FParse::Value(*Params, TEXT("Graph="), GraphName))
+	{
+		UE_LOG(LogBuildWaypointGraph, Error, TEXT("Usage: -run=BuildWaypointGraph -Map=<MapPackage> -Graph=<WaypointGraphAsset>"));
+		return 1;
+	}
+
+	UPedestrianWaypointGraph* Graph = LoadObject<UPedestrianWaypointGraph>(nullptr, *GraphName);
+	if (Graph == nullptr)
+	{
+		UE_LOG(LogBuildWaypointGraph, Error, TEXT("Could not load waypoint graph %s"), *GraphName);
+		return 1;
+	}
+
+	UPackage* MapPackage = LoadPackage(nullptr, *MapName, LOAD_None);
+	UWorld* World = (MapPackage != nullptr) ? UWorld::FindWorldInPackage(MapPackage) : nullptr;
+	if (World == nullptr)
+	{
+		UE_LOG(LogBuildWaypointGraph, Error, TEXT("Could not load map %s"), *MapName);
+		return 1;
+	}
+
+	// Register the components so the line of sight traces have something to hit
+	World->AddToRoot();
+	if (!World->bIsWorldInitialized)
+	{
+		World->InitWorld(UWorld::InitializationValues()
+			.RequiresHitProxies(false)
+			.ShouldSimulatePhysics(false)
+			.EnableTraceCollision(true)
+			.CreateNavigation(false)
+			.CreateAISystem(false)
+			.AllowAudioPlayback(false)
+			.CreatePhysicsScene(true));
+	}
+	World->UpdateWorldComponents(/*bRerunConstructionScripts=*/ true, /*bCurrentLevelOnly=*/ false);
+	World->FlushLevelStreaming(EFlushLevelStreamingType::Full);
+
+	const bool bBuilt = Graph->BuildFromWorld(World);
+
+	World->RemoveFromRoot();
+	World->DestroyWorld(/*bInformEngineOfWorld=*/ false);
+
+	if (!bBuilt)
+	{
+		UE_LOG(LogBuildWaypointGraph, Error, TEXT("No waypoints found in %s, check the build settings on %s"), *MapName, *GraphName);
+		return 1;
+	}
+
+	UPackage* GraphPackage = Graph->GetPackage();
+	const FString Filename = FPackageName::LongPackageNameToFilename(GraphPackage->GetName(), FPackageName::GetAssetPackageExtension());
+
+	FSavePackageArgs SaveArgs;
+	SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+	if (!UPackage::SavePackage(GraphPackage, Graph, *Filename, SaveArgs))
+	{
+		UE_LOG(LogBuildWaypointGraph, Error, TEXT("Failed to save %s"), *Filename);
+		return 1;
+	}
+
+	UE_LOG(LogBuildWaypointGraph, Display, TEXT("Saved waypoint graph %s"), *Filename);
+	return 0;
+#else
+	UE_LOG(LogBuildWaypointGraph, Error, TEXT("BuildWaypointGraph can only be run from an editor build"));
+	return 1;
+#endif
+}
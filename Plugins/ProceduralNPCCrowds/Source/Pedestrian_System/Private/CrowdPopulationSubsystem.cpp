@@ -0,0 +1,582 @@
+//  Copyright (c) 2022 KomodoBit Games. All rights reserved.
+
+
+#include "CrowdPopulationSubsystem.h"
+#include "AIController.h"
+#include "BrainComponent.h"
+#include "CrowdSpawner.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PawnMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/KismetMathLibrary.h"
+#include "PedestrianDestroyer.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(CrowdPopulationSubsystem)
+
+DEFINE_LOG_CATEGORY_STATIC(LogCrowdPopulation, Log, All);
+
+namespace CrowdPopulationCVars
+{
+	static bool bEnable = true;
+	static FAutoConsoleVariableRef CVarEnable(
+		TEXT("CrowdPopulation.Enable"),
+		bEnable,
+		TEXT("Should crowd spawners and pedestrians be managed by the pooled crowd population subsystem? If false, they fall back to per-component distance checks against player 0."),
+		ECVF_Default);
+
+	static int32 SpawnsPerFrame = 4;
+	static FAutoConsoleVariableRef CVarSpawnsPerFrame(
+		TEXT("CrowdPopulation.SpawnsPerFrame"),
+		SpawnsPerFrame,
+		TEXT("The maximum number of pedestrians spawned or taken from the pool each frame"),
+		ECVF_Default);
+
+	static int32 PedestrianChecksPerFrame = 128;
+	static FAutoConsoleVariableRef CVarPedestrianChecksPerFrame(
+		TEXT("CrowdPopulation.PedestrianChecksPerFrame"),
+		PedestrianChecksPerFrame,
+		TEXT("The number of pedestrians checked against the viewers each frame (the rest wait their turn)"),
+		ECVF_Default);
+
+	static int32 MaxPooledPerClass = 256;
+	static FAutoConsoleVariableRef CVarMaxPooledPerClass(
+		TEXT("CrowdPopulation.MaxPooledPerClass"),
+		MaxPooledPerClass,
+		TEXT("The maximum number of inactive pedestrians kept per class, pedestrians released beyond this are destroyed"),
+		ECVF_Default);
+
+	static int32 MaxActivePedestrians = 0;
+	static FAutoConsoleVariableRef CVarMaxActivePedestrians(
+		TEXT("CrowdPopulation.MaxActivePedestrians"),
+		MaxActivePedestrians,
+		TEXT("If above zero, spawns are held back while this many pedestrians are active"),
+		ECVF_Default);
+
+	static float GridCellSize = 5000.0f;
+	static FAutoConsoleVariableRef CVarGridCellSize(
+		TEXT("CrowdPopulation.GridCellSize"),
+		GridCellSize,
+		TEXT("The size (in uu) of the grid cells used to find the spawners near the viewers"),
+		ECVF_Default);
+
+	// Past this many cells per viewer, it's cheaper to just visit every spawner
+	static constexpr int32 MaxViewerCells = 1024;
+}
+
+static FAutoConsoleCommandWithWorld GCrowdPopulationStatsCmd(
+	TEXT("CrowdPopulation.Stats"),
+	TEXT("Logs the crowd population pool and spawn counters"),
+	FConsoleCommandWithWorldDelegate::CreateStatic([](UWorld* World)
+	{
+		if (const UCrowdPopulationSubsystem* Population = UWorld::GetSubsystem<UCrowdPopulationSubsystem>(World))
+		{
+			Population->DumpStats();
+		}
+	}));
+
+
+bool UCrowdPopulationSubsystem::IsEnabled()
+{
+	return CrowdPopulationCVars::bEnable;
+}
+
+bool UCrowdPopulationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UCrowdPopulationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCrowdPopulationSubsystem, STATGROUP_Tickables);
+}
+
+void UCrowdPopulationSubsystem::Deinitialize()
+{
+	Spawners.Reset();
+	SpawnerIndices.Reset();
+	SpawnerGrid.Reset();
+	TriggeredSpawners.Reset();
+	Pedestrians.Reset();
+	PedestrianIndices.Reset();
+	PendingSpawns.Reset();
+	Pools.Reset();
+
+	Super::Deinitialize();
+}
+
+
+FIntPoint UCrowdPopulationSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt32(Location.X / GridCellSize), FMath::FloorToInt32(Location.Y / GridCellSize));
+}
+
+void UCrowdPopulationSubsystem::RegisterSpawner(UCrowdSpawner* Spawner, const FCrowdSpawnerSettings& Settings)
+{
+	if (Spawner == nullptr || Spawner->GetOwner() == nullptr)
+	{
+		return;
+	}
+
+	int32& Index = SpawnerIndices.FindOrAdd(Spawner, INDEX_NONE);
+	if (Index == INDEX_NONE)
+	{
+		Index = Spawners.AddDefaulted();
+		Spawners[Index].Spawner = Spawner;
+		bSpawnerGridDirty = true;
+	}
+
+	FSpawnerEntry& Entry = Spawners[Index];
+	Entry.Settings = Settings;
+
+	const FVector Location = Spawner->GetOwner()->GetActorLocation();
+	if (!Entry.Location.Equals(Location))
+	{
+		Entry.Location = Location;
+		bSpawnerGridDirty |= (GridCellSize <= 0.0f) || (GetCell(Location) != Entry.Cell);
+	}
+
+	MaxSpawnDistance = FMath::Max(MaxSpawnDistance, Settings.DistanceToSpawn);
+}
+
+void UCrowdPopulationSubsystem::UnregisterSpawner(UCrowdSpawner* Spawner)
+{
+	int32 Index = INDEX_NONE;
+	if (SpawnerIndices.RemoveAndCopyValue(Spawner, Index))
+	{
+		PendingSpawns.RemoveAll([Key = TObjectKey<UCrowdSpawner>(Spawner)](const FPendingSpawn& Pending) { return Pending.Spawner == Key; });
+
+		Spawners.RemoveAtSwap(Index);
+		if (Spawners.IsValidIndex(Index))
+		{
+			SpawnerIndices.Add(Spawners[Index].Spawner, Index);
+		}
+
+		bSpawnerGridDirty = true;
+	}
+}
+
+void UCrowdPopulationSubsystem::RebuildSpawnerGrid()
+{
+	GridCellSize = FMath::Max(CrowdPopulationCVars::GridCellSize, 100.0f);
+
+	SpawnerGrid.Reset();
+	TriggeredSpawners.Reset();
+	MaxSpawnDistance = 0.0f;
+
+	for (int32 Index = 0; Index < Spawners.Num(); ++Index)
+	{
+		FSpawnerEntry& Entry = Spawners[Index];
+		Entry.Cell = GetCell(Entry.Location);
+		SpawnerGrid.FindOrAdd(Entry.Cell).Add(Index);
+
+		if (Entry.bTriggered)
+		{
+			TriggeredSpawners.Add(Index);
+		}
+
+		MaxSpawnDistance = FMath::Max(MaxSpawnDistance, Entry.Settings.DistanceToSpawn);
+	}
+
+	bSpawnerGridDirty = false;
+}
+
+
+void UCrowdPopulationSubsystem::RegisterPedestrian(AActor* Pedestrian, float DistanceToRelease)
+{
+	if (Pedestrian == nullptr)
+	{
+		return;
+	}
+
+	int32& Index = PedestrianIndices.FindOrAdd(Pedestrian, INDEX_NONE);
+	if (Index == INDEX_NONE)
+	{
+		Index = Pedestrians.AddDefaulted();
+		Pedestrians[Index].Actor = Pedestrian;
+		Pedestrians[Index].Key = Pedestrian;
+	}
+
+	Pedestrians[Index].DistanceToRelease = DistanceToRelease;
+}
+
+void UCrowdPopulationSubsystem::UnregisterPedestrian(AActor* Pedestrian)
+{
+	if (const int32* Index = PedestrianIndices.Find(Pedestrian))
+	{
+		RemovePedestrianAt(*Index);
+	}
+}
+
+void UCrowdPopulationSubsystem::RemovePedestrianAt(int32 Index)
+{
+	PedestrianIndices.Remove(Pedestrians[Index].Key);
+
+	Pedestrians.RemoveAtSwap(Index);
+	if (Pedestrians.IsValidIndex(Index))
+	{
+		PedestrianIndices.Add(Pedestrians[Index].Key, Index);
+	}
+}
+
+
+void UCrowdPopulationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCrowdPopulationSubsystem::Tick);
+
+	if (!IsEnabled())
+	{
+		if ((Spawners.Num() > 0) || (Pedestrians.Num() > 0))
+		{
+			ReturnToComponentTicks();
+		}
+		return;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	if (bSpawnerGridDirty || (GridCellSize != FMath::Max(CrowdPopulationCVars::GridCellSize, 100.0f)))
+	{
+		RebuildSpawnerGrid();
+	}
+
+	GatherViewers();
+
+	// Like the per-component checks, nothing changes while there is nobody to look at the crowd
+	if (ViewerLocations.Num() > 0)
+	{
+		UpdateSpawners();
+		UpdatePedestrians();
+	}
+
+	ProcessPendingSpawns();
+
+	LastTickTimeMS = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+}
+
+void UCrowdPopulationSubsystem::ReturnToComponentTicks()
+{
+	for (const FSpawnerEntry& Entry : Spawners)
+	{
+		if (UCrowdSpawner* Spawner = Entry.Spawner.ResolveObjectPtr())
+		{
+			Spawner->SetComponentTickEnabled(true);
+		}
+	}
+
+	for (const FPedestrianEntry& Entry : Pedestrians)
+	{
+		if (const AActor* Pedestrian = Entry.Actor.Get())
+		{
+			if (UPedestrianDestroyer* Destroyer = Pedestrian->FindComponentByClass<UPedestrianDestroyer>())
+			{
+				Destroyer->SetComponentTickEnabled(true);
+			}
+		}
+	}
+
+	Spawners.Reset();
+	SpawnerIndices.Reset();
+	SpawnerGrid.Reset();
+	TriggeredSpawners.Reset();
+	Pedestrians.Reset();
+	PedestrianIndices.Reset();
+	PendingSpawns.Reset();
+	NextPedestrianToCheck = 0;
+	MaxSpawnDistance = 0.0f;
+}
+
+void UCrowdPopulationSubsystem::GatherViewers()
+{
+	ViewerLocations.Reset();
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APlayerController* PlayerController = It->Get())
+		{
+			if (const APawn* Pawn = PlayerController->GetPawn())
+			{
+				ViewerLocations.Add(Pawn->GetActorLocation());
+			}
+		}
+	}
+}
+
+bool UCrowdPopulationSubsystem::IsAnyViewerWithin(const FVector& Location, float Distance) const
+{
+	const double DistanceSquared = FMath::Square((double)Distance);
+	for (const FVector& ViewerLocation : ViewerLocations)
+	{
+		if (FVector::DistSquared(Location, ViewerLocation) <= DistanceSquared)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void UCrowdPopulationSubsystem::BuildViewerCells(float Radius)
+{
+	ViewerCells.Reset();
+
+	const int32 CellRadius = FMath::CeilToInt32(Radius / GridCellSize);
+	const int32 CellsPerViewer = FMath::Square(2 * CellRadius + 1);
+	if (CellsPerViewer > CrowdPopulationCVars::MaxViewerCells)
+	{
+		// Cover every occupied cell instead
+		for (const auto& Pair : SpawnerGrid)
+		{
+			ViewerCells.Add(Pair.Key);
+		}
+		return;
+	}
+
+	for (const FVector& ViewerLocation : ViewerLocations)
+	{
+		const FIntPoint Center = GetCell(ViewerLocation);
+		for (int32 Y = Center.Y - CellRadius; Y <= Center.Y + CellRadius; ++Y)
+		{
+			for (int32 X = Center.X - CellRadius; X <= Center.X + CellRadius; ++X)
+			{
+				ViewerCells.Add(FIntPoint(X, Y));
+			}
+		}
+	}
+}
+
+void UCrowdPopulationSubsystem::UpdateSpawners()
+{
+	// Spawners that already spawned their crowd wait for every viewer to leave before they can spawn again
+	for (int32 TriggeredIndex = TriggeredSpawners.Num() - 1; TriggeredIndex >= 0; --TriggeredIndex)
+	{
+		FSpawnerEntry& Entry = Spawners[TriggeredSpawners[TriggeredIndex]];
+		if (!IsAnyViewerWithin(Entry.Location, Entry.Settings.DistanceToSpawn))
+		{
+			Entry.bTriggered = false;
+			TriggeredSpawners.RemoveAtSwap(TriggeredIndex);
+
+			// Anything still queued would be released as soon as it spawned
+			PendingSpawns.RemoveAll([&Entry](const FPendingSpawn& Pending) { return Pending.Spawner == Entry.Spawner; });
+		}
+	}
+
+	// Only the spawners in cells near a viewer can be in range
+	BuildViewerCells(MaxSpawnDistance);
+
+	for (const FIntPoint& Cell : ViewerCells)
+	{
+		if (const TArray<int32>* CellSpawners = SpawnerGrid.Find(Cell))
+		{
+			for (const int32 SpawnerIndex : *CellSpawners)
+			{
+				FSpawnerEntry& Entry = Spawners[SpawnerIndex];
+				if (!Entry.bTriggered && IsAnyViewerWithin(Entry.Location, Entry.Settings.DistanceToSpawn))
+				{
+					TriggerSpawner(Entry);
+					TriggeredSpawners.Add(SpawnerIndex);
+				}
+			}
+		}
+	}
+}
+
+void UCrowdPopulationSubsystem::TriggerSpawner(FSpawnerEntry& Entry)
+{
+	Entry.bTriggered = true;
+
+	const FCrowdSpawnerSettings& Settings = Entry.Settings;
+	if (Settings.NPCToSpawn == nullptr)
+	{
+		return;
+	}
+
+	// Same count and placement as the original spawn loop, but queued so the spawns are spread over several frames
+	const FVector Origin = Entry.Location + Settings.CharacterHeight;
+	for (int32 i = 0; i <= Settings.MaxSpawnAmount; i++)
+	{
+		FPendingSpawn& Pending = PendingSpawns.AddDefaulted_GetRef();
+		Pending.Spawner = Entry.Spawner;
+		Pending.ActorClass = Settings.NPCToSpawn;
+		Pending.Location = UKismetMathLibrary::RandomPointInBoundingBox(Origin, Settings.ProceduralSeperation);
+		Pending.Rotation = Settings.SpawnRotation;
+	}
+}
+
+void UCrowdPopulationSubsystem::UpdatePedestrians()
+{
+	// Round robin through the pedestrians so the cost per frame stays flat no matter how big the crowd gets
+	int32 NumToCheck = FMath::Min(CrowdPopulationCVars::PedestrianChecksPerFrame, Pedestrians.Num());
+	while (NumToCheck-- > 0 && Pedestrians.Num() > 0)
+	{
+		const int32 Index = NextPedestrianToCheck % Pedestrians.Num();
+		const FPedestrianEntry& Entry = Pedestrians[Index];
+
+		AActor* Pedestrian = Entry.Actor.Get();
+		if (Pedestrian == nullptr)
+		{
+			// The last entry was swapped into this slot, so check this index again
+			RemovePedestrianAt(Index);
+		}
+		else if (!IsAnyViewerWithin(Pedestrian->GetActorLocation(), Entry.DistanceToRelease))
+		{
+			ReleasePedestrian(Pedestrian);
+		}
+		else
+		{
+			NextPedestrianToCheck = Index + 1;
+		}
+	}
+}
+
+void UCrowdPopulationSubsystem::ProcessPendingSpawns()
+{
+	int32 NumProcessed = 0;
+	const int32 Budget = FMath::Min(FMath::Max(CrowdPopulationCVars::SpawnsPerFrame, 1), PendingSpawns.Num());
+
+	while (NumProcessed < Budget)
+	{
+		if ((CrowdPopulationCVars::MaxActivePedestrians > 0) && (Pedestrians.Num() >= CrowdPopulationCVars::MaxActivePedestrians))
+		{
+			break;
+		}
+
+		const FPendingSpawn& Pending = PendingSpawns[NumProcessed++];
+		AcquirePedestrian(Pending.ActorClass, Pending.Location, Pending.Rotation);
+	}
+
+	if (NumProcessed > 0)
+	{
+		PendingSpawns.RemoveAt(0, NumProcessed, /*bAllowShrinking=*/ false);
+	}
+}
+
+
+AActor* UCrowdPopulationSubsystem::AcquirePedestrian(TSubclassOf<AActor> ActorClass, const FVector& Location, const FRotator& Rotation)
+{
+	if (TArray<FPooledActor>* Pool = Pools.Find(ActorClass.Get()))
+	{
+		while (Pool->Num() > 0)
+		{
+			FPooledActor Pooled = Pool->Pop(/*bAllowShrinking=*/ false);
+
+			AActor* Pedestrian = Pooled.Actor.Get();
+			if (Pedestrian == nullptr || Pedestrian->IsActorBeingDestroyed())
+			{
+				continue;
+			}
+
+			Pedestrian->SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::ResetPhysics);
+			Pedestrian->SetActorHiddenInGame(false);
+			Pedestrian->SetActorEnableCollision(true);
+			Pedestrian->SetActorTickEnabled(true);
+
+			for (const TWeakObjectPtr<UActorComponent>& Component : Pooled.SuspendedComponents)
+			{
+				if (Component.IsValid())
+				{
+					Component->SetComponentTickEnabled(true);
+				}
+			}
+
+			if (const APawn* Pawn = Cast<APawn>(Pedestrian))
+			{
+				if (const AAIController* AIController = Cast<AAIController>(Pawn->GetController()))
+				{
+					if (UBrainComponent* Brain = AIController->GetBrainComponent())
+					{
+						Brain->RestartLogic();
+					}
+				}
+			}
+
+			if (UPedestrianDestroyer* Destroyer = Pedestrian->FindComponentByClass<UPedestrianDestroyer>())
+			{
+				// Released pedestrians are unregistered, let the destroyer tick again until it registers the reused pedestrian
+				Destroyer->SetComponentTickEnabled(true);
+				Destroyer->OnTakenFromPool.Broadcast();
+			}
+
+			++NumReused;
+			return Pedestrian;
+		}
+	}
+
+	AActor* Pedestrian = GetWorld()->SpawnActor<AActor>(ActorClass, Location, Rotation);
+	if (Pedestrian != nullptr)
+	{
+		++NumSpawned;
+	}
+	return Pedestrian;
+}
+
+void UCrowdPopulationSubsystem::ReleasePedestrian(AActor* Pedestrian)
+{
+	UnregisterPedestrian(Pedestrian);
+
+	TArray<FPooledActor>& Pool = Pools.FindOrAdd(Pedestrian->GetClass());
+	if (Pool.Num() >= CrowdPopulationCVars::MaxPooledPerClass)
+	{
+		Pedestrian->Destroy();
+		++NumDestroyed;
+		return;
+	}
+
+	if (UPedestrianDestroyer* Destroyer = Pedestrian->FindComponentByClass<UPedestrianDestroyer>())
+	{
+		Destroyer->OnReturnedToPool.Broadcast();
+	}
+
+	if (APawn* Pawn = Cast<APawn>(Pedestrian))
+	{
+		if (AAIController* AIController = Cast<AAIController>(Pawn->GetController()))
+		{
+			AIController->StopMovement();
+			if (UBrainComponent* Brain = AIController->GetBrainComponent())
+			{
+				Brain->StopLogic(TEXT("Returned to crowd pool"));
+			}
+		}
+
+		if (UPawnMovementComponent* MovementComponent = Pawn->GetMovementComponent())
+		{
+			MovementComponent->StopMovementImmediately();
+		}
+	}
+
+	FPooledActor& Pooled = Pool.AddDefaulted_GetRef();
+	Pooled.Actor = Pedestrian;
+
+	Pedestrian->SetActorHiddenInGame(true);
+	Pedestrian->SetActorEnableCollision(false);
+	Pedestrian->SetActorTickEnabled(false);
+
+	TInlineComponentArray<UActorComponent*> Components(Pedestrian);
+	for (UActorComponent* Component : Components)
+	{
+		if (Component->IsComponentTickEnabled())
+		{
+			Component->SetComponentTickEnabled(false);
+			Pooled.SuspendedComponents.Add(Component);
+		}
+	}
+
+	++NumReleasedToPool;
+}
+
+
+void UCrowdPopulationSubsystem::DumpStats() const
+{
+	int32 NumPooled = 0;
+	for (const auto& Pair : Pools)
+	{
+		NumPooled += Pair.Value.Num();
+	}
+
+	UE_LOG(LogCrowdPopulation, Log, TEXT("Crowd population: %d spawners (%d triggered), %d active pedestrians, %d pooled, %d pending spawns, %d viewers"),
+		Spawners.Num(), TriggeredSpawners.Num(), Pedestrians.Num(), NumPooled, PendingSpawns.Num(), ViewerLocations.Num());
+	UE_LOG(LogCrowdPopulation, Log, TEXT("  %d spawned, %d reused from pool, %d returned to pool, %d destroyed, last tick %.3f ms"),
+		NumSpawned, NumReused, NumReleasedToPool, NumDestroyed, LastTickTimeMS);
+}
@@ -6,6 +6,7 @@
 #include "Math/Vector.h"
 #include "Kismet/GameplayStatics.h"
 #include "GameFramework/Character.h"
+#include "CrowdPopulationSubsystem.h"
 
 
 // Sets default values for this component's properties
@@ -13,6 +14,7 @@ UCrowdSpawner::UCrowdSpawner()
 {
 	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
 	// off to improve performance if you don't need them.
+	// The tick is only needed by the per-component fallback, it is switched off once the crowd population subsystem takes over.
 	PrimaryComponentTick.bCanEverTick = true;
 
 	// ...
@@ -31,11 +33,41 @@ void UCrowdSpawner::BeginPlay()
 }
 
 
+// Called when the game ends or the spawner is removed
+void UCrowdSpawner::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UCrowdPopulationSubsystem* Population = UWorld::GetSubsystem<UCrowdPopulationSubsystem>(GetWorld()))
+	{
+		Population->UnregisterSpawner(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
 
 
 
 void UCrowdSpawner::CrowdSpawnByDistance(float DistanceToSpawn, int32 MaxSpawnAmount, FVector CharacterHeight, FVector ProceduralSeperation, TSubclassOf<AActor> NPCToSpawn, FRotator SpawnRotation)
 {
+	//Hand the spawner over to the crowd population, which checks it against every viewer and spreads the spawns over several frames
+	if (UCrowdPopulationSubsystem::IsEnabled())
+	{
+		if (UCrowdPopulationSubsystem* Population = UWorld::GetSubsystem<UCrowdPopulationSubsystem>(GetWorld()))
+		{
+			FCrowdSpawnerSettings Settings;
+			Settings.DistanceToSpawn = DistanceToSpawn;
+			Settings.MaxSpawnAmount = MaxSpawnAmount;
+			Settings.CharacterHeight = CharacterHeight;
+			Settings.ProceduralSeperation = ProceduralSeperation;
+			Settings.NPCToSpawn = NPCToSpawn;
+			Settings.SpawnRotation = SpawnRotation;
+			Population->RegisterSpawner(this, Settings);
+			SetComponentTickEnabled(false);
+			return;
+		}
+	}
+
 	if (UGameplayStatics::GetPlayerCharacter(GetWorld(), 0) != NULL)
 	{
 
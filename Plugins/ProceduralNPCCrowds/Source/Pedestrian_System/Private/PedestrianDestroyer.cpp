@@ -6,6 +6,7 @@
 #include "Math/Vector.h"
 #include "Kismet/GameplayStatics.h"
 #include "GameFramework/Character.h"
+#include "CrowdPopulationSubsystem.h"
 
 
 // Sets default values for this component's properties
@@ -13,6 +14,7 @@ UPedestrianDestroyer::UPedestrianDestroyer()
 {
 	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
 	// off to improve performance if you don't need them.
+	// The tick is only needed by the per-component fallback, it is switched off once the crowd population subsystem takes over.
 	PrimaryComponentTick.bCanEverTick = true;
 
 	// ...
@@ -29,8 +31,29 @@ void UPedestrianDestroyer::BeginPlay()
 	
 }
 
+// Called when the game ends or the pedestrian is destroyed
+void UPedestrianDestroyer::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UCrowdPopulationSubsystem* Population = UWorld::GetSubsystem<UCrowdPopulationSubsystem>(GetWorld()))
+	{
+		Population->UnregisterPedestrian(GetOwner());
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void UPedestrianDestroyer::DestroyByDistance(float DistanceToDestroy)
 {
+	//Let the crowd population decide when to remove the pedestrian, it checks every viewer and pools the actor instead of destroying it
+	if (UCrowdPopulationSubsystem::IsEnabled())
+	{
+		if (UCrowdPopulationSubsystem* Population = UWorld::GetSubsystem<UCrowdPopulationSubsystem>(GetWorld()))
+		{
+			Population->RegisterPedestrian(GetOwner(), DistanceToDestroy);
+			SetComponentTickEnabled(false);
+			return;
+		}
+	}
 
 	if (UGameplayStatics::GetPlayerCharacter(GetWorld(), 0) != NULL)
 	{
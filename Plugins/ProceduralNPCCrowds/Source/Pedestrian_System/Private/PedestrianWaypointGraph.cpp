@@ -0,0 +1,440 @@
+//  Copyright (c) 2022 KomodoBit Games. All rights reserved.
+
+
+#include "PedestrianWaypointGraph.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "UObject/Package.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(PedestrianWaypointGraph)
+
+DEFINE_LOG_CATEGORY_STATIC(LogPedestrianWaypointGraph, Log, All);
+
+namespace PedestrianWaypointGraph
+{
+	// Grids larger than this are built with bigger cells instead
+	static constexpr int32 MaxGridCells = 1 << 20;
+}
+
+
+bool UPedestrianWaypointGraph::IsWaypoint(const AActor* Actor, UClass* ResolvedWaypointClass) const
+{
+	if (ResolvedWaypointClass != nullptr && Actor->IsA(ResolvedWaypointClass))
+	{
+		return true;
+	}
+
+	if (!WaypointTag.IsNone() && Actor->ActorHasTag(WaypointTag))
+	{
+		return true;
+	}
+
+	if (WaypointObjectType != EObjectTypeQuery::ObjectTypeQuery_MAX)
+	{
+		const ECollisionChannel Channel = UEngineTypes::ConvertToCollisionChannel(WaypointObjectType);
+
+		TInlineComponentArray<UPrimitiveComponent*> Primitives(Actor);
+		for (const UPrimitiveComponent* Primitive : Primitives)
+		{
+			if (Primitive->IsCollisionEnabled() && Primitive->GetCollisionObjectType() == Channel)
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool UPedestrianWaypointGraph::IsBuiltForWorld(const UWorld* World) const
+{
+	if (World == nullptr || SourceMap.IsNull())
+	{
+		return true;
+	}
+
+	const FString WorldPackage = UWorld::RemovePIEPrefix(World->GetOutermost()->GetName());
+	return SourceMap.ToSoftObjectPath().GetLongPackageName() == WorldPackage;
+}
+
+bool UPedestrianWaypointGraph::BuildFromWorld(UWorld* World)
+{
+	check(World);
+
+	UClass* ResolvedWaypointClass = WaypointClass.LoadSynchronous();
+
+	TArray<AActor*> Waypoints;
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		if (IsWaypoint(*It, ResolvedWaypointClass))
+		{
+			Waypoints.Add(*It);
+		}
+	}
+
+	// Sort so rebuilding an unchanged map gives an identical graph
+	Waypoints.Sort([](const AActor& A, const AActor& B) { return A.GetPathName() < B.GetPathName(); });
+
+	SourceMap = World;
+	NodeLocations.Reset(Waypoints.Num());
+	for (const AActor* Waypoint : Waypoints)
+	{
+		NodeLocations.Add(FVector3f(Waypoint->GetActorLocation()));
+	}
+
+	// Bucket the nodes by edge distance so candidate edges only come from neighboring buckets
+	const float EdgeDistance = FMath::Max(MaxEdgeDistance, 1.0f);
+	TMap<FIntVector, TArray<int32>> Buckets;
+	auto GetBucket = [EdgeDistance](const FVector3f& Location)
+	{
+		return FIntVector(FMath::FloorToInt32(Location.X / EdgeDistance), FMath::FloorToInt32(Location.Y / EdgeDistance), FMath::FloorToInt32(Location.Z / EdgeDistance));
+	};
+	for (int32 Node = 0; Node < NodeLocations.Num(); ++Node)
+	{
+		Buckets.FindOrAdd(GetBucket(NodeLocations[Node])).Add(Node);
+	}
+
+	FCollisionQueryParams TraceParams(SCENE_QUERY_STAT(BuildWaypointGraph), /*bTraceComplex=*/ false);
+
+	TArray<TArray<int32>> Adjacency;
+	Adjacency.SetNum(NodeLocations.Num());
+
+	TArray<TPair<float, int32>> Candidates;
+	for (int32 Node = 0; Node < NodeLocations.Num(); ++Node)
+	{
+		const FVector3f& Location = NodeLocations[Node];
+		const FIntVector Bucket = GetBucket(Location);
+
+		Candidates.Reset();
+		for (int32 Z = -1; Z <= 1; ++Z)
+		{
+			for (int32 Y = -1; Y <= 1; ++Y)
+			{
+				for (int32 X = -1; X <= 1; ++X)
+				{
+					if (const TArray<int32>* BucketNodes = Buckets.Find(Bucket + FIntVector(X, Y, Z)))
+					{
+						for (const int32 Other : *BucketNodes)
+						{
+							const float Distance = FVector3f::Dist(Location, NodeLocations[Other]);
+							if (Other != Node && Distance <= EdgeDistance)
+							{
+								Candidates.Emplace(Distance, Other);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		Candidates.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key < B.Key; });
+
+		int32 NumEdges = 0;
+		for (const TPair<float, int32>& Candidate : Candidates)
+		{
+			if (NumEdges >= MaxEdgesPerNode)
+			{
+				break;
+			}
+
+			if (bRequireLineOfSight)
+			{
+				TraceParams.ClearIgnoredActors();
+				TraceParams.AddIgnoredActor(Waypoints[Node]);
+				TraceParams.AddIgnoredActor(Waypoints[Candidate.Value]);
+				if (World->LineTraceTestByChannel(FVector(Location), FVector(NodeLocations[Candidate.Value]), ECC_Visibility, TraceParams))
+				{
+					continue;
+				}
+			}
+
+			// Edges are two way, a pedestrian can always walk back the way it came
+			Adjacency[Node].AddUnique(Candidate.Value);
+			Adjacency[Candidate.Value].AddUnique(Node);
+			++NumEdges;
+		}
+	}
+
+	EdgeOffsets.Reset(NodeLocations.Num() + 1);
+	EdgeTargets.Reset();
+	EdgeWeights.Reset();
+	for (int32 Node = 0; Node < NodeLocations.Num(); ++Node)
+	{
+		EdgeOffsets.Add(EdgeTargets.Num());
+
+		Adjacency[Node].Sort();
+		for (const int32 Other : Adjacency[Node])
+		{
+			const float Distance = FVector3f::Dist(NodeLocations[Node], NodeLocations[Other]);
+			EdgeTargets.Add(Other);
+			EdgeWeights.Add(1.0f - 0.5f * FMath::Clamp(Distance / EdgeDistance, 0.0f, 1.0f));
+		}
+	}
+	EdgeOffsets.Add(EdgeTargets.Num());
+
+	BuildGrid();
+
+	MarkPackageDirty();
+
+	UE_LOG(LogPedestrianWaypointGraph, Log, TEXT("Built waypoint graph %s from %s: %d nodes, %d edges, %dx%d grid"),
+		*GetPathName(), *World->GetOutermost()->GetName(), GetNumNodes(), GetNumEdges(), GridSize.X, GridSize.Y);
+
+	return GetNumNodes() > 0;
+}
+
+FIntPoint UPedestrianWaypointGraph::GetCell(const FVector3f& Location) const
+{
+	return FIntPoint(FMath::FloorToInt32(Location.X / BakedCellSize), FMath::FloorToInt32(Location.Y / BakedCellSize));
+}
+
+void UPedestrianWaypointGraph::BuildGrid()
+{
+	CellOffsets.Reset();
+	CellNodes.Reset();
+	GridOrigin = FIntPoint::ZeroValue;
+	GridSize = FIntPoint::ZeroValue;
+	BakedCellSize = FMath::Max(GridCellSize, 100.0f);
+
+	if (NodeLocations.Num() == 0)
+	{
+		return;
+	}
+
+	FIntPoint MinCell;
+	FIntPoint MaxCell;
+	for (;;)
+	{
+		MinCell = FIntPoint(MAX_int32, MAX_int32);
+		MaxCell = FIntPoint(MIN_int32, MIN_int32);
+		for (const FVector3f& Location : NodeLocations)
+		{
+			const FIntPoint Cell = GetCell(Location);
+			MinCell = FIntPoint(FMath::Min(MinCell.X, Cell.X), FMath::Min(MinCell.Y, Cell.Y));
+			MaxCell = FIntPoint(FMath::Max(MaxCell.X, Cell.X), FMath::Max(MaxCell.Y, Cell.Y));
+		}
+
+		const int64 NumCells = int64(MaxCell.X - MinCell.X + 1) * int64(MaxCell.Y - MinCell.Y + 1);
+		if (NumCells <= PedestrianWaypointGraph::MaxGridCells)
+		{
+			break;
+		}
+		BakedCellSize *= 2.0f;
+	}
+
+	GridOrigin = MinCell;
+	GridSize = MaxCell - MinCell + FIntPoint(1, 1);
+
+	// Counting sort of the nodes by cell
+	const int32 NumCells = GridSize.X * GridSize.Y;
+	CellOffsets.SetNumZeroed(NumCells + 1);
+
+	TArray<int32> NodeCells;
+	NodeCells.SetNumUninitialized(NodeLocations.Num());
+	for (int32 Node = 0; Node < NodeLocations.Num(); ++Node)
+	{
+		const FIntPoint Cell = GetCell(NodeLocations[Node]) - GridOrigin;
+		NodeCells[Node] = Cell.Y * GridSize.X + Cell.X;
+		++CellOffsets[NodeCells[Node] + 1];
+	}
+
+	for (int32 Cell = 0; Cell < NumCells; ++Cell)
+	{
+		CellOffsets[Cell + 1] += CellOffsets[Cell];
+	}
+
+	CellNodes.SetNumUninitialized(NodeLocations.Num());
+	TArray<int32> CellFill(CellOffsets.GetData(), NumCells);
+	for (int32 Node = 0; Node < NodeLocations.Num(); ++Node)
+	{
+		CellNodes[CellFill[NodeCells[Node]]++] = Node;
+	}
+}
+
+int32 UPedestrianWaypointGraph::FindClosestNode(const FVector& InLocation) const
+{
+	if (NodeLocations.Num() == 0 || GridSize.X <= 0 || GridSize.Y <= 0)
+	{
+		return INDEX_NONE;
+	}
+
+	const FVector3f Location(InLocation);
+	const FIntPoint Start = GetCell(Location) - GridOrigin;
+	const FIntPoint Center(FMath::Clamp(Start.X, 0, GridSize.X - 1), FMath::Clamp(Start.Y, 0, GridSize.Y - 1));
+
+	int32 BestNode = INDEX_NONE;
+	float BestDistSquared = MAX_flt;
+
+	// Search outwards ring by ring until no cell in the ring can hold anything closer than the best so far
+	const int32 MaxRing = FMath::Max(GridSize.X, GridSize.Y);
+	for (int32 Ring = 0; Ring <= MaxRing; ++Ring)
+	{
+		bool bAnyCellInReach = false;
+
+		for (int32 Y = Center.Y - Ring; Y <= Center.Y + Ring; ++Y)
+		{
+			if (Y < 0 || Y >= GridSize.Y)
+			{
+				continue;
+			}
+
+			const bool bEdgeRow = (Y == Center.Y - Ring) || (Y == Center.Y + Ring);
+			const int32 XStep = bEdgeRow ? 1 : FMath::Max(2 * Ring, 1);
+			for (int32 X = Center.X - Ring; X <= Center.X + Ring; X += XStep)
+			{
+				if (X < 0 || X >= GridSize.X)
+				{
+					continue;
+				}
+
+				// Skip cells whose closest point is already further away than the best node
+				const FVector2f CellMin = FVector2f(FIntPoint(X, Y) + GridOrigin) * BakedCellSize;
+				const FVector2f CellMax = CellMin + FVector2f(BakedCellSize);
+				const float DX = FMath::Max3(CellMin.X - Location.X, 0.0f, Location.X - CellMax.X);
+				const float DY = FMath::Max3(CellMin.Y - Location.Y, 0.0f, Location.Y - CellMax.Y);
+				if (DX * DX + DY * DY > BestDistSquared)
+				{
+					continue;
+				}
+				bAnyCellInReach = true;
+
+				const int32 Cell = Y * GridSize.X + X;
+				for (int32 Index = CellOffsets[Cell]; Index < CellOffsets[Cell + 1]; ++Index)
+				{
+					const int32 Node = CellNodes[Index];
+					const float DistSquared = FVector3f::DistSquared(Location, NodeLocations[Node]);
+					if (DistSquared < BestDistSquared)
+					{
+						BestDistSquared = DistSquared;
+						BestNode = Node;
+					}
+				}
+			}
+		}
+
+		if (!bAnyCellInReach && BestNode != INDEX_NONE)
+		{
+			break;
+		}
+	}
+
+	return BestNode;
+}
+
+int32 UPedestrianWaypointGraph::ChooseNextNode(int32 Node, int32 PreviousNode, const FRandomStream& Stream) const
+{
+	if (!EdgeOffsets.IsValidIndex(Node + 1))
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 FirstEdge = EdgeOffsets[Node];
+	const int32 LastEdge = EdgeOffsets[Node + 1];
+
+	float TotalWeight = 0.0f;
+	for (int32 Edge = FirstEdge; Edge < LastEdge; ++Edge)
+	{
+		TotalWeight += (EdgeTargets[Edge] != PreviousNode) ? EdgeWeights[Edge] : 0.0f;
+	}
+
+	if (TotalWeight <= 0.0f)
+	{
+		// Dead end, turn around (or stay put if there are no edges at all)
+		return (LastEdge > FirstEdge) ? EdgeTargets[FirstEdge] : INDEX_NONE;
+	}
+
+	float Choice = Stream.FRand() * TotalWeight;
+	for (int32 Edge = FirstEdge; Edge < LastEdge; ++Edge)
+	{
+		if (EdgeTargets[Edge] == PreviousNode)
+		{
+			continue;
+		}
+
+		Choice -= EdgeWeights[Edge];
+		if (Choice <= 0.0f)
+		{
+			return EdgeTargets[Edge];
+		}
+	}
+
+	// Float round off, take the last candidate
+	for (int32 Edge = LastEdge - 1; Edge >= FirstEdge; --Edge)
+	{
+		if (EdgeTargets[Edge] != PreviousNode)
+		{
+			return EdgeTargets[Edge];
+		}
+	}
+	return INDEX_NONE;
+}
+
+int32 UPedestrianWaypointGraph::ChooseRandomNearbyNode(int32 Node, int32 MaxHops, const FRandomStream& Stream) const
+{
+	int32 Previous = INDEX_NONE;
+	const int32 NumHops = Stream.RandRange(1, FMath::Max(MaxHops, 1));
+	for (int32 Hop = 0; Hop < NumHops; ++Hop)
+	{
+		const int32 Next = ChooseNextNode(Node, Previous, Stream);
+		if (Next == INDEX_NONE)
+		{
+			break;
+		}
+		Previous = Node;
+		Node = Next;
+	}
+	return Node;
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// Compares the cost of a graph decision against the sweep each decision used to make
+
+static FAutoConsoleCommandWithWorldAndArgs GBenchmarkWaypointGraphCmd(
+	TEXT("Pedestrian.Waypoints.BenchmarkGraph"),
+	TEXT("Times waypoint decisions using a baked graph against the sphere sweep they replace. Usage: Pedestrian.Waypoints.BenchmarkGraph <GraphAssetPath> [Iterations=10000] [TraceDistance=600] [SphereRadius=300]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Params, UWorld* World)
+	{
+		const UPedestrianWaypointGraph* Graph = (Params.Num() > 0) ? LoadObject<UPedestrianWaypointGraph>(nullptr, *Params[0]) : nullptr;
+		if (Graph == nullptr || Graph->GetNumNodes() == 0 || World == nullptr)
+		{
+			UE_LOG(LogPedestrianWaypointGraph, Warning, TEXT("Pedestrian.Waypoints.BenchmarkGraph needs a built graph asset and a world"));
+			return;
+		}
+
+		const int32 Iterations = (Params.Num() > 1) ? FMath::Max(FCString::Atoi(*Params[1]), 1) : 10000;
+		const float TraceDistance = (Params.Num() > 2) ? FCString::Atof(*Params[2]) : 600.0f;
+		const float SphereRadius = (Params.Num() > 3) ? FCString::Atof(*Params[3]) : 300.0f;
+
+		// Same seed for both runs so they start from the same nodes
+		FRandomStream Stream(1234);
+		int32 Checksum = 0;
+		const double GraphStart = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			const FVector Location = Graph->GetNodeLocation(Stream.RandHelper(Graph->GetNumNodes())) + FVector(Stream.FRandRange(-200.0f, 200.0f), Stream.FRandRange(-200.0f, 200.0f), 0.0f);
+			const int32 Node = Graph->FindClosestNode(Location);
+			Checksum += Graph->ChooseNextNode(Node, INDEX_NONE, Stream);
+		}
+		const double GraphSeconds = FPlatformTime::Seconds() - GraphStart;
+
+		const FCollisionObjectQueryParams ObjectParams(Graph->WaypointObjectType != EObjectTypeQuery::ObjectTypeQuery_MAX ? UEngineTypes::ConvertToCollisionChannel(Graph->WaypointObjectType) : ECC_WorldDynamic);
+		const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(BenchmarkWaypointSweep), /*bTraceComplex=*/ false);
+		TArray<FHitResult> Hits;
+
+		Stream.Reset();
+		const double SweepStart = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			const FVector Location = Graph->GetNodeLocation(Stream.RandHelper(Graph->GetNumNodes())) + FVector(Stream.FRandRange(-200.0f, 200.0f), Stream.FRandRange(-200.0f, 200.0f), 0.0f);
+			const FVector Forward = FRotator(0.0f, Stream.FRandRange(0.0f, 360.0f), 0.0f).Vector();
+			World->SweepMultiByObjectType(Hits, Location + Forward, Location + Forward * (TraceDistance + 1.0f), FQuat::Identity, ObjectParams, FCollisionShape::MakeSphere(SphereRadius), QueryParams);
+			Checksum += Hits.Num();
+		}
+		const double SweepSeconds = FPlatformTime::Seconds() - SweepStart;
+
+		UE_LOG(LogPedestrianWaypointGraph, Log, TEXT("Waypoint decisions (%d iterations, %d nodes, %d edges): graph %.3f us/decision, sweep %.3f us/decision (checksum %d)"),
+			Iterations, Graph->GetNumNodes(), Graph->GetNumEdges(), GraphSeconds * 1.0e6 / Iterations, SweepSeconds * 1.0e6 / Iterations, Checksum);
+	}));
@@ -0,0 +1,257 @@
+//  Copyright (c) 2022 KomodoBit Games. All rights reserved.
+
+
+#include "WaypointQuerySubsystem.h"
+#include "BTTask_FindNextWaypoint.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+#include "DrawDebugHelpers.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+#include "NavigationSystem.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(WaypointQuerySubsystem)
+
+namespace WaypointQueryCVars
+{
+	static int32 Seed = -1;
+	static FAutoConsoleVariableRef CVarSeed(
+		TEXT("Pedestrian.Waypoints.Seed"),
+		Seed,
+		TEXT("Seed for the per-pedestrian waypoint random streams. If negative, a new seed is picked for each world so crowds differ between runs."),
+		ECVF_Default);
+
+	static int32 MaxSweepsPerFrame = 256;
+	static FAutoConsoleVariableRef CVarMaxSweepsPerFrame(
+		TEXT("Pedestrian.Waypoints.MaxSweepsPerFrame"),
+		MaxSweepsPerFrame,
+		TEXT("The maximum number of async waypoint sweeps issued each frame"),
+		ECVF_Default);
+
+	static int32 MaxNavQueriesPerFrame = 16;
+	static FAutoConsoleVariableRef CVarMaxNavQueriesPerFrame(
+		TEXT("Pedestrian.Waypoints.MaxNavQueriesPerFrame"),
+		MaxNavQueriesPerFrame,
+		TEXT("The maximum number of random navigable point queries (used when a waypoint sweep misses) run each frame"),
+		ECVF_Default);
+
+	static constexpr uint32 StreamPruneInterval = 600;
+}
+
+
+bool UWaypointQuerySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UWaypointQuerySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWaypointQuerySubsystem, STATGROUP_Tickables);
+}
+
+void UWaypointQuerySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	WorldSeed = FMath::Rand();
+}
+
+void UWaypointQuerySubsystem::Deinitialize()
+{
+	NewQueries.Reset();
+	SweepingQueries.Reset();
+	NavQueries.Reset();
+	RandomStreams.Reset();
+
+	Super::Deinitialize();
+}
+
+uint32 UWaypointQuerySubsystem::RequestWaypoint(const FWaypointQueryRequest& Request)
+{
+	FPendingQuery& Query = NewQueries.AddDefaulted_GetRef();
+	Query.Id = NextRequestId;
+	Query.Request = Request;
+
+	NextRequestId = (NextRequestId == MAX_uint32) ? 1 : (NextRequestId + 1);
+	return Query.Id;
+}
+
+void UWaypointQuerySubsystem::CancelRequest(uint32 RequestId)
+{
+	auto MatchesId = [RequestId](const FPendingQuery& Query) { return Query.Id == RequestId; };
+
+	// The sweep itself can't be cancelled, its results are just never read
+	NewQueries.RemoveAll(MatchesId);
+	SweepingQueries.RemoveAll(MatchesId);
+	NavQueries.RemoveAll(MatchesId);
+}
+
+FRandomStream& UWaypointQuerySubsystem::GetRandomStream(const APawn* Pawn)
+{
+	if (FRandomStream* Existing = RandomStreams.Find(Pawn))
+	{
+		return *Existing;
+	}
+
+	const int32 BaseSeed = (WaypointQueryCVars::Seed >= 0) ? WaypointQueryCVars::Seed : WorldSeed;
+
+	// Spawned pedestrian names are stable for a given map and spawn order, so this gives every pedestrian the same stream each run
+	const uint32 PawnHash = (Pawn != nullptr) ? GetTypeHash(Pawn->GetFName().ToString()) : 0;
+	return RandomStreams.Add(Pawn, FRandomStream((int32)HashCombine((uint32)BaseSeed, PawnHash)));
+}
+
+
+void UWaypointQuerySubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UWaypointQuerySubsystem::Tick);
+
+	// Last frame's sweeps have completed by now, read them back before issuing the next batch
+	ProcessSweepResults();
+	ProcessNavFallbacks();
+	IssueSweeps();
+
+	if (++FramesSinceStreamPrune >= WaypointQueryCVars::StreamPruneInterval)
+	{
+		FramesSinceStreamPrune = 0;
+		for (auto It = RandomStreams.CreateIterator(); It; ++It)
+		{
+			if (It.Key().ResolveObjectPtr() == nullptr)
+			{
+				It.RemoveCurrent();
+			}
+		}
+	}
+}
+
+void UWaypointQuerySubsystem::IssueSweeps()
+{
+	UWorld* World = GetWorld();
+
+	const int32 NumToIssue = FMath::Min(NewQueries.Num(), FMath::Max(WaypointQueryCVars::MaxSweepsPerFrame, 1));
+	if (NumToIssue == 0)
+	{
+		return;
+	}
+
+	static const FName TraceTag(TEXT("FindNextWaypoint"));
+	const FCollisionQueryParams QueryParams(TraceTag, /*bTraceComplex=*/ false);
+
+	for (int32 Index = 0; Index < NumToIssue; ++Index)
+	{
+		FPendingQuery& Query = NewQueries[Index];
+		const FWaypointQueryRequest& Request = Query.Request;
+
+		const FCollisionObjectQueryParams ObjectParams(UEngineTypes::ConvertToCollisionChannel(Request.ObjectToUse));
+		Query.TraceHandle = World->AsyncSweepByObjectType(EAsyncTraceType::Multi, Request.Start, Request.End, FQuat::Identity, ObjectParams, FCollisionShape::MakeSphere(Request.SphereRadius), QueryParams);
+
+		SweepingQueries.Add(MoveTemp(Query));
+	}
+
+	NewQueries.RemoveAt(0, NumToIssue, /*bAllowShrinking=*/ false);
+}
+
+void UWaypointQuerySubsystem::ProcessSweepResults()
+{
+	UWorld* World = GetWorld();
+
+	for (int32 Index = 0; Index < SweepingQueries.Num(); )
+	{
+		FPendingQuery& Query = SweepingQueries[Index];
+		if (!World->QueryTraceData(Query.TraceHandle, ScratchTraceDatum))
+		{
+			if (!Query.Request.OwnerComp.IsValid())
+			{
+				SweepingQueries.RemoveAtSwap(Index, 1, /*bAllowShrinking=*/ false);
+			}
+			else if (World->IsTraceHandleValid(Query.TraceHandle, /*bOverlapTrace=*/ false))
+			{
+				// Not done yet
+				++Index;
+			}
+			else
+			{
+				// The results only survive one frame swap, if a tick was skipped they are gone and the sweep has to be issued again
+				NewQueries.Add(MoveTemp(Query));
+				SweepingQueries.RemoveAtSwap(Index, 1, /*bAllowShrinking=*/ false);
+			}
+			continue;
+		}
+
+		const FWaypointQueryRequest& Request = Query.Request;
+		const TArray<FHitResult>& Hits = ScratchTraceDatum.OutHits;
+
+#if ENABLE_DRAW_DEBUG
+		if (Request.DebugDrawType != EDrawDebugTrace::None)
+		{
+			const bool bPersistent = (Request.DebugDrawType == EDrawDebugTrace::Persistent);
+			const float LifeTime = (Request.DebugDrawType == EDrawDebugTrace::ForDuration) ? 1.0f : 0.0f;
+			DrawDebugSweptSphere(World, Request.Start, Request.End, Request.SphereRadius, (Hits.Num() > 0) ? FColor::Green : FColor::Red, bPersistent, LifeTime);
+		}
+#endif
+
+		if (Hits.Num() > 0)
+		{
+			// Pick one of the hit waypoints at random
+			const FRandomStream& Stream = GetRandomStream(Request.Pawn.Get());
+			const FVector ImpactPoint = Hits[Stream.RandHelper(Hits.Num())].ImpactPoint;
+			const FName HitKey = Request.HitKey;
+			CompletedQueries.Add({ MoveTemp(Query), HitKey, ImpactPoint });
+		}
+		else
+		{
+			NavQueries.Add(MoveTemp(Query));
+		}
+
+		SweepingQueries.RemoveAtSwap(Index, 1, /*bAllowShrinking=*/ false);
+	}
+
+	FinishCompletedQueries();
+}
+
+void UWaypointQuerySubsystem::ProcessNavFallbacks()
+{
+	const int32 NumToProcess = FMath::Min(NavQueries.Num(), FMath::Max(WaypointQueryCVars::MaxNavQueriesPerFrame, 1));
+	if (NumToProcess == 0)
+	{
+		return;
+	}
+
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+
+	for (int32 Index = 0; Index < NumToProcess; ++Index)
+	{
+		const FPendingQuery& Query = NavQueries[Index];
+		const FWaypointQueryRequest& Request = Query.Request;
+
+		// Start wandering towards a random navigable point if the sweep didn't find any waypoints
+		FNavLocation ResultLocation(Request.Start);
+		if (NavSys != nullptr)
+		{
+			NavSys->GetRandomPointInNavigableRadius(Request.Start, Request.WanderRadius, ResultLocation);
+		}
+
+		CompletedQueries.Add({ Query, Request.WanderKey, ResultLocation.Location });
+	}
+
+	NavQueries.RemoveAt(0, NumToProcess, /*bAllowShrinking=*/ false);
+
+	FinishCompletedQueries();
+}
+
+void UWaypointQuerySubsystem::FinishCompletedQueries()
+{
+	// Finishing a task can immediately start the next one (and request another waypoint), so the queues must not be iterated while doing this
+	for (const FCompletedQuery& Completed : CompletedQueries)
+	{
+		UBehaviorTreeComponent* OwnerComp = Completed.Query.Request.OwnerComp.Get();
+		const UBTTask_FindNextWaypoint* Task = Completed.Query.Request.Task.Get();
+		if (OwnerComp != nullptr && Task != nullptr)
+		{
+			Task->OnWaypointQueryFinished(*OwnerComp, Completed.Query.Id, Completed.Key, Completed.Location);
+		}
+	}
+
+	CompletedQueries.Reset();
+}
@@ -7,15 +7,30 @@
 #include "Kismet/KismetSystemLibrary.h"
 #include "BTTask_FindNextWaypoint.generated.h"
 
+class UPedestrianWaypointGraph;
+
+struct FBTFindNextWaypointMemory
+{
+	// Id of the waypoint query in flight, zero if none
+	uint32 RequestId;
+
+	// Where the pedestrian is on the waypoint graph, INDEX_NONE until it has been snapped to it
+	int32 CurrentNode;
+	int32 PreviousNode;
+};
 
 /**
- * 
+ * Picks the next waypoint for a pedestrian.
+ * With a baked WaypointGraph for the current map the next waypoint is picked straight from the graph and the task finishes immediately.
+ * Otherwise the query runs through UWaypointQuerySubsystem, so the task stays in progress until the batched sweep (or navmesh fallback) is done.
  */
 UCLASS()
 class PEDESTRIAN_SYSTEM_API UBTTask_FindNextWaypoint : public UBTTaskNode
 {
 	GENERATED_BODY()
 public:
+	UBTTask_FindNextWaypoint();
+
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = Tracing)
 		float TraceDistance = 600.0;
 	
@@ -34,9 +49,25 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = PathFinding)
 		FBlackboardKeySelector FindWayPoint;
 
+	//Radius used to find a random navigable point when no waypoint is hit
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = PathFinding)
+		float WanderRadius = 1000.0;
+
+	//Baked waypoints for the map, replaces the sweep when it was built for the running map
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = PathFinding)
+		TObjectPtr<UPedestrianWaypointGraph> WaypointGraph;
+
+	//Called by the waypoint query scheduler once the query has a result
+	void OnWaypointQueryFinished(UBehaviorTreeComponent& OwnerComp, uint32 RequestId, FName Key, const FVector& Location) const;
+
 
 private:
 	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual EBTNodeResult::Type AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual uint16 GetInstanceMemorySize() const override;
+	virtual void InitializeMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryInit::Type InitType) const override;
+
+	bool ChooseNextGraphWaypoint(UBehaviorTreeComponent& OwnerComp, FBTFindNextWaypointMemory& MyMemory, const APawn& Pawn) const;
 
 	
 
@@ -7,6 +7,8 @@
 #include "Kismet/KismetSystemLibrary.h"
 #include "BTTask_Wander.generated.h"
 
+class UPedestrianWaypointGraph;
+
 /**
  * 
  */
@@ -21,6 +23,10 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = PathFinding)
 		float WanderRadius;
 
+	//Baked waypoints for the map, when set (and built for the running map) a random waypoint within about WanderRadius is picked instead of querying the navmesh
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = PathFinding)
+		TObjectPtr<UPedestrianWaypointGraph> WaypointGraph;
+
 private:
 	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
 };
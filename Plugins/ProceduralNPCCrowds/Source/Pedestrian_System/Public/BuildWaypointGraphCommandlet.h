@@ -0,0 +1,23 @@
+//  Copyright (c) 2022 KomodoBit Games. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BuildWaypointGraphCommandlet.generated.h"
+
+/**
+ * Bakes a UPedestrianWaypointGraph from the waypoints placed in a map and saves it, without opening the editor.
+ *
+ * Usage: UnrealEditor-Cmd <Project> -run=BuildWaypointGraph -Map=/Game/Maps/MyMap -Graph=/Game/Maps/MyMap_WaypointGraph
+ */
+UCLASS()
+class PEDESTRIAN_SYSTEM_API UBuildWaypointGraphCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBuildWaypointGraphCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,149 @@
+//  Copyright (c) 2022 KomodoBit Games. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "CrowdPopulationSubsystem.generated.h"
+
+class AActor;
+class UActorComponent;
+class UCrowdSpawner;
+
+
+// Parameters passed to UCrowdSpawner::CrowdSpawnByDistance
+struct FCrowdSpawnerSettings
+{
+	float DistanceToSpawn = 0.0f;
+	int32 MaxSpawnAmount = 0;
+	FVector CharacterHeight = FVector::ZeroVector;
+	FVector ProceduralSeperation = FVector::ZeroVector;
+	TSubclassOf<AActor> NPCToSpawn;
+	FRotator SpawnRotation = FRotator::ZeroRotator;
+};
+
+
+/**
+ * Owns the crowd population of a world.
+ *
+ * Spawners and pedestrians register here instead of doing their own distance checks against player 0.
+ * Every tick the subsystem checks them against all viewers (using a coarse grid so far away spawners are never visited),
+ * spreads spawns across frames under a budget, and returns pedestrians to a per-class pool instead of destroying them.
+ */
+UCLASS()
+class PEDESTRIAN_SYSTEM_API UCrowdPopulationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static bool IsEnabled();
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// USubsystem interface
+	virtual void Deinitialize() override;
+
+	// Adds the spawner or updates its settings (cheap enough to call every frame)
+	void RegisterSpawner(UCrowdSpawner* Spawner, const FCrowdSpawnerSettings& Settings);
+	void UnregisterSpawner(UCrowdSpawner* Spawner);
+
+	// Starts tracking the pedestrian, which will be returned to the pool once every viewer is further away than DistanceToRelease
+	void RegisterPedestrian(AActor* Pedestrian, float DistanceToRelease);
+	void UnregisterPedestrian(AActor* Pedestrian);
+
+	// Logs the pool and spawn counters
+	void DumpStats() const;
+
+protected:
+
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	struct FSpawnerEntry
+	{
+		TObjectKey<UCrowdSpawner> Spawner;
+		FCrowdSpawnerSettings Settings;
+		FVector Location = FVector::ZeroVector;
+		FIntPoint Cell = FIntPoint::ZeroValue;
+
+		// Set once the spawner has spawned its crowd, cleared when every viewer leaves its range
+		bool bTriggered = false;
+	};
+
+	struct FPedestrianEntry
+	{
+		TWeakObjectPtr<AActor> Actor;
+		TObjectKey<AActor> Key;
+		float DistanceToRelease = 0.0f;
+	};
+
+	struct FPendingSpawn
+	{
+		TObjectKey<UCrowdSpawner> Spawner;
+		TSubclassOf<AActor> ActorClass;
+		FVector Location = FVector::ZeroVector;
+		FRotator Rotation = FRotator::ZeroRotator;
+	};
+
+	struct FPooledActor
+	{
+		TWeakObjectPtr<AActor> Actor;
+
+		// Components that were ticking when the actor was pooled, re-enabled when it is taken from the pool
+		TArray<TWeakObjectPtr<UActorComponent>> SuspendedComponents;
+	};
+
+	FIntPoint GetCell(const FVector& Location) const;
+
+	void GatherViewers();
+	void BuildViewerCells(float Radius);
+	bool IsAnyViewerWithin(const FVector& Location, float Distance) const;
+
+	void UpdateSpawners();
+	void UpdatePedestrians();
+	void ProcessPendingSpawns();
+
+	void TriggerSpawner(FSpawnerEntry& Entry);
+	void RebuildSpawnerGrid();
+
+	AActor* AcquirePedestrian(TSubclassOf<AActor> ActorClass, const FVector& Location, const FRotator& Rotation);
+	void ReleasePedestrian(AActor* Pedestrian);
+
+	void RemovePedestrianAt(int32 Index);
+
+	// Unregisters every spawner and pedestrian and turns their component ticks back on, so they go back to the per-component checks
+	void ReturnToComponentTicks();
+
+private:
+
+	TArray<FSpawnerEntry> Spawners;
+	TMap<TObjectKey<UCrowdSpawner>, int32> SpawnerIndices;
+	TMap<FIntPoint, TArray<int32>> SpawnerGrid;
+	TArray<int32> TriggeredSpawners;
+	float MaxSpawnDistance = 0.0f;
+	float GridCellSize = 0.0f;
+	bool bSpawnerGridDirty = false;
+
+	TArray<FPedestrianEntry> Pedestrians;
+	TMap<TObjectKey<AActor>, int32> PedestrianIndices;
+	int32 NextPedestrianToCheck = 0;
+
+	TArray<FPendingSpawn> PendingSpawns;
+
+	TMap<TObjectKey<UClass>, TArray<FPooledActor>> Pools;
+
+	TArray<FVector, TInlineAllocator<8>> ViewerLocations;
+	TSet<FIntPoint> ViewerCells;
+
+	// Counters for DumpStats
+	int32 NumSpawned = 0;
+	int32 NumReused = 0;
+	int32 NumReleasedToPool = 0;
+	int32 NumDestroyed = 0;
+	double LastTickTimeMS = 0.0;
+};
@@ -20,6 +20,9 @@ protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
+	// Called when the game ends or the spawner is removed
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:
 
 	UFUNCTION(BlueprintCallable, META = (DisplayName = "SpawnPedestrian", Category = "Procedural NPC Crowds"))
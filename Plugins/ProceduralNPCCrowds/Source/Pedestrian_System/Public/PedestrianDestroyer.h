@@ -6,6 +6,7 @@
 #include "Components/ActorComponent.h"
 #include "PedestrianDestroyer.generated.h"
 
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FPedestrianPoolEvent);
 
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class PEDESTRIAN_SYSTEM_API UPedestrianDestroyer : public UActorComponent
@@ -20,11 +21,22 @@ protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
+	// Called when the game ends or the pedestrian is destroyed
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:	
 
 	UFUNCTION(BlueprintCallable, META = (DisplayName = "Remove Pedestrian", Category = "Procedural NPC Crowds"))
 		void DestroyByDistance(float DistanceToDestroy);
 
+	//Called when the crowd population hides this pedestrian to reuse it later instead of destroying it
+	UPROPERTY(BlueprintAssignable, Category = "Procedural NPC Crowds")
+		FPedestrianPoolEvent OnReturnedToPool;
+
+	//Called when the crowd population reuses this pedestrian for a new spawn, use this to reset any per-life state
+	UPROPERTY(BlueprintAssignable, Category = "Procedural NPC Crowds")
+		FPedestrianPoolEvent OnTakenFromPool;
+
 	//creat bool for do once
 	bool bDo;
 
@@ -0,0 +1,118 @@
+//  Copyright (c) 2022 KomodoBit Games. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "Engine/EngineTypes.h"
+#include "PedestrianWaypointGraph.generated.h"
+
+class AActor;
+class UWorld;
+struct FRandomStream;
+
+
+/**
+ * A baked graph of the waypoints placed in a map.
+ *
+ * Nodes, edges (compressed rows: the edges of node N are EdgeOffsets[N] to EdgeOffsets[N + 1]) and a coarse 2D grid of the
+ * nodes are all stored in flat arrays, so picking the next waypoint is a walk over one node's edges and finding the
+ * closest node only looks at a few grid cells. Nothing here touches the scene at runtime.
+ *
+ * Built from a loaded map with BuildFromWorld, either headlessly with the BuildWaypointGraph commandlet or from code.
+ */
+UCLASS(BlueprintType)
+class PEDESTRIAN_SYSTEM_API UPedestrianWaypointGraph : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	//Actors of this class (or its children) are added as waypoints
+	UPROPERTY(EditAnywhere, Category = "Build")
+		TSoftClassPtr<AActor> WaypointClass;
+
+	//Actors with this tag are added as waypoints
+	UPROPERTY(EditAnywhere, Category = "Build")
+		FName WaypointTag;
+
+	//Actors with a colliding component of this object type are added as waypoints (matches ObjectToUse on the waypoint tasks)
+	UPROPERTY(EditAnywhere, Category = "Build")
+		TEnumAsByte<EObjectTypeQuery> WaypointObjectType = EObjectTypeQuery::ObjectTypeQuery_MAX;
+
+	//Waypoints further apart than this are never connected
+	UPROPERTY(EditAnywhere, Category = "Build", meta = (ClampMin = "1.0"))
+		float MaxEdgeDistance = 1500.0f;
+
+	//The maximum number of edges kept per waypoint (the closest ones are kept)
+	UPROPERTY(EditAnywhere, Category = "Build", meta = (ClampMin = "1"))
+		int32 MaxEdgesPerNode = 6;
+
+	//Only connect waypoints that can see each other (one visibility trace per candidate edge at build time)
+	UPROPERTY(EditAnywhere, Category = "Build")
+		bool bRequireLineOfSight = true;
+
+	//Size of the grid cells used to find the closest waypoint
+	UPROPERTY(EditAnywhere, Category = "Build", meta = (ClampMin = "100.0"))
+		float GridCellSize = 2000.0f;
+
+	//The map this graph was built from
+	UPROPERTY(VisibleAnywhere, Category = "Graph")
+		TSoftObjectPtr<UWorld> SourceMap;
+
+	int32 GetNumNodes() const { return NodeLocations.Num(); }
+	int32 GetNumEdges() const { return EdgeTargets.Num(); }
+	FVector GetNodeLocation(int32 Node) const { return FVector(NodeLocations[Node]); }
+
+	//Returns the node closest to the location, or INDEX_NONE if the graph is empty
+	int32 FindClosestNode(const FVector& Location) const;
+
+	//Picks one of the node's neighbors at random (by edge weight), avoiding PreviousNode unless it is the only way to go
+	int32 ChooseNextNode(int32 Node, int32 PreviousNode, const FRandomStream& Stream) const;
+
+	//Picks a random node up to MaxHops edges away
+	int32 ChooseRandomNearbyNode(int32 Node, int32 MaxHops, const FRandomStream& Stream) const;
+
+	//Returns false if the graph was baked from a different map than the one the world is running
+	bool IsBuiltForWorld(const UWorld* World) const;
+
+	//Rebuilds the graph from the waypoints in the world, returns false if no waypoints were found
+	bool BuildFromWorld(UWorld* World);
+
+protected:
+
+	bool IsWaypoint(const AActor* Actor, UClass* ResolvedWaypointClass) const;
+	FIntPoint GetCell(const FVector3f& Location) const;
+	void BuildGrid();
+
+	UPROPERTY()
+		TArray<FVector3f> NodeLocations;
+
+	//Size is the number of nodes plus one
+	UPROPERTY()
+		TArray<int32> EdgeOffsets;
+
+	UPROPERTY()
+		TArray<int32> EdgeTargets;
+
+	//Relative chance of taking each edge (closer waypoints are favored, like the old forward sweep)
+	UPROPERTY()
+		TArray<float> EdgeWeights;
+
+	//The cell size the grid was built with (GridCellSize, grown if the map is too large for it)
+	UPROPERTY()
+		float BakedCellSize = 0.0f;
+
+	UPROPERTY()
+		FIntPoint GridOrigin = FIntPoint::ZeroValue;
+
+	UPROPERTY()
+		FIntPoint GridSize = FIntPoint::ZeroValue;
+
+	//Size is the number of cells plus one, the nodes in cell C are CellNodes[CellOffsets[C]] to CellNodes[CellOffsets[C + 1]]
+	UPROPERTY()
+		TArray<int32> CellOffsets;
+
+	UPROPERTY()
+		TArray<int32> CellNodes;
+};
@@ -0,0 +1,120 @@
+//  Copyright (c) 2022 KomodoBit Games. All rights reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "Kismet/KismetSystemLibrary.h"
+#include "Math/RandomStream.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "WorldCollision.h"
+#include "WaypointQuerySubsystem.generated.h"
+
+class APawn;
+class UBehaviorTreeComponent;
+class UBTTask_FindNextWaypoint;
+
+
+// A single "where do I walk next" request from a pedestrian behavior tree
+struct FWaypointQueryRequest
+{
+	TWeakObjectPtr<UBehaviorTreeComponent> OwnerComp;
+	TWeakObjectPtr<const UBTTask_FindNextWaypoint> Task;
+	TWeakObjectPtr<APawn> Pawn;
+
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+	float SphereRadius = 0.0f;
+	float WanderRadius = 0.0f;
+	TEnumAsByte<EObjectTypeQuery> ObjectToUse;
+	TEnumAsByte<EDrawDebugTrace::Type> DebugDrawType;
+
+	// Blackboard keys written on a sweep hit and on the navmesh fallback
+	FName HitKey;
+	FName WanderKey;
+};
+
+
+/**
+ * Shared scheduler for waypoint queries.
+ *
+ * Requests made during a frame are swept asynchronously as a batch, the results are read back on the following frame,
+ * and misses fall back to a random navigable point (a limited number per frame). Each request finishes its latent task
+ * once its blackboard key has been written. Random choices come from a seeded stream per pedestrian so runs can be reproduced.
+ */
+UCLASS()
+class PEDESTRIAN_SYSTEM_API UWaypointQuerySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// Queues a request, returns an id that can be used to cancel it (never zero)
+	uint32 RequestWaypoint(const FWaypointQueryRequest& Request);
+
+	// Drops a request without writing anything or finishing its task (e.g., when the task is aborted)
+	void CancelRequest(uint32 RequestId);
+
+	// Returns the random stream for this pedestrian, seeded from Pedestrian.Waypoints.Seed and the pawn name
+	FRandomStream& GetRandomStream(const APawn* Pawn);
+
+protected:
+
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	struct FPendingQuery
+	{
+		uint32 Id = 0;
+		FWaypointQueryRequest Request;
+		FTraceHandle TraceHandle;
+	};
+
+	void IssueSweeps();
+	void ProcessSweepResults();
+	void ProcessNavFallbacks();
+
+	struct FCompletedQuery
+	{
+		FPendingQuery Query;
+		FName Key;
+		FVector Location;
+	};
+
+	void FinishCompletedQueries();
+
+private:
+
+	// Waiting for their sweep to be issued
+	TArray<FPendingQuery> NewQueries;
+
+	// Sweeps issued, waiting for results
+	TArray<FPendingQuery> SweepingQueries;
+
+	// The sweep missed, waiting for a navmesh query
+	TArray<FPendingQuery> NavQueries;
+
+	// Results waiting to be written to their blackboards
+	TArray<FCompletedQuery> CompletedQueries;
+
+	TMap<TObjectKey<APawn>, FRandomStream> RandomStreams;
+
+	// Used when Pedestrian.Waypoints.Seed is negative
+	int32 WorldSeed = 0;
+
+	uint32 NextRequestId = 1;
+	uint32 FramesSinceStreamPrune = 0;
+
+	// Reused for reading back sweep results
+	FTraceDatum ScratchTraceDatum;
+};
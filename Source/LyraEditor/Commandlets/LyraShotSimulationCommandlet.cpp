@@ -0,0 +1,115 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "LyraShotSimulationCommandlet.h"
+
+#include "Misc/FileHelper.h"
+#include "Weapons/LyraShotSimulator.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LyraShotSimulationCommandlet)
+
+DEFINE_LOG_CATEGORY_STATIC(LogLyraShotSimulation, Log, Log);
+
+ULyraShotSimulationCommandlet::ULyraShotSimulationCommandlet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+}
+
+int32 ULyraShotSimulationCommandlet::Main(const FString& FullCommandLine)
+{
+	UE_LOG(LogLyraShotSimulation, Display, TEXT("Running LyraShotSimulation commandlet..."));
+
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> Params;
+	ParseCommandLine(*FullCommandLine, Tokens, Switches, Params);
+
+	const FString* WeaponClassPath = Params.Find(TEXT("Weapon"));
+	if (WeaponClassPath == nullptr)
+	{
+		UE_LOG(LogLyraShotSimulation, Error, TEXT("Missing -Weapon=<ClassPath>."));
+		return 1;
+	}
+
+	const UClass* WeaponClass = LoadObject<UClass>(nullptr, **WeaponClassPath);
+	FLyraShotSimulator Simulator(WeaponClass);
+	if (!Simulator.IsValid())
+	{
+		UE_LOG(LogLyraShotSimulation, Error, TEXT("%s is not a ranged weapon instance class."), **WeaponClassPath);
+		return 1;
+	}
+
+	FLyraShotSimulationSettings Settings;
+	if (const FString* Engagements = Params.Find(TEXT("Engagements")))
+	{
+		Settings.NumEngagements = FMath::Max(FCString::Atoi(**Engagements), 1);
+	}
+	if (const FString* Distances = Params.Find(TEXT("Distances")))
+	{
+		TArray<FString> DistanceStrings;
+		Distances->ParseIntoArray(DistanceStrings, TEXT("+"));
+
+		Settings.Distances.Reset();
+		for (const FString& DistanceString : DistanceStrings)
+		{
+			Settings.Distances.Add(FCString::Atof(*DistanceString));
+		}
+	}
+	if (const FString* BaseDamage = Params.Find(TEXT("BaseDamage")))
+	{
+		Settings.BaseDamage = FCString::Atof(**BaseDamage);
+	}
+	if (const FString* FireInterval = Params.Find(TEXT("FireInterval")))
+	{
+		Settings.FireInterval = FMath::Max(FCString::Atof(**FireInterval), 0.0f);
+	}
+	if (const FString* AimError = Params.Find(TEXT("AimError")))
+	{
+		Settings.AimErrorDegrees = FMath::Max(FCString::Atof(**AimError), 0.0f);
+	}
+	if (const FString* Seed = Params.Find(TEXT("Seed")))
+	{
+		Settings.Seed = FCString::Atoi(**Seed);
+	}
+	Settings.bAiming = Switches.Contains(TEXT("Aiming"));
+	Settings.bMoving = Switches.Contains(TEXT("Moving"));
+	Settings.bCrouching = Switches.Contains(TEXT("Crouching"));
+	Settings.bJumpingOrFalling = Switches.Contains(TEXT("Falling"));
+	Settings.bAimAtLastZone = Switches.Contains(TEXT("AimAtHead"));
+
+	Simulator.AddDefaultHitZones();
+
+	TArray<FLyraShotSimulationResult> Results;
+	Simulator.Run(Settings, Results);
+	Simulator.LogResults(Results);
+
+	if (const FString* OutputPath = Params.Find(TEXT("Output")))
+	{
+		if (!FFileHelper::SaveStringToFile(Simulator.ResultsToCsv(Results), **OutputPath))
+		{
+			UE_LOG(LogLyraShotSimulation, Error, TEXT("Failed to write %s."), **OutputPath);
+			return 1;
+		}
+	}
+
+	// Balance gates
+	bool bPassed = true;
+	const FString* MaxMedianTTK = Params.Find(TEXT("MaxMedianTTK"));
+	const FString* MinAccuracy = Params.Find(TEXT("MinAccuracy"));
+	for (const FLyraShotSimulationResult& Result : Results)
+	{
+		if (MaxMedianTTK && ((Result.NumKills * 2 < Result.NumEngagements) || (Result.MedianTimeToKill > FCString::Atof(**MaxMedianTTK))))
+		{
+			UE_LOG(LogLyraShotSimulation, Error, TEXT("At %.0f cm the median time to kill is over %s s (%d of %d engagements killed, median %.3f s)."),
+				Result.Distance, **MaxMedianTTK, Result.NumKills, Result.NumEngagements, Result.MedianTimeToKill);
+			bPassed = false;
+		}
+
+		if (MinAccuracy && (Result.GetAccuracy() < FCString::Atof(**MinAccuracy)))
+		{
+			UE_LOG(LogLyraShotSimulation, Error, TEXT("At %.0f cm the accuracy %.3f is under %s."), Result.Distance, Result.GetAccuracy(), **MinAccuracy);
+			bPassed = false;
+		}
+	}
+
+	return bPassed ? 0 : 1;
+}
@@ -0,0 +1,28 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "LyraShotSimulationCommandlet.generated.h"
+
+class UObject;
+
+/**
+ * Runs the analytic shot simulator (FLyraShotSimulator) on a ranged weapon instance class, for balance regression checks in automation.
+ *
+ * Usage: -run=LyraShotSimulation -Weapon=<ClassPath> [-Engagements=100000] [-Distances=500+1000+2000+4000] [-BaseDamage=20] [-FireInterval=0.1]
+ *        [-AimError=0] [-Seed=0] [-Aiming] [-Moving] [-Crouching] [-Falling] [-AimAtHead] [-Output=<CsvPath>] [-MaxMedianTTK=<Seconds>] [-MinAccuracy=<0..1>]
+ *
+ * Returns non zero if the weapon could not be simulated or any distance misses one of the given thresholds.
+ */
+UCLASS()
+class ULyraShotSimulationCommandlet : public UCommandlet
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	// Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	// End UCommandlet Interface
+};
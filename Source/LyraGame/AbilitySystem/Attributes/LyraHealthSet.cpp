@@ -7,6 +7,7 @@
 #include "AbilitySystem/LyraAbilitySystemComponent.h"
 #include "Engine/World.h"
 #include "GameplayEffectExtension.h"
+#include "Messages/LyraDamageMessageSubsystem.h"
 #include "Messages/LyraVerbMessage.h"
 #include "GameFramework/GameplayMessageSubsystem.h"
 
@@ -110,8 +111,16 @@ void ULyraHealthSet::PostGameplayEffectExecute(const FGameplayEffectModCallbackD
 			//@TODO: Determine if it's an opposing team kill, self-own, team kill, etc...
 			Message.Magnitude = Data.EvaluatedData.Magnitude;
 
-			UGameplayMessageSubsystem& MessageSystem = UGameplayMessageSubsystem::Get(GetWorld());
-			MessageSystem.BroadcastMessage(Message.Verb, Message);
+			// Combined with the other hits from the same instigator this frame
+			if (ULyraDamageMessageSubsystem* DamageMessages = UWorld::GetSubsystem<ULyraDamageMessageSubsystem>(GetWorld()))
+			{
+				DamageMessages->AddDamageMessage(Message);
+			}
+			else
+			{
+				UGameplayMessageSubsystem& MessageSystem = UGameplayMessageSubsystem::Get(GetWorld());
+				MessageSystem.BroadcastMessage(Message.Verb, Message);
+			}
 		}
 
 		// Convert into -Health and then clamp
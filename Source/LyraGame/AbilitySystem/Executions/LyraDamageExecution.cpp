@@ -6,6 +6,7 @@
 #include "AbilitySystem/LyraGameplayEffectContext.h"
 #include "AbilitySystem/LyraAbilitySourceInterface.h"
 #include "Engine/World.h"
+#include "Performance/LyraServerTickBudget.h"
 #include "Teams/LyraTeamSubsystem.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraDamageExecution)
@@ -35,6 +36,8 @@ ULyraDamageExecution::ULyraDamageExecution()
 void ULyraDamageExecution::Execute_Implementation(const FGameplayEffectCustomExecutionParameters& ExecutionParams, FGameplayEffectCustomExecutionOutput& OutExecutionOutput) const
 {
 #if WITH_SERVER_CODE
+	LYRA_SERVER_BUDGET_SCOPE(DamageExecution);
+
 	const FGameplayEffectSpec& Spec = ExecutionParams.GetOwningSpec();
 	FLyraGameplayEffectContext* TypedContext = FLyraGameplayEffectContext::ExtractEffectContext(Spec.GetContext());
 	check(TypedContext);
@@ -112,14 +115,27 @@ void ULyraDamageExecution::Execute_Implementation(const FGameplayEffectCustomExe
 		ensureMsgf(false, TEXT("Damage Calculation cannot deduce a source location for damage coming from %s; Falling back to WORLD_MAX dist!"), *GetPathNameSafe(Spec.Def));
 	}
 
+	const float DamageDone = CalculateDamageDone(BaseDamage, TypedContext->GetAbilitySource(), Distance, TypedContext->GetPhysicalMaterial(), SourceTags, TargetTags, DamageInteractionAllowedMultiplier);
+
+	if (DamageDone > 0.0f)
+	{
+		// Apply a damage modifier, this gets turned into - health on the target
+		OutExecutionOutput.AddOutputModifier(FGameplayModifierEvaluatedData(ULyraHealthSet::GetDamageAttribute(), EGameplayModOp::Additive, DamageDone));
+	}
+#endif // #if WITH_SERVER_CODE
+}
+
+float ULyraDamageExecution::CalculateDamageDone(float BaseDamage, const ILyraAbilitySourceInterface* AbilitySource, double Distance, const UPhysicalMaterial* PhysicalMaterial,
+	const FGameplayTagContainer* SourceTags, const FGameplayTagContainer* TargetTags, float DamageInteractionAllowedMultiplier)
+{
 	// Apply ability source modifiers
 	float PhysicalMaterialAttenuation = 1.0f;
 	float DistanceAttenuation = 1.0f;
-	if (const ILyraAbilitySourceInterface* AbilitySource = TypedContext->GetAbilitySource())
+	if (AbilitySource)
 	{
-		if (const UPhysicalMaterial* PhysMat = TypedContext->GetPhysicalMaterial())
+		if (PhysicalMaterial)
 		{
-			PhysicalMaterialAttenuation = AbilitySource->GetPhysicalMaterialAttenuation(PhysMat, SourceTags, TargetTags);
+			PhysicalMaterialAttenuation = AbilitySource->GetPhysicalMaterialAttenuation(PhysicalMaterial, SourceTags, TargetTags);
 		}
 
 		DistanceAttenuation = AbilitySource->GetDistanceAttenuation(Distance, SourceTags, TargetTags);
@@ -127,13 +143,6 @@ void ULyraDamageExecution::Execute_Implementation(const FGameplayEffectCustomExe
 	DistanceAttenuation = FMath::Max(DistanceAttenuation, 0.0f);
 
 	// Clamping is done when damage is converted to -health
-	const float DamageDone = FMath::Max(BaseDamage * DistanceAttenuation * PhysicalMaterialAttenuation * DamageInteractionAllowedMultiplier, 0.0f);
-
-	if (DamageDone > 0.0f)
-	{
-		// Apply a damage modifier, this gets turned into - health on the target
-		OutExecutionOutput.AddOutputModifier(FGameplayModifierEvaluatedData(ULyraHealthSet::GetDamageAttribute(), EGameplayModOp::Additive, DamageDone));
-	}
-#endif // #if WITH_SERVER_CODE
+	return FMath::Max(BaseDamage * DistanceAttenuation * PhysicalMaterialAttenuation * DamageInteractionAllowedMultiplier, 0.0f);
 }
 
@@ -6,7 +6,10 @@
 
 #include "LyraDamageExecution.generated.h"
 
+class ILyraAbilitySourceInterface;
 class UObject;
+class UPhysicalMaterial;
+struct FGameplayTagContainer;
 
 
 /**
@@ -23,6 +26,10 @@ public:
 
 	ULyraDamageExecution();
 
+	// The damage done by a hit before it is converted to -health (also used by FLyraShotSimulator, so keep it free of any world state)
+	static float CalculateDamageDone(float BaseDamage, const ILyraAbilitySourceInterface* AbilitySource, double Distance, const UPhysicalMaterial* PhysicalMaterial,
+		const FGameplayTagContainer* SourceTags, const FGameplayTagContainer* TargetTags, float DamageInteractionAllowedMultiplier);
+
 protected:
 
 	virtual void Execute_Implementation(const FGameplayEffectCustomExecutionParameters& ExecutionParams, FGameplayEffectCustomExecutionOutput& OutExecutionOutput) const override;
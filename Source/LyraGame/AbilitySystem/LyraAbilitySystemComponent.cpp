@@ -4,18 +4,32 @@
 
 #include "AbilitySystem/Abilities/LyraGameplayAbility.h"
 #include "AbilitySystem/LyraAbilityTagRelationshipMapping.h"
+#include "AbilitySystemGlobals.h"
 #include "Animation/LyraAnimInstance.h"
 #include "Engine/World.h"
 #include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
 #include "LyraGlobalAbilitySystem.h"
 #include "LyraLogChannels.h"
 #include "System/LyraAssetManager.h"
 #include "System/LyraGameData.h"
+#include "UObject/UObjectIterator.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraAbilitySystemComponent)
 
 UE_DEFINE_GAMEPLAY_TAG(TAG_Gameplay_AbilityInputBlocked, "Gameplay.AbilityInputBlocked");
 
+namespace LyraConsoleVariables
+{
+	static bool bBatchServerAbilityRPCs = true;
+	static FAutoConsoleVariableRef CVarBatchServerAbilityRPCs(
+		TEXT("Lyra.AbilitySystem.BatchServerAbilityRPCs"),
+		bBatchServerAbilityRPCs,
+		TEXT("When true, abilities activated from input on clients send their activation, target data and end to the server in a single RPC when they happen in the same frame."),
+		ECVF_Default);
+}
+
 ULyraAbilitySystemComponent::ULyraAbilitySystemComponent(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
@@ -180,12 +194,12 @@ void ULyraAbilitySystemComponent::AbilityInputTagPressed(const FGameplayTag& Inp
 {
 	if (InputTag.IsValid())
 	{
-		for (const FGameplayAbilitySpec& AbilitySpec : ActivatableAbilities.Items)
+		if (const auto* SpecHandles = DynamicTagToSpecHandles.Find(InputTag))
 		{
-			if (AbilitySpec.Ability && (AbilitySpec.DynamicAbilityTags.HasTagExact(InputTag)))
+			for (const FGameplayAbilitySpecHandle& SpecHandle : *SpecHandles)
 			{
-				InputPressedSpecHandles.AddUnique(AbilitySpec.Handle);
-				InputHeldSpecHandles.AddUnique(AbilitySpec.Handle);
+				InputPressedSpecHandles.Add(SpecHandle);
+				InputHeldSpecHandles.Add(SpecHandle);
 			}
 		}
 	}
@@ -195,17 +209,197 @@ void ULyraAbilitySystemComponent::AbilityInputTagReleased(const FGameplayTag& In
 {
 	if (InputTag.IsValid())
 	{
+		if (const auto* SpecHandles = DynamicTagToSpecHandles.Find(InputTag))
+		{
+			for (const FGameplayAbilitySpecHandle& SpecHandle : *SpecHandles)
+			{
+				InputReleasedSpecHandles.Add(SpecHandle);
+				InputHeldSpecHandles.Remove(SpecHandle);
+			}
+		}
+	}
+}
+
+void ULyraAbilitySystemComponent::OnGiveAbility(FGameplayAbilitySpec& AbilitySpec)
+{
+	Super::OnGiveAbility(AbilitySpec);
+
+	AddToInputTagIndex(AbilitySpec);
+}
+
+void ULyraAbilitySystemComponent::OnRemoveAbility(FGameplayAbilitySpec& AbilitySpec)
+{
+	RemoveFromInputTagIndex(AbilitySpec.Handle);
+
+	InputPressedSpecHandles.Remove(AbilitySpec.Handle);
+	InputReleasedSpecHandles.Remove(AbilitySpec.Handle);
+	InputHeldSpecHandles.Remove(AbilitySpec.Handle);
+
+	Super::OnRemoveAbility(AbilitySpec);
+}
+
+void ULyraAbilitySystemComponent::RefreshAbilityInputTags(const FGameplayAbilitySpecHandle& Handle)
+{
+	RemoveFromInputTagIndex(Handle);
+
+	if (const FGameplayAbilitySpec* AbilitySpec = FindAbilitySpecFromHandle(Handle))
+	{
+		AddToInputTagIndex(*AbilitySpec);
+	}
+}
+
+void ULyraAbilitySystemComponent::AddToInputTagIndex(const FGameplayAbilitySpec& AbilitySpec)
+{
+	if (AbilitySpec.Ability == nullptr)
+	{
+		return;
+	}
+
+	for (const FGameplayTag& DynamicTag : AbilitySpec.DynamicAbilityTags)
+	{
+		DynamicTagToSpecHandles.FindOrAdd(DynamicTag).AddUnique(AbilitySpec.Handle);
+	}
+}
+
+void ULyraAbilitySystemComponent::RemoveFromInputTagIndex(const FGameplayAbilitySpecHandle& Handle)
+{
+	// The dynamic tags may have changed since the ability was indexed, so look everywhere (there are only a few input tags)
+	for (auto It = DynamicTagToSpecHandles.CreateIterator(); It; ++It)
+	{
+		It.Value().Remove(Handle);
+		if (It.Value().Num() == 0)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+bool ULyraAbilitySystemComponent::ShouldDoServerAbilityRPCBatch() const
+{
+	return LyraConsoleVariables::bBatchServerAbilityRPCs;
+}
+
+#if !UE_BUILD_SHIPPING
+void ULyraAbilitySystemComponent::RunInputDispatchBenchmark(int32 Iterations, double& OutLinearSeconds, double& OutIndexedSeconds, int32& OutMismatches) const
+{
+	TArray<FGameplayAbilitySpecHandle> LinearHandles;
+	int32 NumIndexed = 0;
+
+	for (const auto& Pair : DynamicTagToSpecHandles)
+	{
+		const FGameplayTag& InputTag = Pair.Key;
+
+		// What AbilityInputTagPressed used to do
+		const double LinearStart = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			LinearHandles.Reset();
+			for (const FGameplayAbilitySpec& AbilitySpec : ActivatableAbilities.Items)
+			{
+				if (AbilitySpec.Ability && (AbilitySpec.DynamicAbilityTags.HasTagExact(InputTag)))
+				{
+					LinearHandles.AddUnique(AbilitySpec.Handle);
+				}
+			}
+		}
+		OutLinearSeconds += FPlatformTime::Seconds() - LinearStart;
+
+		const double IndexedStart = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			if (const auto* SpecHandles = DynamicTagToSpecHandles.Find(InputTag))
+			{
+				NumIndexed = SpecHandles->Num();
+			}
+		}
+		OutIndexedSeconds += FPlatformTime::Seconds() - IndexedStart;
+
+		OutMismatches += (LinearHandles.Num() != NumIndexed) ? 1 : 0;
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GLyraAbilitySystemBenchmarkInputDispatchCmd(
+	TEXT("Lyra.AbilitySystem.BenchmarkInputDispatch"),
+	TEXT("Times input tag dispatch for every ability system component in the world (bots included) against a scan of all granted abilities. Usage: Lyra.AbilitySystem.BenchmarkInputDispatch [Iterations=1000]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 Iterations = (Args.Num() > 0) ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 1000;
+
+		int32 NumComponents = 0;
+		int32 NumAbilities = 0;
+		int32 NumMismatches = 0;
+		double LinearSeconds = 0.0;
+		double IndexedSeconds = 0.0;
+		for (TObjectIterator<ULyraAbilitySystemComponent> It; It; ++It)
+		{
+			if (It->GetWorld() == World)
+			{
+				It->RunInputDispatchBenchmark(Iterations, LinearSeconds, IndexedSeconds, NumMismatches);
+				NumAbilities += It->GetActivatableAbilities().Num();
+				++NumComponents;
+			}
+		}
+
+		UE_LOG(LogLyraAbilitySystem, Display, TEXT("Input dispatch over %d components (%.1f abilities each): linear %.3f ms, indexed %.3f ms for %d iterations, %d mismatches"),
+			NumComponents, (NumComponents > 0) ? (float)NumAbilities / NumComponents : 0.0f, LinearSeconds * 1000.0, IndexedSeconds * 1000.0, Iterations, NumMismatches);
+	}));
+
+void ULyraAbilitySystemComponent::RunCanActivateBenchmark(int32 Iterations, double& OutSeconds, int32& OutNumCanActivate) const
+{
+	const FGameplayAbilityActorInfo* ActorInfo = AbilityActorInfo.Get();
+
+	const double Start = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		OutNumCanActivate = 0;
 		for (const FGameplayAbilitySpec& AbilitySpec : ActivatableAbilities.Items)
 		{
-			if (AbilitySpec.Ability && (AbilitySpec.DynamicAbilityTags.HasTagExact(InputTag)))
+			if (AbilitySpec.Ability && AbilitySpec.Ability->CanActivateAbility(AbilitySpec.Handle, ActorInfo))
 			{
-				InputReleasedSpecHandles.AddUnique(AbilitySpec.Handle);
-				InputHeldSpecHandles.Remove(AbilitySpec.Handle);
+				++OutNumCanActivate;
 			}
 		}
 	}
+	OutSeconds += FPlatformTime::Seconds() - Start;
 }
 
+static FAutoConsoleCommandWithWorldAndArgs GLyraAbilitySystemBenchmarkCanActivateCmd(
+	TEXT("Lyra.AbilitySystem.BenchmarkCanActivate"),
+	TEXT("Times CanActivateAbility for every ability given to the local player with the compiled tag relationships and with the old iteration. Usage: Lyra.AbilitySystem.BenchmarkCanActivate [Iterations=1000]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 Iterations = (Args.Num() > 0) ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 1000;
+
+		const APlayerController* PC = (World != nullptr) ? World->GetFirstPlayerController() : nullptr;
+		const ULyraAbilitySystemComponent* LyraASC = (PC != nullptr) ? Cast<ULyraAbilitySystemComponent>(UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(PC->GetPawn())) : nullptr;
+		IConsoleVariable* UseCompiledCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("Lyra.AbilitySystem.UseCompiledTagRelationships"));
+		if ((LyraASC == nullptr) || (UseCompiledCVar == nullptr))
+		{
+			UE_LOG(LogLyraAbilitySystem, Warning, TEXT("Lyra.AbilitySystem.BenchmarkCanActivate needs a local pawn with an ability system component"));
+			return;
+		}
+
+		const bool bWasUsingCompiled = UseCompiledCVar->GetBool();
+
+		double IterationSeconds = 0.0;
+		int32 IterationCanActivate = 0;
+		UseCompiledCVar->Set(false);
+		LyraASC->RunCanActivateBenchmark(Iterations, IterationSeconds, IterationCanActivate);
+
+		double CompiledSeconds = 0.0;
+		int32 CompiledCanActivate = 0;
+		UseCompiledCVar->Set(true);
+		LyraASC->RunCanActivateBenchmark(Iterations, CompiledSeconds, CompiledCanActivate);
+
+		UseCompiledCVar->Set(bWasUsingCompiled);
+
+		const int32 NumChecks = Iterations * LyraASC->GetActivatableAbilities().Num();
+		UE_LOG(LogLyraAbilitySystem, Display, TEXT("CanActivateAbility x %d: iteration %.3f ms (%.0f checks/s), compiled %.3f ms (%.0f checks/s), %d vs %d can activate"),
+			NumChecks, IterationSeconds * 1000.0, NumChecks / FMath::Max(IterationSeconds, UE_DOUBLE_SMALL_NUMBER),
+			CompiledSeconds * 1000.0, NumChecks / FMath::Max(CompiledSeconds, UE_DOUBLE_SMALL_NUMBER), IterationCanActivate, CompiledCanActivate);
+	}));
+#endif // !UE_BUILD_SHIPPING
+
 void ULyraAbilitySystemComponent::ProcessAbilityInput(float DeltaTime, bool bGamePaused)
 {
 	if (HasMatchingGameplayTag(TAG_Gameplay_AbilityInputBlocked))
@@ -214,11 +408,8 @@ void ULyraAbilitySystemComponent::ProcessAbilityInput(float DeltaTime, bool bGam
 		return;
 	}
 
-	static TArray<FGameplayAbilitySpecHandle> AbilitiesToActivate;
 	AbilitiesToActivate.Reset();
 
-	//@TODO: See if we can use FScopedServerAbilityRPCBatcher ScopedRPCBatcher in some of these loops
-
 	//
 	// Process all abilities that activate when the input is held.
 	//
@@ -232,7 +423,7 @@ void ULyraAbilitySystemComponent::ProcessAbilityInput(float DeltaTime, bool bGam
 
 				if (LyraAbilityCDO->GetActivationPolicy() == ELyraAbilityActivationPolicy::WhileInputActive)
 				{
-					AbilitiesToActivate.AddUnique(AbilitySpec->Handle);
+					AbilitiesToActivate.Add(AbilitySpec->Handle);
 				}
 			}
 		}
@@ -260,7 +451,7 @@ void ULyraAbilitySystemComponent::ProcessAbilityInput(float DeltaTime, bool bGam
 
 					if (LyraAbilityCDO->GetActivationPolicy() == ELyraAbilityActivationPolicy::OnInputTriggered)
 					{
-						AbilitiesToActivate.AddUnique(AbilitySpec->Handle);
+						AbilitiesToActivate.Add(AbilitySpec->Handle);
 					}
 				}
 			}
@@ -274,8 +465,11 @@ void ULyraAbilitySystemComponent::ProcessAbilityInput(float DeltaTime, bool bGam
 	//
 	for (const FGameplayAbilitySpecHandle& AbilitySpecHandle : AbilitiesToActivate)
 	{
+		// Abilities that activate, send target data and end this frame do it in a single server RPC (see ShouldDoServerAbilityRPCBatch)
+		FScopedServerAbilityRPCBatcher ScopedRPCBatcher(this, AbilitySpecHandle);
 		TryActivateAbility(AbilitySpecHandle);
 	}
+	AbilitiesToActivate.Reset();
 
 	//
 	// Process all abilities that had their input released this frame.
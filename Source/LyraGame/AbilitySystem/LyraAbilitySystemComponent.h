@@ -68,6 +68,21 @@ public:
 	/** Looks at ability tags and gathers additional required and blocking tags */
 	void GetAdditionalActivationTagRequirements(const FGameplayTagContainer& AbilityTags, FGameplayTagContainer& OutActivationRequired, FGameplayTagContainer& OutActivationBlocked) const;
 
+	/** Call after changing the dynamic tags (e.g., the input tag) of an ability that was already given */
+	void RefreshAbilityInputTags(const FGameplayAbilitySpecHandle& Handle);
+
+#if !UE_BUILD_SHIPPING
+	/** Times input tag dispatch through the index against a scan of all abilities and logs the results */
+	void RunInputDispatchBenchmark(int32 Iterations, double& OutLinearSeconds, double& OutIndexedSeconds, int32& OutMismatches) const;
+
+	/** Calls CanActivateAbility on every given ability and returns the time taken and how many could activate */
+	void RunCanActivateBenchmark(int32 Iterations, double& OutSeconds, int32& OutNumCanActivate) const;
+#endif
+
+	//~UAbilitySystemComponent interface
+	virtual bool ShouldDoServerAbilityRPCBatch() const override;
+	//~End of UAbilitySystemComponent interface
+
 protected:
 
 	void TryActivateAbilitiesOnSpawn();
@@ -75,6 +90,12 @@ protected:
 	virtual void AbilitySpecInputPressed(FGameplayAbilitySpec& Spec) override;
 	virtual void AbilitySpecInputReleased(FGameplayAbilitySpec& Spec) override;
 
+	virtual void OnGiveAbility(FGameplayAbilitySpec& AbilitySpec) override;
+	virtual void OnRemoveAbility(FGameplayAbilitySpec& AbilitySpec) override;
+
+	void AddToInputTagIndex(const FGameplayAbilitySpec& AbilitySpec);
+	void RemoveFromInputTagIndex(const FGameplayAbilitySpecHandle& Handle);
+
 	virtual void NotifyAbilityActivated(const FGameplayAbilitySpecHandle Handle, UGameplayAbility* Ability) override;
 	virtual void NotifyAbilityFailed(const FGameplayAbilitySpecHandle Handle, UGameplayAbility* Ability, const FGameplayTagContainer& FailureReason) override;
 	virtual void NotifyAbilityEnded(FGameplayAbilitySpecHandle Handle, UGameplayAbility* Ability, bool bWasCancelled) override;
@@ -93,13 +114,19 @@ protected:
 	TObjectPtr<ULyraAbilityTagRelationshipMapping> TagRelationshipMapping;
 
 	// Handles to abilities that had their input pressed this frame.
-	TArray<FGameplayAbilitySpecHandle> InputPressedSpecHandles;
+	TSet<FGameplayAbilitySpecHandle> InputPressedSpecHandles;
 
 	// Handles to abilities that had their input released this frame.
-	TArray<FGameplayAbilitySpecHandle> InputReleasedSpecHandles;
+	TSet<FGameplayAbilitySpecHandle> InputReleasedSpecHandles;
 
 	// Handles to abilities that have their input held.
-	TArray<FGameplayAbilitySpecHandle> InputHeldSpecHandles;
+	TSet<FGameplayAbilitySpecHandle> InputHeldSpecHandles;
+
+	// Handles to abilities to activate this frame, only used during ProcessAbilityInput.
+	TSet<FGameplayAbilitySpecHandle> AbilitiesToActivate;
+
+	// Handles to the given abilities that have each dynamic ability tag (input tags are added as dynamic tags).
+	TMap<FGameplayTag, TArray<FGameplayAbilitySpecHandle, TInlineAllocator<2>>> DynamicTagToSpecHandles;
 
 	// Number of abilities running in each activation group.
 	int32 ActivationGroupCounts[(uint8)ELyraAbilityActivationGroup::MAX];
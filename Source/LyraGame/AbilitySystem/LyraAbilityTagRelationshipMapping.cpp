@@ -2,11 +2,139 @@
 
 #include "AbilitySystem/LyraAbilityTagRelationshipMapping.h"
 
+#include "HAL/IConsoleManager.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraAbilityTagRelationshipMapping)
 
+namespace LyraConsoleVariables
+{
+	static bool bUseCompiledTagRelationships = true;
+	static FAutoConsoleVariableRef CVarUseCompiledTagRelationships(
+		TEXT("Lyra.AbilitySystem.UseCompiledTagRelationships"),
+		bUseCompiledTagRelationships,
+		TEXT("When true, ability tag relationships are looked up in the compiled table instead of iterating every relationship (for comparison)."),
+		ECVF_Default);
+
+	static int32 MaxCachedTagRelationshipResults = 1024;
+	static FAutoConsoleVariableRef CVarMaxCachedTagRelationshipResults(
+		TEXT("Lyra.AbilitySystem.MaxCachedTagRelationshipResults"),
+		MaxCachedTagRelationshipResults,
+		TEXT("The maximum number of ability tag containers whose merged relationships are cached per mapping. The cache is flushed when full."),
+		ECVF_Default);
+}
+
+namespace LyraTagRelationships
+{
+	// Independent of the order of the tags, equal containers always hash the same
+	static uint32 HashAbilityTags(const FGameplayTagContainer& AbilityTags)
+	{
+		uint32 Hash = AbilityTags.Num();
+		for (const FGameplayTag& Tag : AbilityTags)
+		{
+			Hash += MurmurFinalize32(GetTypeHash(Tag));
+		}
+		return Hash;
+	}
+}
+
+void ULyraAbilityTagRelationshipMapping::FMergedRelationship::Append(const FMergedRelationship& Other)
+{
+	AbilityTagsToBlock.AppendTags(Other.AbilityTagsToBlock);
+	AbilityTagsToCancel.AppendTags(Other.AbilityTagsToCancel);
+	ActivationRequiredTags.AppendTags(Other.ActivationRequiredTags);
+	ActivationBlockedTags.AppendTags(Other.ActivationBlockedTags);
+}
+
+void ULyraAbilityTagRelationshipMapping::PostLoad()
+{
+	Super::PostLoad();
+
+	CompileRelationships();
+}
+
+#if WITH_EDITOR
+void ULyraAbilityTagRelationshipMapping::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	CompileRelationships();
+}
+#endif
+
+void ULyraAbilityTagRelationshipMapping::CompileRelationships()
+{
+	CompiledRelationships.Reset();
+	CachedResults.Reset();
+
+	for (const FLyraAbilityTagRelationship& Tags : AbilityTagRelationships)
+	{
+		if (Tags.AbilityTag.IsValid())
+		{
+			FMergedRelationship& Merged = CompiledRelationships.FindOrAdd(Tags.AbilityTag);
+			Merged.AbilityTagsToBlock.AppendTags(Tags.AbilityTagsToBlock);
+			Merged.AbilityTagsToCancel.AppendTags(Tags.AbilityTagsToCancel);
+			Merged.ActivationRequiredTags.AppendTags(Tags.ActivationRequiredTags);
+			Merged.ActivationBlockedTags.AppendTags(Tags.ActivationBlockedTags);
+		}
+	}
+
+	bCompiled = true;
+}
+
+const ULyraAbilityTagRelationshipMapping::FMergedRelationship* ULyraAbilityTagRelationshipMapping::FindMergedRelationship(const FGameplayTagContainer& AbilityTags) const
+{
+	const uint32 Hash = LyraTagRelationships::HashAbilityTags(AbilityTags);
+	if (const FCachedResult* CachedResult = CachedResults.Find(Hash))
+	{
+		if (CachedResult->AbilityTags == AbilityTags)
+		{
+			return &CachedResult->Merged;
+		}
+	}
+
+	// A relationship applies if the ability has its tag or a child of it, so look up every tag and its parents
+	FMergedRelationship Merged;
+	for (const FGameplayTag& AbilityTag : AbilityTags)
+	{
+		for (const FGameplayTag& Tag : AbilityTag.GetGameplayTagParents())
+		{
+			if (const FMergedRelationship* Relationship = CompiledRelationships.Find(Tag))
+			{
+				Merged.Append(*Relationship);
+			}
+		}
+	}
+
+	if (CachedResults.Num() >= LyraConsoleVariables::MaxCachedTagRelationshipResults)
+	{
+		CachedResults.Reset();
+	}
+
+	// On a hash collision the newer container wins the slot
+	FCachedResult& NewResult = CachedResults.Add(Hash);
+	NewResult.AbilityTags = AbilityTags;
+	NewResult.Merged = MoveTemp(Merged);
+	return &NewResult.Merged;
+}
+
 void ULyraAbilityTagRelationshipMapping::GetAbilityTagsToBlockAndCancel(const FGameplayTagContainer& AbilityTags, FGameplayTagContainer* OutTagsToBlock, FGameplayTagContainer* OutTagsToCancel) const
 {
+	if (bCompiled && LyraConsoleVariables::bUseCompiledTagRelationships)
+	{
+		if (const FMergedRelationship* Merged = FindMergedRelationship(AbilityTags))
+		{
+			if (OutTagsToBlock)
+			{
+				OutTagsToBlock->AppendTags(Merged->AbilityTagsToBlock);
+			}
+			if (OutTagsToCancel)
+			{
+				OutTagsToCancel->AppendTags(Merged->AbilityTagsToCancel);
+			}
+		}
+		return;
+	}
+
 	// Simple iteration for now
 	for (int32 i = 0; i < AbilityTagRelationships.Num(); i++)
 	{
@@ -27,6 +155,22 @@ void ULyraAbilityTagRelationshipMapping::GetAbilityTagsToBlockAndCancel(const FG
 
 void ULyraAbilityTagRelationshipMapping::GetRequiredAndBlockedActivationTags(const FGameplayTagContainer& AbilityTags, FGameplayTagContainer* OutActivationRequired, FGameplayTagContainer* OutActivationBlocked) const
 {
+	if (bCompiled && LyraConsoleVariables::bUseCompiledTagRelationships)
+	{
+		if (const FMergedRelationship* Merged = FindMergedRelationship(AbilityTags))
+		{
+			if (OutActivationRequired)
+			{
+				OutActivationRequired->AppendTags(Merged->ActivationRequiredTags);
+			}
+			if (OutActivationBlocked)
+			{
+				OutActivationBlocked->AppendTags(Merged->ActivationBlockedTags);
+			}
+		}
+		return;
+	}
+
 	// Simple iteration for now
 	for (int32 i = 0; i < AbilityTagRelationships.Num(); i++)
 	{
@@ -47,6 +191,12 @@ void ULyraAbilityTagRelationshipMapping::GetRequiredAndBlockedActivationTags(con
 
 bool ULyraAbilityTagRelationshipMapping::IsAbilityCancelledByTag(const FGameplayTagContainer& AbilityTags, const FGameplayTag& ActionTag) const
 {
+	if (bCompiled && LyraConsoleVariables::bUseCompiledTagRelationships)
+	{
+		const FMergedRelationship* Relationship = CompiledRelationships.Find(ActionTag);
+		return (Relationship != nullptr) && Relationship->AbilityTagsToCancel.HasAny(AbilityTags);
+	}
+
 	// Simple iteration for now
 	for (int32 i = 0; i < AbilityTagRelationships.Num(); i++)
 	{
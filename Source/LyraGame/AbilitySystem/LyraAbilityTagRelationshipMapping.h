@@ -37,7 +37,12 @@ struct FLyraAbilityTagRelationship
 };
 
 
-/** Mapping of how ability tags block or cancel other abilities */
+/**
+ * Mapping of how ability tags block or cancel other abilities
+ *
+ * The relationships are compiled on load into a table keyed by ability tag (relationships for the same tag merged), and the
+ * merged results for each set of ability tags queried are cached, so activation checks don't walk every relationship.
+ */
 UCLASS()
 class ULyraAbilityTagRelationshipMapping : public UDataAsset
 {
@@ -49,6 +54,13 @@ private:
 	TArray<FLyraAbilityTagRelationship> AbilityTagRelationships;
 
 public:
+	//~UObject interface
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+	//~End of UObject interface
+
 	/** Given a set of ability tags, parse the tag relationship and fill out tags to block and cancel */
 	void GetAbilityTagsToBlockAndCancel(const FGameplayTagContainer& AbilityTags, FGameplayTagContainer* OutTagsToBlock, FGameplayTagContainer* OutTagsToCancel) const;
 
@@ -57,4 +69,36 @@ public:
 
 	/** Returns true if the specified ability tags are canceled by the passed in action tag */
 	bool IsAbilityCancelledByTag(const FGameplayTagContainer& AbilityTags, const FGameplayTag& ActionTag) const;
+
+	/** Rebuilds the compiled table from AbilityTagRelationships (and clears the cached results) */
+	void CompileRelationships();
+
+private:
+	/** The merged containers of every relationship that applies to some ability tags */
+	struct FMergedRelationship
+	{
+		FGameplayTagContainer AbilityTagsToBlock;
+		FGameplayTagContainer AbilityTagsToCancel;
+		FGameplayTagContainer ActivationRequiredTags;
+		FGameplayTagContainer ActivationBlockedTags;
+
+		void Append(const FMergedRelationship& Other);
+	};
+
+	struct FCachedResult
+	{
+		FGameplayTagContainer AbilityTags;
+		FMergedRelationship Merged;
+	};
+
+	/** Returns the merged relationships that apply to the ability tags (from the cache when possible) */
+	const FMergedRelationship* FindMergedRelationship(const FGameplayTagContainer& AbilityTags) const;
+
+	/** The relationships merged per AbilityTag */
+	TMap<FGameplayTag, FMergedRelationship> CompiledRelationships;
+
+	/** Merged results keyed by an order independent hash of the ability tags (the tags are compared on a hit) */
+	mutable TMap<uint32, FCachedResult> CachedResults;
+
+	bool bCompiled = false;
 };
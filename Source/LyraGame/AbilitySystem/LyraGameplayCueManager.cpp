@@ -34,6 +34,20 @@ namespace LyraGameplayCueManagerCvars
 		TEXT("Shows all assets that were loaded via LyraGameplayCueManager and are currently in memory."),
 		FConsoleCommandWithArgsDelegate::CreateStatic(ULyraGameplayCueManager::DumpGameplayCues));
 
+#if !UE_BUILD_SHIPPING
+	static FAutoConsoleCommand CVarPreloadLoadTest(
+		TEXT("Lyra.GameplayCues.PreloadLoadTest"),
+		TEXT("Queues a preload of every gameplay cue in the runtime library (or the first N when given a number) and reports the longest frame slice spent scheduling them, the number of load requests and the memory used once they are all loaded."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(ULyraGameplayCueManager::PreloadLoadTest));
+#endif
+
+	static float PreloadBudgetMs = 0.5f;
+	static FAutoConsoleVariableRef CVarPreloadBudgetMs(
+		TEXT("Lyra.GameplayCues.PreloadBudgetMs"),
+		PreloadBudgetMs,
+		TEXT("Time in milliseconds spent each frame registering referenced gameplay cues; the ones that are not loaded yet are requested together in a single streamable handle. 0 means no limit."),
+		ECVF_Default);
+
 	static ELyraEditorLoadMode LoadMode = ELyraEditorLoadMode::LoadUpfront;
 }
 
@@ -141,14 +155,22 @@ void ULyraGameplayCueManager::DumpGameplayCues(const TArray<FString>& Args)
 	}
 
 	UE_LOG(LogLyra, Log, TEXT("=========== Dumping Preloaded Gameplay Cue Notifies ==========="));
-	for (UClass* CueClass : GCM->PreloadedCues)
+	TSet<UClass*> PreloadedCueSet;
+	for (int32 Slot = 0; Slot < GCM->PreloadedCues.Num(); ++Slot)
 	{
-		TSet<FObjectKey>* ReferencerSet = GCM->PreloadedCueReferencers.Find(CueClass);
-		int32 NumRefs = ReferencerSet ? ReferencerSet->Num() : 0;
-		UE_LOG(LogLyra, Log, TEXT("  %s (%d refs)"), *GetPathNameSafe(CueClass), NumRefs);
-		if (bIncludeRefs && ReferencerSet)
+		UClass* CueClass = GCM->PreloadedCues[Slot];
+		if (CueClass == nullptr)
+		{
+			continue;
+		}
+
+		PreloadedCueSet.Add(CueClass);
+
+		const TArray<FObjectKey>& Referencers = GCM->PreloadedCueReferencers[Slot];
+		UE_LOG(LogLyra, Log, TEXT("  %s (%d refs)"), *GetPathNameSafe(CueClass), Referencers.Num());
+		if (bIncludeRefs)
 		{
-			for (const FObjectKey& Ref : *ReferencerSet)
+			for (const FObjectKey& Ref : Referencers)
 			{
 				UObject* RefObject = Ref.ResolveObjectPtr();
 				UE_LOG(LogLyra, Log, TEXT("    ^- %s"), *GetPathNameSafe(RefObject));
@@ -162,7 +184,7 @@ void ULyraGameplayCueManager::DumpGameplayCues(const TArray<FString>& Args)
 	{
 		for (const FGameplayCueNotifyData& CueData : GCM->RuntimeGameplayCueObjectLibrary.CueSet->GameplayCueData)
 		{
-			if (CueData.LoadedGameplayCueClass && !GCM->AlwaysLoadedCues.Contains(CueData.LoadedGameplayCueClass) && !GCM->PreloadedCues.Contains(CueData.LoadedGameplayCueClass))
+			if (CueData.LoadedGameplayCueClass && !GCM->AlwaysLoadedCues.Contains(CueData.LoadedGameplayCueClass) && !PreloadedCueSet.Contains(CueData.LoadedGameplayCueClass))
 			{
 				NumMissingCuesLoaded++;
 				UE_LOG(LogLyra, Log, TEXT("  %s"), *CueData.LoadedGameplayCueClass->GetPathName());
@@ -172,11 +194,78 @@ void ULyraGameplayCueManager::DumpGameplayCues(const TArray<FString>& Args)
 
 	UE_LOG(LogLyra, Log, TEXT("=========== Gameplay Cue Notify summary ==========="));
 	UE_LOG(LogLyra, Log, TEXT("  ... %d cues in always loaded list"), GCM->AlwaysLoadedCues.Num());
-	UE_LOG(LogLyra, Log, TEXT("  ... %d cues in preloaded list"), GCM->PreloadedCues.Num());
+	UE_LOG(LogLyra, Log, TEXT("  ... %d cues in preloaded list"), GCM->NumPreloadedCues);
 	UE_LOG(LogLyra, Log, TEXT("  ... %d cues loaded on demand"), NumMissingCuesLoaded);
-	UE_LOG(LogLyra, Log, TEXT("  ... %d cues in total"), GCM->AlwaysLoadedCues.Num() + GCM->PreloadedCues.Num() + NumMissingCuesLoaded);
+	UE_LOG(LogLyra, Log, TEXT("  ... %d cues in total"), GCM->AlwaysLoadedCues.Num() + GCM->NumPreloadedCues + NumMissingCuesLoaded);
+	UE_LOG(LogLyra, Log, TEXT("  ... %d preloads waiting to be scheduled, %d load requests in flight (%d issued), longest scheduling slice %.3f ms"),
+		GCM->PendingCuePreloads.Num() - GCM->NextPendingCuePreload, GCM->NumPreloadBatchesInFlight, GCM->NumPreloadBatchesIssued, GCM->LongestPreloadSliceSeconds * 1000.0);
 }
 
+#if !UE_BUILD_SHIPPING
+void ULyraGameplayCueManager::PreloadLoadTest(const TArray<FString>& Args)
+{
+	ULyraGameplayCueManager* GCM = Get();
+	if (!GCM || !GCM->RuntimeGameplayCueObjectLibrary.CueSet)
+	{
+		UE_LOG(LogLyra, Error, TEXT("PreloadLoadTest failed. No ULyraGameplayCueManager or runtime cue set found."));
+		return;
+	}
+
+	if (GCM->LoadTestReferencer.IsValid())
+	{
+		UE_LOG(LogLyra, Warning, TEXT("PreloadLoadTest is already running."));
+		return;
+	}
+
+	const TArray<FGameplayCueNotifyData>& CueData = GCM->RuntimeGameplayCueObjectLibrary.CueSet->GameplayCueData;
+	int32 NumCues = CueData.Num();
+	if (Args.Num() > 0)
+	{
+		NumCues = FMath::Clamp(FCString::Atoi(*Args[0]), 0, NumCues);
+	}
+
+	// Any live object will do as the referencer, the cues it preloads are released on the next map load once it is gone
+	GCM->LoadTestReferencer.Reset(NewObject<UGameplayCueSet>(GetTransientPackage()));
+	GCM->LoadTestStartTime = FPlatformTime::Seconds();
+	GCM->LoadTestStartFrame = GFrameCounter;
+	GCM->LoadTestStartMemory = FPlatformMemory::GetStats().UsedPhysical;
+	GCM->LoadTestNumCues = NumCues;
+	GCM->LoadTestStartBatches = GCM->NumPreloadBatchesIssued;
+	GCM->LongestPreloadSliceSeconds = 0.0;
+
+	// Bypasses the load mode so the scheduler can be measured in any configuration (with LoadUpfront every cue is already loaded and only the bookkeeping is measured)
+	for (int32 CueIndex = 0; CueIndex < NumCues; ++CueIndex)
+	{
+		GCM->QueueCuePreload(CueData[CueIndex].GameplayCueTag, GCM->LoadTestReferencer.Get());
+	}
+
+	UE_LOG(LogLyra, Log, TEXT("PreloadLoadTest: queued %d cues with a %.2f ms budget per frame"), NumCues, LyraGameplayCueManagerCvars::PreloadBudgetMs);
+
+	GCM->CheckPreloadLoadTestComplete();
+}
+
+void ULyraGameplayCueManager::CheckPreloadLoadTestComplete()
+{
+	if (!LoadTestReferencer.IsValid() || (NextPendingCuePreload < PendingCuePreloads.Num()) || (NumPreloadBatchesInFlight > 0))
+	{
+		return;
+	}
+
+	const double ElapsedSeconds = FPlatformTime::Seconds() - LoadTestStartTime;
+	const int64 MemoryDelta = (int64)FPlatformMemory::GetStats().UsedPhysical - (int64)LoadTestStartMemory;
+
+	UE_LOG(LogLyra, Log, TEXT("PreloadLoadTest: %d cues preloaded in %.1f ms (%d frames), %d load requests, longest scheduling slice %.3f ms, %.2f MB of memory used"),
+		LoadTestNumCues,
+		ElapsedSeconds * 1000.0,
+		(int32)(GFrameCounter - LoadTestStartFrame),
+		NumPreloadBatchesIssued - LoadTestStartBatches,
+		LongestPreloadSliceSeconds * 1000.0,
+		(double)MemoryDelta / (1024.0 * 1024.0));
+
+	LoadTestReferencer.Reset();
+}
+#endif
+
 void ULyraGameplayCueManager::OnGameplayTagLoaded(const FGameplayTag& Tag)
 {
 	FScopeLock ScopeLock(&LoadedGameplayTagsToProcessCS);
@@ -267,36 +356,141 @@ void ULyraGameplayCueManager::ProcessTagToPreload(const FGameplayTag& Tag, UObje
 		break;
 	}
 
-	check(RuntimeGameplayCueObjectLibrary.CueSet);
+	QueueCuePreload(Tag, OwningObject);
+}
+
+void ULyraGameplayCueManager::QueueCuePreload(const FGameplayTag& Tag, UObject* OwningObject)
+{
+	FPendingCuePreload& PendingPreload = PendingCuePreloads.AddDefaulted_GetRef();
+	PendingPreload.Tag = Tag;
+	PendingPreload.WeakOwner = OwningObject;
+	PendingPreload.bAlwaysLoadedCue = (OwningObject == nullptr);
+
+	if (!PreloadTickHandle.IsValid())
+	{
+		PreloadTickHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickPreloadScheduler));
+	}
+}
+
+bool ULyraGameplayCueManager::TickPreloadScheduler(float DeltaTime)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(ULyraGameplayCueManager::TickPreloadScheduler);
 
-	int32* DataIdx = RuntimeGameplayCueObjectLibrary.CueSet->GameplayCueDataMap.Find(Tag);
-	if (DataIdx && RuntimeGameplayCueObjectLibrary.CueSet->GameplayCueData.IsValidIndex(*DataIdx))
+	UGameplayCueSet* CueSet = RuntimeGameplayCueObjectLibrary.CueSet;
+	if (!GIsRunning || (CueSet == nullptr))
 	{
-		const FGameplayCueNotifyData& CueData = RuntimeGameplayCueObjectLibrary.CueSet->GameplayCueData[*DataIdx];
+		PendingCuePreloads.Reset();
+		NextPendingCuePreload = 0;
+		PreloadTickHandle.Reset();
+		return false;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double BudgetSeconds = LyraGameplayCueManagerCvars::PreloadBudgetMs / 1000.0;
+
+	TArray<FPendingCuePreload> Batch;
+	TArray<FSoftObjectPath> BatchPaths;
+
+	int32 NumProcessed = 0;
+	while (NextPendingCuePreload < PendingCuePreloads.Num())
+	{
+		// Always make some progress, even with a tiny budget
+		if ((NumProcessed > 0) && (BudgetSeconds > 0.0) && ((FPlatformTime::Seconds() - StartTime) >= BudgetSeconds))
+		{
+			break;
+		}
+
+		const FPendingCuePreload& PendingPreload = PendingCuePreloads[NextPendingCuePreload++];
+		++NumProcessed;
+
+		// The referencer went away while waiting
+		if (!PendingPreload.bAlwaysLoadedCue && !PendingPreload.WeakOwner.IsValid())
+		{
+			continue;
+		}
 
-		UClass* LoadedGameplayCueClass = FindObject<UClass>(nullptr, *CueData.GameplayCueNotifyObj.ToString());
-		if (LoadedGameplayCueClass)
+		const int32 CueIndex = FindCueIndex(PendingPreload.Tag);
+		if (CueIndex == INDEX_NONE)
 		{
-			RegisterPreloadedCue(LoadedGameplayCueClass, OwningObject);
+			continue;
+		}
+
+		const FGameplayCueNotifyData& CueData = CueSet->GameplayCueData[CueIndex];
+		if (UClass* LoadedGameplayCueClass = FindObject<UClass>(nullptr, *CueData.GameplayCueNotifyObj.ToString()))
+		{
+			RegisterPreloadedCue(LoadedGameplayCueClass, PendingPreload.WeakOwner.Get());
 		}
 		else
 		{
-			bool bAlwaysLoadedCue = OwningObject == nullptr;
-			TWeakObjectPtr<UObject> WeakOwner = OwningObject;
-			StreamableManager.RequestAsyncLoad(CueData.GameplayCueNotifyObj, FStreamableDelegate::CreateUObject(this, &ThisClass::OnPreloadCueComplete, CueData.GameplayCueNotifyObj, WeakOwner, bAlwaysLoadedCue), FStreamableManager::DefaultAsyncLoadPriority, false, false, TEXT("GameplayCueManager"));
+			BatchPaths.AddUnique(CueData.GameplayCueNotifyObj);
+			Batch.Add(PendingPreload);
 		}
 	}
+
+	if (BatchPaths.Num() > 0)
+	{
+		++NumPreloadBatchesInFlight;
+		++NumPreloadBatchesIssued;
+		StreamableManager.RequestAsyncLoad(MoveTemp(BatchPaths), FStreamableDelegate::CreateUObject(this, &ThisClass::OnPreloadBatchComplete, MoveTemp(Batch)), FStreamableManager::DefaultAsyncLoadPriority, false, false, TEXT("GameplayCueManager"));
+	}
+
+	const bool bMorePending = (NextPendingCuePreload < PendingCuePreloads.Num());
+	if (!bMorePending)
+	{
+		PendingCuePreloads.Reset();
+		NextPendingCuePreload = 0;
+		PreloadTickHandle.Reset();
+	}
+
+	LongestPreloadSliceSeconds = FMath::Max(LongestPreloadSliceSeconds, FPlatformTime::Seconds() - StartTime);
+
+#if !UE_BUILD_SHIPPING
+	CheckPreloadLoadTestComplete();
+#endif
+
+	return bMorePending;
 }
 
-void ULyraGameplayCueManager::OnPreloadCueComplete(FSoftObjectPath Path, TWeakObjectPtr<UObject> OwningObject, bool bAlwaysLoadedCue)
+void ULyraGameplayCueManager::OnPreloadBatchComplete(TArray<FPendingCuePreload> Batch)
 {
-	if (bAlwaysLoadedCue || OwningObject.IsValid())
+	TRACE_CPUPROFILER_EVENT_SCOPE(ULyraGameplayCueManager::OnPreloadBatchComplete);
+
+	--NumPreloadBatchesInFlight;
+
+	if (RuntimeGameplayCueObjectLibrary.CueSet)
 	{
-		if (UClass* LoadedGameplayCueClass = Cast<UClass>(Path.ResolveObject()))
+		for (const FPendingCuePreload& PendingPreload : Batch)
 		{
-			RegisterPreloadedCue(LoadedGameplayCueClass, OwningObject.Get());
+			if (!PendingPreload.bAlwaysLoadedCue && !PendingPreload.WeakOwner.IsValid())
+			{
+				continue;
+			}
+
+			// The cue set may have been rebuilt while loading, so look the index up again
+			const int32 CueIndex = FindCueIndex(PendingPreload.Tag);
+			if (CueIndex == INDEX_NONE)
+			{
+				continue;
+			}
+
+			const FGameplayCueNotifyData& CueData = RuntimeGameplayCueObjectLibrary.CueSet->GameplayCueData[CueIndex];
+			if (UClass* LoadedGameplayCueClass = Cast<UClass>(CueData.GameplayCueNotifyObj.ResolveObject()))
+			{
+				RegisterPreloadedCue(LoadedGameplayCueClass, PendingPreload.WeakOwner.Get());
+			}
 		}
 	}
+
+#if !UE_BUILD_SHIPPING
+	CheckPreloadLoadTestComplete();
+#endif
+}
+
+int32 ULyraGameplayCueManager::FindCueIndex(const FGameplayTag& Tag) const
+{
+	const UGameplayCueSet* CueSet = RuntimeGameplayCueObjectLibrary.CueSet;
+	const int32* DataIdx = CueSet ? CueSet->GameplayCueDataMap.Find(Tag) : nullptr;
+	return (DataIdx && CueSet->GameplayCueData.IsValidIndex(*DataIdx)) ? *DataIdx : INDEX_NONE;
 }
 
 void ULyraGameplayCueManager::RegisterPreloadedCue(UClass* LoadedGameplayCueClass, UObject* OwningObject)
@@ -307,14 +501,44 @@ void ULyraGameplayCueManager::RegisterPreloadedCue(UClass* LoadedGameplayCueClas
 	if (bAlwaysLoadedCue)
 	{
 		AlwaysLoadedCues.Add(LoadedGameplayCueClass);
-		PreloadedCues.Remove(LoadedGameplayCueClass);
-		PreloadedCueReferencers.Remove(LoadedGameplayCueClass);
+		RemovePreloadedCue(LoadedGameplayCueClass);
 	}
 	else if ((OwningObject != LoadedGameplayCueClass) && (OwningObject != LoadedGameplayCueClass->GetDefaultObject()) && !AlwaysLoadedCues.Contains(LoadedGameplayCueClass))
 	{
-		PreloadedCues.Add(LoadedGameplayCueClass);
-		TSet<FObjectKey>& ReferencerSet = PreloadedCueReferencers.FindOrAdd(LoadedGameplayCueClass);
-		ReferencerSet.Add(OwningObject);
+		// Each class keeps the slot it was first given, the cue set indices change whenever game features add or remove cue paths
+		int32& Slot = PreloadedCueSlots.FindOrAdd(FObjectKey(LoadedGameplayCueClass), INDEX_NONE);
+		if (Slot == INDEX_NONE)
+		{
+			Slot = PreloadedCues.Add(nullptr);
+			PreloadedCueReferencers.AddDefaulted();
+		}
+
+		if (PreloadedCues[Slot] == nullptr)
+		{
+			PreloadedCues[Slot] = LoadedGameplayCueClass;
+			++NumPreloadedCues;
+		}
+
+		// Cues usually have a handful of referencers, a linear search is cheaper than hashing them
+		PreloadedCueReferencers[Slot].AddUnique(FObjectKey(OwningObject));
+	}
+}
+
+void ULyraGameplayCueManager::RemovePreloadedCue(UClass* LoadedGameplayCueClass)
+{
+	if (const int32* Slot = PreloadedCueSlots.Find(FObjectKey(LoadedGameplayCueClass)))
+	{
+		RemovePreloadedCueSlot(*Slot);
+	}
+}
+
+void ULyraGameplayCueManager::RemovePreloadedCueSlot(int32 Slot)
+{
+	if (PreloadedCues.IsValidIndex(Slot) && (PreloadedCues[Slot] != nullptr))
+	{
+		PreloadedCues[Slot] = nullptr;
+		PreloadedCueReferencers[Slot].Reset();
+		--NumPreloadedCues;
 	}
 }
 
@@ -329,24 +553,25 @@ void ULyraGameplayCueManager::HandlePostLoadMap(UWorld* NewWorld)
 
 		for (UClass* CueClass : PreloadedCues)
 		{
-			RuntimeGameplayCueObjectLibrary.CueSet->RemoveLoadedClass(CueClass);
+			if (CueClass)
+			{
+				RuntimeGameplayCueObjectLibrary.CueSet->RemoveLoadedClass(CueClass);
+			}
 		}
 	}
 
-	for (auto CueIt = PreloadedCues.CreateIterator(); CueIt; ++CueIt)
+	for (int32 Slot = 0; Slot < PreloadedCues.Num(); ++Slot)
 	{
-		TSet<FObjectKey>& ReferencerSet = PreloadedCueReferencers.FindChecked(*CueIt);
-		for (auto RefIt = ReferencerSet.CreateIterator(); RefIt; ++RefIt)
+		if (PreloadedCues[Slot] == nullptr)
 		{
-			if (!RefIt->ResolveObjectPtr())
-			{
-				RefIt.RemoveCurrent();
-			}
+			continue;
 		}
-		if (ReferencerSet.Num() == 0)
+
+		TArray<FObjectKey>& Referencers = PreloadedCueReferencers[Slot];
+		Referencers.RemoveAllSwap([](const FObjectKey& Ref) { return Ref.ResolveObjectPtr() == nullptr; });
+		if (Referencers.Num() == 0)
 		{
-			PreloadedCueReferencers.Remove(*CueIt);
-			CueIt.RemoveCurrent();
+			RemovePreloadedCueSlot(Slot);
 		}
 	}
 }
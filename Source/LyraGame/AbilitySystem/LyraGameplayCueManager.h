@@ -2,7 +2,9 @@
 
 #pragma once
 
+#include "Containers/Ticker.h"
 #include "GameplayCueManager.h"
+#include "UObject/StrongObjectPtr.h"
 
 #include "LyraGameplayCueManager.generated.h"
 
@@ -36,6 +38,11 @@ public:
 
 	static void DumpGameplayCues(const TArray<FString>& Args);
 
+#if !UE_BUILD_SHIPPING
+	// Queues a preload of every cue in the runtime library at once and reports the longest frame slice and the memory used once it is done
+	static void PreloadLoadTest(const TArray<FString>& Args);
+#endif
+
 	// When delay loading cues, this will load the cues that must be always loaded anyway
 	void LoadAlwaysLoadedCues();
 
@@ -47,8 +54,12 @@ private:
 	void HandlePostGarbageCollect();
 	void ProcessLoadedTags();
 	void ProcessTagToPreload(const FGameplayTag& Tag, UObject* OwningObject);
-	void OnPreloadCueComplete(FSoftObjectPath Path, TWeakObjectPtr<UObject> OwningObject, bool bAlwaysLoadedCue);
+	void QueueCuePreload(const FGameplayTag& Tag, UObject* OwningObject);
+	bool TickPreloadScheduler(float DeltaTime);
 	void RegisterPreloadedCue(UClass* LoadedGameplayCueClass, UObject* OwningObject);
+	void RemovePreloadedCue(UClass* LoadedGameplayCueClass);
+	void RemovePreloadedCueSlot(int32 Slot);
+	int32 FindCueIndex(const FGameplayTag& Tag) const;
 	void HandlePostLoadMap(UWorld* NewWorld);
 	void UpdateDelayLoadDelegateListeners();
 	bool ShouldDelayLoadGameplayCues() const;
@@ -63,11 +74,31 @@ private:
 		FLoadedGameplayTagToProcessData(const FGameplayTag& InTag, const TWeakObjectPtr<UObject>& InWeakOwner) : Tag(InTag), WeakOwner(InWeakOwner) {}
 	};
 
+	struct FPendingCuePreload
+	{
+		FGameplayTag Tag;
+		TWeakObjectPtr<UObject> WeakOwner;
+		bool bAlwaysLoadedCue = false;
+	};
+
+	void OnPreloadBatchComplete(TArray<FPendingCuePreload> Batch);
+
+#if !UE_BUILD_SHIPPING
+	void CheckPreloadLoadTestComplete();
+#endif
+
 private:
-	// Cues that were preloaded on the client due to being referenced by content
+	// Cues that were preloaded on the client due to being referenced by content, indexed by the slot of their class (nullptr when not preloaded)
 	UPROPERTY(transient)
-	TSet<TObjectPtr<UClass>> PreloadedCues;
-	TMap<FObjectKey, TSet<FObjectKey>> PreloadedCueReferencers;
+	TArray<TObjectPtr<UClass>> PreloadedCues;
+
+	// The objects referencing each preloaded cue, same indices as PreloadedCues
+	TArray<TArray<FObjectKey>> PreloadedCueReferencers;
+
+	// The slot of each cue class that was ever preloaded, assigned once so it survives the runtime cue set being rebuilt
+	TMap<FObjectKey, int32> PreloadedCueSlots;
+
+	int32 NumPreloadedCues = 0;
 
 	// Cues that were preloaded on the client and will always be loaded (code referenced or explicitly always loaded)
 	UPROPERTY(transient)
@@ -76,4 +107,22 @@ private:
 	TArray<FLoadedGameplayTagToProcessData> LoadedGameplayTagsToProcess;
 	FCriticalSection LoadedGameplayTagsToProcessCS;
 	bool bProcessLoadedTagsAfterGC = false;
+
+	// Preloads waiting for the scheduler, which handles as many as fit in Lyra.GameplayCues.PreloadBudgetMs each frame and loads them with a single request
+	TArray<FPendingCuePreload> PendingCuePreloads;
+	int32 NextPendingCuePreload = 0;
+	FTSTicker::FDelegateHandle PreloadTickHandle;
+
+	int32 NumPreloadBatchesInFlight = 0;
+	int32 NumPreloadBatchesIssued = 0;
+	double LongestPreloadSliceSeconds = 0.0;
+
+#if !UE_BUILD_SHIPPING
+	TStrongObjectPtr<UObject> LoadTestReferencer;
+	double LoadTestStartTime = 0.0;
+	uint64 LoadTestStartFrame = 0;
+	uint64 LoadTestStartMemory = 0;
+	int32 LoadTestNumCues = 0;
+	int32 LoadTestStartBatches = 0;
+#endif
 };
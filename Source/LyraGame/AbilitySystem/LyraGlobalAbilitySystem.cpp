@@ -3,9 +3,26 @@
 #include "LyraGlobalAbilitySystem.h"
 
 #include "AbilitySystem/LyraAbilitySystemComponent.h"
+#include "AbilitySystemGlobals.h"
+#include "Engine/World.h"
+#include "GameFramework/Info.h"
+#include "GameplayEffect.h"
+#include "HAL/IConsoleManager.h"
+#include "LyraLogChannels.h"
+#include "Performance/LyraServerTickBudget.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraGlobalAbilitySystem)
 
+namespace LyraConsoleVariables
+{
+	static float GlobalAbilitySystemBudgetMs = 1.0f;
+	static FAutoConsoleVariableRef CVarGlobalAbilitySystemBudgetMs(
+		TEXT("Lyra.GlobalAbilitySystem.BudgetMs"),
+		GlobalAbilitySystemBudgetMs,
+		TEXT("Milliseconds per frame spent applying global abilities and effects to registered ASCs (at least one ASC is done per frame). 0 applies everything immediately."),
+		ECVF_Default);
+}
+
 void FGlobalAppliedAbilityList::AddToASC(TSubclassOf<UGameplayAbility> Ability, ULyraAbilitySystemComponent* ASC)
 {
 	if (FGameplayAbilitySpecHandle* SpecHandle = Handles.Find(ASC))
@@ -54,6 +71,21 @@ void FGlobalAppliedEffectList::AddToASC(TSubclassOf<UGameplayEffect> Effect, ULy
 	Handles.Add(ASC, GameplayEffectHandle);
 }
 
+void FGlobalAppliedEffectList::AddToASC(const FGameplayEffectSpec& SharedSpec, ULyraAbilitySystemComponent* ASC)
+{
+	if (FActiveGameplayEffectHandle* EffectHandle = Handles.Find(ASC))
+	{
+		RemoveFromASC(ASC);
+	}
+
+	// Setting the context recaptures the source data, so the result is the same as building a new spec for this ASC
+	FGameplayEffectSpec Spec(SharedSpec);
+	Spec.SetContext(ASC->MakeEffectContext());
+
+	const FActiveGameplayEffectHandle GameplayEffectHandle = ASC->ApplyGameplayEffectSpecToSelf(Spec);
+	Handles.Add(ASC, GameplayEffectHandle);
+}
+
 void FGlobalAppliedEffectList::RemoveFromASC(ULyraAbilitySystemComponent* ASC)
 {
 	if (FActiveGameplayEffectHandle* EffectHandle = Handles.Find(ASC))
@@ -79,14 +111,175 @@ ULyraGlobalAbilitySystem::ULyraGlobalAbilitySystem()
 {
 }
 
+TStatId ULyraGlobalAbilitySystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULyraGlobalAbilitySystem, STATGROUP_Tickables);
+}
+
+void ULyraGlobalAbilitySystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (PendingApplications.Num() > 0)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(ULyraGlobalAbilitySystem::Tick);
+
+		// Do the minimum (one ASC) while the server is over its frame budget
+		const double BudgetSeconds = FLyraServerTickBudget::ShouldThrottleNonCriticalWork() ? 0.0 : (LyraConsoleVariables::GlobalAbilitySystemBudgetMs / 1000.0);
+		ProcessPendingApplications(BudgetSeconds);
+	}
+}
+
+ULyraGlobalAbilitySystem::FPendingApplication& ULyraGlobalAbilitySystem::FindOrAddPendingAbility(TSubclassOf<UGameplayAbility> Ability)
+{
+	if (FPendingApplication* Pending = PendingApplications.FindByPredicate([&Ability](const FPendingApplication& Existing) { return Existing.Ability == Ability; }))
+	{
+		return *Pending;
+	}
+
+	FPendingApplication& NewPending = PendingApplications.AddDefaulted_GetRef();
+	NewPending.Ability = Ability;
+	NewPending.StartTime = FPlatformTime::Seconds();
+	return NewPending;
+}
+
+ULyraGlobalAbilitySystem::FPendingApplication& ULyraGlobalAbilitySystem::FindOrAddPendingEffect(TSubclassOf<UGameplayEffect> Effect)
+{
+	if (FPendingApplication* Pending = PendingApplications.FindByPredicate([&Effect](const FPendingApplication& Existing) { return Existing.Effect == Effect; }))
+	{
+		return *Pending;
+	}
+
+	FPendingApplication& NewPending = PendingApplications.AddDefaulted_GetRef();
+	NewPending.Effect = Effect;
+	NewPending.StartTime = FPlatformTime::Seconds();
+
+	// The spec is built without an instigator, each ASC sets its own context when applying it
+	const UGameplayEffect* GameplayEffectCDO = Effect->GetDefaultObject<UGameplayEffect>();
+	NewPending.SharedEffectSpec = MakeShared<FGameplayEffectSpec>(GameplayEffectCDO, FGameplayEffectContextHandle(UAbilitySystemGlobals::Get().AllocGameplayEffectContext()), /*Level=*/ 1.0f);
+	return NewPending;
+}
+
+double ULyraGlobalAbilitySystem::ProcessPendingApplications(double BudgetSeconds)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	const double EndTime = StartTime + BudgetSeconds;
+	bool bAppliedAny = false;
+
+	while (PendingApplications.Num() > 0)
+	{
+		// Granting or applying can re-enter Apply*ToAll, Remove*FromAll or RegisterASC and change the queue, so the entry is taken out of it while it is worked on
+		FPendingApplication Pending = MoveTemp(PendingApplications[0]);
+		PendingApplications.RemoveAt(0);
+		++Pending.NumFrames;
+
+		bool bRemovedFromAll = false;
+		const double SliceStart = FPlatformTime::Seconds();
+		while (Pending.RemainingASCs.Num() > 0)
+		{
+			// Always make some progress, even with no budget left
+			if (bAppliedAny && (FPlatformTime::Seconds() >= EndTime))
+			{
+				break;
+			}
+
+			ULyraAbilitySystemComponent* ASC = Pending.RemainingASCs.Pop(/*bAllowShrinking=*/ false).Get();
+			if (ASC == nullptr)
+			{
+				continue;
+			}
+
+			if (Pending.Ability != nullptr)
+			{
+				FGlobalAppliedAbilityList* Entry = AppliedAbilities.Find(Pending.Ability);
+				bRemovedFromAll = (Entry == nullptr);
+				if (Entry)
+				{
+					Entry->AddToASC(Pending.Ability, ASC);
+				}
+			}
+			else
+			{
+				FGlobalAppliedEffectList* Entry = AppliedEffects.Find(Pending.Effect);
+				bRemovedFromAll = (Entry == nullptr);
+				if (Entry)
+				{
+					Entry->AddToASC(*Pending.SharedEffectSpec, ASC);
+				}
+			}
+
+			if (bRemovedFromAll)
+			{
+				break;
+			}
+
+			++Pending.NumApplied;
+			bAppliedAny = true;
+		}
+		Pending.MaxSliceSeconds = FMath::Max(Pending.MaxSliceSeconds, FPlatformTime::Seconds() - SliceStart);
+
+		if (bRemovedFromAll)
+		{
+			// Removed while it was being applied, the rest of the ASCs never get it
+			continue;
+		}
+
+		if (Pending.RemainingASCs.Num() > 0)
+		{
+			// Back in front for the next frame, along with any ASCs queued for the same class in the meantime
+			const int32 RequeuedIndex = PendingApplications.IndexOfByPredicate([&Pending](const FPendingApplication& Other)
+				{
+					return (Other.Ability == Pending.Ability) && (Other.Effect == Pending.Effect);
+				});
+			if (RequeuedIndex != INDEX_NONE)
+			{
+				for (const TWeakObjectPtr<ULyraAbilitySystemComponent>& ASC : PendingApplications[RequeuedIndex].RemainingASCs)
+				{
+					Pending.RemainingASCs.AddUnique(ASC);
+				}
+				Pending.bBroadcastCompletion |= PendingApplications[RequeuedIndex].bBroadcastCompletion;
+				PendingApplications.RemoveAt(RequeuedIndex);
+			}
+
+			PendingApplications.Insert(MoveTemp(Pending), 0);
+			break;
+		}
+
+		CompletePendingApplication(Pending);
+	}
+
+	return FPlatformTime::Seconds() - StartTime;
+}
+
+void ULyraGlobalAbilitySystem::CompletePendingApplication(const FPendingApplication& Pending)
+{
+	UClass* AppliedClass = (Pending.Ability != nullptr) ? Pending.Ability.Get() : Pending.Effect.Get();
+
+	UE_LOG(LogLyraAbilitySystem, Log, TEXT("Global %s applied to %d ASCs over %d frames (longest slice %.3f ms, %.1f ms in total)"),
+		*GetNameSafe(AppliedClass), Pending.NumApplied, Pending.NumFrames, Pending.MaxSliceSeconds * 1000.0, (FPlatformTime::Seconds() - Pending.StartTime) * 1000.0);
+
+	if (Pending.bBroadcastCompletion)
+	{
+		OnGlobalApplicationComplete.Broadcast(AppliedClass);
+	}
+}
+
 void ULyraGlobalAbilitySystem::ApplyAbilityToAll(TSubclassOf<UGameplayAbility> Ability)
 {
 	if ((Ability.Get() != nullptr) && (!AppliedAbilities.Contains(Ability)))
 	{
-		FGlobalAppliedAbilityList& Entry = AppliedAbilities.Add(Ability);		
+		AppliedAbilities.Add(Ability);
+
+		FPendingApplication& Pending = FindOrAddPendingAbility(Ability);
+		Pending.bBroadcastCompletion = true;
 		for (ULyraAbilitySystemComponent* ASC : RegisteredASCs)
 		{
-			Entry.AddToASC(Ability, ASC);
+			Pending.RemainingASCs.Add(ASC);
+		}
+
+		if (LyraConsoleVariables::GlobalAbilitySystemBudgetMs <= 0.0f)
+		{
+			ProcessPendingApplications(TNumericLimits<double>::Max());
 		}
 	}
 }
@@ -95,10 +288,18 @@ void ULyraGlobalAbilitySystem::ApplyEffectToAll(TSubclassOf<UGameplayEffect> Eff
 {
 	if ((Effect.Get() != nullptr) && (!AppliedEffects.Contains(Effect)))
 	{
-		FGlobalAppliedEffectList& Entry = AppliedEffects.Add(Effect);
+		AppliedEffects.Add(Effect);
+
+		FPendingApplication& Pending = FindOrAddPendingEffect(Effect);
+		Pending.bBroadcastCompletion = true;
 		for (ULyraAbilitySystemComponent* ASC : RegisteredASCs)
 		{
-			Entry.AddToASC(Effect, ASC);
+			Pending.RemainingASCs.Add(ASC);
+		}
+
+		if (LyraConsoleVariables::GlobalAbilitySystemBudgetMs <= 0.0f)
+		{
+			ProcessPendingApplications(TNumericLimits<double>::Max());
 		}
 	}
 }
@@ -107,6 +308,8 @@ void ULyraGlobalAbilitySystem::RemoveAbilityFromAll(TSubclassOf<UGameplayAbility
 {
 	if ((Ability.Get() != nullptr) && AppliedAbilities.Contains(Ability))
 	{
+		PendingApplications.RemoveAll([&Ability](const FPendingApplication& Pending) { return Pending.Ability == Ability; });
+
 		FGlobalAppliedAbilityList& Entry = AppliedAbilities[Ability];
 		Entry.RemoveFromAll();
 		AppliedAbilities.Remove(Ability);
@@ -117,6 +320,8 @@ void ULyraGlobalAbilitySystem::RemoveEffectFromAll(TSubclassOf<UGameplayEffect>
 {
 	if ((Effect.Get() != nullptr) && AppliedEffects.Contains(Effect))
 	{
+		PendingApplications.RemoveAll([&Effect](const FPendingApplication& Pending) { return Pending.Effect == Effect; });
+
 		FGlobalAppliedEffectList& Entry = AppliedEffects[Effect];
 		Entry.RemoveFromAll();
 		AppliedEffects.Remove(Effect);
@@ -127,21 +332,32 @@ void ULyraGlobalAbilitySystem::RegisterASC(ULyraAbilitySystemComponent* ASC)
 {
 	check(ASC);
 
+	// Catch the new ASC up with the active global abilities and effects along with any other pending work
 	for (auto& Entry : AppliedAbilities)
 	{
-		Entry.Value.AddToASC(Entry.Key, ASC);
+		FindOrAddPendingAbility(Entry.Key).RemainingASCs.AddUnique(ASC);
 	}
 	for (auto& Entry : AppliedEffects)
 	{
-		Entry.Value.AddToASC(Entry.Key, ASC);
+		FindOrAddPendingEffect(Entry.Key).RemainingASCs.AddUnique(ASC);
 	}
 
 	RegisteredASCs.AddUnique(ASC);
+
+	if ((LyraConsoleVariables::GlobalAbilitySystemBudgetMs <= 0.0f) && (PendingApplications.Num() > 0))
+	{
+		ProcessPendingApplications(TNumericLimits<double>::Max());
+	}
 }
 
 void ULyraGlobalAbilitySystem::UnregisterASC(ULyraAbilitySystemComponent* ASC)
 {
 	check(ASC);
+	for (FPendingApplication& Pending : PendingApplications)
+	{
+		Pending.RemainingASCs.Remove(ASC);
+	}
+
 	for (auto& Entry : AppliedAbilities)
 	{
 		Entry.Value.RemoveFromASC(ASC);
@@ -154,3 +370,81 @@ void ULyraGlobalAbilitySystem::UnregisterASC(ULyraAbilitySystemComponent* ASC)
 	RegisteredASCs.Remove(ASC);
 }
 
+
+#if !UE_BUILD_SHIPPING
+namespace LyraGlobalAbilitySystemBenchmark
+{
+	static TArray<TWeakObjectPtr<AActor>> SpawnedActors;
+	static TSubclassOf<UGameplayEffect> AppliedEffect;
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GLyraGlobalAbilitySystemBenchmarkCmd(
+	TEXT("Lyra.GlobalAbilitySystem.Benchmark"),
+	TEXT("Registers temporary ASCs, times applying an effect to all of them in one go the old way, then applies it again time sliced (the completion is logged with the longest slice). The effect is applied to every registered ASC, players included, until the command is run again (with 0 to only clean up). Usage: Lyra.GlobalAbilitySystem.Benchmark [NumASCs=100] [EffectClassPath]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		ULyraGlobalAbilitySystem* GlobalAbilitySystem = UWorld::GetSubsystem<ULyraGlobalAbilitySystem>(World);
+		if ((GlobalAbilitySystem == nullptr) || (World->GetNetMode() == NM_Client))
+		{
+			UE_LOG(LogLyraAbilitySystem, Warning, TEXT("Lyra.GlobalAbilitySystem.Benchmark needs a world with authority"));
+			return;
+		}
+
+		for (const TWeakObjectPtr<AActor>& Actor : LyraGlobalAbilitySystemBenchmark::SpawnedActors)
+		{
+			if (Actor.IsValid())
+			{
+				Actor->Destroy();
+			}
+		}
+		LyraGlobalAbilitySystemBenchmark::SpawnedActors.Reset();
+
+		if (LyraGlobalAbilitySystemBenchmark::AppliedEffect != nullptr)
+		{
+			GlobalAbilitySystem->RemoveEffectFromAll(LyraGlobalAbilitySystemBenchmark::AppliedEffect);
+			LyraGlobalAbilitySystemBenchmark::AppliedEffect = nullptr;
+		}
+
+		const int32 NumASCs = (Args.Num() > 0) ? FMath::Max(FCString::Atoi(*Args[0]), 0) : 100;
+		TSubclassOf<UGameplayEffect> Effect = (Args.Num() > 1) ? FSoftClassPath(Args[1]).TryLoadClass<UGameplayEffect>() : UGameplayEffect::StaticClass();
+		if ((NumASCs == 0) || (Effect == nullptr))
+		{
+			return;
+		}
+
+		if (GlobalAbilitySystem->HasPendingApplications() || GlobalAbilitySystem->IsEffectAppliedToAll(Effect))
+		{
+			UE_LOG(LogLyraAbilitySystem, Warning, TEXT("Lyra.GlobalAbilitySystem.Benchmark can't run while global abilities or effects are being applied, or with an effect that is already applied to all"));
+			return;
+		}
+
+		TArray<ULyraAbilitySystemComponent*> ASCs;
+		for (int32 Index = 0; Index < NumASCs; ++Index)
+		{
+			AInfo* Actor = World->SpawnActor<AInfo>();
+			ULyraAbilitySystemComponent* ASC = NewObject<ULyraAbilitySystemComponent>(Actor);
+			ASC->RegisterComponent();
+			ASC->InitAbilityActorInfo(Actor, Actor);
+			GlobalAbilitySystem->RegisterASC(ASC);
+
+			ASCs.Add(ASC);
+			LyraGlobalAbilitySystemBenchmark::SpawnedActors.Add(Actor);
+		}
+
+		// What ApplyEffectToAll used to do, a new spec per ASC all in the same frame
+		FGlobalAppliedEffectList OldList;
+		const double OldStart = FPlatformTime::Seconds();
+		for (ULyraAbilitySystemComponent* ASC : ASCs)
+		{
+			OldList.AddToASC(Effect, ASC);
+		}
+		const double OldSeconds = FPlatformTime::Seconds() - OldStart;
+		OldList.RemoveFromAll();
+
+		UE_LOG(LogLyraAbilitySystem, Display, TEXT("Applying %s to %d ASCs in one frame took %.3f ms, now applying it time sliced with a %.2f ms budget"),
+			*GetNameSafe(Effect), NumASCs, OldSeconds * 1000.0, LyraConsoleVariables::GlobalAbilitySystemBudgetMs);
+
+		GlobalAbilitySystem->ApplyEffectToAll(Effect);
+		LyraGlobalAbilitySystemBenchmark::AppliedEffect = Effect;
+	}));
+#endif // !UE_BUILD_SHIPPING
@@ -6,6 +6,7 @@
 #include "Subsystems/WorldSubsystem.h"
 #include "GameplayAbilitySpecHandle.h"
 #include "Templates/SubclassOf.h"
+#include "UObject/WeakObjectPtrTemplates.h"
 
 #include "LyraGlobalAbilitySystem.generated.h"
 
@@ -16,6 +17,7 @@ class UObject;
 struct FActiveGameplayEffectHandle;
 struct FFrame;
 struct FGameplayAbilitySpecHandle;
+struct FGameplayEffectSpec;
 
 USTRUCT()
 struct FGlobalAppliedAbilityList
@@ -39,18 +41,40 @@ struct FGlobalAppliedEffectList
 	TMap<TObjectPtr<ULyraAbilitySystemComponent>, FActiveGameplayEffectHandle> Handles;
 
 	void AddToASC(TSubclassOf<UGameplayEffect> Effect, ULyraAbilitySystemComponent* ASC);
+
+	// Applies a copy of a spec that was built once for every ASC, only the context is made per ASC
+	void AddToASC(const FGameplayEffectSpec& SharedSpec, ULyraAbilitySystemComponent* ASC);
+
 	void RemoveFromASC(ULyraAbilitySystemComponent* ASC);
 	void RemoveFromAll();
 };
 
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FLyraGlobalApplicationCompleteDelegate, UClass*, AppliedClass);
+
+/**
+ * ULyraGlobalAbilitySystem
+ *
+ *	Applies abilities and effects to every registered ASC. Applying to many ASCs at once (e.g., on a game phase change) is
+ *	spread over several frames within a time budget (Lyra.GlobalAbilitySystem.BudgetMs), and OnGlobalApplicationComplete
+ *	is broadcast once every ASC has it. ASCs registering later are caught up the same way.
+ */
 UCLASS()
-class ULyraGlobalAbilitySystem : public UWorldSubsystem
+class ULyraGlobalAbilitySystem : public UTickableWorldSubsystem
 {
 	GENERATED_BODY()
 
 public:
 	ULyraGlobalAbilitySystem();
 
+	//~FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End of FTickableGameObject interface
+
+	/** Called when an ability or effect applied with ApplyAbilityToAll or ApplyEffectToAll has reached every registered ASC */
+	UPROPERTY(BlueprintAssignable, Category="Lyra")
+	FLyraGlobalApplicationCompleteDelegate OnGlobalApplicationComplete;
+
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category="Lyra")
 	void ApplyAbilityToAll(TSubclassOf<UGameplayAbility> Ability);
 
@@ -69,6 +93,42 @@ public:
 	/** Removes an ASC from the global system, along with any active global effects/abilities. */
 	void UnregisterASC(ULyraAbilitySystemComponent* ASC);
 
+	/** Returns true if abilities or effects are still being applied over the next frames */
+	bool HasPendingApplications() const { return PendingApplications.Num() > 0; }
+
+	bool IsEffectAppliedToAll(TSubclassOf<UGameplayEffect> Effect) const { return AppliedEffects.Contains(Effect); }
+
+private:
+	/** An ability or effect that still has to be applied to some ASCs */
+	struct FPendingApplication
+	{
+		TSubclassOf<UGameplayAbility> Ability;
+		TSubclassOf<UGameplayEffect> Effect;
+
+		// Built once for all the ASCs
+		TSharedPtr<FGameplayEffectSpec> SharedEffectSpec;
+
+		TArray<TWeakObjectPtr<ULyraAbilitySystemComponent>> RemainingASCs;
+
+		// Only broadcast for ApplyAbilityToAll/ApplyEffectToAll, not when catching up a newly registered ASC
+		bool bBroadcastCompletion = false;
+
+		int32 NumApplied = 0;
+		int32 NumFrames = 0;
+		double MaxSliceSeconds = 0.0;
+		double StartTime = 0.0;
+	};
+
+	FPendingApplication& FindOrAddPendingAbility(TSubclassOf<UGameplayAbility> Ability);
+	FPendingApplication& FindOrAddPendingEffect(TSubclassOf<UGameplayEffect> Effect);
+
+	/** Applies pending work until the budget runs out, returns the time spent */
+	double ProcessPendingApplications(double BudgetSeconds);
+
+	void CompletePendingApplication(const FPendingApplication& Pending);
+
+	TArray<FPendingApplication> PendingApplications;
+
 private:
 	UPROPERTY()
 	TMap<TSubclassOf<UGameplayAbility>, FGlobalAppliedAbilityList> AppliedAbilities;
@@ -0,0 +1,120 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "LyraCameraCollisionSubsystem.h"
+
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LyraCameraCollisionSubsystem)
+
+namespace LyraConsoleVariables
+{
+	static int32 CameraMaxAsyncSweepsPerFrame = 32;
+	static FAutoConsoleVariableRef CVarCameraMaxAsyncSweepsPerFrame(
+		TEXT("Lyra.Camera.AsyncPenetration.MaxSweepsPerFrame"),
+		CameraMaxAsyncSweepsPerFrame,
+		TEXT("Maximum number of optional camera penetration sweeps issued per frame across all local cameras (the main feeler of each camera is always swept). 0 means no limit."),
+		ECVF_Default);
+}
+
+bool ULyraCameraCollisionSubsystem::ResolveSweep(FLyraCameraFeelerSweep& Sweep)
+{
+	if (Sweep.bPendingImmediate)
+	{
+		Sweep.bPendingImmediate = false;
+		Sweep.Hit = Sweep.PendingHit;
+		Sweep.bHit = Sweep.PendingHit.bBlockingHit;
+	}
+	else if (Sweep.PendingHandle.IsValid())
+	{
+		UWorld* World = GetWorld();
+
+		FTraceDatum TraceData;
+		if (World->QueryTraceData(Sweep.PendingHandle, TraceData))
+		{
+			const FHitResult* BlockingHit = TraceData.OutHits.FindByPredicate([](const FHitResult& Hit) { return Hit.bBlockingHit; });
+			Sweep.Hit = BlockingHit ? *BlockingHit : FHitResult();
+			Sweep.bHit = (BlockingHit != nullptr);
+		}
+		else if (World->IsTraceHandleValid(Sweep.PendingHandle, /*bOverlapTrace=*/ false))
+		{
+			// Still running, keep the previous result
+			return Sweep.bHasResult;
+		}
+		else
+		{
+			// The results were thrown away before anyone read them (e.g., the camera skipped a frame)
+			Sweep.PendingHandle.Invalidate();
+			return Sweep.bHasResult;
+		}
+
+		Sweep.PendingHandle.Invalidate();
+	}
+	else
+	{
+		return Sweep.bHasResult;
+	}
+
+	Sweep.Start = Sweep.PendingStart;
+	Sweep.End = Sweep.PendingEnd;
+	Sweep.Radius = Sweep.PendingRadius;
+	Sweep.bHasResult = true;
+
+	return true;
+}
+
+bool ULyraCameraCollisionSubsystem::IssueSweep(FLyraCameraFeelerSweep& Sweep, const FVector& Start, const FVector& End, float Radius, const FCollisionQueryParams& Params, bool bRequired)
+{
+	if (!ConsumeFrameBudget(bRequired))
+	{
+		++NumSweepsSkipped;
+		return false;
+	}
+
+	UWorld* World = GetWorld();
+	const FCollisionShape SphereShape = FCollisionShape::MakeSphere(Radius);
+
+	Sweep.PendingStart = Start;
+	Sweep.PendingEnd = End;
+	Sweep.PendingRadius = Radius;
+
+	if (bExecuteSweepsImmediately)
+	{
+		Sweep.PendingHandle.Invalidate();
+		Sweep.PendingHit = FHitResult();
+		World->SweepSingleByChannel(Sweep.PendingHit, Start, End, FQuat::Identity, ECC_Camera, SphereShape, Params);
+		Sweep.bPendingImmediate = true;
+	}
+	else
+	{
+		Sweep.bPendingImmediate = false;
+		Sweep.PendingHandle = World->AsyncSweepByChannel(EAsyncTraceType::Single, Start, End, FQuat::Identity, ECC_Camera, SphereShape, Params);
+	}
+
+	++NumSweepsIssued;
+	return true;
+}
+
+void ULyraCameraCollisionSubsystem::ResetStats()
+{
+	NumSweepsIssued = 0;
+	NumSweepsSkipped = 0;
+}
+
+bool ULyraCameraCollisionSubsystem::ConsumeFrameBudget(bool bRequired)
+{
+	if (BudgetFrame != GFrameCounter)
+	{
+		BudgetFrame = GFrameCounter;
+		NumSweepsIssuedThisFrame = 0;
+	}
+
+	const int32 MaxSweeps = LyraConsoleVariables::CameraMaxAsyncSweepsPerFrame;
+	if (!bRequired && (MaxSweeps > 0) && (NumSweepsIssuedThisFrame >= MaxSweeps) && !bExecuteSweepsImmediately)
+	{
+		return false;
+	}
+
+	++NumSweepsIssuedThisFrame;
+	return true;
+}
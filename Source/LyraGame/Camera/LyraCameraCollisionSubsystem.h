@@ -0,0 +1,88 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CollisionQueryParams.h"
+#include "Engine/HitResult.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+
+#include "LyraCameraCollisionSubsystem.generated.h"
+
+class UObject;
+
+/**
+ * FLyraCameraFeelerSweep
+ *
+ *	One penetration avoidance feeler, swept asynchronously on one frame and read back on a later one.
+ *	The start and end the sweep was issued with are kept, so the reader can tell how far the camera has moved since.
+ */
+struct FLyraCameraFeelerSweep
+{
+	// The sweep in flight (the handle is invalid once it has been read back)
+	FTraceHandle PendingHandle;
+	FVector PendingStart = FVector::ZeroVector;
+	FVector PendingEnd = FVector::ZeroVector;
+	float PendingRadius = 0.0f;
+
+	// Result of a sweep that was run immediately, waiting to be read back
+	FHitResult PendingHit;
+	bool bPendingImmediate = false;
+
+	// The last sweep that was read back
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+	float Radius = 0.0f;
+	FHitResult Hit;
+	bool bHit = false;
+	bool bHasResult = false;
+
+	void Reset()
+	{
+		PendingHandle.Invalidate();
+		bPendingImmediate = false;
+		bHit = false;
+		bHasResult = false;
+	}
+};
+
+/**
+ * ULyraCameraCollisionSubsystem
+ *
+ *	Issues the penetration avoidance sweeps of every local camera through the world's async trace buffer, so they all run
+ *	as one batch of parallel tasks at the end of the frame instead of one by one on the game thread during the camera update.
+ *	The number of sweeps issued per frame is capped by Lyra.Camera.AsyncPenetration.MaxSweepsPerFrame (required sweeps,
+ *	such as the main feeler, are always issued).
+ */
+UCLASS()
+class LYRAGAME_API ULyraCameraCollisionSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Reads back the result of the sweep in flight, if it has finished. Returns true if the sweep has a result (new or old).
+	bool ResolveSweep(FLyraCameraFeelerSweep& Sweep);
+
+	// Issues a sphere sweep on the camera channel, returns false if it was skipped because of the per frame budget
+	bool IssueSweep(FLyraCameraFeelerSweep& Sweep, const FVector& Start, const FVector& End, float Radius, const FCollisionQueryParams& Params, bool bRequired);
+
+	// When set, sweeps run synchronously when issued but are still only read back by ResolveSweep (used to replay recorded camera paths deterministically)
+	void SetExecuteSweepsImmediately(bool bImmediate) { bExecuteSweepsImmediately = bImmediate; }
+
+	int32 GetNumSweepsIssued() const { return NumSweepsIssued; }
+	int32 GetNumSweepsSkipped() const { return NumSweepsSkipped; }
+	void ResetStats();
+
+private:
+	// Returns true if there is room for one more sweep this frame (and counts it)
+	bool ConsumeFrameBudget(bool bRequired);
+
+private:
+	uint64 BudgetFrame = 0;
+	int32 NumSweepsIssuedThisFrame = 0;
+
+	int32 NumSweepsIssued = 0;
+	int32 NumSweepsSkipped = 0;
+
+	bool bExecuteSweepsImmediately = false;
+};
@@ -6,10 +6,13 @@
 #include "Camera/LyraPenetrationAvoidanceFeeler.h"
 #include "Curves/CurveVector.h"
 #include "Engine/Canvas.h"
+#include "Engine/World.h"
 #include "GameFramework/CameraBlockingVolume.h"
 #include "LyraCameraAssistInterface.h"
 #include "GameFramework/Controller.h"
 #include "GameFramework/Character.h"
+#include "HAL/IConsoleManager.h"
+#include "LyraLogChannels.h"
 #include "Math/RotationMatrix.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraCameraMode_ThirdPerson)
@@ -19,6 +22,63 @@ namespace LyraCameraMode_ThirdPerson_Statics
 	static const FName NAME_IgnoreCameraCollision = TEXT("IgnoreCameraCollision");
 }
 
+namespace LyraConsoleVariables
+{
+	static bool bCameraAsyncPenetration = true;
+	static FAutoConsoleVariableRef CVarCameraAsyncPenetration(
+		TEXT("Lyra.Camera.AsyncPenetration"),
+		bCameraAsyncPenetration,
+		TEXT("If true, third person camera penetration feelers are swept asynchronously and the results are used on the next frame."),
+		ECVF_Default);
+
+	static float CameraAsyncPenetrationMargin = 10.0f;
+	static FAutoConsoleVariableRef CVarCameraAsyncPenetrationMargin(
+		TEXT("Lyra.Camera.AsyncPenetration.Margin"),
+		CameraAsyncPenetrationMargin,
+		TEXT("Distance async camera penetration sweeps are inflated by on top of the expected camera motion. A result is only used while both ends of the feeler have moved less than its inflation since it was swept."),
+		ECVF_Default);
+
+	static float CameraAsyncPenetrationMaxMotionInflation = 100.0f;
+	static FAutoConsoleVariableRef CVarCameraAsyncPenetrationMaxMotionInflation(
+		TEXT("Lyra.Camera.AsyncPenetration.MaxMotionInflation"),
+		CameraAsyncPenetrationMaxMotionInflation,
+		TEXT("Upper bound on how far async camera penetration sweeps are inflated to cover the motion of the feeler (from movement and rotation) until their result is read back."),
+		ECVF_Default);
+}
+
+#if !UE_BUILD_SHIPPING
+namespace LyraCameraPenetrationRecording
+{
+	static TArray<FLyraCameraPenetrationFrame> Frames;
+	static TWeakObjectPtr<ULyraCameraMode_ThirdPerson> CameraMode;
+	static TWeakObjectPtr<const AActor> ViewTarget;
+	static int32 FramesToRecord = 0;
+
+	static void RecordFrame(ULyraCameraMode_ThirdPerson* InCameraMode, const AActor& InViewTarget, const FVector& SafeLocation, const FVector& DesiredLocation, float DeltaTime, bool bSingleRayOnly)
+	{
+		if ((FramesToRecord <= 0) || (CameraMode.IsValid() && (CameraMode.Get() != InCameraMode)))
+		{
+			return;
+		}
+
+		// The first camera to update after the command owns the recording
+		CameraMode = InCameraMode;
+		ViewTarget = &InViewTarget;
+
+		FLyraCameraPenetrationFrame& Frame = Frames.AddDefaulted_GetRef();
+		Frame.SafeLocation = SafeLocation;
+		Frame.DesiredLocation = DesiredLocation;
+		Frame.DeltaTime = DeltaTime;
+		Frame.bSingleRayOnly = bSingleRayOnly;
+
+		if (--FramesToRecord == 0)
+		{
+			UE_LOG(LogLyra, Display, TEXT("Recorded %d frames of %s, replay them with Lyra.Camera.ReplayPenetrationPath"), Frames.Num(), *GetNameSafe(InCameraMode));
+		}
+	}
+}
+#endif // !UE_BUILD_SHIPPING
+
 ULyraCameraMode_ThirdPerson::ULyraCameraMode_ThirdPerson()
 {
 	TargetOffsetCurve = nullptr;
@@ -117,15 +177,10 @@ void ULyraCameraMode_ThirdPerson::UpdatePreventPenetration(float DeltaTime)
 
 	AActor* TargetActor = GetTargetActor();
 
-	APawn* TargetPawn = Cast<APawn>(TargetActor);
-	AController* TargetController = TargetPawn ? TargetPawn->GetController() : nullptr;
-	ILyraCameraAssistInterface* TargetControllerAssist = Cast<ILyraCameraAssistInterface>(TargetController);
-
 	ILyraCameraAssistInterface* TargetActorAssist = Cast<ILyraCameraAssistInterface>(TargetActor);
 
 	TOptional<AActor*> OptionalPPTarget = TargetActorAssist ? TargetActorAssist->GetCameraPreventPenetrationTarget() : TOptional<AActor*>();
 	AActor* PPActor = OptionalPPTarget.IsSet() ? OptionalPPTarget.GetValue() : TargetActor;
-	ILyraCameraAssistInterface* PPActorAssist = OptionalPPTarget.IsSet() ? Cast<ILyraCameraAssistInterface>(PPActor) : nullptr;
 
 	const UPrimitiveComponent* PPActorRootComponent = Cast<UPrimitiveComponent>(PPActor->GetRootComponent());
 	if (PPActorRootComponent)
@@ -152,12 +207,21 @@ void ULyraCameraMode_ThirdPerson::UpdatePreventPenetration(float DeltaTime)
 
 		// Then aim line to desired camera position
 		bool const bSingleRayPenetrationCheck = !bDoPredictiveAvoidance;
+#if !UE_BUILD_SHIPPING
+		LyraCameraPenetrationRecording::RecordFrame(this, *PPActor, SafeLocation, View.Location, DeltaTime, bSingleRayPenetrationCheck);
+#endif
 		PreventCameraPenetration(*PPActor, SafeLocation, View.Location, DeltaTime, AimLineToDesiredPosBlockedPct, bSingleRayPenetrationCheck);
 
-		ILyraCameraAssistInterface* AssistArray[] = { TargetControllerAssist, TargetActorAssist, PPActorAssist };
-
 		if (AimLineToDesiredPosBlockedPct < ReportPenetrationPercent)
 		{
+			// Only look up the assists when there is something to tell them
+			APawn* TargetPawn = Cast<APawn>(TargetActor);
+			AController* TargetController = TargetPawn ? TargetPawn->GetController() : nullptr;
+			ILyraCameraAssistInterface* TargetControllerAssist = Cast<ILyraCameraAssistInterface>(TargetController);
+			ILyraCameraAssistInterface* PPActorAssist = OptionalPPTarget.IsSet() ? Cast<ILyraCameraAssistInterface>(PPActor) : nullptr;
+
+			ILyraCameraAssistInterface* AssistArray[] = { TargetControllerAssist, TargetActorAssist, PPActorAssist };
+
 			for (ILyraCameraAssistInterface* Assist : AssistArray)
 			{
 				if (Assist)
@@ -201,6 +265,21 @@ void ULyraCameraMode_ThirdPerson::PreventCameraPenetration(class AActor const& V
 	FCollisionShape SphereShape = FCollisionShape::MakeSphere(0.f);
 	UWorld* World = GetWorld();
 
+	// Pick up the async sweeps that finished since the last update (including those of feelers that are not due this frame)
+	ULyraCameraCollisionSubsystem* CollisionSubsystem = LyraConsoleVariables::bCameraAsyncPenetration ? World->GetSubsystem<ULyraCameraCollisionSubsystem>() : nullptr;
+	if (CollisionSubsystem)
+	{
+		FeelerSweeps.SetNum(PenetrationAvoidanceFeelers.Num());
+		for (FLyraCameraFeelerSweep& Sweep : FeelerSweeps)
+		{
+			CollisionSubsystem->ResolveSweep(Sweep);
+		}
+	}
+	else
+	{
+		FeelerSweeps.Reset();
+	}
+
 	for (int32 RayIdx = 0; RayIdx < NumRaysToShoot; ++RayIdx)
 	{
 		FLyraPenetrationAvoidanceFeeler& Feeler = PenetrationAvoidanceFeelers[RayIdx];
@@ -224,7 +303,17 @@ void ULyraCameraMode_ThirdPerson::PreventCameraPenetration(class AActor const& V
 
 			// MT-> passing camera as actor so that camerablockingvolumes know when it's the camera doing traces
 			FHitResult Hit;
-			const bool bHit = World->SweepSingleByChannel(Hit, SafeLoc, RayTarget, FQuat::Identity, TraceChannel, SphereShape, SphereParams);
+			float HitDistance = 0.0f;
+			bool bHit = false;
+			if (CollisionSubsystem)
+			{
+				bHit = SweepFeelerAsync(*CollisionSubsystem, RayIdx, SafeLoc, RayTarget, SphereShape.Sphere.Radius, SphereParams, Hit, HitDistance);
+			}
+			else
+			{
+				bHit = World->SweepSingleByChannel(Hit, SafeLoc, RayTarget, FQuat::Identity, TraceChannel, SphereShape, SphereParams);
+				HitDistance = (Hit.Location - SafeLoc).Size();
+			}
 #if ENABLE_DRAW_DEBUG
 			if (World->TimeSince(LastDrawDebugTime) < 1.f)
 			{
@@ -277,7 +366,7 @@ void ULyraCameraMode_ThirdPerson::PreventCameraPenetration(class AActor const& V
 					NewBlockPct += (1.f - NewBlockPct) * (1.f - Weight);
 
 					// Recompute blocked pct taking into account pushout distance.
-					NewBlockPct = ((Hit.Location - SafeLoc).Size() - CollisionPushOutDistance) / (RayTarget - SafeLoc).Size();
+					NewBlockPct = (HitDistance - CollisionPushOutDistance) / (RayTarget - SafeLoc).Size();
 					DistBlockedPctThisFrame = FMath::Min(NewBlockPct, DistBlockedPctThisFrame);
 
 					// This feeler got a hit, so do another trace next frame
@@ -349,6 +438,162 @@ void ULyraCameraMode_ThirdPerson::PreventCameraPenetration(class AActor const& V
 	}
 }
 
+bool ULyraCameraMode_ThirdPerson::SweepFeelerAsync(ULyraCameraCollisionSubsystem& CollisionSubsystem, int32 FeelerIndex, FVector const& SafeLoc, FVector const& RayTarget, float Radius, FCollisionQueryParams const& Params, FHitResult& OutHit, float& OutHitDistance)
+{
+	FLyraCameraFeelerSweep& Sweep = FeelerSweeps[FeelerIndex];
+	const float Margin = FMath::Max(LyraConsoleVariables::CameraAsyncPenetrationMargin, 0.0f);
+	const float MaxMotionInflation = FMath::Max(LyraConsoleVariables::CameraAsyncPenetrationMaxMotionInflation, 0.0f);
+
+	// The old sweep was inflated, so while neither end of the ray has moved further than its inflation its swept volume
+	// contains the one we would sweep now, and its hit is never further out than ours would be.
+	const float Drift = Sweep.bHasResult ? FMath::Max(FVector::Dist(Sweep.Start, SafeLoc), FVector::Dist(Sweep.End, RayTarget)) : 0.0f;
+	const bool bCanUseResult = Sweep.bHasResult && !bResetInterpolation && (Drift <= (Sweep.Radius - Radius));
+
+	// The feeler is expected to move about as far again (from the camera moving and turning) before the next sweep is read back
+	const float InflatedRadius = Radius + Margin + FMath::Min(Drift, MaxMotionInflation);
+
+	if (!bCanUseResult)
+	{
+		// Sweep now with the inflation the next sweep would use and keep the result as if it came back from an async sweep,
+		// so the following frames can use it instead of sweeping twice
+		Sweep.PendingHandle.Invalidate();
+		Sweep.bPendingImmediate = false;
+		Sweep.Hit = FHitResult();
+		Sweep.bHit = GetWorld()->SweepSingleByChannel(Sweep.Hit, SafeLoc, RayTarget, FQuat::Identity, ECC_Camera, FCollisionShape::MakeSphere(InflatedRadius), Params);
+		Sweep.Start = SafeLoc;
+		Sweep.End = RayTarget;
+		Sweep.Radius = InflatedRadius;
+		Sweep.bHasResult = true;
+		++NumSyncFeelerSweeps;
+	}
+	else
+	{
+		// The main feeler is always swept, the predictive ones can be skipped when the frame budget is used up
+		CollisionSubsystem.IssueSweep(Sweep, SafeLoc, RayTarget, InflatedRadius, Params, /*bRequired=*/ FeelerIndex == 0);
+	}
+
+	OutHit = Sweep.Hit;
+	OutHitDistance = FMath::Min((Sweep.Hit.Location - SafeLoc).Size(), (RayTarget - SafeLoc).Size());
+
+	return Sweep.bHit;
+}
+
+#if !UE_BUILD_SHIPPING
+void ULyraCameraMode_ThirdPerson::ReplayPenetrationPath(const AActor& ViewTarget, TConstArrayView<FLyraCameraPenetrationFrame> Frames, bool bAsync, TArray<float>& OutBlockedPcts)
+{
+	ULyraCameraCollisionSubsystem* CollisionSubsystem = GetWorld()->GetSubsystem<ULyraCameraCollisionSubsystem>();
+
+	const bool bWasAsync = LyraConsoleVariables::bCameraAsyncPenetration;
+	LyraConsoleVariables::bCameraAsyncPenetration = bAsync;
+
+	// Async sweeps run when issued so the replay does not depend on when the async trace tasks finish
+	if (CollisionSubsystem)
+	{
+		CollisionSubsystem->SetExecuteSweepsImmediately(true);
+	}
+
+	bResetInterpolation = false;
+	AimLineToDesiredPosBlockedPct = 1.0f;
+	NumSyncFeelerSweeps = 0;
+	FeelerSweeps.Reset();
+	for (FLyraPenetrationAvoidanceFeeler& Feeler : PenetrationAvoidanceFeelers)
+	{
+		Feeler.FramesUntilNextTrace = 0;
+	}
+
+	OutBlockedPcts.Reset(Frames.Num());
+	for (const FLyraCameraPenetrationFrame& Frame : Frames)
+	{
+		FVector CameraLocation = Frame.DesiredLocation;
+		PreventCameraPenetration(ViewTarget, Frame.SafeLocation, CameraLocation, Frame.DeltaTime, AimLineToDesiredPosBlockedPct, Frame.bSingleRayOnly);
+		OutBlockedPcts.Add(AimLineToDesiredPosBlockedPct);
+	}
+
+	if (CollisionSubsystem)
+	{
+		CollisionSubsystem->SetExecuteSweepsImmediately(false);
+	}
+
+	LyraConsoleVariables::bCameraAsyncPenetration = bWasAsync;
+}
+
+static FAutoConsoleCommand GLyraCameraRecordPenetrationPathCmd(
+	TEXT("Lyra.Camera.RecordPenetrationPath"),
+	TEXT("Records the inputs of the penetration avoidance of the next third person camera to update, for replaying with Lyra.Camera.ReplayPenetrationPath. Usage: Lyra.Camera.RecordPenetrationPath [Frames=600]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+	{
+		LyraCameraPenetrationRecording::Frames.Reset();
+		LyraCameraPenetrationRecording::CameraMode.Reset();
+		LyraCameraPenetrationRecording::ViewTarget.Reset();
+		LyraCameraPenetrationRecording::FramesToRecord = (Args.Num() > 0) ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 600;
+	}));
+
+static FAutoConsoleCommand GLyraCameraReplayPenetrationPathCmd(
+	TEXT("Lyra.Camera.ReplayPenetrationPath"),
+	TEXT("Replays the recorded camera path with synchronous and with async penetration sweeps, and compares the blocked percentages and the time spent. Usage: Lyra.Camera.ReplayPenetrationPath [Repeats=10]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+	{
+		const int32 Repeats = (Args.Num() > 0) ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 10;
+
+		ULyraCameraMode_ThirdPerson* RecordedMode = LyraCameraPenetrationRecording::CameraMode.Get();
+		const AActor* ViewTarget = LyraCameraPenetrationRecording::ViewTarget.Get();
+		const TArray<FLyraCameraPenetrationFrame>& Frames = LyraCameraPenetrationRecording::Frames;
+		if ((RecordedMode == nullptr) || (ViewTarget == nullptr) || (Frames.Num() == 0) || (LyraCameraPenetrationRecording::FramesToRecord > 0))
+		{
+			UE_LOG(LogLyra, Warning, TEXT("Lyra.Camera.ReplayPenetrationPath needs a finished recording from Lyra.Camera.RecordPenetrationPath (and the camera and view target still alive)"));
+			return;
+		}
+
+		// Replay on copies so the live camera keeps its state
+		ULyraCameraMode_ThirdPerson* SyncMode = NewObject<ULyraCameraMode_ThirdPerson>(RecordedMode->GetOuter(), RecordedMode->GetClass(), NAME_None, RF_Transient, RecordedMode);
+		ULyraCameraMode_ThirdPerson* AsyncMode = NewObject<ULyraCameraMode_ThirdPerson>(RecordedMode->GetOuter(), RecordedMode->GetClass(), NAME_None, RF_Transient, RecordedMode);
+		ULyraCameraCollisionSubsystem* CollisionSubsystem = RecordedMode->GetWorld()->GetSubsystem<ULyraCameraCollisionSubsystem>();
+
+		TArray<float> SyncBlockedPcts;
+		double SyncStart = FPlatformTime::Seconds();
+		for (int32 Repeat = 0; Repeat < Repeats; ++Repeat)
+		{
+			SyncMode->ReplayPenetrationPath(*ViewTarget, Frames, /*bAsync=*/ false, SyncBlockedPcts);
+		}
+		const double SyncSeconds = FPlatformTime::Seconds() - SyncStart;
+
+		if (CollisionSubsystem)
+		{
+			CollisionSubsystem->ResetStats();
+		}
+
+		TArray<float> AsyncBlockedPcts;
+		double AsyncStart = FPlatformTime::Seconds();
+		for (int32 Repeat = 0; Repeat < Repeats; ++Repeat)
+		{
+			AsyncMode->ReplayPenetrationPath(*ViewTarget, Frames, /*bAsync=*/ true, AsyncBlockedPcts);
+		}
+		const double AsyncSeconds = FPlatformTime::Seconds() - AsyncStart;
+
+		// Async results may hold the camera in a little closer, but it should never end up further out than the synchronous sweeps put it
+		float MaxDifference = 0.0f;
+		double TotalDifference = 0.0;
+		int32 NumFurtherOut = 0;
+		for (int32 FrameIndex = 0; FrameIndex < Frames.Num(); ++FrameIndex)
+		{
+			const float Difference = AsyncBlockedPcts[FrameIndex] - SyncBlockedPcts[FrameIndex];
+			MaxDifference = FMath::Max(MaxDifference, FMath::Abs(Difference));
+			TotalDifference += FMath::Abs(Difference);
+			NumFurtherOut += (Difference > UE_KINDA_SMALL_NUMBER) ? 1 : 0;
+		}
+
+		UE_LOG(LogLyra, Display, TEXT("Camera penetration replay of %d frames x %d: sync %.3f ms/frame, async %.3f ms/frame with its sweeps run inline (%d sweeps issued, %d skipped by the budget, %d synchronous fallbacks per replay)"),
+			Frames.Num(), Repeats,
+			SyncSeconds * 1000.0 / (Frames.Num() * Repeats), AsyncSeconds * 1000.0 / (Frames.Num() * Repeats),
+			CollisionSubsystem ? CollisionSubsystem->GetNumSweepsIssued() : 0, CollisionSubsystem ? CollisionSubsystem->GetNumSweepsSkipped() : 0, AsyncMode->GetNumSyncFeelerSweeps());
+		UE_LOG(LogLyra, Display, TEXT("Blocked percentage difference: max %.4f, mean %.4f, %d frames further out than sync"),
+			MaxDifference, TotalDifference / Frames.Num(), NumFurtherOut);
+
+		SyncMode->MarkAsGarbage();
+		AsyncMode->MarkAsGarbage();
+	}));
+#endif // !UE_BUILD_SHIPPING
+
 void ULyraCameraMode_ThirdPerson::SetTargetCrouchOffset(FVector NewTargetOffset)
 {
 	CrouchOffsetBlendPct = 0.0f;
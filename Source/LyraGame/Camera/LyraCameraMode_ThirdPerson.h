@@ -3,6 +3,7 @@
 #pragma once
 
 #include "LyraCameraMode.h"
+#include "Camera/LyraCameraCollisionSubsystem.h"
 #include "Curves/CurveFloat.h"
 #include "LyraPenetrationAvoidanceFeeler.h"
 #include "DrawDebugHelpers.h"
@@ -10,6 +11,17 @@
 
 class UCurveVector;
 
+#if !UE_BUILD_SHIPPING
+// One frame of a camera path recorded with Lyra.Camera.RecordPenetrationPath
+struct FLyraCameraPenetrationFrame
+{
+	FVector SafeLocation = FVector::ZeroVector;
+	FVector DesiredLocation = FVector::ZeroVector;
+	float DeltaTime = 0.0f;
+	bool bSingleRayOnly = false;
+};
+#endif
+
 /**
  * ULyraCameraMode_ThirdPerson
  *
@@ -32,6 +44,10 @@ protected:
 	void UpdatePreventPenetration(float DeltaTime);
 	void PreventCameraPenetration(class AActor const& ViewTarget, FVector const& SafeLoc, FVector& CameraLoc, float const& DeltaTime, float& DistBlockedPct, bool bSingleRayOnly);
 
+	// Uses the last async result of the feeler if the ray has not moved further than the sweep was inflated by and issues the sweep for the next frame,
+	// otherwise sweeps now (inflated by the expected motion) and keeps that result for the next frames instead
+	bool SweepFeelerAsync(ULyraCameraCollisionSubsystem& CollisionSubsystem, int32 FeelerIndex, FVector const& SafeLoc, FVector const& RayTarget, float Radius, FCollisionQueryParams const& Params, FHitResult& OutHit, float& OutHitDistance);
+
 	virtual void DrawDebug(UCanvas* Canvas) const override;
 
 protected:
@@ -101,6 +117,20 @@ public:
 	mutable float LastDrawDebugTime = -MAX_FLT;
 #endif
 
+	// Async sweep state of each feeler, used when Lyra.Camera.AsyncPenetration is enabled
+	TArray<FLyraCameraFeelerSweep> FeelerSweeps;
+
+	// Number of feelers that had to be swept synchronously because their async result was missing or too old
+	int32 NumSyncFeelerSweeps = 0;
+
+#if !UE_BUILD_SHIPPING
+public:
+	// Runs a recorded path through the penetration avoidance from a clean state, with async sweeps or without
+	void ReplayPenetrationPath(const AActor& ViewTarget, TConstArrayView<FLyraCameraPenetrationFrame> Frames, bool bAsync, TArray<float>& OutBlockedPcts);
+
+	int32 GetNumSyncFeelerSweeps() const { return NumSyncFeelerSweeps; }
+#endif
+
 protected:
 	
 	void SetTargetCrouchOffset(FVector NewTargetOffset);
@@ -14,8 +14,10 @@
 #include "Net/UnrealNetwork.h"
 #include "Player/LyraPlayerController.h"
 #include "Player/LyraPlayerState.h"
+#include "System/LyraActorUtilities.h"
 #include "System/LyraSignificanceManager.h"
 #include "TimerManager.h"
+#include "Weapons/LyraLagCompensationSubsystem.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraCharacter)
 
@@ -91,12 +93,26 @@ void ALyraCharacter::BeginPlay()
 
 	UWorld* World = GetWorld();
 
+	// Subobjects (equipment instances) can be replicated from the registered list only, before the first replication of this pawn
+	if (HasAuthority() && ULyraActorUtilities::ShouldUseRegisteredSubObjectListOnly(this))
+	{
+		bReplicateUsingRegisteredSubObjectList = true;
+	}
+
 	const bool bRegisterWithSignificanceManager = !IsNetMode(NM_DedicatedServer);
 	if (bRegisterWithSignificanceManager)
 	{
 		if (ULyraSignificanceManager* SignificanceManager = USignificanceManager::Get<ULyraSignificanceManager>(World))
 		{
-//@TODO: SignificanceManager->RegisterObject(this, (EFortSignificanceType)SignificanceType);
+			SignificanceManager->RegisterPawn(this);
+		}
+	}
+
+	if (HasAuthority())
+	{
+		if (ULyraLagCompensationSubsystem* LagCompensation = World->GetSubsystem<ULyraLagCompensationSubsystem>())
+		{
+			LagCompensation->RegisterPawn(this);
 		}
 	}
 }
@@ -112,9 +128,14 @@ void ALyraCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 	{
 		if (ULyraSignificanceManager* SignificanceManager = USignificanceManager::Get<ULyraSignificanceManager>(World))
 		{
-			SignificanceManager->UnregisterObject(this);
+			SignificanceManager->UnregisterActor(this);
 		}
 	}
+
+	if (ULyraLagCompensationSubsystem* LagCompensation = World->GetSubsystem<ULyraLagCompensationSubsystem>())
+	{
+		LagCompensation->UnregisterPawn(this);
+	}
 }
 
 void ALyraCharacter::Reset()
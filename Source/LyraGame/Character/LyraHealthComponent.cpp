@@ -11,6 +11,7 @@
 #include "GameplayEffectExtension.h"
 #include "AbilitySystem/LyraAbilitySystemComponent.h"
 #include "AbilitySystem/Attributes/LyraHealthSet.h"
+#include "Messages/LyraDamageMessageSubsystem.h"
 #include "Messages/LyraVerbMessage.h"
 #include "Messages/LyraVerbMessageHelpers.h"
 #include "GameFramework/GameplayMessageSubsystem.h"
@@ -29,6 +30,7 @@ ULyraHealthComponent::ULyraHealthComponent(const FObjectInitializer& ObjectIniti
 	PrimaryComponentTick.bCanEverTick = false;
 
 	SetIsReplicatedByDefault(true);
+	bReplicateUsingRegisteredSubObjectList = true;
 
 	AbilitySystemComponent = nullptr;
 	HealthSet = nullptr;
@@ -101,6 +103,7 @@ void ULyraHealthComponent::UninitializeFromAbilitySystem()
 
 	HealthSet = nullptr;
 	AbilitySystemComponent = nullptr;
+	PendingHealthChanges.Reset();
 }
 
 void ULyraHealthComponent::ClearGameplayTags()
@@ -148,7 +151,45 @@ static AActor* GetInstigatorFromAttrChangeData(const FOnAttributeChangeData& Cha
 
 void ULyraHealthComponent::HandleHealthChanged(const FOnAttributeChangeData& ChangeData)
 {
-	OnHealthChanged.Broadcast(this, ChangeData.OldValue, ChangeData.NewValue, GetInstigatorFromAttrChangeData(ChangeData));
+	AActor* Instigator = GetInstigatorFromAttrChangeData(ChangeData);
+
+	ULyraDamageMessageSubsystem* DamageMessages = ULyraDamageMessageSubsystem::IsBatchingEnabled() ? UWorld::GetSubsystem<ULyraDamageMessageSubsystem>(GetWorld()) : nullptr;
+	if (DamageMessages == nullptr)
+	{
+		OnHealthChanged.Broadcast(this, ChangeData.OldValue, ChangeData.NewValue, Instigator);
+		return;
+	}
+
+	if (PendingHealthChanges.Num() == 0)
+	{
+		DamageMessages->AddPendingHealthChange(this);
+	}
+	else if (PendingHealthChanges.Last().Instigator.Get() == Instigator)
+	{
+		// Back to back changes from the same instigator are merged into one
+		PendingHealthChanges.Last().NewValue = ChangeData.NewValue;
+		return;
+	}
+
+	// Each change starts where the previous one ended, so listeners summing NewValue - OldValue still get the real total
+	FLyraPendingHealthChange& PendingChange = PendingHealthChanges.AddDefaulted_GetRef();
+	PendingChange.Instigator = Instigator;
+	PendingChange.OldValue = (PendingHealthChanges.Num() > 1) ? PendingHealthChanges.Last(1).NewValue : ChangeData.OldValue;
+	PendingChange.NewValue = ChangeData.NewValue;
+}
+
+void ULyraHealthComponent::FlushPendingHealthChanges()
+{
+	if (PendingHealthChanges.Num() > 0)
+	{
+		TArray<FLyraPendingHealthChange, TInlineAllocator<2>> HealthChangesToBroadcast = MoveTemp(PendingHealthChanges);
+		PendingHealthChanges.Reset();
+
+		for (const FLyraPendingHealthChange& PendingChange : HealthChangesToBroadcast)
+		{
+			OnHealthChanged.Broadcast(this, PendingChange.OldValue, PendingChange.NewValue, PendingChange.Instigator.Get());
+		}
+	}
 }
 
 void ULyraHealthComponent::HandleMaxHealthChanged(const FOnAttributeChangeData& ChangeData)
@@ -159,6 +200,12 @@ void ULyraHealthComponent::HandleMaxHealthChanged(const FOnAttributeChangeData&
 void ULyraHealthComponent::HandleOutOfHealth(AActor* DamageInstigator, AActor* DamageCauser, const FGameplayEffectSpec& DamageEffectSpec, float DamageMagnitude)
 {
 #if WITH_SERVER_CODE
+	// Make sure everything listening sees the damage before the death and the elimination
+	if (ULyraDamageMessageSubsystem* DamageMessages = UWorld::GetSubsystem<ULyraDamageMessageSubsystem>(GetWorld()))
+	{
+		DamageMessages->Flush();
+	}
+
 	if (AbilitySystemComponent)
 	{
 		// Send the "GameplayEvent.Death" gameplay event through the owner's ability system.  This can be used to trigger a death gameplay ability.
@@ -252,6 +299,9 @@ void ULyraHealthComponent::StartDeath()
 
 	DeathState = ELyraDeathState::DeathStarted;
 
+	// Clients get here from the replicated death state, possibly with the final health change still queued
+	FlushPendingHealthChanges();
+
 	if (AbilitySystemComponent)
 	{
 		AbilitySystemComponent->SetLooseGameplayTagCount(LyraGameplayTags::Status_Death_Dying, 1);
@@ -20,6 +20,19 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FLyraHealth_DeathEvent, AActor*, Own
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(FLyraHealth_AttributeChanged, ULyraHealthComponent*, HealthComponent, float, OldValue, float, NewValue, AActor*, Instigator);
 
 
+/**
+ * FLyraPendingHealthChange
+ *
+ *	Consecutive health changes caused by one instigator during a frame, waiting to be broadcast as a single OnHealthChanged.
+ */
+struct FLyraPendingHealthChange
+{
+	TWeakObjectPtr<AActor> Instigator;
+	float OldValue = 0.0f;
+	float NewValue = 0.0f;
+};
+
+
 /**
  * ELyraDeathState
  *
@@ -87,6 +100,9 @@ public:
 	// Applies enough damage to kill the owner.
 	virtual void DamageSelfDestruct(bool bFellOutOfWorld = false);
 
+	// Broadcasts the health changes queued while Lyra.Damage.BatchMessages is enabled, in order, one per run of changes from the same instigator.
+	void FlushPendingHealthChanges();
+
 public:
 
 	// Delegate fired when the health value has changed.
@@ -131,4 +147,7 @@ protected:
 	// Replicated state used to handle dying.
 	UPROPERTY(ReplicatedUsing = OnRep_DeathState)
 	ELyraDeathState DeathState;
+
+	// Health changes waiting to be broadcast, in the order of their latest change (so the last one ends on the current health).
+	TArray<FLyraPendingHealthChange, TInlineAllocator<2>> PendingHealthChanges;
 };
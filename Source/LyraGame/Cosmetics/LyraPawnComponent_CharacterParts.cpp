@@ -220,6 +220,9 @@ ULyraPawnComponent_CharacterParts::ULyraPawnComponent_CharacterParts(const FObje
 	, CharacterPartList(this)
 {
 	SetIsReplicatedByDefault(true);
+
+	// Parts are replicated as plain structs, there are no subobjects to replicate
+	bReplicateUsingRegisteredSubObjectList = true;
 }
 
 void ULyraPawnComponent_CharacterParts::GetLifetimeReplicatedProps(TArray< FLifetimeProperty >& OutLifetimeProps) const
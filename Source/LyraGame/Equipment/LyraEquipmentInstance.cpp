@@ -38,8 +38,12 @@ void ULyraEquipmentInstance::GetLifetimeReplicatedProps(TArray<FLifetimeProperty
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(ThisClass, Instigator);
-	DOREPLIFETIME(ThisClass, SpawnedActors);
+	// Push based, so unchanged equipment costs nothing to consider for replication
+	FDoRepLifetimeParams SharedParams;
+	SharedParams.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, Instigator, SharedParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, SpawnedActors, SharedParams);
 }
 
 #if UE_WITH_IRIS
@@ -54,6 +58,12 @@ void ULyraEquipmentInstance::RegisterReplicationFragments(UE::Net::FFragmentRegi
 }
 #endif // UE_WITH_IRIS
 
+void ULyraEquipmentInstance::SetInstigator(UObject* InInstigator)
+{
+	Instigator = InInstigator;
+	MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, Instigator, this);
+}
+
 APawn* ULyraEquipmentInstance::GetPawn() const
 {
 	return Cast<APawn>(GetOuter());
@@ -91,6 +101,8 @@ void ULyraEquipmentInstance::SpawnEquipmentActors(const TArray<FLyraEquipmentAct
 
 			SpawnedActors.Add(NewActor);
 		}
+
+		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, SpawnedActors, this);
 	}
 }
 
@@ -32,7 +32,7 @@ public:
 	UFUNCTION(BlueprintPure, Category=Equipment)
 	UObject* GetInstigator() const { return Instigator; }
 
-	void SetInstigator(UObject* InInstigator) { Instigator = InInstigator; }
+	void SetInstigator(UObject* InInstigator);
 
 	UFUNCTION(BlueprintPure, Category=Equipment)
 	APawn* GetPawn() const;
@@ -5,9 +5,15 @@
 #include "AbilitySystem/LyraAbilitySystemComponent.h"
 #include "AbilitySystemGlobals.h"
 #include "Engine/ActorChannel.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
 #include "LyraEquipmentDefinition.h"
 #include "LyraEquipmentInstance.h"
+#include "LyraLogChannels.h"
 #include "Net/UnrealNetwork.h"
+#include "Weapons/LyraRangedWeaponInstance.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraEquipmentManagerComponent)
 
@@ -35,6 +41,8 @@ void FLyraEquipmentList::PreReplicatedRemove(const TArrayView<int32> RemovedIndi
 			Entry.Instance->OnUnequipped();
 		}
  	}
+
+	InvalidateTypeIndex();
 }
 
 void FLyraEquipmentList::PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize)
@@ -47,6 +55,8 @@ void FLyraEquipmentList::PostReplicatedAdd(const TArrayView<int32> AddedIndices,
 			Entry.Instance->OnEquipped();
 		}
 	}
+
+	InvalidateTypeIndex();
 }
 
 void FLyraEquipmentList::PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize)
@@ -56,6 +66,9 @@ void FLyraEquipmentList::PostReplicatedChange(const TArrayView<int32> ChangedInd
 // 		const FGameplayTagStack& Stack = Stacks[Index];
 // 		TagToCountMap[Stack.Tag] = Stack.StackCount;
 // 	}
+
+	// The instance may have been resolved (or replaced) since it was added
+	InvalidateTypeIndex();
 }
 
 ULyraAbilitySystemComponent* FLyraEquipmentList::GetAbilitySystemComponent() const
@@ -102,6 +115,7 @@ ULyraEquipmentInstance* FLyraEquipmentList::AddEntry(TSubclassOf<ULyraEquipmentD
 
 
 	MarkItemDirty(NewEntry);
+	InvalidateTypeIndex();
 
 	return Result;
 }
@@ -123,10 +137,35 @@ void FLyraEquipmentList::RemoveEntry(ULyraEquipmentInstance* Instance)
 
 			EntryIt.RemoveCurrent();
 			MarkArrayDirty();
+			InvalidateTypeIndex();
 		}
 	}
 }
 
+TConstArrayView<TObjectPtr<ULyraEquipmentInstance>> FLyraEquipmentList::GetInstancesOfType(const UClass* InstanceType) const
+{
+	if (InstanceType == nullptr)
+	{
+		return TConstArrayView<TObjectPtr<ULyraEquipmentInstance>>();
+	}
+
+	if (const TArray<TObjectPtr<ULyraEquipmentInstance>>* CachedInstances = TypeIndex.Find(InstanceType))
+	{
+		return *CachedInstances;
+	}
+
+	TArray<TObjectPtr<ULyraEquipmentInstance>>& Instances = TypeIndex.Add(InstanceType);
+	for (const FLyraAppliedEquipmentEntry& Entry : Entries)
+	{
+		if ((Entry.Instance != nullptr) && Entry.Instance->IsA(InstanceType))
+		{
+			Instances.Add(Entry.Instance);
+		}
+	}
+
+	return Instances;
+}
+
 //////////////////////////////////////////////////////////////////////
 // ULyraEquipmentManagerComponent
 
@@ -136,6 +175,9 @@ ULyraEquipmentManagerComponent::ULyraEquipmentManagerComponent(const FObjectInit
 {
 	SetIsReplicatedByDefault(true);
 	bWantsInitializeComponent = true;
+
+	// Equipment instances are registered with AddReplicatedSubObject, so owners using the registered list never call ReplicateSubobjects
+	bReplicateUsingRegisteredSubObjectList = true;
 }
 
 void ULyraEquipmentManagerComponent::GetLifetimeReplicatedProps(TArray< FLifetimeProperty >& OutLifetimeProps) const
@@ -182,6 +224,7 @@ bool ULyraEquipmentManagerComponent::ReplicateSubobjects(UActorChannel* Channel,
 {
 	bool WroteSomething = Super::ReplicateSubobjects(Channel, Bunch, RepFlags);
 
+	// Only reached when the owning actor does not use the registered subobject list
 	for (FLyraAppliedEquipmentEntry& Entry : EquipmentList.Entries)
 	{
 		ULyraEquipmentInstance* Instance = Entry.Instance;
@@ -239,34 +282,84 @@ void ULyraEquipmentManagerComponent::ReadyForReplication()
 
 ULyraEquipmentInstance* ULyraEquipmentManagerComponent::GetFirstInstanceOfType(TSubclassOf<ULyraEquipmentInstance> InstanceType)
 {
-	for (FLyraAppliedEquipmentEntry& Entry : EquipmentList.Entries)
+	TConstArrayView<TObjectPtr<ULyraEquipmentInstance>> Instances = EquipmentList.GetInstancesOfType(InstanceType);
+	return (Instances.Num() > 0) ? Instances[0].Get() : nullptr;
+}
+
+TArray<ULyraEquipmentInstance*> ULyraEquipmentManagerComponent::GetEquipmentInstancesOfType(TSubclassOf<ULyraEquipmentInstance> InstanceType) const
+{
+	TConstArrayView<TObjectPtr<ULyraEquipmentInstance>> Instances = EquipmentList.GetInstancesOfType(InstanceType);
+
+	TArray<ULyraEquipmentInstance*> Results;
+	Results.Reserve(Instances.Num());
+	for (ULyraEquipmentInstance* Instance : Instances)
 	{
-		if (ULyraEquipmentInstance* Instance = Entry.Instance)
-		{
-			if (Instance->IsA(InstanceType))
-			{
-				return Instance;
-			}
-		}
+		Results.Add(Instance);
 	}
+	return Results;
+}
 
-	return nullptr;
+TConstArrayView<TObjectPtr<ULyraEquipmentInstance>> ULyraEquipmentManagerComponent::GetEquipmentInstancesOfTypeView(TSubclassOf<ULyraEquipmentInstance> InstanceType) const
+{
+	return EquipmentList.GetInstancesOfType(InstanceType);
 }
 
-TArray<ULyraEquipmentInstance*> ULyraEquipmentManagerComponent::GetEquipmentInstancesOfType(TSubclassOf<ULyraEquipmentInstance> InstanceType) const
+#if !UE_BUILD_SHIPPING
+void ULyraEquipmentManagerComponent::RunQueryBenchmark(int32 Iterations) const
 {
-	TArray<ULyraEquipmentInstance*> Results;
-	for (const FLyraAppliedEquipmentEntry& Entry : EquipmentList.Entries)
+	// The queries made every frame by the weapon state component, the weapon UI and anim layer selection
+	const UClass* QueryTypes[] = { ULyraRangedWeaponInstance::StaticClass(), ULyraWeaponInstance::StaticClass(), ULyraEquipmentInstance::StaticClass() };
+
+	for (const UClass* QueryType : QueryTypes)
 	{
-		if (ULyraEquipmentInstance* Instance = Entry.Instance)
+		int32 LinearFound = 0;
+		const double LinearStart = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
 		{
-			if (Instance->IsA(InstanceType))
+			// What GetFirstInstanceOfType used to do
+			for (const FLyraAppliedEquipmentEntry& Entry : EquipmentList.Entries)
 			{
-				Results.Add(Instance);
+				if ((Entry.Instance != nullptr) && Entry.Instance->IsA(QueryType))
+				{
+					++LinearFound;
+					break;
+				}
 			}
 		}
+		const double LinearTime = FPlatformTime::Seconds() - LinearStart;
+
+		int32 IndexedFound = 0;
+		const double IndexedStart = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			IndexedFound += (EquipmentList.GetInstancesOfType(QueryType).Num() > 0) ? 1 : 0;
+		}
+		const double IndexedTime = FPlatformTime::Seconds() - IndexedStart;
+
+		UE_LOG(LogLyra, Display, TEXT("%s: linear %.3f ms, indexed %.3f ms for %d queries over %d entries%s"),
+			*GetNameSafe(QueryType), LinearTime * 1000.0, IndexedTime * 1000.0, Iterations, EquipmentList.Entries.Num(),
+			(LinearFound == IndexedFound) ? TEXT("") : TEXT(" (RESULTS DO NOT MATCH)"));
 	}
-	return Results;
 }
 
+static FAutoConsoleCommandWithWorldAndArgs GLyraEquipmentBenchmarkQueriesCmd(
+	TEXT("Lyra.Equipment.BenchmarkQueries"),
+	TEXT("Times the per-frame equipment type queries of the local player's pawn against a linear scan. Usage: Lyra.Equipment.BenchmarkQueries [Iterations=100000]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 Iterations = (Args.Num() > 0) ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 100000;
+
+		const APlayerController* PC = (World != nullptr) ? World->GetFirstPlayerController() : nullptr;
+		const APawn* Pawn = (PC != nullptr) ? PC->GetPawn() : nullptr;
+		if (const ULyraEquipmentManagerComponent* EquipmentManager = (Pawn != nullptr) ? Pawn->FindComponentByClass<ULyraEquipmentManagerComponent>() : nullptr)
+		{
+			EquipmentManager->RunQueryBenchmark(Iterations);
+		}
+		else
+		{
+			UE_LOG(LogLyra, Warning, TEXT("Lyra.Equipment.BenchmarkQueries needs a local pawn with an equipment manager"));
+		}
+	}));
+#endif // !UE_BUILD_SHIPPING
+
 
@@ -77,9 +77,14 @@ public:
 	ULyraEquipmentInstance* AddEntry(TSubclassOf<ULyraEquipmentDefinition> EquipmentDefinition);
 	void RemoveEntry(ULyraEquipmentInstance* Instance);
 
+	// Returns the instances that are of a type (or a child of it), in list order. Only valid until the list changes.
+	TConstArrayView<TObjectPtr<ULyraEquipmentInstance>> GetInstancesOfType(const UClass* InstanceType) const;
+
 private:
 	ULyraAbilitySystemComponent* GetAbilitySystemComponent() const;
 
+	void InvalidateTypeIndex() { TypeIndex.Reset(); }
+
 	friend ULyraEquipmentManagerComponent;
 
 private:
@@ -89,6 +94,10 @@ private:
 
 	UPROPERTY(NotReplicated)
 	TObjectPtr<UActorComponent> OwnerComponent;
+
+	// The instances of each queried type (including child types), filled on first query and cleared when the list changes.
+	// The instances are kept alive by Entries.
+	mutable TMap<const UClass*, TArray<TObjectPtr<ULyraEquipmentInstance>>> TypeIndex;
 };
 
 template<>
@@ -142,12 +151,20 @@ public:
  	UFUNCTION(BlueprintCallable, BlueprintPure)
 	TArray<ULyraEquipmentInstance*> GetEquipmentInstancesOfType(TSubclassOf<ULyraEquipmentInstance> InstanceType) const;
 
+	/** Returns all equipped instances of a given type without allocating. The view is only valid until equipment changes, don't keep it. */
+	TConstArrayView<TObjectPtr<ULyraEquipmentInstance>> GetEquipmentInstancesOfTypeView(TSubclassOf<ULyraEquipmentInstance> InstanceType) const;
+
 	template <typename T>
 	T* GetFirstInstanceOfType()
 	{
 		return (T*)GetFirstInstanceOfType(T::StaticClass());
 	}
 
+#if !UE_BUILD_SHIPPING
+	/** Times the common per-frame queries against a linear scan of the equipment list and logs the results */
+	void RunQueryBenchmark(int32 Iterations) const;
+#endif
+
 private:
 	UPROPERTY(Replicated)
 	FLyraEquipmentList EquipmentList;
@@ -23,6 +23,9 @@ ULyraQuickBarComponent::ULyraQuickBarComponent(const FObjectInitializer& ObjectI
 	: Super(ObjectInitializer)
 {
 	SetIsReplicatedByDefault(true);
+
+	// The slotted items are replicated by the inventory that owns them, there is nothing for ReplicateSubobjects to write here
+	bReplicateUsingRegisteredSubObjectList = true;
 }
 
 void ULyraQuickBarComponent::GetLifetimeReplicatedProps(TArray< FLifetimeProperty >& OutLifetimeProps) const
@@ -84,22 +84,34 @@ void UAnimNotify_LyraContextEffects::Notify(USkeletalMeshComponent* MeshComp, UA
 			// Set up Array of Objects that implement the Context Effects Interface
 			TArray<UObject*> LyraContextEffectImplementingObjects;
 
-			// Determine if the Owning Actor is one of the Objects that implements the Context Effects Interface
-			if (OwningActor->Implements<ULyraContextEffectsInterface>())
+			// Use the implementers cached by the subsystem when there is one (there is none in editor preview worlds)
+			UWorld* OwningWorld = OwningActor->GetWorld();
+			if (ULyraContextEffectsSubsystem* LyraContextEffectsSubsystem = OwningWorld ? OwningWorld->GetSubsystem<ULyraContextEffectsSubsystem>() : nullptr)
 			{
-				// If so, add it to the Array
-				LyraContextEffectImplementingObjects.Add(OwningActor);
+				for (const TWeakObjectPtr<UObject>& Implementer : LyraContextEffectsSubsystem->GetContextEffectImplementers(OwningActor))
+				{
+					LyraContextEffectImplementingObjects.Add(Implementer.Get());
+				}
 			}
-
-			// Cycle through Owning Actor's Components and determine if any of them is a Component implementing the Context Effect Interface
-			for (const auto Component : OwningActor->GetComponents())
+			else
 			{
-				if (Component)
+				// Determine if the Owning Actor is one of the Objects that implements the Context Effects Interface
+				if (OwningActor->Implements<ULyraContextEffectsInterface>())
+				{
+					// If so, add it to the Array
+					LyraContextEffectImplementingObjects.Add(OwningActor);
+				}
+
+				// Cycle through Owning Actor's Components and determine if any of them is a Component implementing the Context Effect Interface
+				for (const auto Component : OwningActor->GetComponents())
 				{
-					// If the Component implements the Context Effects Interface, add it to the list
-					if (Component->Implements<ULyraContextEffectsInterface>())
+					if (Component)
 					{
-						LyraContextEffectImplementingObjects.Add(Component);
+						// If the Component implements the Context Effects Interface, add it to the list
+						if (Component->Implements<ULyraContextEffectsInterface>())
+						{
+							LyraContextEffectImplementingObjects.Add(Component);
+						}
 					}
 				}
 			}
@@ -158,7 +170,8 @@ void UAnimNotify_LyraContextEffects::Notify(USkeletalMeshComponent* MeshComp, UA
 							TArray<UNiagaraSystem*> TotalNiagaraSystems;
 
 							// Attempt to load the Effect Library content (will cache in Transient data on the Effect Library Asset)
-							EffectLibrary->LoadEffects();
+							// The preview needs the effects right away, so block instead of loading asynchronously
+							EffectLibrary->LoadEffectsSynchronous();
 
 							// If the Effect Library is valid and marked as Loaded, Get Effects from it
 							if (EffectLibrary && EffectLibrary->GetContextEffectsLibraryLoadState() == EContextEffectsLibraryLoadState::Loaded)
@@ -6,6 +6,7 @@
 #include "Engine/World.h"
 #include "LyraContextEffectsSubsystem.h"
 #include "PhysicalMaterials/PhysicalMaterial.h"
+#include "System/LyraSignificanceManager.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraContextEffectComponent)
 
@@ -39,6 +40,7 @@ void ULyraContextEffectComponent::BeginPlay()
 		if (ULyraContextEffectsSubsystem* LyraContextEffectsSubsystem = World->GetSubsystem<ULyraContextEffectsSubsystem>())
 		{
 			LyraContextEffectsSubsystem->LoadAndAddContextEffectsLibraries(GetOwner(), CurrentContextEffectsLibraries);
+			LyraContextEffectsSubsystem->InvalidateContextEffectImplementers(GetOwner());
 		}
 	}
 }
@@ -51,6 +53,7 @@ void ULyraContextEffectComponent::EndPlay(const EEndPlayReason::Type EndPlayReas
 		if (ULyraContextEffectsSubsystem* LyraContextEffectsSubsystem = World->GetSubsystem<ULyraContextEffectsSubsystem>())
 		{
 			LyraContextEffectsSubsystem->UnloadAndRemoveContextEffectsLibraries(GetOwner());
+			LyraContextEffectsSubsystem->InvalidateContextEffectImplementers(GetOwner());
 		}
 	}
 
@@ -63,9 +66,11 @@ void ULyraContextEffectComponent::AnimMotionEffect_Implementation(const FName Bo
 	const bool bHitSuccess, const FHitResult HitResult, FGameplayTagContainer Contexts,
 	FVector VFXScale, float AudioVolume, float AudioPitch)
 {
-	// Prep Components
-	TArray<UAudioComponent*> AudioComponentsToAdd;
-	TArray<UNiagaraComponent*> NiagaraComponentsToAdd;
+	// Skip effects on actors too far away or off screen to notice them
+	if (!ULyraSignificanceManager::ShouldSpawnContextEffects(GetOwner()))
+	{
+		return;
+	}
 
 	FGameplayTagContainer TotalContexts;
 
@@ -99,31 +104,13 @@ void ULyraContextEffectComponent::AnimMotionEffect_Implementation(const FName Bo
 		}
 	}
 
-	// Cycle through Active Audio Components and cache
-	for (UAudioComponent* ActiveAudioComponent : ActiveAudioComponents)
-	{
-		if (ActiveAudioComponent)
-		{
-			AudioComponentsToAdd.Add(ActiveAudioComponent);
-		}
-	}
-
-	// Cycle through Active Niagara Components and cache
-	for (UNiagaraComponent* ActiveNiagaraComponent : ActiveNiagaraComponents)
-	{
-		if (ActiveNiagaraComponent)
-		{
-			NiagaraComponentsToAdd.Add(ActiveNiagaraComponent);
-		}
-	}
-
 	// Get World
 	if (const UWorld* World = GetWorld())
 	{
 		// Get Subsystem
 		if (ULyraContextEffectsSubsystem* LyraContextEffectsSubsystem = World->GetSubsystem<ULyraContextEffectsSubsystem>())
 		{
-			// Set up Audio Components and Niagara
+			// Set up Audio Components and Niagara (pooled, so not kept past this call)
 			TArray<UAudioComponent*> AudioComponents;
 			TArray<UNiagaraComponent*> NiagaraComponents;
 
@@ -131,21 +118,8 @@ void ULyraContextEffectComponent::AnimMotionEffect_Implementation(const FName Bo
 			LyraContextEffectsSubsystem->SpawnContextEffects(GetOwner(), StaticMeshComponent, Bone, 
 				LocationOffset, RotationOffset, MotionEffect, TotalContexts,
 				AudioComponents, NiagaraComponents, VFXScale, AudioVolume, AudioPitch);
-
-			// Append resultant effects
-			AudioComponentsToAdd.Append(AudioComponents);
-			NiagaraComponentsToAdd.Append(NiagaraComponents);
 		}
 	}
-
-	// Append Active Audio Components
-	ActiveAudioComponents.Empty();
-	ActiveAudioComponents.Append(AudioComponentsToAdd);
-
-	// Append Active
-	ActiveNiagaraComponents.Empty();
-	ActiveNiagaraComponents.Append(NiagaraComponentsToAdd);
-
 }
 
 void ULyraContextEffectComponent::UpdateEffectContexts(FGameplayTagContainer NewEffectContexts)
@@ -66,10 +66,4 @@ private:
 
 	UPROPERTY(Transient)
 	TSet<TSoftObjectPtr<ULyraContextEffectsLibrary>> CurrentContextEffectsLibraries;
-
-	UPROPERTY(Transient)
-	TArray<TObjectPtr<UAudioComponent>> ActiveAudioComponents;
-
-	UPROPERTY(Transient)
-	TArray<TObjectPtr<UNiagaraComponent>> ActiveNiagaraComponents;
 };
@@ -2,14 +2,103 @@
 
 #include "Feedback/ContextEffects/LyraContextEffectsLibrary.h"
 
+#include "Algo/Sort.h"
+#include "Algo/StableSort.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "HAL/IConsoleManager.h"
+#include "LyraLogChannels.h"
 #include "NiagaraSystem.h"
 #include "Sound/SoundBase.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraContextEffectsLibrary)
 
+namespace LyraConsoleVariables
+{
+	static int32 MaxCachedContextEffectResults = 256;
+	static FAutoConsoleVariableRef CVarMaxCachedContextEffectResults(
+		TEXT("Lyra.ContextEffects.MaxCachedResults"),
+		MaxCachedContextEffectResults,
+		TEXT("The maximum number of (effect, context) lookups cached per context effects library. The cache is flushed when full, 0 disables caching."),
+		ECVF_Default);
+}
+
+namespace LyraContextEffectsReplay
+{
+	// A GetEffects call captured by Lyra.ContextEffects.RecordNotifies
+	struct FRecordedLookup
+	{
+		TWeakObjectPtr<ULyraContextEffectsLibrary> Library;
+		FGameplayTag Effect;
+		FGameplayTagContainer Context;
+	};
+
+	static bool bRecording = false;
+	static TArray<FRecordedLookup> RecordedLookups;
+	static constexpr int32 MaxRecordedLookups = 100000;
+}
 
-void ULyraContextEffectsLibrary::GetEffects(const FGameplayTag Effect, const FGameplayTagContainer Context, 
+void ULyraContextEffectsLibrary::GetEffects(const FGameplayTag Effect, const FGameplayTagContainer Context,
 	TArray<USoundBase*>& Sounds, TArray<UNiagaraSystem*>& NiagaraSystems)
+{
+	// Make sure Effect is valid and Library is loaded
+	if (Effect.IsValid() && Context.IsValid() && EffectsLoadState == EContextEffectsLibraryLoadState::Loaded)
+	{
+		if (LyraContextEffectsReplay::bRecording && (LyraContextEffectsReplay::RecordedLookups.Num() < LyraContextEffectsReplay::MaxRecordedLookups))
+		{
+			LyraContextEffectsReplay::RecordedLookups.Add({ this, Effect, Context });
+		}
+
+		// Most notifies repeat the same few (effect, context) pairs, e.g., footsteps on the same surface
+		FCacheKey CacheKey{ Effect, Context };
+		if (const FCachedResult* CachedResult = ResultCache.Find(CacheKey))
+		{
+			Sounds.Append(CachedResult->Sounds);
+			NiagaraSystems.Append(CachedResult->NiagaraSystems);
+			return;
+		}
+
+		FCachedResult Result;
+
+		// Only the entries for this effect tag are considered
+		if (const FEffectBucket* Bucket = EffectIndex.Find(Effect))
+		{
+			const int32 NumContextTags = Context.Num();
+			for (const int32 EntryIndex : Bucket->Entries)
+			{
+				const ULyraActiveContextEffects* ActiveContextEffect = ActiveContextEffects[EntryIndex];
+
+				// Entries are sorted by context size, an entry needing more tags than the context has can't match, and neither can the rest
+				if (ActiveContextEffect->Context.Num() > NumContextTags)
+				{
+					break;
+				}
+
+				// Ensure the Context has all tags in the Effect (entries with empty contexts are never indexed)
+				if (Context.HasAllExact(ActiveContextEffect->Context))
+				{
+					Result.Sounds.Append(ActiveContextEffect->Sounds);
+					Result.NiagaraSystems.Append(ActiveContextEffect->NiagaraSystems);
+				}
+			}
+		}
+
+		Sounds.Append(Result.Sounds);
+		NiagaraSystems.Append(Result.NiagaraSystems);
+
+		if (LyraConsoleVariables::MaxCachedContextEffectResults > 0)
+		{
+			if (ResultCache.Num() >= LyraConsoleVariables::MaxCachedContextEffectResults)
+			{
+				ResultCache.Reset();
+			}
+			ResultCache.Add(MoveTemp(CacheKey), MoveTemp(Result));
+		}
+	}
+}
+
+void ULyraContextEffectsLibrary::GetEffectsLinear(const FGameplayTag Effect, const FGameplayTagContainer& Context,
+	TArray<USoundBase*>& Sounds, TArray<UNiagaraSystem*>& NiagaraSystems) const
 {
 	// Make sure Effect is valid and Library is loaded
 	if (Effect.IsValid() && Context.IsValid() && EffectsLoadState == EContextEffectsLibraryLoadState::Loaded)
@@ -32,17 +121,31 @@ void ULyraContextEffectsLibrary::GetEffects(const FGameplayTag Effect, const FGa
 
 void ULyraContextEffectsLibrary::LoadEffects()
 {
-	// Load Effects into Library if not currently loading
-	if (EffectsLoadState != EContextEffectsLibraryLoadState::Loading)
+	// Load Effects into Library if not already loaded or loading (every actor using the library asks for it to be loaded)
+	if (EffectsLoadState == EContextEffectsLibraryLoadState::Unloaded)
 	{
 		// Set load state to loading
 		EffectsLoadState = EContextEffectsLibraryLoadState::Loading;
 
-		// Clear out any old Active Effects
-		ActiveContextEffects.Empty();
-
 		// Call internal loading function
-		LoadEffectsInternal();
+		LoadEffectsInternal(/*bSynchronous=*/ false);
+	}
+}
+
+void ULyraContextEffectsLibrary::LoadEffectsSynchronous()
+{
+	if (EffectsLoadState == EContextEffectsLibraryLoadState::Loading)
+	{
+		// Finish the pending async load, the completion callback runs from inside the wait
+		if (EffectsLoadHandle.IsValid())
+		{
+			EffectsLoadHandle->WaitUntilComplete();
+		}
+	}
+	else if (EffectsLoadState == EContextEffectsLibraryLoadState::Unloaded)
+	{
+		EffectsLoadState = EContextEffectsLibraryLoadState::Loading;
+		LoadEffectsInternal(/*bSynchronous=*/ true);
 	}
 }
 
@@ -52,18 +155,79 @@ EContextEffectsLibraryLoadState ULyraContextEffectsLibrary::GetContextEffectsLib
 	return EffectsLoadState;
 }
 
-void ULyraContextEffectsLibrary::LoadEffectsInternal()
+#if WITH_EDITOR
+void ULyraContextEffectsLibrary::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	// Drop the loaded effects so the next LoadEffects (e.g. from the editor preview) rebuilds them from the edited entries
+	if (EffectsLoadHandle.IsValid())
+	{
+		EffectsLoadHandle->CancelHandle();
+		EffectsLoadHandle.Reset();
+	}
+
+	ActiveContextEffects.Reset();
+	EffectIndex.Reset();
+	ResultCache.Reset();
+	EffectsLoadState = EContextEffectsLibraryLoadState::Unloaded;
+}
+#endif
+
+void ULyraContextEffectsLibrary::LoadEffectsInternal(bool bSynchronous)
+{
+	// Gather every effect asset so they are requested as a single batch
+	TArray<FSoftObjectPath> EffectPaths;
+	for (const FLyraContextEffects& ContextEffect : ContextEffects)
+	{
+		if (ContextEffect.EffectTag.IsValid() && ContextEffect.Context.IsValid())
+		{
+			for (const FSoftObjectPath& Effect : ContextEffect.Effects)
+			{
+				if (!Effect.IsNull())
+				{
+					EffectPaths.AddUnique(Effect);
+				}
+			}
+		}
+	}
+
+	LoadStartTime = FPlatformTime::Seconds();
+
+	if (EffectPaths.Num() == 0)
+	{
+		EffectsLoadHandle.Reset();
+		OnEffectsLoaded();
+		return;
+	}
+
+	FStreamableManager& StreamableManager = UAssetManager::GetStreamableManager();
+	if (bSynchronous)
+	{
+		EffectsLoadHandle = StreamableManager.RequestSyncLoad(EffectPaths);
+		OnEffectsLoaded();
+	}
+	else
+	{
+		EffectsLoadHandle = StreamableManager.RequestAsyncLoad(EffectPaths, FStreamableDelegate::CreateUObject(this, &ThisClass::OnEffectsLoaded), FStreamableManager::AsyncLoadHighPriority);
+	}
+}
+
+void ULyraContextEffectsLibrary::OnEffectsLoaded()
 {
-	// TODO Add Async Loading for Libraries
+	// A synchronous load can finish a pending async one first, only build once
+	if (EffectsLoadState != EContextEffectsLibraryLoadState::Loading)
+	{
+		return;
+	}
 
-	// Copy data for async load
-	TArray<FLyraContextEffects> LocalContextEffects = ContextEffects;
+	const double BuildStartTime = FPlatformTime::Seconds();
 
 	// Prepare Active Context Effects Array
 	TArray<ULyraActiveContextEffects*> ActiveContextEffectsArray;
 
 	// Loop through Context Effects
-	for (const FLyraContextEffects& ContextEffect : LocalContextEffects)
+	for (const FLyraContextEffects& ContextEffect : ContextEffects)
 	{
 		// Make sure Tags are Valid
 		if (ContextEffect.EffectTag.IsValid() && ContextEffect.Context.IsValid())
@@ -75,24 +239,18 @@ void ULyraContextEffectsLibrary::LoadEffectsInternal()
 			NewActiveContextEffects->EffectTag = ContextEffect.EffectTag;
 			NewActiveContextEffects->Context = ContextEffect.Context;
 
-			// Try to load and add Effects to New Active Context Effects
+			// Add the loaded Effects to New Active Context Effects
 			for (const FSoftObjectPath& Effect : ContextEffect.Effects)
 			{
-				if (UObject* Object = Effect.TryLoad())
+				if (UObject* Object = Effect.ResolveObject())
 				{
-					if (Object->IsA(USoundBase::StaticClass()))
+					if (USoundBase* SoundBase = Cast<USoundBase>(Object))
 					{
-						if (USoundBase* SoundBase = Cast<USoundBase>(Object))
-						{
-							NewActiveContextEffects->Sounds.Add(SoundBase);
-						}
+						NewActiveContextEffects->Sounds.Add(SoundBase);
 					}
-					else if (Object->IsA(UNiagaraSystem::StaticClass()))
+					else if (UNiagaraSystem* NiagaraSystem = Cast<UNiagaraSystem>(Object))
 					{
-						if (UNiagaraSystem* NiagaraSystem = Cast<UNiagaraSystem>(Object))
-						{
-							NewActiveContextEffects->NiagaraSystems.Add(NiagaraSystem);
-						}
+						NewActiveContextEffects->NiagaraSystems.Add(NiagaraSystem);
 					}
 				}
 			}
@@ -102,9 +260,12 @@ void ULyraContextEffectsLibrary::LoadEffectsInternal()
 		}
 	}
 
-	// TODO Call Load Complete after Async Load
 	// Mark loading complete
 	this->LyraContextEffectLibraryLoadingComplete(ActiveContextEffectsArray);
+
+	const double EndTime = FPlatformTime::Seconds();
+	UE_LOG(LogLyra, Log, TEXT("Context effects library %s loaded %d entries in %.2f ms (%.3f ms on the game thread to build)"),
+		*GetName(), ActiveContextEffectsArray.Num(), (EndTime - LoadStartTime) * 1000.0, (EndTime - BuildStartTime) * 1000.0);
 }
 
 void ULyraContextEffectsLibrary::LyraContextEffectLibraryLoadingComplete(
@@ -113,7 +274,129 @@ void ULyraContextEffectsLibrary::LyraContextEffectLibraryLoadingComplete(
 	// Flag data as loaded
 	EffectsLoadState = EContextEffectsLibraryLoadState::Loaded;
 
-	// Append incoming Context Effects Array to current list of Active Context Effects
+	// Replace any old Active Effects with the incoming Context Effects Array
+	ActiveContextEffects.Reset();
 	ActiveContextEffects.Append(LyraActiveContextEffects);
+
+	BuildEffectIndex();
+}
+
+void ULyraContextEffectsLibrary::BuildEffectIndex()
+{
+	EffectIndex.Reset();
+	ResultCache.Reset();
+
+	for (int32 EntryIndex = 0; EntryIndex < ActiveContextEffects.Num(); ++EntryIndex)
+	{
+		EffectIndex.FindOrAdd(ActiveContextEffects[EntryIndex]->EffectTag).Entries.Add(EntryIndex);
+	}
+
+	// Stable so entries with the same context size keep their authored order (which is the order their effects are returned in)
+	for (TPair<FGameplayTag, FEffectBucket>& Pair : EffectIndex)
+	{
+		Algo::StableSortBy(Pair.Value.Entries, [this](int32 EntryIndex) { return ActiveContextEffects[EntryIndex]->Context.Num(); });
+	}
 }
 
+//////////////////////////////////////////////////////////////////////
+// Notify stream recording and replay, for measuring lookup cost
+
+static FAutoConsoleCommand GLyraContextEffectsRecordCmd(
+	TEXT("Lyra.ContextEffects.RecordNotifies"),
+	TEXT("Starts (1) or stops (0) recording the context effect lookups made by notifies, for Lyra.ContextEffects.ReplayNotifies"),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+	{
+		const bool bStart = (Args.Num() == 0) || (FCString::Atoi(*Args[0]) != 0);
+		if (bStart)
+		{
+			LyraContextEffectsReplay::RecordedLookups.Reset();
+		}
+		LyraContextEffectsReplay::bRecording = bStart;
+
+		UE_LOG(LogLyra, Display, TEXT("%s recording context effect lookups (%d recorded)"), bStart ? TEXT("Started") : TEXT("Stopped"), LyraContextEffectsReplay::RecordedLookups.Num());
+	}));
+
+static FAutoConsoleCommand GLyraContextEffectsReplayCmd(
+	TEXT("Lyra.ContextEffects.ReplayNotifies"),
+	TEXT("Replays the recorded context effect lookups through the indexed lookup and the linear scan it replaced, and reports the cost of each. Usage: Lyra.ContextEffects.ReplayNotifies [Iterations=10]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+	{
+		const int32 Iterations = (Args.Num() > 0) ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 10;
+
+		TArray<LyraContextEffectsReplay::FRecordedLookup> Lookups;
+		for (const LyraContextEffectsReplay::FRecordedLookup& Lookup : LyraContextEffectsReplay::RecordedLookups)
+		{
+			ULyraContextEffectsLibrary* Library = Lookup.Library.Get();
+			if ((Library != nullptr) && (Library->GetContextEffectsLibraryLoadState() == EContextEffectsLibraryLoadState::Loaded))
+			{
+				Lookups.Add(Lookup);
+			}
+		}
+
+		if (Lookups.Num() == 0)
+		{
+			UE_LOG(LogLyra, Display, TEXT("No recorded lookups to replay (use Lyra.ContextEffects.RecordNotifies first)"));
+			return;
+		}
+
+		// Don't record our own lookups
+		const bool bWasRecording = LyraContextEffectsReplay::bRecording;
+		LyraContextEffectsReplay::bRecording = false;
+
+		TArray<USoundBase*> Sounds;
+		TArray<UNiagaraSystem*> NiagaraSystems;
+		TArray<USoundBase*> ExpectedSounds;
+		TArray<UNiagaraSystem*> ExpectedNiagaraSystems;
+
+		int32 NumMismatches = 0;
+		for (const LyraContextEffectsReplay::FRecordedLookup& Lookup : Lookups)
+		{
+			Sounds.Reset();
+			NiagaraSystems.Reset();
+			ExpectedSounds.Reset();
+			ExpectedNiagaraSystems.Reset();
+
+			Lookup.Library->GetEffects(Lookup.Effect, Lookup.Context, Sounds, NiagaraSystems);
+			Lookup.Library->GetEffectsLinear(Lookup.Effect, Lookup.Context, ExpectedSounds, ExpectedNiagaraSystems);
+
+			// The index returns entries grouped by context size, so only the set of effects has to match
+			Algo::Sort(Sounds);
+			Algo::Sort(NiagaraSystems);
+			Algo::Sort(ExpectedSounds);
+			Algo::Sort(ExpectedNiagaraSystems);
+			if ((Sounds != ExpectedSounds) || (NiagaraSystems != ExpectedNiagaraSystems))
+			{
+				++NumMismatches;
+			}
+		}
+
+		const double IndexedStart = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			for (const LyraContextEffectsReplay::FRecordedLookup& Lookup : Lookups)
+			{
+				Sounds.Reset();
+				NiagaraSystems.Reset();
+				Lookup.Library->GetEffects(Lookup.Effect, Lookup.Context, Sounds, NiagaraSystems);
+			}
+		}
+		const double IndexedSeconds = FPlatformTime::Seconds() - IndexedStart;
+
+		const double LinearStart = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			for (const LyraContextEffectsReplay::FRecordedLookup& Lookup : Lookups)
+			{
+				Sounds.Reset();
+				NiagaraSystems.Reset();
+				Lookup.Library->GetEffectsLinear(Lookup.Effect, Lookup.Context, Sounds, NiagaraSystems);
+			}
+		}
+		const double LinearSeconds = FPlatformTime::Seconds() - LinearStart;
+
+		LyraContextEffectsReplay::bRecording = bWasRecording;
+
+		const double NumLookups = (double)Lookups.Num() * Iterations;
+		UE_LOG(LogLyra, Display, TEXT("Replayed %d lookups x %d: indexed %.3f us/lookup, linear %.3f us/lookup, %d mismatches"),
+			Lookups.Num(), Iterations, (IndexedSeconds / NumLookups) * 1.0e6, (LinearSeconds / NumLookups) * 1.0e6, NumMismatches);
+	}));
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "GameplayTagContainer.h"
+#include "Templates/SharedPointer.h"
 #include "UObject/SoftObjectPath.h"
 #include "UObject/WeakObjectPtr.h"
 
@@ -11,6 +12,7 @@
 class UNiagaraSystem;
 class USoundBase;
 struct FFrame;
+struct FStreamableHandle;
 
 /**
  *
@@ -81,19 +83,79 @@ public:
 	UFUNCTION(BlueprintCallable)
 	void GetEffects(const FGameplayTag Effect, const FGameplayTagContainer Context, TArray<USoundBase*>& Sounds, TArray<UNiagaraSystem*>& NiagaraSystems);
 
+	/** Starts loading the effects asynchronously, the library can be used once its load state is Loaded */
 	UFUNCTION(BlueprintCallable)
 	void LoadEffects();
 
+	/** Loads the effects and blocks until they are ready (or finishes a pending async load), for editor previews */
+	void LoadEffectsSynchronous();
+
 	EContextEffectsLibraryLoadState GetContextEffectsLibraryLoadState();
 
+	/** Reference implementation of GetEffects that scans every active effect, used to validate and benchmark the index */
+	void GetEffectsLinear(const FGameplayTag Effect, const FGameplayTagContainer& Context, TArray<USoundBase*>& Sounds, TArray<UNiagaraSystem*>& NiagaraSystems) const;
+
+	//~UObject interface
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+	//~End of UObject interface
+
 private:
-	void LoadEffectsInternal();
+	void LoadEffectsInternal(bool bSynchronous);
+
+	void OnEffectsLoaded();
 
 	void LyraContextEffectLibraryLoadingComplete(TArray<ULyraActiveContextEffects*> LyraActiveContextEffects);
 
+	/** Rebuilds EffectIndex from ActiveContextEffects and clears the result cache */
+	void BuildEffectIndex();
+
 	UPROPERTY(Transient)
 	TArray< TObjectPtr<ULyraActiveContextEffects>> ActiveContextEffects;
 
 	UPROPERTY(Transient)
 	EContextEffectsLibraryLoadState EffectsLoadState = EContextEffectsLibraryLoadState::Unloaded;
+
+	/** Keeps the effect assets loaded, and is waited on by LoadEffectsSynchronous while loading */
+	TSharedPtr<FStreamableHandle> EffectsLoadHandle;
+
+	/** When the current load was requested, for reporting load time */
+	double LoadStartTime = 0.0;
+
+	/** Indices into ActiveContextEffects for one effect tag, sorted by the number of context tags (fewest first) */
+	struct FEffectBucket
+	{
+		TArray<int32> Entries;
+	};
+
+	TMap<FGameplayTag, FEffectBucket> EffectIndex;
+
+	struct FCachedResult
+	{
+		TArray<TObjectPtr<USoundBase>> Sounds;
+		TArray<TObjectPtr<UNiagaraSystem>> NiagaraSystems;
+	};
+
+	struct FCacheKey
+	{
+		FGameplayTag Effect;
+		FGameplayTagContainer Context;
+
+		bool operator==(const FCacheKey& Other) const { return (Effect == Other.Effect) && (Context == Other.Context); }
+
+		friend uint32 GetTypeHash(const FCacheKey& Key)
+		{
+			// Containers with the same tags compare equal regardless of order, so combine the tag hashes in an order independent way
+			uint32 ContextHash = 0;
+			for (const FGameplayTag& Tag : Key.Context)
+			{
+				ContextHash += GetTypeHash(Tag);
+			}
+			return HashCombine(GetTypeHash(Key.Effect), ContextHash);
+		}
+	};
+
+	/** Results of previous (effect, context) lookups, the assets are kept alive by ActiveContextEffects */
+	TMap<FCacheKey, FCachedResult> ResultCache;
 };
@@ -3,19 +3,108 @@
 
 #include "LyraContextEffectsSubsystem.h"
 
+#include "Components/AudioComponent.h"
+#include "Feedback/ContextEffects/LyraContextEffectsInterface.h"
 #include "Feedback/ContextEffects/LyraContextEffectsLibrary.h"
 #include "Feedback/ContextEffects/LyraContextEffectsSubsystem.h"
-#include "Kismet/GameplayStatics.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "LyraLogChannels.h"
+#include "NiagaraComponent.h"
 #include "NiagaraFunctionLibrary.h"
 #include "NiagaraSystem.h"
+#include "Sound/SoundBase.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraContextEffectsSubsystem)
 
 class AActor;
-class UAudioComponent;
-class UNiagaraSystem;
 class USceneComponent;
-class USoundBase;
+
+namespace LyraConsoleVariables
+{
+	static int32 MaxPooledContextEffectAudioComponents = 32;
+	static FAutoConsoleVariableRef CVarMaxPooledContextEffectAudioComponents(
+		TEXT("Lyra.ContextEffects.MaxPooledAudioComponents"),
+		MaxPooledContextEffectAudioComponents,
+		TEXT("The maximum number of idle audio components kept for reuse by context effects, finished components past this are destroyed."),
+		ECVF_Default);
+
+	static float ContextEffectNearDistance = 1500.0f;
+	static FAutoConsoleVariableRef CVarContextEffectNearDistance(
+		TEXT("Lyra.ContextEffects.NearDistance"),
+		ContextEffectNearDistance,
+		TEXT("Context effects closer than this to a local viewer use the near concurrency limit."),
+		ECVF_Default);
+
+	static float ContextEffectMidDistance = 4000.0f;
+	static FAutoConsoleVariableRef CVarContextEffectMidDistance(
+		TEXT("Lyra.ContextEffects.MidDistance"),
+		ContextEffectMidDistance,
+		TEXT("Context effects closer than this (and past the near distance) to a local viewer use the mid concurrency limit, the rest use the far limit."),
+		ECVF_Default);
+
+	static int32 MaxActiveContextEffectsNear = 8;
+	static FAutoConsoleVariableRef CVarMaxActiveContextEffectsNear(
+		TEXT("Lyra.ContextEffects.MaxActiveNear"),
+		MaxActiveContextEffectsNear,
+		TEXT("The maximum number of sounds and particle systems playing at once for the same effect tag near the local viewers (0 for no limit)."),
+		ECVF_Default);
+
+	static int32 MaxActiveContextEffectsMid = 4;
+	static FAutoConsoleVariableRef CVarMaxActiveContextEffectsMid(
+		TEXT("Lyra.ContextEffects.MaxActiveMid"),
+		MaxActiveContextEffectsMid,
+		TEXT("The maximum number of sounds and particle systems playing at once for the same effect tag at mid distance (0 for no limit)."),
+		ECVF_Default);
+
+	static int32 MaxActiveContextEffectsFar = 2;
+	static FAutoConsoleVariableRef CVarMaxActiveContextEffectsFar(
+		TEXT("Lyra.ContextEffects.MaxActiveFar"),
+		MaxActiveContextEffectsFar,
+		TEXT("The maximum number of sounds and particle systems playing at once for the same effect tag far from the local viewers (0 for no limit)."),
+		ECVF_Default);
+}
+
+static FAutoConsoleCommandWithWorld GLyraContextEffectsStatsCmd(
+	TEXT("Lyra.ContextEffects.Stats"),
+	TEXT("Logs how many context effects were requested, played and rejected, and the audio component pool hit rate"),
+	FConsoleCommandWithWorldDelegate::CreateStatic([](UWorld* World)
+	{
+		if (const ULyraContextEffectsSubsystem* LyraContextEffectsSubsystem = (World != nullptr) ? World->GetSubsystem<ULyraContextEffectsSubsystem>() : nullptr)
+		{
+			LyraContextEffectsSubsystem->LogStats();
+		}
+	}));
+
+void ULyraContextEffectsSubsystem::Deinitialize()
+{
+	for (UAudioComponent* AudioComponent : FreeAudioComponents)
+	{
+		if (AudioComponent)
+		{
+			AudioComponent->DestroyComponent();
+		}
+	}
+	FreeAudioComponents.Reset();
+
+	for (UAudioComponent* AudioComponent : PlayingAudioComponents)
+	{
+		if (AudioComponent)
+		{
+			AudioComponent->OnAudioFinishedNative.RemoveAll(this);
+			AudioComponent->DestroyComponent();
+		}
+	}
+	PlayingAudioComponents.Reset();
+
+	ActiveEffects.Reset();
+	ImplementerCache.Reset();
+
+	Super::Deinitialize();
+}
 
 void ULyraContextEffectsSubsystem::SpawnContextEffects(
 	const AActor* SpawningActor
@@ -65,24 +154,62 @@ void ULyraContextEffectsSubsystem::SpawnContextEffects(
 				}
 			}
 
+			if ((TotalSounds.Num() == 0 && TotalNiagaraSystems.Num() == 0) || AttachToComponent == nullptr)
+			{
+				return;
+			}
+
+			++Stats.NumRequests;
+
+			// Cap how many of this effect play at once, the further from the viewers the lower the cap
+			const EDistanceBand Band = GetDistanceBand(AttachToComponent->GetSocketLocation(AttachPoint));
+
 			// Cycle through found Sounds
 			for (USoundBase* Sound : TotalSounds)
 			{
-				// Spawn Sounds Attached, add Audio Component to List of ACs
-				UAudioComponent* AudioComponent = UGameplayStatics::SpawnSoundAttached(Sound, AttachToComponent, AttachPoint, LocationOffset, RotationOffset, EAttachLocation::KeepRelativeOffset,
-					false, AudioVolume, AudioPitch, 0.0f, nullptr, nullptr, true);
+				if (Sound == nullptr)
+				{
+					continue;
+				}
 
-				AudioOut.Add(AudioComponent);
+				if (!TryReserveConcurrency(Effect, Band))
+				{
+					++Stats.NumRejectedByConcurrency;
+					continue;
+				}
+
+				// Play Sounds on a pooled Audio Component, add it to List of ACs
+				if (UAudioComponent* AudioComponent = PlayPooledSound(Sound, AttachToComponent, AttachPoint, LocationOffset, RotationOffset, AudioVolume, AudioPitch))
+				{
+					AddActiveEffect(Effect, Band, AudioComponent, Sound);
+					AudioOut.Add(AudioComponent);
+				}
 			}
 
 			// Cycle through found Niagara Systems
 			for (UNiagaraSystem* NiagaraSystem : TotalNiagaraSystems)
 			{
-				// Spawn Niagara Systems Attached, add Niagara Component to List of NCs
+				if (NiagaraSystem == nullptr)
+				{
+					continue;
+				}
+
+				if (!TryReserveConcurrency(Effect, Band))
+				{
+					++Stats.NumRejectedByConcurrency;
+					continue;
+				}
+
+				// Spawn Niagara Systems Attached from the Niagara component pool, add Niagara Component to List of NCs
 				UNiagaraComponent* NiagaraComponent = UNiagaraFunctionLibrary::SpawnSystemAttached(NiagaraSystem, AttachToComponent, AttachPoint, LocationOffset,
-					RotationOffset, VFXScale, EAttachLocation::KeepRelativeOffset, true, ENCPoolMethod::None, true, true);
+					RotationOffset, VFXScale, EAttachLocation::KeepRelativeOffset, true, ENCPoolMethod::AutoRelease, true, true);
 
-				NiagaraOut.Add(NiagaraComponent);
+				if (NiagaraComponent)
+				{
+					++Stats.NumNiagaraSpawned;
+					AddActiveEffect(Effect, Band, NiagaraComponent, NiagaraSystem);
+					NiagaraOut.Add(NiagaraComponent);
+				}
 			}
 		}
 	}
@@ -118,11 +245,11 @@ void ULyraContextEffectsSubsystem::LoadAndAddContextEffectsLibraries(AActor* Own
 	ULyraContextEffectsSet* EffectsLibrariesSet = NewObject<ULyraContextEffectsSet>(this);
 
 	// Cycle through Libraries getting Soft Obj Refs
+	TArray<FSoftObjectPath> LibrariesToLoad;
 	for (const TSoftObjectPtr<ULyraContextEffectsLibrary>& ContextEffectSoftObj : ContextEffectsLibraries)
 	{
-		// Load Library Assets from Soft Obj refs
-		// TODO Support Async Loading of Asset Data
-		if (ULyraContextEffectsLibrary* EffectsLibrary = ContextEffectSoftObj.LoadSynchronous())
+		// Libraries already in memory are added right away, the rest are loaded asynchronously
+		if (ULyraContextEffectsLibrary* EffectsLibrary = ContextEffectSoftObj.Get())
 		{
 			// Call load on valid Libraries
 			EffectsLibrary->LoadEffects();
@@ -130,6 +257,33 @@ void ULyraContextEffectsSubsystem::LoadAndAddContextEffectsLibraries(AActor* Own
 			// Add new library to Set
 			EffectsLibrariesSet->LyraContextEffectsLibraries.Add(EffectsLibrary);
 		}
+		else if (!ContextEffectSoftObj.IsNull())
+		{
+			LibrariesToLoad.Add(ContextEffectSoftObj.ToSoftObjectPath());
+		}
+	}
+
+	if (LibrariesToLoad.Num() > 0)
+	{
+		TWeakObjectPtr<ULyraContextEffectsSet> WeakEffectsLibrariesSet = EffectsLibrariesSet;
+		UAssetManager::GetStreamableManager().RequestAsyncLoad(LibrariesToLoad, FStreamableDelegate::CreateWeakLambda(this, [WeakEffectsLibrariesSet, LibrariesToLoad]()
+			{
+				// The actor may have been removed (and its set replaced) while loading
+				ULyraContextEffectsSet* LoadedEffectsLibrariesSet = WeakEffectsLibrariesSet.Get();
+				if (LoadedEffectsLibrariesSet == nullptr)
+				{
+					return;
+				}
+
+				for (const FSoftObjectPath& LibraryPath : LibrariesToLoad)
+				{
+					if (ULyraContextEffectsLibrary* EffectsLibrary = Cast<ULyraContextEffectsLibrary>(LibraryPath.ResolveObject()))
+					{
+						EffectsLibrary->LoadEffects();
+						LoadedEffectsLibrariesSet->LyraContextEffectsLibraries.Add(EffectsLibrary);
+					}
+				}
+			}));
 	}
 
 	// Update Active Actor Effects Map
@@ -148,3 +302,229 @@ void ULyraContextEffectsSubsystem::UnloadAndRemoveContextEffectsLibraries(AActor
 	ActiveActorEffectsMap.Remove(OwningActor);
 }
 
+
+const TArray<TWeakObjectPtr<UObject>>& ULyraContextEffectsSubsystem::GetContextEffectImplementers(AActor* Actor)
+{
+	static const TArray<TWeakObjectPtr<UObject>> Empty;
+	if (Actor == nullptr)
+	{
+		return Empty;
+	}
+
+	if (const TArray<TWeakObjectPtr<UObject>>* CachedImplementers = ImplementerCache.Find(Actor))
+	{
+		return *CachedImplementers;
+	}
+
+	// Drop actors that are gone before adding a new one
+	for (auto It = ImplementerCache.CreateIterator(); It; ++It)
+	{
+		if (It.Key().ResolveObjectPtr() == nullptr)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	TArray<TWeakObjectPtr<UObject>>& Implementers = ImplementerCache.Add(Actor);
+
+	if (Actor->Implements<ULyraContextEffectsInterface>())
+	{
+		Implementers.Add(Actor);
+	}
+
+	for (UActorComponent* Component : Actor->GetComponents())
+	{
+		if (Component && Component->Implements<ULyraContextEffectsInterface>())
+		{
+			Implementers.Add(Component);
+		}
+	}
+
+	return Implementers;
+}
+
+void ULyraContextEffectsSubsystem::InvalidateContextEffectImplementers(AActor* Actor)
+{
+	ImplementerCache.Remove(Actor);
+}
+
+ULyraContextEffectsSubsystem::EDistanceBand ULyraContextEffectsSubsystem::GetDistanceBand(const FVector& Location)
+{
+	if (ViewerLocationsFrame != GFrameCounter)
+	{
+		ViewerLocationsFrame = GFrameCounter;
+		ViewerLocations.Reset();
+
+		for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+		{
+			const APlayerController* PC = Iterator->Get();
+			if (PC && PC->IsLocalController())
+			{
+				FVector ViewLocation;
+				FRotator ViewRotation;
+				PC->GetPlayerViewPoint(/*out*/ ViewLocation, /*out*/ ViewRotation);
+				ViewerLocations.Add(ViewLocation);
+			}
+		}
+	}
+
+	// Nobody is watching (e.g., a server), treat everything as near
+	if (ViewerLocations.Num() == 0)
+	{
+		return EDistanceBand::Near;
+	}
+
+	double MinDistanceSquared = TNumericLimits<double>::Max();
+	for (const FVector& ViewerLocation : ViewerLocations)
+	{
+		MinDistanceSquared = FMath::Min(MinDistanceSquared, FVector::DistSquared(ViewerLocation, Location));
+	}
+
+	if (MinDistanceSquared <= FMath::Square(LyraConsoleVariables::ContextEffectNearDistance))
+	{
+		return EDistanceBand::Near;
+	}
+	else if (MinDistanceSquared <= FMath::Square(LyraConsoleVariables::ContextEffectMidDistance))
+	{
+		return EDistanceBand::Mid;
+	}
+	return EDistanceBand::Far;
+}
+
+bool ULyraContextEffectsSubsystem::TryReserveConcurrency(const FGameplayTag& Effect, EDistanceBand Band)
+{
+	int32 MaxActive = 0;
+	switch (Band)
+	{
+	case EDistanceBand::Near: MaxActive = LyraConsoleVariables::MaxActiveContextEffectsNear; break;
+	case EDistanceBand::Mid: MaxActive = LyraConsoleVariables::MaxActiveContextEffectsMid; break;
+	default: MaxActive = LyraConsoleVariables::MaxActiveContextEffectsFar; break;
+	}
+
+	if (MaxActive <= 0)
+	{
+		return true;
+	}
+
+	TArray<FActiveEffect>* Active = ActiveEffects.Find(FConcurrencyKey{ Effect, Band });
+	if (Active == nullptr)
+	{
+		return true;
+	}
+
+	// Pooled components are reused for other effects, so an entry is only still playing if it plays the same asset
+	Active->RemoveAllSwap([](const FActiveEffect& ActiveEffect)
+	{
+		const UObject* Component = ActiveEffect.Component.Get();
+		const UObject* Asset = ActiveEffect.Asset.Get();
+		if (const UAudioComponent* AudioComponent = Cast<UAudioComponent>(Component))
+		{
+			return !AudioComponent->IsPlaying() || (AudioComponent->Sound != Asset);
+		}
+		else if (const UNiagaraComponent* NiagaraComponent = Cast<UNiagaraComponent>(Component))
+		{
+			return !NiagaraComponent->IsActive() || (NiagaraComponent->GetAsset() != Asset);
+		}
+		return true;
+	});
+
+	return Active->Num() < MaxActive;
+}
+
+void ULyraContextEffectsSubsystem::AddActiveEffect(const FGameplayTag& Effect, EDistanceBand Band, UObject* Component, const UObject* Asset)
+{
+	ActiveEffects.FindOrAdd(FConcurrencyKey{ Effect, Band }).Add(FActiveEffect{ Component, Asset });
+}
+
+UAudioComponent* ULyraContextEffectsSubsystem::PlayPooledSound(USoundBase* Sound, USceneComponent* AttachToComponent, const FName AttachPoint, const FVector& LocationOffset,
+	const FRotator& RotationOffset, float AudioVolume, float AudioPitch)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr || World->GetNetMode() == NM_DedicatedServer)
+	{
+		return nullptr;
+	}
+
+	UAudioComponent* AudioComponent = nullptr;
+	while (AudioComponent == nullptr && FreeAudioComponents.Num() > 0)
+	{
+		AudioComponent = FreeAudioComponents.Pop(/*bAllowShrinking=*/ false);
+		if (AudioComponent && !IsValid(AudioComponent))
+		{
+			AudioComponent = nullptr;
+		}
+	}
+
+	if (AudioComponent)
+	{
+		++Stats.NumAudioPoolHits;
+	}
+	else
+	{
+		++Stats.NumAudioPoolMisses;
+
+		AudioComponent = NewObject<UAudioComponent>(World);
+		AudioComponent->bAutoActivate = false;
+		AudioComponent->bAutoDestroy = false;
+		AudioComponent->bIsUISound = false;
+		AudioComponent->RegisterComponentWithWorld(World);
+		AudioComponent->OnAudioFinishedNative.AddUObject(this, &ThisClass::OnPooledAudioFinished);
+	}
+
+	AudioComponent->AttachToComponent(AttachToComponent, FAttachmentTransformRules::KeepRelativeTransform, AttachPoint);
+	AudioComponent->SetRelativeLocationAndRotation(LocationOffset, RotationOffset);
+	AudioComponent->SetSound(Sound);
+	AudioComponent->SetVolumeMultiplier(AudioVolume);
+	AudioComponent->SetPitchMultiplier(AudioPitch);
+
+	PlayingAudioComponents.Add(AudioComponent);
+	AudioComponent->Play();
+	++Stats.NumSoundsPlayed;
+
+	// Nothing was started (e.g., no audio device), the finished event will not come
+	if (!AudioComponent->IsPlaying())
+	{
+		ReleasePooledAudio(AudioComponent);
+		return nullptr;
+	}
+
+	return AudioComponent;
+}
+
+void ULyraContextEffectsSubsystem::OnPooledAudioFinished(UAudioComponent* AudioComponent)
+{
+	ReleasePooledAudio(AudioComponent);
+}
+
+void ULyraContextEffectsSubsystem::ReleasePooledAudio(UAudioComponent* AudioComponent)
+{
+	if (PlayingAudioComponents.Remove(AudioComponent) == 0)
+	{
+		return;
+	}
+
+	AudioComponent->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+	AudioComponent->SetSound(nullptr);
+
+	if (FreeAudioComponents.Num() < LyraConsoleVariables::MaxPooledContextEffectAudioComponents)
+	{
+		FreeAudioComponents.Add(AudioComponent);
+	}
+	else
+	{
+		AudioComponent->OnAudioFinishedNative.RemoveAll(this);
+		AudioComponent->DestroyComponent();
+	}
+}
+
+void ULyraContextEffectsSubsystem::LogStats() const
+{
+	const int32 NumAudioRequests = Stats.NumAudioPoolHits + Stats.NumAudioPoolMisses;
+	const float AudioPoolHitRate = (NumAudioRequests > 0) ? (100.0f * Stats.NumAudioPoolHits / NumAudioRequests) : 0.0f;
+
+	UE_LOG(LogLyra, Display, TEXT("Context effects: %d requests, %d sounds played, %d Niagara systems spawned, %d rejected by concurrency limits"),
+		Stats.NumRequests, Stats.NumSoundsPlayed, Stats.NumNiagaraSpawned, Stats.NumRejectedByConcurrency);
+	UE_LOG(LogLyra, Display, TEXT("  Audio pool: %d hits, %d misses (%.1f%% hit rate), %d playing, %d idle"),
+		Stats.NumAudioPoolHits, Stats.NumAudioPoolMisses, AudioPoolHitRate, PlayingAudioComponents.Num(), FreeAudioComponents.Num());
+	UE_LOG(LogLyra, Display, TEXT("  %d actors with cached context effect implementers"), ImplementerCache.Num());
+}
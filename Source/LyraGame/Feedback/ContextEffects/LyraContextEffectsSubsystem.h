@@ -5,6 +5,7 @@
 #include "Engine/DeveloperSettings.h"
 #include "GameplayTagContainer.h"
 #include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
 
 #include "LyraContextEffectsSubsystem.generated.h"
 
@@ -14,7 +15,9 @@ class AActor;
 class UAudioComponent;
 class ULyraContextEffectsLibrary;
 class UNiagaraComponent;
+class UNiagaraSystem;
 class USceneComponent;
+class USoundBase;
 struct FFrame;
 struct FGameplayTag;
 struct FGameplayTagContainer;
@@ -48,7 +51,11 @@ public:
 
 
 /**
- * 
+ * Looks up and plays context effects for actors.
+ *
+ * Sounds are played on pooled audio components and Niagara systems use the Niagara component pool, so the returned components are
+ * only valid until their effect finishes and must not be kept. The number of effects playing at once is capped per effect tag and
+ * distance band (see the Lyra.ContextEffects.* cvars), and Lyra.ContextEffects.Stats reports spawn counts and the pool hit rate.
  */
 UCLASS()
 class LYRAGAME_API ULyraContextEffectsSubsystem : public UWorldSubsystem
@@ -56,6 +63,10 @@ class LYRAGAME_API ULyraContextEffectsSubsystem : public UWorldSubsystem
 	GENERATED_BODY()
 	
 public:
+	//~USubsystem interface
+	virtual void Deinitialize() override;
+	//~End of USubsystem interface
+
 	/** */
 	UFUNCTION(BlueprintCallable, Category = "ContextEffects")
 	void SpawnContextEffects(
@@ -84,9 +95,82 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "ContextEffects")
 	void UnloadAndRemoveContextEffectsLibraries(AActor* OwningActor);
 
+	/** Returns the actor and its components that implement ILyraContextEffectsInterface (cached per actor) */
+	const TArray<TWeakObjectPtr<UObject>>& GetContextEffectImplementers(AActor* Actor);
+
+	/** Forgets the cached implementers of an actor, call when components implementing the interface are added or removed */
+	void InvalidateContextEffectImplementers(AActor* Actor);
+
+	void LogStats() const;
+
+private:
+	enum class EDistanceBand : uint8
+	{
+		Near,
+		Mid,
+		Far,
+		Count
+	};
+
+	EDistanceBand GetDistanceBand(const FVector& Location);
+
+	/** Returns false if too many effects for this tag are already playing in the band */
+	bool TryReserveConcurrency(const FGameplayTag& Effect, EDistanceBand Band);
+
+	void AddActiveEffect(const FGameplayTag& Effect, EDistanceBand Band, UObject* Component, const UObject* Asset);
+
+	UAudioComponent* PlayPooledSound(USoundBase* Sound, USceneComponent* AttachToComponent, const FName AttachPoint, const FVector& LocationOffset,
+		const FRotator& RotationOffset, float AudioVolume, float AudioPitch);
+
+	void OnPooledAudioFinished(UAudioComponent* AudioComponent);
+	void ReleasePooledAudio(UAudioComponent* AudioComponent);
+
 private:
 
 	UPROPERTY(Transient)
 	TMap<TObjectPtr<AActor>, TObjectPtr<ULyraContextEffectsSet>> ActiveActorEffectsMap;
 
+	TMap<TObjectKey<AActor>, TArray<TWeakObjectPtr<UObject>>> ImplementerCache;
+
+	/** Audio components that are not playing and can be reused */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UAudioComponent>> FreeAudioComponents;
+
+	/** Audio components currently playing a context effect */
+	UPROPERTY(Transient)
+	TSet<TObjectPtr<UAudioComponent>> PlayingAudioComponents;
+
+	struct FActiveEffect
+	{
+		TWeakObjectPtr<UObject> Component;
+		TWeakObjectPtr<const UObject> Asset;
+	};
+
+	struct FConcurrencyKey
+	{
+		FGameplayTag Effect;
+		EDistanceBand Band;
+
+		bool operator==(const FConcurrencyKey& Other) const { return (Effect == Other.Effect) && (Band == Other.Band); }
+		friend uint32 GetTypeHash(const FConcurrencyKey& Key) { return HashCombine(GetTypeHash(Key.Effect), (uint32)Key.Band); }
+	};
+
+	/** The components playing for each effect tag and distance band, pruned when checked */
+	TMap<FConcurrencyKey, TArray<FActiveEffect>> ActiveEffects;
+
+	/** Local viewer locations, refreshed once per frame */
+	TArray<FVector, TInlineAllocator<4>> ViewerLocations;
+	uint64 ViewerLocationsFrame = 0;
+
+	struct FStats
+	{
+		int32 NumRequests = 0;
+		int32 NumRejectedByConcurrency = 0;
+		int32 NumSoundsPlayed = 0;
+		int32 NumAudioPoolHits = 0;
+		int32 NumAudioPoolMisses = 0;
+		int32 NumNiagaraSpawned = 0;
+	};
+
+	FStats Stats;
 };
@@ -9,6 +9,7 @@
 #include "Feedback/NumberPops/LyraNumberPopComponent.h"
 #include "LyraDamagePopStyle.h"
 #include "Materials/MaterialInstanceDynamic.h"
+#include "System/LyraSignificanceManager.h"
 #include "TimerManager.h"
 #include "UObject/Package.h"
 
@@ -44,6 +45,12 @@ ULyraNumberPopComponent_MeshText::ULyraNumberPopComponent_MeshText(const FObject
 
 void ULyraNumberPopComponent_MeshText::AddNumberPop(const FLyraNumberPopRequest& NewRequest)
 {
+	// Skip pops nobody would be able to read
+	if (!ULyraSignificanceManager::ShouldShowNumberPop(GetWorld(), NewRequest.WorldLocation))
+	{
+		return;
+	}
+
 	// Drop requests for remote players on the floor
 	// (this prevents multiple pops from showing up for the host of a listen server)
 	if (APlayerController* PC = GetController<APlayerController>())
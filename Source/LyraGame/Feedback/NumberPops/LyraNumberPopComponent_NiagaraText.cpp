@@ -7,6 +7,7 @@
 #include "LyraLogChannels.h"
 #include "NiagaraComponent.h"
 #include "NiagaraDataInterfaceArrayFunctionLibrary.h"
+#include "System/LyraSignificanceManager.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraNumberPopComponent_NiagaraText)
 
@@ -19,6 +20,12 @@ ULyraNumberPopComponent_NiagaraText::ULyraNumberPopComponent_NiagaraText(const F
 
 void ULyraNumberPopComponent_NiagaraText::AddNumberPop(const FLyraNumberPopRequest& NewRequest)
 {
+	// Skip pops nobody would be able to read
+	if (!ULyraSignificanceManager::ShouldShowNumberPop(GetWorld(), NewRequest.WorldLocation))
+	{
+		return;
+	}
+
 	int32 LocalDamage = NewRequest.NumberToDisplay;
 
 	//Change Damage to negative to differentiate Critial vs Normal hit
@@ -2,6 +2,7 @@
 
 #include "LyraInventoryItemInstance.h"
 
+#include "GameFramework/Actor.h"
 #include "Inventory/LyraInventoryItemDefinition.h"
 #include "Net/UnrealNetwork.h"
 
@@ -22,8 +23,15 @@ void ULyraInventoryItemInstance::GetLifetimeReplicatedProps(TArray<FLifetimeProp
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(ThisClass, StatTags);
-	DOREPLIFETIME(ThisClass, ItemDef);
+	// Push based, so an unchanged item costs nothing to consider for replication
+	FDoRepLifetimeParams SharedParams;
+	SharedParams.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, StatTags, SharedParams);
+
+	// The definition is set before the item is first replicated and never changes
+	SharedParams.Condition = COND_InitialOnly;
+	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, ItemDef, SharedParams);
 }
 
 #if UE_WITH_IRIS
@@ -41,11 +49,24 @@ void ULyraInventoryItemInstance::RegisterReplicationFragments(UE::Net::FFragment
 void ULyraInventoryItemInstance::AddStatTagStack(FGameplayTag Tag, int32 StackCount)
 {
 	StatTags.AddStack(Tag, StackCount);
+	MarkStatTagsDirty();
 }
 
 void ULyraInventoryItemInstance::RemoveStatTagStack(FGameplayTag Tag, int32 StackCount)
 {
 	StatTags.RemoveStack(Tag, StackCount);
+	MarkStatTagsDirty();
+}
+
+void ULyraInventoryItemInstance::MarkStatTagsDirty()
+{
+	MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, StatTags, this);
+
+	// Wake up the owner if it went dormant (e.g., a storage actor), otherwise the change would not be sent
+	if (AActor* OwningActor = GetTypedOuter<AActor>())
+	{
+		OwningActor->FlushNetDormancy();
+	}
 }
 
 int32 ULyraInventoryItemInstance::GetStatTagStackCount(FGameplayTag Tag) const
@@ -61,6 +82,7 @@ bool ULyraInventoryItemInstance::HasStatTag(FGameplayTag Tag) const
 void ULyraInventoryItemInstance::SetItemDef(TSubclassOf<ULyraInventoryItemDefinition> InDef)
 {
 	ItemDef = InDef;
+	MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, ItemDef, this);
 }
 
 const ULyraInventoryItemFragment* ULyraInventoryItemInstance::FindFragmentByClass(TSubclassOf<ULyraInventoryItemFragment> FragmentClass) const
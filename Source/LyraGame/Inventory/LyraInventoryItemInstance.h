@@ -67,6 +67,8 @@ private:
 
 	void SetItemDef(TSubclassOf<ULyraInventoryItemDefinition> InDef);
 
+	void MarkStatTagsDirty();
+
 	friend struct FLyraInventoryList;
 
 private:
@@ -4,9 +4,13 @@
 
 #include "Engine/ActorChannel.h"
 #include "Engine/World.h"
+#include "GameFramework/Controller.h"
 #include "GameFramework/GameplayMessageSubsystem.h"
+#include "GameFramework/Info.h"
+#include "HAL/IConsoleManager.h"
 #include "LyraInventoryItemDefinition.h"
 #include "LyraInventoryItemInstance.h"
+#include "LyraLogChannels.h"
 #include "NativeGameplayTags.h"
 #include "Net/UnrealNetwork.h"
 
@@ -42,6 +46,8 @@ void FLyraInventoryList::PreReplicatedRemove(const TArrayView<int32> RemovedIndi
 		BroadcastChangeMessage(Stack, /*OldCount=*/ Stack.StackCount, /*NewCount=*/ 0);
 		Stack.LastObservedCount = 0;
 	}
+
+	bDefinitionIndexDirty = true;
 }
 
 void FLyraInventoryList::PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize)
@@ -52,6 +58,8 @@ void FLyraInventoryList::PostReplicatedAdd(const TArrayView<int32> AddedIndices,
 		BroadcastChangeMessage(Stack, /*OldCount=*/ 0, /*NewCount=*/ Stack.StackCount);
 		Stack.LastObservedCount = Stack.StackCount;
 	}
+
+	bDefinitionIndexDirty = true;
 }
 
 void FLyraInventoryList::PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize)
@@ -63,6 +71,9 @@ void FLyraInventoryList::PostReplicatedChange(const TArrayView<int32> ChangedInd
 		BroadcastChangeMessage(Stack, /*OldCount=*/ Stack.LastObservedCount, /*NewCount=*/ Stack.StackCount);
 		Stack.LastObservedCount = Stack.StackCount;
 	}
+
+	// The instance may have been resolved (or replaced) since it was added
+	bDefinitionIndexDirty = true;
 }
 
 void FLyraInventoryList::BroadcastChangeMessage(FLyraInventoryEntry& Entry, int32 OldCount, int32 NewCount)
@@ -78,6 +89,34 @@ void FLyraInventoryList::BroadcastChangeMessage(FLyraInventoryEntry& Entry, int3
 }
 
 ULyraInventoryItemInstance* FLyraInventoryList::AddEntry(TSubclassOf<ULyraInventoryItemDefinition> ItemDef, int32 StackCount)
+{
+	ULyraInventoryItemInstance* Result = CreateEntry(ItemDef, StackCount);
+
+	//const ULyraInventoryItemDefinition* ItemCDO = GetDefault<ULyraInventoryItemDefinition>(ItemDef);
+	MarkItemDirty(Entries.Last());
+
+	return Result;
+}
+
+void FLyraInventoryList::AddEntries(TSubclassOf<ULyraInventoryItemDefinition> ItemDef, int32 StackCount, int32 NumEntries, TArray<ULyraInventoryItemInstance*>& OutInstances)
+{
+	const int32 FirstNewIndex = Entries.Num();
+	Entries.Reserve(FirstNewIndex + NumEntries);
+	OutInstances.Reserve(OutInstances.Num() + NumEntries);
+
+	for (int32 Count = 0; Count < NumEntries; ++Count)
+	{
+		OutInstances.Add(CreateEntry(ItemDef, StackCount));
+	}
+
+	// Mark the new items once they are all in place (marking only assigns replication IDs and bumps keys)
+	for (int32 Index = FirstNewIndex; Index < Entries.Num(); ++Index)
+	{
+		MarkItemDirty(Entries[Index]);
+	}
+}
+
+ULyraInventoryItemInstance* FLyraInventoryList::CreateEntry(TSubclassOf<ULyraInventoryItemDefinition> ItemDef, int32 StackCount)
 {
 	ULyraInventoryItemInstance* Result = nullptr;
 
@@ -101,8 +140,7 @@ ULyraInventoryItemInstance* FLyraInventoryList::AddEntry(TSubclassOf<ULyraInvent
 	NewEntry.StackCount = StackCount;
 	Result = NewEntry.Instance;
 
-	//const ULyraInventoryItemDefinition* ItemCDO = GetDefault<ULyraInventoryItemDefinition>(ItemDef);
-	MarkItemDirty(NewEntry);
+	AddToDefinitionIndex(Result);
 
 	return Result;
 }
@@ -123,6 +161,95 @@ void FLyraInventoryList::RemoveEntry(ULyraInventoryItemInstance* Instance)
 			MarkArrayDirty();
 		}
 	}
+
+	if ((Instance != nullptr) && !bDefinitionIndexDirty)
+	{
+		if (TArray<TObjectPtr<ULyraInventoryItemInstance>>* DefinitionEntries = DefinitionIndex.Find(Instance->GetItemDef()))
+		{
+			DefinitionEntries->Remove(Instance);
+		}
+	}
+}
+
+void FLyraInventoryList::RemoveEntries(TConstArrayView<ULyraInventoryItemInstance*> Instances)
+{
+	if (Instances.Num() == 0)
+	{
+		return;
+	}
+
+	TSet<ULyraInventoryItemInstance*> InstancesToRemove;
+	InstancesToRemove.Reserve(Instances.Num());
+	for (ULyraInventoryItemInstance* Instance : Instances)
+	{
+		InstancesToRemove.Add(Instance);
+	}
+
+	const int32 NumRemoved = Entries.RemoveAll([&InstancesToRemove](const FLyraInventoryEntry& Entry)
+	{
+		return InstancesToRemove.Contains(Entry.Instance);
+	});
+
+	if (NumRemoved > 0)
+	{
+		MarkArrayDirty();
+	}
+
+	if (!bDefinitionIndexDirty)
+	{
+		for (auto IndexIt = DefinitionIndex.CreateIterator(); IndexIt; ++IndexIt)
+		{
+			IndexIt.Value().RemoveAll([&InstancesToRemove](const TObjectPtr<ULyraInventoryItemInstance>& Instance)
+			{
+				return InstancesToRemove.Contains(Instance);
+			});
+		}
+	}
+}
+
+TConstArrayView<TObjectPtr<ULyraInventoryItemInstance>> FLyraInventoryList::GetEntriesByDefinition(TSubclassOf<ULyraInventoryItemDefinition> ItemDef) const
+{
+	if (bDefinitionIndexDirty)
+	{
+		RebuildDefinitionIndex();
+	}
+
+	if (const TArray<TObjectPtr<ULyraInventoryItemInstance>>* DefinitionEntries = DefinitionIndex.Find(ItemDef))
+	{
+		return *DefinitionEntries;
+	}
+	return TConstArrayView<TObjectPtr<ULyraInventoryItemInstance>>();
+}
+
+void FLyraInventoryList::AddToDefinitionIndex(ULyraInventoryItemInstance* Instance)
+{
+	// Entries are only ever appended, so adding to the end keeps the index in list order
+	if (!bDefinitionIndexDirty)
+	{
+		DefinitionIndex.FindOrAdd(Instance->GetItemDef()).Add(Instance);
+	}
+}
+
+void FLyraInventoryList::RebuildDefinitionIndex() const
+{
+	DefinitionIndex.Reset();
+	bDefinitionIndexDirty = false;
+
+	for (const FLyraInventoryEntry& Entry : Entries)
+	{
+		if (IsValid(Entry.Instance))
+		{
+			if (const UClass* ItemDef = Entry.Instance->GetItemDef())
+			{
+				DefinitionIndex.FindOrAdd(ItemDef).Add(Entry.Instance);
+			}
+			else
+			{
+				// The instance has not received its definition yet (clients only), try again next time
+				bDefinitionIndexDirty = true;
+			}
+		}
+	}
 }
 
 TArray<ULyraInventoryItemInstance*> FLyraInventoryList::GetAllItems() const
@@ -147,6 +274,9 @@ ULyraInventoryManagerComponent::ULyraInventoryManagerComponent(const FObjectInit
 	, InventoryList(this)
 {
 	SetIsReplicatedByDefault(true);
+
+	// Item instances are registered with AddReplicatedSubObject, so owners using the registered list never call ReplicateSubobjects
+	bReplicateUsingRegisteredSubObjectList = true;
 }
 
 void ULyraInventoryManagerComponent::GetLifetimeReplicatedProps(TArray< FLifetimeProperty >& OutLifetimeProps) const
@@ -177,6 +307,24 @@ ULyraInventoryItemInstance* ULyraInventoryManagerComponent::AddItemDefinition(TS
 	return Result;
 }
 
+TArray<ULyraInventoryItemInstance*> ULyraInventoryManagerComponent::AddItemDefinitionStacks(TSubclassOf<ULyraInventoryItemDefinition> ItemDef, int32 StackCount, int32 NumStacks)
+{
+	TArray<ULyraInventoryItemInstance*> Results;
+	if ((ItemDef != nullptr) && (NumStacks > 0))
+	{
+		InventoryList.AddEntries(ItemDef, StackCount, NumStacks, /*out*/ Results);
+
+		if (IsUsingRegisteredSubObjectList() && IsReadyForReplication())
+		{
+			for (ULyraInventoryItemInstance* Instance : Results)
+			{
+				AddReplicatedSubObject(Instance);
+			}
+		}
+	}
+	return Results;
+}
+
 void ULyraInventoryManagerComponent::AddItemInstance(ULyraInventoryItemInstance* ItemInstance)
 {
 	InventoryList.AddEntry(ItemInstance);
@@ -203,16 +351,11 @@ TArray<ULyraInventoryItemInstance*> ULyraInventoryManagerComponent::GetAllItems(
 
 ULyraInventoryItemInstance* ULyraInventoryManagerComponent::FindFirstItemStackByDefinition(TSubclassOf<ULyraInventoryItemDefinition> ItemDef) const
 {
-	for (const FLyraInventoryEntry& Entry : InventoryList.Entries)
+	for (ULyraInventoryItemInstance* Instance : InventoryList.GetEntriesByDefinition(ItemDef))
 	{
-		ULyraInventoryItemInstance* Instance = Entry.Instance;
-
 		if (IsValid(Instance))
 		{
-			if (Instance->GetItemDef() == ItemDef)
-			{
-				return Instance;
-			}
+			return Instance;
 		}
 	}
 
@@ -221,21 +364,7 @@ ULyraInventoryItemInstance* ULyraInventoryManagerComponent::FindFirstItemStackBy
 
 int32 ULyraInventoryManagerComponent::GetTotalItemCountByDefinition(TSubclassOf<ULyraInventoryItemDefinition> ItemDef) const
 {
-	int32 TotalCount = 0;
-	for (const FLyraInventoryEntry& Entry : InventoryList.Entries)
-	{
-		ULyraInventoryItemInstance* Instance = Entry.Instance;
-
-		if (IsValid(Instance))
-		{
-			if (Instance->GetItemDef() == ItemDef)
-			{
-				++TotalCount;
-			}
-		}
-	}
-
-	return TotalCount;
+	return InventoryList.GetEntriesByDefinition(ItemDef).Num();
 }
 
 bool ULyraInventoryManagerComponent::ConsumeItemsByDefinition(TSubclassOf<ULyraInventoryItemDefinition> ItemDef, int32 NumToConsume)
@@ -246,22 +375,30 @@ bool ULyraInventoryManagerComponent::ConsumeItemsByDefinition(TSubclassOf<ULyraI
 		return false;
 	}
 
-	//@TODO: N squared right now as there's no acceleration structure
-	int32 TotalConsumed = 0;
-	while (TotalConsumed < NumToConsume)
+	TConstArrayView<TObjectPtr<ULyraInventoryItemInstance>> DefinitionEntries = InventoryList.GetEntriesByDefinition(ItemDef);
+	if (DefinitionEntries.Num() < NumToConsume)
 	{
-		if (ULyraInventoryItemInstance* Instance = ULyraInventoryManagerComponent::FindFirstItemStackByDefinition(ItemDef))
-		{
-			InventoryList.RemoveEntry(Instance);
-			++TotalConsumed;
-		}
-		else
+		return false;
+	}
+
+	TArray<ULyraInventoryItemInstance*> InstancesToRemove;
+	InstancesToRemove.Reserve(NumToConsume);
+	for (int32 Index = 0; Index < NumToConsume; ++Index)
+	{
+		InstancesToRemove.Add(DefinitionEntries[Index]);
+	}
+
+	InventoryList.RemoveEntries(InstancesToRemove);
+
+	if (IsUsingRegisteredSubObjectList())
+	{
+		for (ULyraInventoryItemInstance* Instance : InstancesToRemove)
 		{
-			return false;
+			RemoveReplicatedSubObject(Instance);
 		}
 	}
 
-	return TotalConsumed == NumToConsume;
+	return true;
 }
 
 void ULyraInventoryManagerComponent::ReadyForReplication()
@@ -287,6 +424,7 @@ bool ULyraInventoryManagerComponent::ReplicateSubobjects(UActorChannel* Channel,
 {
 	bool WroteSomething = Super::ReplicateSubobjects(Channel, Bunch, RepFlags);
 
+	// Only reached when the owning actor does not use the registered subobject list
 	for (FLyraInventoryEntry& Entry : InventoryList.Entries)
 	{
 		ULyraInventoryItemInstance* Instance = Entry.Instance;
@@ -300,6 +438,113 @@ bool ULyraInventoryManagerComponent::ReplicateSubobjects(UActorChannel* Channel,
 	return WroteSomething;
 }
 
+//////////////////////////////////////////////////////////////////////
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs GLyraInventoryBenchmarkCmd(
+	TEXT("Lyra.Inventory.BenchmarkDefinitionIndex"),
+	TEXT("Fills temporary inventories of growing size, checks the indexed counts against a scan of all items and times counting and consuming. Usage: Lyra.Inventory.BenchmarkDefinitionIndex [BaseNumItems=256] [Steps=4]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		if ((World == nullptr) || (World->GetNetMode() == NM_Client))
+		{
+			UE_LOG(LogLyra, Warning, TEXT("Lyra.Inventory.BenchmarkDefinitionIndex needs a world with authority"));
+			return;
+		}
+
+		const int32 BaseNumItems = (Args.Num() > 0) ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 256;
+		const int32 Steps = (Args.Num() > 1) ? FMath::Clamp(FCString::Atoi(*Args[1]), 1, 8) : 4;
+
+		// Any definition will do, instances only keep the class
+		const TSubclassOf<ULyraInventoryItemDefinition> ItemDef = ULyraInventoryItemDefinition::StaticClass();
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		AInfo* TempActor = World->SpawnActor<AInfo>(SpawnParams);
+		if (TempActor == nullptr)
+		{
+			return;
+		}
+
+		for (int32 Step = 0; Step < Steps; ++Step)
+		{
+			const int32 NumItems = BaseNumItems << Step;
+
+			ULyraInventoryManagerComponent* Inventory = NewObject<ULyraInventoryManagerComponent>(TempActor);
+			Inventory->RegisterComponent();
+
+			const double AddStart = FPlatformTime::Seconds();
+			Inventory->AddItemDefinitionStacks(ItemDef, /*StackCount=*/ 1, NumItems);
+			const double AddTime = FPlatformTime::Seconds() - AddStart;
+
+			int32 ScannedCount = 0;
+			for (ULyraInventoryItemInstance* Instance : Inventory->GetAllItems())
+			{
+				ScannedCount += (Instance->GetItemDef() == ItemDef) ? 1 : 0;
+			}
+
+			const double CountStart = FPlatformTime::Seconds();
+			const int32 IndexedCount = Inventory->GetTotalItemCountByDefinition(ItemDef);
+			const double CountTime = FPlatformTime::Seconds() - CountStart;
+
+			const double ConsumeStart = FPlatformTime::Seconds();
+			const bool bConsumed = Inventory->ConsumeItemsByDefinition(ItemDef, NumItems / 2);
+			const double ConsumeTime = FPlatformTime::Seconds() - ConsumeStart;
+
+			const int32 RemainingCount = Inventory->GetTotalItemCountByDefinition(ItemDef);
+			const bool bMatches = (IndexedCount == ScannedCount) && bConsumed && (RemainingCount == Inventory->GetAllItems().Num()) && (RemainingCount == NumItems - (NumItems / 2));
+
+			UE_LOG(LogLyra, Display, TEXT("%6d items: add %.3f ms, count %.4f ms, consume half %.3f ms, counts %s"),
+				NumItems, AddTime * 1000.0, CountTime * 1000.0, ConsumeTime * 1000.0, bMatches ? TEXT("match") : TEXT("DO NOT MATCH"));
+
+			Inventory->DestroyComponent();
+		}
+
+		TempActor->Destroy();
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs GLyraInventoryFillForReplicationBenchmarkCmd(
+	TEXT("Lyra.Inventory.FillForReplicationBenchmark"),
+	TEXT("Tops up the inventory of every controller to the given number of items, for measuring replication cost (e.g., add 49 bots with AddPlayerBot on a dedicated server, then use stat net or Insights). Usage: Lyra.Inventory.FillForReplicationBenchmark [ItemsPerController=30]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		if ((World == nullptr) || (World->GetNetMode() == NM_Client))
+		{
+			UE_LOG(LogLyra, Warning, TEXT("Lyra.Inventory.FillForReplicationBenchmark needs a world with authority"));
+			return;
+		}
+
+		const int32 ItemsPerController = (Args.Num() > 0) ? FMath::Max(FCString::Atoi(*Args[0]), 0) : 30;
+		const TSubclassOf<ULyraInventoryItemDefinition> ItemDef = ULyraInventoryItemDefinition::StaticClass();
+
+		int32 NumInventories = 0;
+		int32 NumItems = 0;
+		int32 NumUsingSubObjectList = 0;
+		for (FConstControllerIterator Iterator = World->GetControllerIterator(); Iterator; ++Iterator)
+		{
+			AController* Controller = Iterator->Get();
+			ULyraInventoryManagerComponent* Inventory = Controller ? Controller->FindComponentByClass<ULyraInventoryManagerComponent>() : nullptr;
+			if (Inventory == nullptr)
+			{
+				continue;
+			}
+
+			const int32 NumToAdd = ItemsPerController - Inventory->GetAllItems().Num();
+			if (NumToAdd > 0)
+			{
+				Inventory->AddItemDefinitionStacks(ItemDef, /*StackCount=*/ 1, NumToAdd);
+			}
+
+			++NumInventories;
+			NumItems += Inventory->GetAllItems().Num();
+			NumUsingSubObjectList += Controller->IsUsingRegisteredSubObjectList() ? 1 : 0;
+		}
+
+		UE_LOG(LogLyra, Display, TEXT("%d inventories now hold %d items, %d of their owners replicate from the registered subobject list"),
+			NumInventories, NumItems, NumUsingSubObjectList);
+	}));
+#endif // !UE_BUILD_SHIPPING
+
 //////////////////////////////////////////////////////////////////////
 //
 
@@ -94,11 +94,25 @@ public:
 	ULyraInventoryItemInstance* AddEntry(TSubclassOf<ULyraInventoryItemDefinition> ItemClass, int32 StackCount);
 	void AddEntry(ULyraInventoryItemInstance* Instance);
 
+	// Adds NumEntries stacks of the same item definition
+	void AddEntries(TSubclassOf<ULyraInventoryItemDefinition> ItemClass, int32 StackCount, int32 NumEntries, TArray<ULyraInventoryItemInstance*>& OutInstances);
+
 	void RemoveEntry(ULyraInventoryItemInstance* Instance);
 
+	// Removes several entries in a single pass over the list
+	void RemoveEntries(TConstArrayView<ULyraInventoryItemInstance*> Instances);
+
+	// Returns the instances of an item definition, in list order
+	TConstArrayView<TObjectPtr<ULyraInventoryItemInstance>> GetEntriesByDefinition(TSubclassOf<ULyraInventoryItemDefinition> ItemClass) const;
+
 private:
 	void BroadcastChangeMessage(FLyraInventoryEntry& Entry, int32 OldCount, int32 NewCount);
 
+	ULyraInventoryItemInstance* CreateEntry(TSubclassOf<ULyraInventoryItemDefinition> ItemClass, int32 StackCount);
+
+	void AddToDefinitionIndex(ULyraInventoryItemInstance* Instance);
+	void RebuildDefinitionIndex() const;
+
 private:
 	friend ULyraInventoryManagerComponent;
 
@@ -109,6 +123,12 @@ private:
 
 	UPROPERTY(NotReplicated)
 	TObjectPtr<UActorComponent> OwnerComponent;
+
+	// The instances of each item definition, in list order (the instances are kept alive by Entries)
+	mutable TMap<const UClass*, TArray<TObjectPtr<ULyraInventoryItemInstance>>> DefinitionIndex;
+
+	// Set by replication callbacks, the index is rebuilt on the next query
+	mutable bool bDefinitionIndexDirty = false;
 };
 
 template<>
@@ -143,6 +163,10 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category=Inventory)
 	ULyraInventoryItemInstance* AddItemDefinition(TSubclassOf<ULyraInventoryItemDefinition> ItemDef, int32 StackCount = 1);
 
+	// Adds NumStacks separate stacks of an item definition, reserving space for them up front (each new entry is still marked dirty)
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category=Inventory)
+	TArray<ULyraInventoryItemInstance*> AddItemDefinitionStacks(TSubclassOf<ULyraInventoryItemDefinition> ItemDef, int32 StackCount = 1, int32 NumStacks = 1);
+
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category=Inventory)
 	void AddItemInstance(ULyraInventoryItemInstance* ItemInstance);
 
@@ -155,7 +179,10 @@ public:
 	UFUNCTION(BlueprintCallable, Category=Inventory, BlueprintPure)
 	ULyraInventoryItemInstance* FindFirstItemStackByDefinition(TSubclassOf<ULyraInventoryItemDefinition> ItemDef) const;
 
+	// Returns the number of entries of an item definition (constant time, the list keeps an index per definition)
 	int32 GetTotalItemCountByDefinition(TSubclassOf<ULyraInventoryItemDefinition> ItemDef) const;
+
+	// Removes the first NumToConsume entries of an item definition, returns false (and removes nothing) if there are not enough
 	bool ConsumeItemsByDefinition(TSubclassOf<ULyraInventoryItemDefinition> ItemDef, int32 NumToConsume);
 
 	//~UObject interface
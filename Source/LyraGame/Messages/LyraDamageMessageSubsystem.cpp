@@ -0,0 +1,226 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "LyraDamageMessageSubsystem.h"
+
+#include "Character/LyraHealthComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/GameplayMessageSubsystem.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+#include "LyraLogChannels.h"
+#include "NativeGameplayTags.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LyraDamageMessageSubsystem)
+
+// Only used by Lyra.Damage.SimulateCombat, so the simulated damage does not reach the gameplay listeners
+UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_Lyra_Damage_Message_Simulated, "Lyra.Damage.Message.Simulated");
+
+namespace LyraConsoleVariables
+{
+	static bool bBatchDamageMessages = true;
+	static FAutoConsoleVariableRef CVarBatchDamageMessages(
+		TEXT("Lyra.Damage.BatchMessages"),
+		bBatchDamageMessages,
+		TEXT("If true, damage messages are combined per instigator and target, and consecutive health changes from the same instigator are merged, then broadcast once per frame instead of once per damage instance."),
+		ECVF_Default);
+}
+
+void ULyraDamageMessageSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if ((PendingMessages.Num() > 0) || (PendingHealthChanges.Num() > 0))
+	{
+		Flush();
+	}
+}
+
+TStatId ULyraDamageMessageSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULyraDamageMessageSubsystem, STATGROUP_Tickables);
+}
+
+bool ULyraDamageMessageSubsystem::IsBatchingEnabled()
+{
+	return LyraConsoleVariables::bBatchDamageMessages;
+}
+
+void ULyraDamageMessageSubsystem::AddDamageMessage(const FLyraVerbMessage& Message)
+{
+	if (!IsBatchingEnabled())
+	{
+		UGameplayMessageSubsystem::Get(GetWorld()).BroadcastMessage(Message.Verb, Message);
+		return;
+	}
+
+	// Only a handful of pairs take damage in any one frame, a linear search beats hashing them
+	FLyraVerbMessage* PendingMessage = PendingMessages.FindByPredicate([&Message](const FLyraVerbMessage& Other)
+		{
+			return (Other.Target == Message.Target) && (Other.Instigator == Message.Instigator) && (Other.Verb == Message.Verb);
+		});
+
+	if (PendingMessage)
+	{
+		// The tags of the first hit are kept, except for the context which is merged
+		PendingMessage->ContextTags.AppendTags(Message.ContextTags);
+		PendingMessage->Magnitude += Message.Magnitude;
+	}
+	else
+	{
+		PendingMessages.Add(Message);
+	}
+}
+
+void ULyraDamageMessageSubsystem::AddPendingHealthChange(ULyraHealthComponent* HealthComponent)
+{
+	PendingHealthChanges.AddUnique(HealthComponent);
+}
+
+void ULyraDamageMessageSubsystem::Flush()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(ULyraDamageMessageSubsystem::Flush);
+
+	// Listeners can cause more damage, which is queued for the next flush
+	TArray<FLyraVerbMessage> MessagesToBroadcast = MoveTemp(PendingMessages);
+	PendingMessages.Reset();
+
+	TArray<TWeakObjectPtr<ULyraHealthComponent>> HealthChangesToBroadcast = MoveTemp(PendingHealthChanges);
+	PendingHealthChanges.Reset();
+
+	if (MessagesToBroadcast.Num() > 0)
+	{
+		UGameplayMessageSubsystem& MessageSystem = UGameplayMessageSubsystem::Get(GetWorld());
+		for (const FLyraVerbMessage& Message : MessagesToBroadcast)
+		{
+			MessageSystem.BroadcastMessage(Message.Verb, Message);
+		}
+	}
+
+	for (const TWeakObjectPtr<ULyraHealthComponent>& HealthComponent : HealthChangesToBroadcast)
+	{
+		if (ULyraHealthComponent* StrongHealthComponent = HealthComponent.Get())
+		{
+			StrongHealthComponent->FlushPendingHealthChanges();
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs GLyraDamageSimulateCombatCmd(
+	TEXT("Lyra.Damage.SimulateCombat"),
+	TEXT("Plays a scripted fight between the pawns in the world (each one fires a shotgun at the next and an explosion hits them all every frame) with and without Lyra.Damage.BatchMessages, and reports the number of damage messages received by a listener and the game thread time spent. Usage: Lyra.Damage.SimulateCombat [Frames=600] [PelletsPerShot=12]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		ULyraDamageMessageSubsystem* DamageMessages = World ? World->GetSubsystem<ULyraDamageMessageSubsystem>() : nullptr;
+		if (DamageMessages == nullptr)
+		{
+			UE_LOG(LogLyra, Error, TEXT("Lyra.Damage.SimulateCombat: No damage message subsystem in this world."));
+			return;
+		}
+
+		TArray<APawn*> Combatants;
+		for (TActorIterator<APawn> PawnIt(World); PawnIt; ++PawnIt)
+		{
+			Combatants.Add(*PawnIt);
+		}
+
+		if (Combatants.Num() < 2)
+		{
+			UE_LOG(LogLyra, Error, TEXT("Lyra.Damage.SimulateCombat: Needs at least two pawns in the world (try adding bots)."));
+			return;
+		}
+
+		const int32 NumFrames = (Args.Num() > 0) ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 600;
+		const int32 NumPellets = (Args.Num() > 1) ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 12;
+
+		// Send anything real that is already queued before measuring
+		DamageMessages->Flush();
+
+		// The listener does the same bookkeeping as the assist processor
+		int32 NumMessagesReceived = 0;
+		double TotalDamageReceived = 0.0;
+		TMap<TPair<UObject*, UObject*>, double> DamageByPair;
+
+		UGameplayMessageSubsystem& MessageSystem = UGameplayMessageSubsystem::Get(World);
+		FGameplayMessageListenerHandle ListenerHandle = MessageSystem.RegisterListener<FLyraVerbMessage>(TAG_Lyra_Damage_Message_Simulated,
+			[&](FGameplayTag Channel, const FLyraVerbMessage& Payload)
+			{
+				++NumMessagesReceived;
+				TotalDamageReceived += Payload.Magnitude;
+				DamageByPair.FindOrAdd(TPair<UObject*, UObject*>(Payload.Instigator, Payload.Target)) += Payload.Magnitude;
+			});
+
+		const bool bPreviousBatchDamageMessages = LyraConsoleVariables::bBatchDamageMessages;
+
+		auto RunScenario = [&](bool bBatch)
+		{
+			LyraConsoleVariables::bBatchDamageMessages = bBatch;
+			NumMessagesReceived = 0;
+			TotalDamageReceived = 0.0;
+			DamageByPair.Reset();
+
+			FLyraVerbMessage Message;
+			Message.Verb = TAG_Lyra_Damage_Message_Simulated;
+
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+			{
+				for (int32 ShooterIndex = 0; ShooterIndex < Combatants.Num(); ++ShooterIndex)
+				{
+					Message.Instigator = Combatants[ShooterIndex];
+					Message.Target = Combatants[(ShooterIndex + 1) % Combatants.Num()];
+					for (int32 PelletIndex = 0; PelletIndex < NumPellets; ++PelletIndex)
+					{
+						Message.Magnitude = 5.0;
+						DamageMessages->AddDamageMessage(Message);
+					}
+				}
+
+				Message.Instigator = Combatants[Frame % Combatants.Num()];
+				for (APawn* Victim : Combatants)
+				{
+					Message.Target = Victim;
+					Message.Magnitude = 20.0;
+					DamageMessages->AddDamageMessage(Message);
+				}
+
+				DamageMessages->Flush();
+			}
+
+			return FPlatformTime::Seconds() - StartTime;
+		};
+
+		const double ImmediateSeconds = RunScenario(false);
+		const int32 NumImmediateMessages = NumMessagesReceived;
+		const double ImmediateDamage = TotalDamageReceived;
+		const TMap<TPair<UObject*, UObject*>, double> ImmediateDamageByPair = DamageByPair;
+
+		const double BatchedSeconds = RunScenario(true);
+		const int32 NumBatchedMessages = NumMessagesReceived;
+
+		int32 NumMismatchedPairs = 0;
+		for (const auto& KVP : ImmediateDamageByPair)
+		{
+			const double* BatchedDamage = DamageByPair.Find(KVP.Key);
+			if ((BatchedDamage == nullptr) || !FMath::IsNearlyEqual(*BatchedDamage, KVP.Value, 0.01))
+			{
+				++NumMismatchedPairs;
+			}
+		}
+
+		LyraConsoleVariables::bBatchDamageMessages = bPreviousBatchDamageMessages;
+		MessageSystem.UnregisterListener(ListenerHandle);
+
+		UE_LOG(LogLyra, Log, TEXT("Lyra.Damage.SimulateCombat: %d pawns, %d frames, %d pellets per shot, %.0f total damage"),
+			Combatants.Num(), NumFrames, NumPellets, ImmediateDamage);
+		UE_LOG(LogLyra, Log, TEXT("  Immediate: %d messages (%.1f per frame), %.3f ms (%.2f us per frame)"),
+			NumImmediateMessages, (double)NumImmediateMessages / NumFrames, ImmediateSeconds * 1000.0, ImmediateSeconds * 1000000.0 / NumFrames);
+		UE_LOG(LogLyra, Log, TEXT("  Batched:   %d messages (%.1f per frame), %.3f ms (%.2f us per frame)"),
+			NumBatchedMessages, (double)NumBatchedMessages / NumFrames, BatchedSeconds * 1000.0, BatchedSeconds * 1000000.0 / NumFrames);
+		UE_LOG(LogLyra, Log, TEXT("  %d of %d instigator/target pairs received different damage totals"),
+			NumMismatchedPairs, ImmediateDamageByPair.Num());
+	}));
+#endif // !UE_BUILD_SHIPPING
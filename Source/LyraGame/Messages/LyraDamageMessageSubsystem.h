@@ -0,0 +1,51 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Messages/LyraVerbMessage.h"
+#include "Subsystems/WorldSubsystem.h"
+
+#include "LyraDamageMessageSubsystem.generated.h"
+
+class ULyraHealthComponent;
+class UObject;
+
+/**
+ * ULyraDamageMessageSubsystem
+ *
+ *	Combines the damage messages sent during a frame into one message per verb, instigator and target (summing their magnitudes),
+ *	and broadcasts them once at the end of the frame. Health components queue their OnHealthChanged broadcasts here the same way.
+ *	A shotgun blast or an explosion then produces one damage message, number pop and health bar update per victim instead of one per pellet.
+ *	Everything queued is flushed early before an elimination is broadcast, so listeners always see the damage before the kill.
+ *	Disabled with Lyra.Damage.BatchMessages, in which case everything is broadcast right away.
+ */
+UCLASS()
+class LYRAGAME_API ULyraDamageMessageSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End of FTickableGameObject interface
+
+	static bool IsBatchingEnabled();
+
+	// Queues a damage message, or broadcasts it right away when batching is disabled
+	void AddDamageMessage(const FLyraVerbMessage& Message);
+
+	// Queues a health component with a health change to broadcast
+	void AddPendingHealthChange(ULyraHealthComponent* HealthComponent);
+
+	// Broadcasts everything queued so far
+	void Flush();
+
+	int32 GetNumPendingMessages() const { return PendingMessages.Num(); }
+
+private:
+	UPROPERTY(Transient)
+	TArray<FLyraVerbMessage> PendingMessages;
+
+	TArray<TWeakObjectPtr<ULyraHealthComponent>> PendingHealthChanges;
+};
@@ -8,17 +8,206 @@
 #include "Engine/World.h"
 #include "GameFramework/PlayerState.h"
 #include "GameModes/LyraGameState.h"
+#include "HAL/FileManager.h"
+#include "LyraLogChannels.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
 #include "Performance/LyraPerformanceStatTypes.h"
+#include "UObject/UObjectGlobals.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraPerformanceStatSubsystem)
 
 class FSubsystemCollectionBase;
 
+namespace LyraPerformanceStatVars
+{
+	static int32 HistogramWindowFrames = 3600;
+	static FAutoConsoleVariableRef CVarHistogramWindowFrames(
+		TEXT("Lyra.Perf.HistogramWindowFrames"),
+		HistogramWindowFrames,
+		TEXT("The number of frames covered by the rolling performance stat histograms"),
+		ECVF_Default);
+
+	static float HitchThresholdMS = 60.0f;
+	static FAutoConsoleVariableRef CVarHitchThresholdMS(
+		TEXT("Lyra.Perf.HitchThresholdMS"),
+		HitchThresholdMS,
+		TEXT("Frames that take longer than this (in ms) are counted as hitches"),
+		ECVF_Default);
+
+	static bool bExportOnMapChange = false;
+	static FAutoConsoleVariableRef CVarExportOnMapChange(
+		TEXT("Lyra.Perf.ExportOnMapChange"),
+		bExportOnMapChange,
+		TEXT("Should the performance stat histograms be exported (and the session reset) whenever a new map is loaded, e.g., at the end of a match?"),
+		ECVF_Default);
+
+	static bool bExportAsJson = true;
+	static FAutoConsoleVariableRef CVarExportAsJson(
+		TEXT("Lyra.Perf.ExportAsJson"),
+		bExportAsJson,
+		TEXT("Should automatic performance stat exports be written as JSON (true) or CSV (false)?"),
+		ECVF_Default);
+}
+
+//////////////////////////////////////////////////////////////////////
+// FLyraPerformanceStatHistogram
+
+FLyraPerformanceStatHistogram::FLyraPerformanceStatHistogram()
+	: WindowSampleCount(0)
+	, SessionSampleCount(0)
+	, WindowSum(0.0)
+	, SessionSum(0.0)
+{
+	for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+	{
+		WindowCounts[Bucket].store(0, std::memory_order_relaxed);
+		SessionCounts[Bucket].store(0, std::memory_order_relaxed);
+	}
+}
+
+int32 FLyraPerformanceStatHistogram::GetBucketForValue(double Value)
+{
+	if (!(Value > MinValue))
+	{
+		return 0;
+	}
+
+	const int32 Bucket = 1 + FMath::FloorToInt32(FMath::Log2(Value / MinValue) * SubBucketsPerOctave);
+	return FMath::Clamp(Bucket, 1, NumBuckets - 1);
+}
+
+double FLyraPerformanceStatHistogram::GetValueForBucket(int32 Bucket)
+{
+	if (Bucket <= 0)
+	{
+		return 0.0;
+	}
+
+	// Use the upper edge of the bucket so percentiles err on the pessimistic side
+	return MinValue * FMath::Pow(2.0, (double)Bucket / SubBucketsPerOctave);
+}
+
+void FLyraPerformanceStatHistogram::SetWindowSize(int32 InWindowSize)
+{
+	InWindowSize = FMath::Max(InWindowSize, 1);
+	if (WindowCapacity != InWindowSize)
+	{
+		WindowCapacity = InWindowSize;
+		WindowSamples.Reset();
+		WindowSamples.Reserve(InWindowSize);
+		NextWindowSample = 0;
+
+		for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+		{
+			WindowCounts[Bucket].store(0, std::memory_order_relaxed);
+		}
+		WindowSampleCount.store(0, std::memory_order_relaxed);
+		WindowSum.store(0.0, std::memory_order_relaxed);
+	}
+}
+
+void FLyraPerformanceStatHistogram::AddSample(double InValue)
+{
+	// Samples are stored at float precision in the window, so bucket them at the same precision to make eviction exact
+	const float Value = (float)InValue;
+
+	const int32 Capacity = WindowCapacity;
+	if (Capacity == 0)
+	{
+		return;
+	}
+
+	if (WindowSamples.Num() < Capacity)
+	{
+		WindowSamples.Add(Value);
+		WindowSampleCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		const float Expired = WindowSamples[NextWindowSample];
+		WindowCounts[GetBucketForValue(Expired)].fetch_sub(1, std::memory_order_relaxed);
+		WindowSum.store(WindowSum.load(std::memory_order_relaxed) - Expired, std::memory_order_relaxed);
+
+		WindowSamples[NextWindowSample] = Value;
+		NextWindowSample = (NextWindowSample + 1) % Capacity;
+	}
+
+	const int32 Bucket = GetBucketForValue(Value);
+	WindowCounts[Bucket].fetch_add(1, std::memory_order_relaxed);
+	WindowSum.store(WindowSum.load(std::memory_order_relaxed) + Value, std::memory_order_relaxed);
+
+	SessionCounts[Bucket].fetch_add(1, std::memory_order_relaxed);
+	SessionSampleCount.fetch_add(1, std::memory_order_relaxed);
+	SessionSum.store(SessionSum.load(std::memory_order_relaxed) + Value, std::memory_order_relaxed);
+}
+
+void FLyraPerformanceStatHistogram::ResetSession()
+{
+	for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+	{
+		SessionCounts[Bucket].store(0, std::memory_order_relaxed);
+	}
+	SessionSampleCount.store(0, std::memory_order_relaxed);
+	SessionSum.store(0.0, std::memory_order_relaxed);
+}
+
+double FLyraPerformanceStatHistogram::GetPercentile(double Fraction, bool bSession) const
+{
+	const std::atomic<uint32>* Counts = bSession ? SessionCounts : WindowCounts;
+
+	const uint32 Total = GetSampleCount(bSession);
+	if (Total == 0)
+	{
+		return 0.0;
+	}
+
+	const uint64 Target = FMath::Max<uint64>(1, (uint64)FMath::CeilToDouble(FMath::Clamp(Fraction, 0.0, 1.0) * Total));
+	uint64 Cumulative = 0;
+	for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+	{
+		Cumulative += Counts[Bucket].load(std::memory_order_relaxed);
+		if (Cumulative >= Target)
+		{
+			return GetValueForBucket(Bucket);
+		}
+	}
+
+	return GetMax(bSession);
+}
+
+double FLyraPerformanceStatHistogram::GetMax(bool bSession) const
+{
+	const std::atomic<uint32>* Counts = bSession ? SessionCounts : WindowCounts;
+	for (int32 Bucket = NumBuckets - 1; Bucket >= 0; --Bucket)
+	{
+		if (Counts[Bucket].load(std::memory_order_relaxed) > 0)
+		{
+			return GetValueForBucket(Bucket);
+		}
+	}
+	return 0.0;
+}
+
+double FLyraPerformanceStatHistogram::GetMean(bool bSession) const
+{
+	const uint32 Total = GetSampleCount(bSession);
+	const double Sum = bSession ? SessionSum.load(std::memory_order_relaxed) : WindowSum.load(std::memory_order_relaxed);
+	return (Total > 0) ? (Sum / Total) : 0.0;
+}
+
+uint32 FLyraPerformanceStatHistogram::GetSampleCount(bool bSession) const
+{
+	return bSession ? SessionSampleCount.load(std::memory_order_relaxed) : WindowSampleCount.load(std::memory_order_relaxed);
+}
+
 //////////////////////////////////////////////////////////////////////
 // FLyraPerformanceStatCache
 
 void FLyraPerformanceStatCache::StartCharting()
 {
+	ResetSession();
 }
 
 void FLyraPerformanceStatCache::ProcessFrame(const FFrameData& FrameData)
@@ -62,10 +251,153 @@ void FLyraPerformanceStatCache::ProcessFrame(const FFrameData& FrameData)
 			}
 		}
 	}
+
+	UpdateHistograms();
 }
 
 void FLyraPerformanceStatCache::StopCharting()
 {
+	ExportHistograms(TEXT("Chart"), LyraPerformanceStatVars::bExportAsJson);
+}
+
+void FLyraPerformanceStatCache::UpdateHistograms()
+{
+	const int32 WindowSize = FMath::Max(LyraPerformanceStatVars::HistogramWindowFrames, 1);
+	if (WindowSize != CachedWindowSize)
+	{
+		CachedWindowSize = WindowSize;
+		for (FLyraPerformanceStatHistogram& Histogram : Histograms)
+		{
+			Histogram.SetWindowSize(WindowSize);
+		}
+
+		WindowFrameTimes.Reset();
+		WindowFrameTimes.Reserve(WindowSize);
+		NextWindowFrame = 0;
+		WindowHitchCount.store(0, std::memory_order_relaxed);
+	}
+
+	for (ELyraDisplayablePerformanceStat Stat : TEnumRange<ELyraDisplayablePerformanceStat>())
+	{
+		Histograms[(int32)Stat].AddSample(GetCachedStat(Stat));
+	}
+
+	// Hitch tracking, using the same rolling window as the histograms
+	const float HitchThresholdSeconds = LyraPerformanceStatVars::HitchThresholdMS * 0.001f;
+	const float FrameTime = (float)CachedData.TrueDeltaSeconds;
+	const bool bIsHitch = (FrameTime > HitchThresholdSeconds);
+
+	if (WindowFrameTimes.Num() < WindowSize)
+	{
+		WindowFrameTimes.Add(FrameTime);
+	}
+	else
+	{
+		if (WindowFrameTimes[NextWindowFrame] > HitchThresholdSeconds)
+		{
+			WindowHitchCount.fetch_sub(1, std::memory_order_relaxed);
+		}
+		WindowFrameTimes[NextWindowFrame] = FrameTime;
+		NextWindowFrame = (NextWindowFrame + 1) % WindowSize;
+	}
+
+	if (bIsHitch)
+	{
+		WindowHitchCount.fetch_add(1, std::memory_order_relaxed);
+		SessionHitchCount.fetch_add(1, std::memory_order_relaxed);
+		SessionLongestHitch.store(FMath::Max(SessionLongestHitch.load(std::memory_order_relaxed), FrameTime), std::memory_order_relaxed);
+	}
+}
+
+void FLyraPerformanceStatCache::ResetSession()
+{
+	for (FLyraPerformanceStatHistogram& Histogram : Histograms)
+	{
+		Histogram.ResetSession();
+	}
+	SessionHitchCount.store(0, std::memory_order_relaxed);
+	SessionLongestHitch.store(0.0f, std::memory_order_relaxed);
+}
+
+FString FLyraPerformanceStatCache::ExportHistograms(const FString& Label, bool bAsJson) const
+{
+	static const double Percentiles[] = { 0.5, 0.9, 0.95, 0.99 };
+
+	const UEnum* StatEnum = StaticEnum<ELyraDisplayablePerformanceStat>();
+	const FString Timestamp = FDateTime::Now().ToString(TEXT("%Y%m%d-%H%M%S"));
+
+	FString Output;
+	if (bAsJson)
+	{
+		Output += TEXT("{\n");
+		Output += FString::Printf(TEXT("\t\"label\": \"%s\",\n"), *Label.ReplaceCharWithEscapedChar());
+		Output += FString::Printf(TEXT("\t\"timestamp\": \"%s\",\n"), *Timestamp);
+		Output += FString::Printf(TEXT("\t\"hitchThresholdMs\": %.3f,\n"), LyraPerformanceStatVars::HitchThresholdMS);
+		Output += FString::Printf(TEXT("\t\"hitches\": { \"window\": %u, \"session\": %u, \"longestMs\": %.3f },\n"),
+			GetHitchCount(/*bSession=*/ false), GetHitchCount(/*bSession=*/ true), SessionLongestHitch.load(std::memory_order_relaxed) * 1000.0f);
+		Output += TEXT("\t\"stats\": {\n");
+	}
+	else
+	{
+		Output += TEXT("Stat,Scope,Samples,Mean,P50,P90,P95,P99,Max\n");
+	}
+
+	bool bFirstStat = true;
+	for (ELyraDisplayablePerformanceStat Stat : TEnumRange<ELyraDisplayablePerformanceStat>())
+	{
+		const FLyraPerformanceStatHistogram& Histogram = Histograms[(int32)Stat];
+		const FString StatName = StatEnum->GetNameStringByValue((int64)Stat);
+
+		if (bAsJson)
+		{
+			Output += FString::Printf(TEXT("%s\t\t\"%s\": {"), bFirstStat ? TEXT("") : TEXT(",\n"), *StatName);
+		}
+
+		for (const bool bSession : { false, true })
+		{
+			const TCHAR* Scope = bSession ? TEXT("session") : TEXT("window");
+			if (bAsJson)
+			{
+				Output += FString::Printf(TEXT("%s \"%s\": { \"samples\": %u, \"mean\": %f, \"p50\": %f, \"p90\": %f, \"p95\": %f, \"p99\": %f, \"max\": %f }"),
+					bSession ? TEXT(",") : TEXT(""), Scope, Histogram.GetSampleCount(bSession), Histogram.GetMean(bSession),
+					Histogram.GetPercentile(Percentiles[0], bSession), Histogram.GetPercentile(Percentiles[1], bSession),
+					Histogram.GetPercentile(Percentiles[2], bSession), Histogram.GetPercentile(Percentiles[3], bSession),
+					Histogram.GetMax(bSession));
+			}
+			else
+			{
+				Output += FString::Printf(TEXT("%s,%s,%u,%f,%f,%f,%f,%f,%f\n"),
+					*StatName, Scope, Histogram.GetSampleCount(bSession), Histogram.GetMean(bSession),
+					Histogram.GetPercentile(Percentiles[0], bSession), Histogram.GetPercentile(Percentiles[1], bSession),
+					Histogram.GetPercentile(Percentiles[2], bSession), Histogram.GetPercentile(Percentiles[3], bSession),
+					Histogram.GetMax(bSession));
+			}
+		}
+
+		if (bAsJson)
+		{
+			Output += TEXT(" }");
+		}
+		bFirstStat = false;
+	}
+
+	if (bAsJson)
+	{
+		Output += TEXT("\n\t}\n}\n");
+	}
+
+	const FString OutputDir = FPaths::ProfilingDir() / TEXT("PerformanceStats");
+	IFileManager::Get().MakeDirectory(*OutputDir, /*Tree=*/ true);
+
+	const FString Filename = OutputDir / FPaths::MakeValidFileName(FString::Printf(TEXT("%s_%s.%s"), *Label, *Timestamp, bAsJson ? TEXT("json") : TEXT("csv")));
+	if (!FFileHelper::SaveStringToFile(Output, *Filename))
+	{
+		UE_LOG(LogLyra, Warning, TEXT("Failed to write performance stat histograms to %s"), *Filename);
+		return FString();
+	}
+
+	UE_LOG(LogLyra, Log, TEXT("Wrote performance stat histograms to %s"), *Filename);
+	return Filename;
 }
 
 double FLyraPerformanceStatCache::GetCachedStat(ELyraDisplayablePerformanceStat Stat) const
@@ -115,10 +447,14 @@ void ULyraPerformanceStatSubsystem::Initialize(FSubsystemCollectionBase& Collect
 {
 	Tracker = MakeShared<FLyraPerformanceStatCache>(this);
 	GEngine->AddPerformanceDataConsumer(Tracker);
+
+	FCoreUObjectDelegates::PreLoadMap.AddUObject(this, &ThisClass::HandlePreLoadMap);
 }
 
 void ULyraPerformanceStatSubsystem::Deinitialize()
 {
+	FCoreUObjectDelegates::PreLoadMap.RemoveAll(this);
+
 	GEngine->RemovePerformanceDataConsumer(Tracker);
 	Tracker.Reset();
 }
@@ -128,3 +464,40 @@ double ULyraPerformanceStatSubsystem::GetCachedStat(ELyraDisplayablePerformanceS
 	return Tracker->GetCachedStat(Stat);
 }
 
+double ULyraPerformanceStatSubsystem::GetStatPercentile(ELyraDisplayablePerformanceStat Stat, double Fraction, bool bSession) const
+{
+	return Tracker->GetHistogram(Stat).GetPercentile(Fraction, bSession);
+}
+
+FString ULyraPerformanceStatSubsystem::ExportPerformanceHistograms(const FString& Label, bool bAsJson)
+{
+	return Tracker->ExportHistograms(Label, bAsJson);
+}
+
+void ULyraPerformanceStatSubsystem::HandlePreLoadMap(const FString& MapName)
+{
+	// Leaving a map is the end of a match, so write out the session so far and start a new one
+	if (LyraPerformanceStatVars::bExportOnMapChange && Tracker.IsValid())
+	{
+		Tracker->ExportHistograms(TEXT("MatchEnd"), LyraPerformanceStatVars::bExportAsJson);
+		Tracker->ResetSession();
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GLyraExportPerfHistogramsCmd(
+	TEXT("Lyra.Perf.ExportHistograms"),
+	TEXT("Writes the percentile summary of the performance stat histograms to the profiling directory. Usage: Lyra.Perf.ExportHistograms [Label] [csv|json]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Params, UWorld* World)
+	{
+		const FString Label = (Params.Num() > 0) ? Params[0] : TEXT("Manual");
+		const bool bAsJson = (Params.Num() > 1) ? !Params[1].Equals(TEXT("csv"), ESearchCase::IgnoreCase) : LyraPerformanceStatVars::bExportAsJson;
+
+		if (UGameInstance* GameInstance = (World != nullptr) ? World->GetGameInstance() : nullptr)
+		{
+			if (ULyraPerformanceStatSubsystem* Subsystem = GameInstance->GetSubsystem<ULyraPerformanceStatSubsystem>())
+			{
+				Subsystem->ExportPerformanceHistograms(Label, bAsJson);
+			}
+		}
+	}));
+
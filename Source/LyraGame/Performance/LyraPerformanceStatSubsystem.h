@@ -3,11 +3,12 @@
 #pragma once
 
 #include "ChartCreation.h"
+#include "Performance/LyraPerformanceStatTypes.h"
 #include "Subsystems/GameInstanceSubsystem.h"
 
-#include "LyraPerformanceStatSubsystem.generated.h"
+#include <atomic>
 
-enum class ELyraDisplayablePerformanceStat : uint8;
+#include "LyraPerformanceStatSubsystem.generated.h"
 
 class FSubsystemCollectionBase;
 class ULyraPerformanceStatSubsystem;
@@ -16,6 +17,50 @@ struct FFrame;
 
 //////////////////////////////////////////////////////////////////////
 
+// Log-scale histogram of a single stat over a rolling window of frames and over the whole session
+// Samples are only added from the game thread, but the counts can be read from any thread without locking
+struct FLyraPerformanceStatHistogram
+{
+public:
+	static constexpr int32 SubBucketsPerOctave = 16;
+	static constexpr int32 NumOctaves = 40;
+
+	// Bucket 0 holds everything at or below MinValue (including zero)
+	static constexpr int32 NumBuckets = (SubBucketsPerOctave * NumOctaves) + 1;
+	static constexpr double MinValue = 1.0e-5;
+
+	FLyraPerformanceStatHistogram();
+
+	void SetWindowSize(int32 InWindowSize);
+	void AddSample(double Value);
+	void ResetSession();
+
+	// Returns the approximate value below which the specified fraction (0..1) of samples fall
+	double GetPercentile(double Fraction, bool bSession) const;
+	double GetMax(bool bSession) const;
+	double GetMean(bool bSession) const;
+	uint32 GetSampleCount(bool bSession) const;
+
+	static int32 GetBucketForValue(double Value);
+	static double GetValueForBucket(int32 Bucket);
+
+private:
+	std::atomic<uint32> WindowCounts[NumBuckets];
+	std::atomic<uint32> SessionCounts[NumBuckets];
+
+	std::atomic<uint32> WindowSampleCount;
+	std::atomic<uint32> SessionSampleCount;
+	std::atomic<double> WindowSum;
+	std::atomic<double> SessionSum;
+
+	// The raw samples in the rolling window, so they can be removed from the counts when they expire
+	TArray<float> WindowSamples;
+	int32 WindowCapacity = 0;
+	int32 NextWindowSample = 0;
+};
+
+//////////////////////////////////////////////////////////////////////
+
 // Observer which caches the stats for the previous frame
 struct FLyraPerformanceStatCache : public IPerformanceDataConsumer
 {
@@ -33,7 +78,31 @@ public:
 
 	double GetCachedStat(ELyraDisplayablePerformanceStat Stat) const;
 
+	const FLyraPerformanceStatHistogram& GetHistogram(ELyraDisplayablePerformanceStat Stat) const { return Histograms[(int32)Stat]; }
+
+	uint32 GetHitchCount(bool bSession) const { return bSession ? SessionHitchCount.load(std::memory_order_relaxed) : WindowHitchCount.load(std::memory_order_relaxed); }
+
+	// Clears the session histograms and hitch count (the rolling window is left alone)
+	void ResetSession();
+
+	// Writes the percentile summary of every stat to disk, returning the path written to
+	FString ExportHistograms(const FString& Label, bool bAsJson) const;
+
+protected:
+	void UpdateHistograms();
+
 protected:
+	FLyraPerformanceStatHistogram Histograms[(int32)ELyraDisplayablePerformanceStat::Count];
+
+	// Frame times of the rolling window, used to expire hitches from the window count
+	TArray<float> WindowFrameTimes;
+	int32 NextWindowFrame = 0;
+	int32 CachedWindowSize = 0;
+
+	std::atomic<uint32> WindowHitchCount { 0 };
+	std::atomic<uint32> SessionHitchCount { 0 };
+	std::atomic<float> SessionLongestHitch { 0.0f };
+
 	IPerformanceDataConsumer::FFrameData CachedData;
 	ULyraPerformanceStatSubsystem* MySubsystem;
 
@@ -59,11 +128,22 @@ public:
 	UFUNCTION(BlueprintCallable)
 	double GetCachedStat(ELyraDisplayablePerformanceStat Stat) const;
 
+	// Returns the value below which the specified fraction (0..1) of recent samples of the stat fall
+	UFUNCTION(BlueprintCallable)
+	double GetStatPercentile(ELyraDisplayablePerformanceStat Stat, double Fraction, bool bSession = false) const;
+
+	// Writes the percentile summary of every stat (as CSV or JSON) to the profiling directory and returns the file path
+	UFUNCTION(BlueprintCallable, meta = (AdvancedDisplay = "bAsJson"))
+	FString ExportPerformanceHistograms(const FString& Label, bool bAsJson = true);
+
 	//~USubsystem interface
 	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
 	virtual void Deinitialize() override;
 	//~End of USubsystem interface
 
+protected:
+	void HandlePreLoadMap(const FString& MapName);
+
 protected:
 	TSharedPtr<FLyraPerformanceStatCache> Tracker;
 };
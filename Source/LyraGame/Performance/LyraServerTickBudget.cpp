@@ -0,0 +1,284 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Performance/LyraServerTickBudget.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "LyraLogChannels.h"
+#include "Misc/App.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace LyraServerTickBudgetVars
+{
+	static float BudgetMS = 33.3f;
+	static FAutoConsoleVariableRef CVarBudgetMS(
+		TEXT("Lyra.Server.TickBudget.BudgetMS"),
+		BudgetMS,
+		TEXT("The frame time (in ms) the server is expected to stay under, excluding the time spent idling for the max tick rate. Frames longer than this are counted as over budget"),
+		ECVF_Default);
+
+	static int32 WindowFrames = 300;
+	static FAutoConsoleVariableRef CVarWindowFrames(
+		TEXT("Lyra.Server.TickBudget.WindowFrames"),
+		WindowFrames,
+		TEXT("The number of frames summarized by the tick budget dumps"),
+		ECVF_Default);
+
+	static float JsonDumpInterval = 0.0f;
+	static FAutoConsoleVariableRef CVarJsonDumpInterval(
+		TEXT("Lyra.Server.TickBudget.JsonDumpInterval"),
+		JsonDumpInterval,
+		TEXT("If above zero, how often (in seconds) the rolling JSON summary is rewritten to the profiling directory"),
+		ECVF_Default);
+
+	static bool bThrottleNonCritical = false;
+	static FAutoConsoleVariableRef CVarThrottleNonCritical(
+		TEXT("Lyra.Server.TickBudget.ThrottleNonCritical"),
+		bThrottleNonCritical,
+		TEXT("Should work that can be deferred (e.g., player state replication) be skipped for a frame after the server goes over budget?"),
+		ECVF_Default);
+}
+
+//////////////////////////////////////////////////////////////////////
+
+bool FLyraServerTickBudget::bEnabled = false;
+
+FAutoConsoleVariableRef FLyraServerTickBudget::CVarEnable(
+	TEXT("Lyra.Server.TickBudget.Enable"),
+	FLyraServerTickBudget::bEnabled,
+	TEXT("Should the server accumulate per-frame costs for the main Lyra hot paths?"),
+	FConsoleVariableDelegate::CreateStatic(&FLyraServerTickBudget::OnEnabledChanged),
+	ECVF_Default);
+
+FLyraServerTickBudget& FLyraServerTickBudget::Get()
+{
+	static FLyraServerTickBudget Instance;
+	return Instance;
+}
+
+FLyraServerTickBudget::FLyraServerTickBudget()
+{
+}
+
+const TCHAR* FLyraServerTickBudget::GetCategoryName(ELyraServerBudgetCategory Category)
+{
+	switch (Category)
+	{
+	case ELyraServerBudgetCategory::ReplicationGraph: return TEXT("ReplicationGraph");
+	case ELyraServerBudgetCategory::AbilityActivation: return TEXT("AbilityActivation");
+	case ELyraServerBudgetCategory::DamageExecution: return TEXT("DamageExecution");
+	case ELyraServerBudgetCategory::LagCompensation: return TEXT("LagCompensation");
+	}
+
+	static_assert((int32)ELyraServerBudgetCategory::Count == 4, "Need to update GetCategoryName to handle new categories");
+	return TEXT("Unknown");
+}
+
+void FLyraServerTickBudget::OnEnabledChanged(IConsoleVariable* Variable)
+{
+	if (bEnabled)
+	{
+		Get().BindFrameDelegates();
+	}
+	else
+	{
+		Get().UnbindFrameDelegates();
+	}
+}
+
+void FLyraServerTickBudget::BindFrameDelegates()
+{
+	if (!BeginFrameHandle.IsValid())
+	{
+		BeginFrameHandle = FCoreDelegates::OnBeginFrame.AddRaw(this, &FLyraServerTickBudget::HandleBeginFrame);
+		EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FLyraServerTickBudget::HandleEndFrame);
+	}
+}
+
+void FLyraServerTickBudget::UnbindFrameDelegates()
+{
+	FCoreDelegates::OnBeginFrame.Remove(BeginFrameHandle);
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	BeginFrameHandle.Reset();
+	EndFrameHandle.Reset();
+
+	FrameStartCycles = 0;
+	bLastFrameOverBudget = false;
+}
+
+void FLyraServerTickBudget::AddCycles(ELyraServerBudgetCategory Category, uint64 Cycles)
+{
+	CurrentCycles[(int32)Category] += Cycles;
+}
+
+bool FLyraServerTickBudget::ShouldThrottleNonCriticalWork()
+{
+	return bEnabled && LyraServerTickBudgetVars::bThrottleNonCritical && Get().WasLastFrameOverBudget();
+}
+
+void FLyraServerTickBudget::HandleBeginFrame()
+{
+	FrameStartCycles = FPlatformTime::Cycles64();
+	FMemory::Memzero(CurrentCycles);
+}
+
+void FLyraServerTickBudget::HandleEndFrame()
+{
+	if (FrameStartCycles == 0)
+	{
+		// Enabled part way through a frame
+		return;
+	}
+
+	const int32 Capacity = FMath::Max(LyraServerTickBudgetVars::WindowFrames, 1);
+	if (Capacity != WindowCapacity)
+	{
+		WindowCapacity = Capacity;
+		NextWindowFrame = 0;
+		WindowFrameMS.Reset(Capacity);
+		for (TArray<float>& CategoryMS : WindowCategoryMS)
+		{
+			CategoryMS.Reset(Capacity);
+		}
+	}
+
+	// The max tick rate sleep happens inside the frame, only the time spent working counts towards the budget
+	const double ElapsedMS = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - FrameStartCycles);
+	const float FrameMS = (float)FMath::Max(ElapsedMS - (FApp::GetIdleTime() * 1000.0), 0.0);
+	bLastFrameOverBudget = (FrameMS > LyraServerTickBudgetVars::BudgetMS);
+
+	const bool bWindowFull = (WindowFrameMS.Num() == WindowCapacity);
+	if (bWindowFull)
+	{
+		WindowFrameMS[NextWindowFrame] = FrameMS;
+	}
+	else
+	{
+		WindowFrameMS.Add(FrameMS);
+	}
+
+	for (int32 CategoryIndex = 0; CategoryIndex < (int32)ELyraServerBudgetCategory::Count; ++CategoryIndex)
+	{
+		const float CategoryMS = (float)FPlatformTime::ToMilliseconds64(CurrentCycles[CategoryIndex]);
+		if (bWindowFull)
+		{
+			WindowCategoryMS[CategoryIndex][NextWindowFrame] = CategoryMS;
+		}
+		else
+		{
+			WindowCategoryMS[CategoryIndex].Add(CategoryMS);
+		}
+	}
+
+	NextWindowFrame = (NextWindowFrame + 1) % WindowCapacity;
+
+	if (LyraServerTickBudgetVars::JsonDumpInterval > 0.0f)
+	{
+		const double Now = FPlatformTime::Seconds();
+		if ((Now - LastJsonDumpTime) >= LyraServerTickBudgetVars::JsonDumpInterval)
+		{
+			LastJsonDumpTime = Now;
+			DumpToJson();
+		}
+	}
+}
+
+FLyraServerTickBudget::FWindowSummary FLyraServerTickBudget::SummarizeWindow() const
+{
+	FWindowSummary Summary;
+	Summary.NumFrames = WindowFrameMS.Num();
+	if (Summary.NumFrames == 0)
+	{
+		return Summary;
+	}
+
+	double TotalFrameMS = 0.0;
+	for (const float FrameMS : WindowFrameMS)
+	{
+		TotalFrameMS += FrameMS;
+		Summary.MaxFrameMS = FMath::Max<double>(Summary.MaxFrameMS, FrameMS);
+		Summary.NumFramesOverBudget += (FrameMS > LyraServerTickBudgetVars::BudgetMS) ? 1 : 0;
+	}
+	Summary.AverageFrameMS = TotalFrameMS / Summary.NumFrames;
+
+	for (int32 CategoryIndex = 0; CategoryIndex < (int32)ELyraServerBudgetCategory::Count; ++CategoryIndex)
+	{
+		double TotalMS = 0.0;
+		for (const float CategoryMS : WindowCategoryMS[CategoryIndex])
+		{
+			TotalMS += CategoryMS;
+			Summary.MaxMS[CategoryIndex] = FMath::Max<double>(Summary.MaxMS[CategoryIndex], CategoryMS);
+		}
+		Summary.AverageMS[CategoryIndex] = TotalMS / Summary.NumFrames;
+	}
+
+	return Summary;
+}
+
+void FLyraServerTickBudget::DumpToLog() const
+{
+	const FWindowSummary Summary = SummarizeWindow();
+
+	UE_LOG(LogLyra, Log, TEXT("Server tick budget over the last %d frames: budget %.2f ms, average %.2f ms, max %.2f ms, %d frames over budget"),
+		Summary.NumFrames, LyraServerTickBudgetVars::BudgetMS, Summary.AverageFrameMS, Summary.MaxFrameMS, Summary.NumFramesOverBudget);
+
+	for (int32 CategoryIndex = 0; CategoryIndex < (int32)ELyraServerBudgetCategory::Count; ++CategoryIndex)
+	{
+		const double ShareOfBudget = (LyraServerTickBudgetVars::BudgetMS > 0.0f) ? (Summary.AverageMS[CategoryIndex] / LyraServerTickBudgetVars::BudgetMS) : 0.0;
+		UE_LOG(LogLyra, Log, TEXT("  %-20s average %.3f ms (%.1f%% of budget), max %.3f ms"),
+			GetCategoryName((ELyraServerBudgetCategory)CategoryIndex), Summary.AverageMS[CategoryIndex], ShareOfBudget * 100.0, Summary.MaxMS[CategoryIndex]);
+	}
+}
+
+FString FLyraServerTickBudget::DumpToJson() const
+{
+	const FWindowSummary Summary = SummarizeWindow();
+
+	FString Output;
+	Output += TEXT("{\n");
+	Output += FString::Printf(TEXT("\t\"budgetMs\": %.3f,\n"), LyraServerTickBudgetVars::BudgetMS);
+	Output += FString::Printf(TEXT("\t\"frames\": %d,\n"), Summary.NumFrames);
+	Output += FString::Printf(TEXT("\t\"framesOverBudget\": %d,\n"), Summary.NumFramesOverBudget);
+	Output += FString::Printf(TEXT("\t\"averageFrameMs\": %.3f,\n"), Summary.AverageFrameMS);
+	Output += FString::Printf(TEXT("\t\"maxFrameMs\": %.3f,\n"), Summary.MaxFrameMS);
+	Output += TEXT("\t\"categories\": {\n");
+	for (int32 CategoryIndex = 0; CategoryIndex < (int32)ELyraServerBudgetCategory::Count; ++CategoryIndex)
+	{
+		Output += FString::Printf(TEXT("\t\t\"%s\": { \"averageMs\": %.4f, \"maxMs\": %.4f }%s\n"),
+			GetCategoryName((ELyraServerBudgetCategory)CategoryIndex), Summary.AverageMS[CategoryIndex], Summary.MaxMS[CategoryIndex],
+			(CategoryIndex + 1 < (int32)ELyraServerBudgetCategory::Count) ? TEXT(",") : TEXT(""));
+	}
+	Output += TEXT("\t}\n}\n");
+
+	// The same file is rewritten each time so external tools can poll it
+	const FString OutputDir = FPaths::ProfilingDir() / TEXT("ServerTickBudget");
+	IFileManager::Get().MakeDirectory(*OutputDir, /*Tree=*/ true);
+
+	const FString Filename = OutputDir / TEXT("ServerTickBudget.json");
+	if (!FFileHelper::SaveStringToFile(Output, *Filename))
+	{
+		UE_LOG(LogLyra, Warning, TEXT("Failed to write the server tick budget summary to %s"), *Filename);
+		return FString();
+	}
+
+	return Filename;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+static FAutoConsoleCommand GLyraServerTickBudgetDumpCmd(
+	TEXT("Lyra.Server.TickBudget.Dump"),
+	TEXT("Logs the per-category server frame cost over the rolling window (requires Lyra.Server.TickBudget.Enable). Pass 'json' to also write it to the profiling directory."),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Params)
+	{
+		FLyraServerTickBudget& Budget = FLyraServerTickBudget::Get();
+		Budget.DumpToLog();
+
+		if ((Params.Num() > 0) && Params[0].Equals(TEXT("json"), ESearchCase::IgnoreCase))
+		{
+			const FString Filename = Budget.DumpToJson();
+			UE_LOG(LogLyra, Log, TEXT("Wrote the server tick budget summary to %s"), *Filename);
+		}
+	}));
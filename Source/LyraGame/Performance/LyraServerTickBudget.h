@@ -0,0 +1,128 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+
+class FAutoConsoleVariableRef;
+class IConsoleVariable;
+
+//////////////////////////////////////////////////////////////////////
+
+// The hot paths on the server that report their cost to FLyraServerTickBudget
+// Times are inclusive, so a category that runs inside another one (e.g., a damage execution applied during an ability activation) is counted in both
+enum class ELyraServerBudgetCategory : uint8
+{
+	// Replication graph gather and actor replication (ULyraReplicationGraph::ServerReplicateActors)
+	ReplicationGraph,
+
+	// Gameplay ability activation (ULyraGameplayAbility::ActivateAbility)
+	AbilityActivation,
+
+	// Damage gameplay effect executions
+	DamageExecution,
+
+	// Hitbox history recording and hit validation
+	LagCompensation,
+
+	Count
+};
+
+//////////////////////////////////////////////////////////////////////
+
+// Per-frame cost accounting for the server's main Lyra hot paths
+// Scopes are cheap enough to leave compiled in (a single branch when disabled), and only the game thread may report time
+class LYRAGAME_API FLyraServerTickBudget
+{
+public:
+	static FLyraServerTickBudget& Get();
+
+	static bool IsEnabled() { return bEnabled; }
+
+	// Adds time to the specified category for the current frame
+	void AddCycles(ELyraServerBudgetCategory Category, uint64 Cycles);
+
+	// Returns true if the last completed frame went over the configured budget
+	bool WasLastFrameOverBudget() const { return bLastFrameOverBudget; }
+
+	// Returns true if work that can safely be deferred by a frame should be skipped this frame
+	static bool ShouldThrottleNonCriticalWork();
+
+	// Writes a summary of the rolling window to the log
+	void DumpToLog() const;
+
+	// Writes a summary of the rolling window as JSON to the profiling directory, returning the path written to
+	FString DumpToJson() const;
+
+	static const TCHAR* GetCategoryName(ELyraServerBudgetCategory Category);
+
+private:
+	FLyraServerTickBudget();
+
+	void BindFrameDelegates();
+	void UnbindFrameDelegates();
+	static void OnEnabledChanged(IConsoleVariable* Variable);
+
+	void HandleBeginFrame();
+	void HandleEndFrame();
+
+	struct FWindowSummary
+	{
+		int32 NumFrames = 0;
+		int32 NumFramesOverBudget = 0;
+		double AverageFrameMS = 0.0;
+		double MaxFrameMS = 0.0;
+		double AverageMS[(int32)ELyraServerBudgetCategory::Count] = {};
+		double MaxMS[(int32)ELyraServerBudgetCategory::Count] = {};
+	};
+
+	FWindowSummary SummarizeWindow() const;
+
+private:
+	// Mirrors Lyra.Server.TickBudget.Enable
+	static bool bEnabled;
+	static FAutoConsoleVariableRef CVarEnable;
+
+	// Cycles accumulated for the frame in progress
+	uint64 CurrentCycles[(int32)ELyraServerBudgetCategory::Count] = {};
+	uint64 FrameStartCycles = 0;
+
+	// Rolling window of completed frames, one stream per category (in ms)
+	TArray<float> WindowFrameMS;
+	TArray<float> WindowCategoryMS[(int32)ELyraServerBudgetCategory::Count];
+	int32 WindowCapacity = 0;
+	int32 NextWindowFrame = 0;
+
+	double LastJsonDumpTime = 0.0;
+	bool bLastFrameOverBudget = false;
+
+	FDelegateHandle BeginFrameHandle;
+	FDelegateHandle EndFrameHandle;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+// Reports the time spent in the enclosing scope to FLyraServerTickBudget
+struct FLyraServerBudgetScope
+{
+	explicit FLyraServerBudgetScope(ELyraServerBudgetCategory InCategory)
+		: Category(InCategory)
+		, StartCycles(FLyraServerTickBudget::IsEnabled() && IsInGameThread() ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+
+	~FLyraServerBudgetScope()
+	{
+		if (StartCycles != 0)
+		{
+			FLyraServerTickBudget::Get().AddCycles(Category, FPlatformTime::Cycles64() - StartCycles);
+		}
+	}
+
+private:
+	ELyraServerBudgetCategory Category;
+	uint64 StartCycles;
+};
+
+#define LYRA_SERVER_BUDGET_SCOPE(CategoryName) FLyraServerBudgetScope PREPROCESSOR_JOIN(LyraServerBudgetScope_, __LINE__)(ELyraServerBudgetCategory::CategoryName)
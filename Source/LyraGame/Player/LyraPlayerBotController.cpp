@@ -9,6 +9,7 @@
 #include "GameModes/LyraGameMode.h"
 #include "LyraLogChannels.h"
 #include "Perception/AIPerceptionComponent.h"
+#include "System/LyraActorUtilities.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraPlayerBotController)
 
@@ -21,6 +22,17 @@ ALyraPlayerBotController::ALyraPlayerBotController(const FObjectInitializer& Obj
 	bStopAILogicOnUnposses = false;
 }
 
+void ALyraPlayerBotController::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Subobjects (inventory items) can be replicated from the registered list only, before the first replication of this controller
+	if (HasAuthority() && ULyraActorUtilities::ShouldUseRegisteredSubObjectListOnly(this))
+	{
+		bReplicateUsingRegisteredSubObjectList = true;
+	}
+}
+
 void ALyraPlayerBotController::OnPlayerStateChangedTeam(UObject* TeamAgent, int32 OldTeam, int32 NewTeam)
 {
 	ConditionalBroadcastTeamChanged(this, IntegerToGenericTeamId(OldTeam), IntegerToGenericTeamId(NewTeam));
@@ -56,7 +56,11 @@ protected:
 private:
 	void BroadcastOnPlayerStateChanged();
 
-protected:	
+protected:
+	//~AActor interface
+	virtual void BeginPlay() override;
+	//~End of AActor interface
+
 	//~AController interface
 	virtual void InitPlayerState() override;
 	virtual void CleanupPlayerState() override;
@@ -17,6 +17,7 @@
 #include "LyraLocalPlayer.h"
 #include "Settings/LyraSettingsShared.h"
 #include "Development/LyraDeveloperSettings.h"
+#include "System/LyraActorUtilities.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraPlayerController)
 
@@ -50,6 +51,12 @@ void ALyraPlayerController::BeginPlay()
 {
 	Super::BeginPlay();
 	SetActorHiddenInGame(false);
+
+	// Subobjects (inventory items) can be replicated from the registered list only, before the first replication of this controller
+	if (HasAuthority() && ULyraActorUtilities::ShouldUseRegisteredSubObjectListOnly(this))
+	{
+		bReplicateUsingRegisteredSubObjectList = true;
+	}
 }
 
 void ALyraPlayerController::EndPlay(const EEndPlayReason::Type EndPlayReason)
@@ -2,10 +2,23 @@
 
 #include "LyraActorUtilities.h"
 
+#include "Components/ActorComponent.h"
 #include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "LyraLogChannels.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraActorUtilities)
 
+namespace LyraConsoleVariables
+{
+	static bool bRegisteredSubObjectListOnly = false;
+	static FAutoConsoleVariableRef CVarRegisteredSubObjectListOnly(
+		TEXT("Lyra.Net.RegisteredSubObjectListOnly"),
+		bRegisteredSubObjectListOnly,
+		TEXT("If true, characters and controllers whose replicated components all use the registered subobject list replicate their subobjects (e.g., inventory items and equipment instances) from that list only, instead of also walking them in ReplicateSubobjects. Applies to actors that begin play afterwards."),
+		ECVF_Default);
+}
+
 EBlueprintExposedNetMode ULyraActorUtilities::SwitchOnNetMode(const UObject* WorldContextObject)
 {
 	ENetMode NetMode = NM_Standalone;
@@ -39,3 +52,21 @@ EBlueprintExposedNetMode ULyraActorUtilities::SwitchOnNetMode(const UObject* Wor
 	}
 }
 
+bool ULyraActorUtilities::ShouldUseRegisteredSubObjectListOnly(const AActor* Actor)
+{
+	if (!LyraConsoleVariables::bRegisteredSubObjectListOnly || (Actor == nullptr))
+	{
+		return false;
+	}
+
+	for (const UActorComponent* Component : Actor->GetReplicatedComponents())
+	{
+		if ((Component != nullptr) && !Component->IsUsingRegisteredSubObjectList())
+		{
+			UE_LOG(LogLyra, Verbose, TEXT("%s keeps replicating subobjects through ReplicateSubobjects, component %s does not use the registered subobject list"), *GetNameSafe(Actor), *GetNameSafe(Component));
+			return false;
+		}
+	}
+
+	return true;
+}
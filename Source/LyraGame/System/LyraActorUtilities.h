@@ -6,6 +6,7 @@
 
 #include "LyraActorUtilities.generated.h"
 
+class AActor;
 class UObject;
 struct FFrame;
 
@@ -40,4 +41,11 @@ public:
 	 */
 	UFUNCTION(BlueprintCallable, Category="Lyra", meta=(WorldContext="WorldContextObject", ExpandEnumAsExecs=ReturnValue))
 	static EBlueprintExposedNetMode SwitchOnNetMode(const UObject* WorldContextObject);
+
+	/**
+	 * Returns true if the actor should replicate its subobjects from the registered subobject lists only (skipping ReplicateSubobjects).
+	 * This is opt-in with Lyra.Net.RegisteredSubObjectListOnly, and only allowed when every replicated component of the actor uses the
+	 * registered list, since the subobjects of components still relying on ReplicateSubobjects would stop replicating.
+	 */
+	static bool ShouldUseRegisteredSubObjectListOnly(const AActor* Actor);
 };
@@ -38,7 +38,13 @@
 *		ULyraReplicationGraphNode_PlayerStateFrequencyLimiter
 *		A custom node for handling player state replication. This replicates a small rolling set of player states (currently 2/frame). This is so player states replicate
 *		to simulated connections at a low, steady frequency, and to take advantage of serialization sharing. Auto proxy player states are replicated at higher frequency (to the
-*		owning connection only) via ULyraReplicationGraphNode_AlwaysRelevant_ForConnection.
+*		owning connection only) via ULyraReplicationGraphNode_AlwaysRelevant_ForConnection. The node keeps its list of player states up to date from the add/remove
+*		notifications ULyraReplicationGraph forwards to it, rather than iterating the world every frame.
+*		
+*		ULyraReplicationGraphNode_PawnPrioritization_ForConnection
+*		Connection specific node that doesn't gather anything. Every few frames it scales the connection's ReplicationPeriodFrame for each Lyra character by how
+*		relevant that character is to the connection's viewers (distance, view cone, and whether they recently damaged each other). Far away pawns behind
+*		the viewer replicate less often; pawns the viewer is fighting replicate at the class rate. See the Lyra.RepGraph.Prioritization.* cvars.
 *		
 *		UReplicationGraphNode_TearOff_ForConnection
 *		Connection specific node for handling tear off actors. This is created and managed in the base implementation of Replication Graph.
@@ -101,7 +107,9 @@
 #include "UObject/UObjectIterator.h"
 
 #include "LyraReplicationGraphSettings.h"
+#include "Performance/LyraServerTickBudget.h"
 #include "Character/LyraCharacter.h"
+#include "Character/LyraHealthComponent.h"
 #include "Player/LyraPlayerController.h"
 
 DEFINE_LOG_CATEGORY( LogLyraRepGraph );
@@ -145,6 +153,38 @@ namespace Lyra::RepGraph
 	int32 EnableFastSharedPath = 1;
 	static FAutoConsoleVariableRef CVarLyraRepEnableFastSharedPath(TEXT("Lyra.RepGraph.EnableFastSharedPath"), EnableFastSharedPath, TEXT(""), ECVF_Default);
 
+	int32 PlayerStateThrottledSkipFrames = 1;
+	static FAutoConsoleVariableRef CVarLyraRepPlayerStateThrottledSkipFrames(TEXT("Lyra.RepGraph.PlayerStateThrottledSkipFrames"), PlayerStateThrottledSkipFrames, TEXT("How many frames the player state batches are skipped between two gathered batches while the server is over its tick budget"), ECVF_Default);
+
+	int32 EnablePawnPrioritization = 1;
+	static FAutoConsoleVariableRef CVarLyraRepEnablePawnPrioritization(TEXT("Lyra.RepGraph.Prioritization.Enable"), EnablePawnPrioritization, TEXT("Scale how often pawns replicate to each connection by their relevance to its viewers"), ECVF_Default);
+
+	// Each connection recomputes its pawn periods every this many frames (connections are staggered across frames)
+	int32 PawnPrioritizationUpdateFrames = 4;
+	static FAutoConsoleVariableRef CVarLyraRepPawnPrioritizationUpdateFrames(TEXT("Lyra.RepGraph.Prioritization.UpdateFrames"), PawnPrioritizationUpdateFrames, TEXT("How many frames between recomputing the pawn replication periods of a connection"), ECVF_Default);
+
+	// Period multiplier for a pawn at the cull distance (scales linearly from 1 at the viewer)
+	float PawnPrioritizationMaxDistanceScale = 4.0f;
+	static FAutoConsoleVariableRef CVarLyraRepPawnPrioritizationMaxDistanceScale(TEXT("Lyra.RepGraph.Prioritization.MaxDistanceScale"), PawnPrioritizationMaxDistanceScale, TEXT("Replication period multiplier for pawns at the cull distance"), ECVF_Default);
+
+	float PawnPrioritizationOutOfViewScale = 2.0f;
+	static FAutoConsoleVariableRef CVarLyraRepPawnPrioritizationOutOfViewScale(TEXT("Lyra.RepGraph.Prioritization.OutOfViewScale"), PawnPrioritizationOutOfViewScale, TEXT("Extra replication period multiplier for pawns outside the view cone of every viewer"), ECVF_Default);
+
+	float PawnPrioritizationViewConeHalfAngle = 60.0f;
+	static FAutoConsoleVariableRef CVarLyraRepPawnPrioritizationViewConeHalfAngle(TEXT("Lyra.RepGraph.Prioritization.ViewConeHalfAngle"), PawnPrioritizationViewConeHalfAngle, TEXT("Half angle (in degrees) of the view cone used to find pawns in view"), ECVF_Default);
+
+	// Pawns closer than this are never throttled, regardless of where the viewer is looking
+	float PawnPrioritizationNearDistance = 1500.0f;
+	static FAutoConsoleVariableRef CVarLyraRepPawnPrioritizationNearDistance(TEXT("Lyra.RepGraph.Prioritization.NearDistance"), PawnPrioritizationNearDistance, TEXT("Pawns closer than this to a viewer always replicate at the class rate"), ECVF_Default);
+
+	int32 PawnPrioritizationMaxPeriodFrames = 12;
+	static FAutoConsoleVariableRef CVarLyraRepPawnPrioritizationMaxPeriodFrames(TEXT("Lyra.RepGraph.Prioritization.MaxPeriodFrames"), PawnPrioritizationMaxPeriodFrames, TEXT("Upper bound on the scaled replication period (in frames)"), ECVF_Default);
+
+	float RecentDamageInteractionTime = 3.0f;
+	static FAutoConsoleVariableRef CVarLyraRepRecentDamageInteractionTime(TEXT("Lyra.RepGraph.Prioritization.RecentDamageTime"), RecentDamageInteractionTime, TEXT("Pawns that damaged each other within this many seconds replicate to each other at the class rate"), ECVF_Default);
+
+	static constexpr int32 MaxRecentDamageInteractions = 64;
+
 	UReplicationDriver* ConditionalCreateReplicationDriver(UNetDriver* ForNetDriver, UWorld* World)
 	{
 		// Only create for GameNetDriver
@@ -189,11 +229,21 @@ ULyraReplicationGraph::ULyraReplicationGraph()
 	}
 }
 
+int32 ULyraReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	LYRA_SERVER_BUDGET_SCOPE(ReplicationGraph);
+
+	return Super::ServerReplicateActors(DeltaSeconds);
+}
+
 void ULyraReplicationGraph::ResetGameWorldState()
 {
 	Super::ResetGameWorldState();
 
 	AlwaysRelevantStreamingLevelActors.Empty();
+	PrioritizedPawns.Reset();
+	RecentDamageInteractions.Reset();
+	NextRecentDamageInteraction = 0;
 
 	for (UNetReplicationGraphConnection* ConnManager : Connections)
 	{
@@ -568,7 +618,7 @@ void ULyraReplicationGraph::InitGlobalGraphNodes()
 	// -----------------------------------------------
 	//	Player State specialization. This will return a rolling subset of the player states to replicate
 	// -----------------------------------------------
-	ULyraReplicationGraphNode_PlayerStateFrequencyLimiter* PlayerStateNode = CreateNewNode<ULyraReplicationGraphNode_PlayerStateFrequencyLimiter>();
+	PlayerStateNode = CreateNewNode<ULyraReplicationGraphNode_PlayerStateFrequencyLimiter>();
 	AddGlobalGraphNode(PlayerStateNode);
 }
 
@@ -583,6 +633,9 @@ void ULyraReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnect
 	RepGraphConnection->OnClientVisibleLevelNameRemove.AddUObject(AlwaysRelevantConnectionNode, &ULyraReplicationGraphNode_AlwaysRelevant_ForConnection::OnClientLevelVisibilityRemove);
 
 	AddConnectionGraphNode(AlwaysRelevantConnectionNode, RepGraphConnection);
+
+	ULyraReplicationGraphNode_PawnPrioritization_ForConnection* PawnPrioritizationNode = CreateNewNode<ULyraReplicationGraphNode_PawnPrioritization_ForConnection>();
+	AddConnectionGraphNode(PawnPrioritizationNode, RepGraphConnection);
 }
 
 EClassRepNodeMapping ULyraReplicationGraph::GetMappingPolicy(UClass* Class)
@@ -594,6 +647,21 @@ EClassRepNodeMapping ULyraReplicationGraph::GetMappingPolicy(UClass* Class)
 
 void ULyraReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
 {
+	// These are tracked on top of the class routing below
+	if (ActorInfo.Class->IsChildOf(APlayerState::StaticClass()))
+	{
+		PlayerStateNode->NotifyAddNetworkActor(ActorInfo);
+	}
+	else if (ActorInfo.Class->IsChildOf(ALyraCharacter::StaticClass()))
+	{
+		PrioritizedPawns.ConditionalAdd(ActorInfo.Actor);
+
+		if (ULyraHealthComponent* HealthComponent = ULyraHealthComponent::FindHealthComponent(ActorInfo.GetActor()))
+		{
+			HealthComponent->OnHealthChanged.AddUniqueDynamic(this, &ThisClass::OnPawnHealthChanged);
+		}
+	}
+
 	EClassRepNodeMapping Policy = GetMappingPolicy(ActorInfo.Class);
 	switch(Policy)
 	{
@@ -638,6 +706,20 @@ void ULyraReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActo
 
 void ULyraReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
 {
+	if (ActorInfo.Class->IsChildOf(APlayerState::StaticClass()))
+	{
+		PlayerStateNode->NotifyRemoveNetworkActor(ActorInfo);
+	}
+	else if (ActorInfo.Class->IsChildOf(ALyraCharacter::StaticClass()))
+	{
+		PrioritizedPawns.RemoveFast(ActorInfo.Actor);
+
+		if (ULyraHealthComponent* HealthComponent = ULyraHealthComponent::FindHealthComponent(ActorInfo.GetActor()))
+		{
+			HealthComponent->OnHealthChanged.RemoveDynamic(this, &ThisClass::OnPawnHealthChanged);
+		}
+	}
+
 	EClassRepNodeMapping Policy = GetMappingPolicy(ActorInfo.Class);
 	switch(Policy)
 	{
@@ -686,6 +768,72 @@ void ULyraReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedA
 	};
 }
 
+static const AActor* GetPawnForDamageInstigator(const AActor* Instigator)
+{
+	// Damage instigators can be the pawn, its controller or its player state
+	if (const AController* Controller = Cast<AController>(Instigator))
+	{
+		return Controller->GetPawn();
+	}
+	if (const APlayerState* PlayerState = Cast<APlayerState>(Instigator))
+	{
+		return PlayerState->GetPawn();
+	}
+	return Instigator;
+}
+
+void ULyraReplicationGraph::OnPawnHealthChanged(ULyraHealthComponent* HealthComponent, float OldValue, float NewValue, AActor* Instigator)
+{
+	const AActor* Victim = HealthComponent->GetOwner();
+	const AActor* InstigatorPawn = GetPawnForDamageInstigator(Instigator);
+	if ((NewValue >= OldValue) || (InstigatorPawn == nullptr) || (InstigatorPawn == Victim))
+	{
+		return;
+	}
+
+	FRecentDamageInteraction Interaction;
+	Interaction.Victim = Victim;
+	Interaction.Instigator = InstigatorPawn;
+	Interaction.Time = GetWorld()->GetTimeSeconds();
+
+	if (RecentDamageInteractions.Num() < Lyra::RepGraph::MaxRecentDamageInteractions)
+	{
+		RecentDamageInteractions.Add(Interaction);
+	}
+	else
+	{
+		RecentDamageInteractions[NextRecentDamageInteraction] = Interaction;
+		NextRecentDamageInteraction = (NextRecentDamageInteraction + 1) % Lyra::RepGraph::MaxRecentDamageInteractions;
+	}
+}
+
+void ULyraReplicationGraph::GetRecentDamagePartners(const AActor* Pawn, double Now, TArray<const AActor*, TInlineAllocator<8>>& OutPartners) const
+{
+	if (Pawn == nullptr)
+	{
+		return;
+	}
+
+	for (const FRecentDamageInteraction& Interaction : RecentDamageInteractions)
+	{
+		if ((Now - Interaction.Time) > Lyra::RepGraph::RecentDamageInteractionTime)
+		{
+			continue;
+		}
+
+		const AActor* Victim = Interaction.Victim.Get();
+		const AActor* Instigator = Interaction.Instigator.Get();
+		if (Victim == Pawn)
+		{
+			OutPartners.AddUnique(Instigator);
+		}
+		else if (Instigator == Pawn)
+		{
+			OutPartners.AddUnique(Victim);
+		}
+	}
+}
+
 // Since we listen to global (static) events, we need to watch out for cross world broadcasts (PIE)
 #if WITH_EDITOR
 #define CHECK_WORLDS(X) if(X->GetWorld() != GetWorld()) return;
@@ -895,25 +1043,44 @@ ULyraReplicationGraphNode_PlayerStateFrequencyLimiter::ULyraReplicationGraphNode
 	bRequiresPrepareForReplicationCall = true;
 }
 
+void ULyraReplicationGraphNode_PlayerStateFrequencyLimiter::NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo)
+{
+	PlayerStates.AddUnique(ActorInfo.Actor);
+	bListsDirty = true;
+}
+
+bool ULyraReplicationGraphNode_PlayerStateFrequencyLimiter::NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound)
+{
+	const bool bRemoved = (PlayerStates.RemoveSwap(ActorInfo.Actor, /*bAllowShrinking=*/ false) > 0);
+	bListsDirty |= bRemoved;
+
+	UE_CLOG(!bRemoved && bWarnIfNotFound, LogLyraRepGraph, Warning, TEXT("Player state %s was not found in ULyraReplicationGraphNode_PlayerStateFrequencyLimiter"), *GetActorRepListTypeDebugString(ActorInfo.Actor));
+	return bRemoved;
+}
+
+void ULyraReplicationGraphNode_PlayerStateFrequencyLimiter::NotifyResetAllNetworkActors()
+{
+	PlayerStates.Reset();
+	bListsDirty = true;
+}
+
 void ULyraReplicationGraphNode_PlayerStateFrequencyLimiter::PrepareForReplication()
 {
-	ReplicationActorLists.Reset();
 	ForceNetUpdateReplicationActorList.Reset();
 
+	// The list of player states is maintained from add/remove notifications, so the batches only need to be rebuilt when a player joins or leaves
+	if (!bListsDirty)
+	{
+		return;
+	}
+	bListsDirty = false;
+
+	ReplicationActorLists.Reset();
 	ReplicationActorLists.AddDefaulted();
 	FActorRepListRefView* CurrentList = &ReplicationActorLists[0];
 
-	// We rebuild our lists of player states each frame. This is not as efficient as it could be but its the simplest way
-	// to handle players disconnecting and keeping the lists compact. If the lists were persistent we would need to defrag them as players left.
-
-	for (TActorIterator<APlayerState> It(GetWorld()); It; ++It)
+	for (FActorRepListType PS : PlayerStates)
 	{
-		APlayerState* PS = *It;
-		if (IsActorValidForReplicationGather(PS) == false)
-		{
-			continue;
-		}
-
 		if (CurrentList->Num() >= TargetActorsPerFrame)
 		{
 			ReplicationActorLists.AddDefaulted();
@@ -926,8 +1093,14 @@ void ULyraReplicationGraphNode_PlayerStateFrequencyLimiter::PrepareForReplicatio
 
 void ULyraReplicationGraphNode_PlayerStateFrequencyLimiter::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
 {
-	const int32 ListIdx = Params.ReplicationFrameNum % ReplicationActorLists.Num();
-	Params.OutGatheredReplicationLists.AddReplicationActorList(ReplicationActorLists[ListIdx]);
+	// While the server is over budget, only every few frames gathers a batch. The batches still cycle in order, so every player state keeps
+	// replicating, just at a lower rate, instead of starving for as long as the overload lasts.
+	const uint32 GatherInterval = FLyraServerTickBudget::ShouldThrottleNonCriticalWork() ? (uint32)FMath::Max(Lyra::RepGraph::PlayerStateThrottledSkipFrames, 0) + 1 : 1;
+	if ((Params.ReplicationFrameNum % GatherInterval) == 0)
+	{
+		const int32 ListIdx = (Params.ReplicationFrameNum / GatherInterval) % ReplicationActorLists.Num();
+		Params.OutGatheredReplicationLists.AddReplicationActorList(ReplicationActorLists[ListIdx]);
+	}
 
 	if (ForceNetUpdateReplicationActorList.Num() > 0)
 	{
@@ -951,6 +1124,134 @@ void ULyraReplicationGraphNode_PlayerStateFrequencyLimiter::LogNode(FReplication
 
 // ------------------------------------------------------------------------------
 
+void ULyraReplicationGraphNode_PawnPrioritization_ForConnection::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	const bool bEnabled = (Lyra::RepGraph::EnablePawnPrioritization != 0);
+	if (!bEnabled && !bPeriodsModified)
+	{
+		return;
+	}
+
+	// Stagger connections across frames so only a fraction of them do this work each frame
+	const uint32 UpdateFrames = (uint32)FMath::Max(Lyra::RepGraph::PawnPrioritizationUpdateFrames, 1);
+	if (bEnabled && (((Params.ReplicationFrameNum + (uint32)Params.ConnectionManager.ConnectionOrderNum) % UpdateFrames) != 0))
+	{
+		return;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	UpdatePawnPeriods(Params, bEnabled);
+
+	const double ElapsedSeconds = FPlatformTime::Seconds() - StartTime;
+	TotalUpdateSeconds += ElapsedSeconds;
+	MaxUpdateSeconds = FMath::Max(MaxUpdateSeconds, ElapsedSeconds);
+	++NumUpdates;
+}
+
+void ULyraReplicationGraphNode_PawnPrioritization_ForConnection::UpdatePawnPeriods(const FConnectionGatherActorListParameters& Params, bool bEnabled)
+{
+	const ULyraReplicationGraph* LyraGraph = CastChecked<ULyraReplicationGraph>(GetOuter());
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	// Pawns controlled or viewed by this connection are returned by the always relevant node at the class rate
+	TArray<const AActor*, TInlineAllocator<4>> ViewerPawns;
+	TArray<const AActor*, TInlineAllocator<8>> DamagePartners;
+	for (const FNetViewer& CurViewer : Params.Viewers)
+	{
+		if (const APlayerController* PC = Cast<APlayerController>(CurViewer.InViewer))
+		{
+			ViewerPawns.AddUnique(PC->GetPawn());
+			LyraGraph->GetRecentDamagePartners(PC->GetPawn(), Now, DamagePartners);
+		}
+		ViewerPawns.AddUnique(CurViewer.ViewTarget);
+	}
+
+	const float ViewConeCos = FMath::Cos(FMath::DegreesToRadians(Lyra::RepGraph::PawnPrioritizationViewConeHalfAngle));
+	const float NearDistanceSq = FMath::Square(Lyra::RepGraph::PawnPrioritizationNearDistance);
+
+	NumFullRatePawns = 0;
+	NumThrottledPawns = 0;
+
+	for (FActorRepListType Actor : LyraGraph->PrioritizedPawns)
+	{
+		if (ViewerPawns.Contains(Actor))
+		{
+			continue;
+		}
+
+		FConnectionReplicationActorInfo& ConnectionActorInfo = Params.ConnectionManager.ActorInfoMap.FindOrAdd(Actor);
+		const FGlobalActorReplicationInfo& GlobalInfo = GraphGlobals->GlobalActorReplicationInfoMap->Get(Actor);
+		const uint32 BasePeriod = FMath::Max<uint32>(GlobalInfo.Settings.ReplicationPeriodFrame, 1);
+
+		float Scale = 1.0f;
+		if (bEnabled && !DamagePartners.Contains(Actor))
+		{
+			const FVector ActorLocation = Actor->GetActorLocation();
+			const float CullDistance = FMath::Max(FMath::Sqrt(ConnectionActorInfo.GetCullDistanceSquared()), 1.0f);
+
+			// Use the most relevant viewer: the closest, and in view if any of them can see it
+			float ClosestDistanceSq = MAX_flt;
+			bool bInView = false;
+			for (const FNetViewer& CurViewer : Params.Viewers)
+			{
+				const FVector ToActor = ActorLocation - CurViewer.ViewLocation;
+				const float DistanceSq = ToActor.SizeSquared();
+				ClosestDistanceSq = FMath::Min(ClosestDistanceSq, DistanceSq);
+				bInView |= (FVector::DotProduct(ToActor.GetSafeNormal(), CurViewer.ViewDir) >= ViewConeCos);
+			}
+
+			if (ClosestDistanceSq > NearDistanceSq)
+			{
+				const float DistanceAlpha = FMath::Clamp(FMath::Sqrt(ClosestDistanceSq) / CullDistance, 0.0f, 1.0f);
+				Scale = FMath::Lerp(1.0f, FMath::Max(Lyra::RepGraph::PawnPrioritizationMaxDistanceScale, 1.0f), DistanceAlpha);
+				if (!bInView)
+				{
+					Scale *= FMath::Max(Lyra::RepGraph::PawnPrioritizationOutOfViewScale, 1.0f);
+				}
+			}
+		}
+
+		const uint32 MaxPeriod = FMath::Max((uint32)FMath::Max(Lyra::RepGraph::PawnPrioritizationMaxPeriodFrames, 1), BasePeriod);
+		const uint32 NewPeriod = FMath::Clamp((uint32)FMath::RoundToInt(BasePeriod * Scale), BasePeriod, MaxPeriod);
+		if (ConnectionActorInfo.ReplicationPeriodFrame != NewPeriod)
+		{
+			ConnectionActorInfo.ReplicationPeriodFrame = NewPeriod;
+
+			// Don't make a pawn that just became relevant wait out its old, longer period
+			ConnectionActorInfo.NextReplicationFrameNum = FMath::Min(ConnectionActorInfo.NextReplicationFrameNum, ConnectionActorInfo.LastRepFrameNum + NewPeriod);
+		}
+
+		if (NewPeriod > BasePeriod)
+		{
+			++NumThrottledPawns;
+		}
+		else
+		{
+			++NumFullRatePawns;
+		}
+	}
+
+	bPeriodsModified = bEnabled;
+}
+
+void ULyraReplicationGraphNode_PawnPrioritization_ForConnection::LogNode(FReplicationGraphDebugInfo& DebugInfo, const FString& NodeName) const
+{
+	DebugInfo.Log(NodeName);
+	DebugInfo.PushIndent();
+	DebugInfo.Log(FString::Printf(TEXT("Pawns at class rate: %d, throttled: %d"), NumFullRatePawns, NumThrottledPawns));
+	DebugInfo.PopIndent();
+}
+
+void ULyraReplicationGraphNode_PawnPrioritization_ForConnection::LogStats(const FString& ConnectionName, int32 OutBytesPerSecond) const
+{
+	const double AverageMicroseconds = (NumUpdates > 0) ? (TotalUpdateSeconds / NumUpdates) * 1.0e6 : 0.0;
+	UE_LOG(LogLyraRepGraph, Display, TEXT("%-40s updates: %6d  avg: %7.2fus  max: %7.2fus  full rate: %3d  throttled: %3d  out: %7d B/s"),
+		*ConnectionName, NumUpdates, AverageMicroseconds, MaxUpdateSeconds * 1.0e6, NumFullRatePawns, NumThrottledPawns, OutBytesPerSecond);
+}
+
+// ------------------------------------------------------------------------------
+
 void ULyraReplicationGraph::PrintRepNodePolicies()
 {
 	UEnum* Enum = StaticEnum<EClassRepNodeMapping>();
@@ -973,6 +1274,31 @@ void ULyraReplicationGraph::PrintRepNodePolicies()
 	}
 }
 
+void ULyraReplicationGraph::PrintPrioritizationStats()
+{
+	for (UNetReplicationGraphConnection* ConnManager : Connections)
+	{
+		for (UReplicationGraphNode* ConnectionNode : ConnManager->GetConnectionGraphNodes())
+		{
+			if (const ULyraReplicationGraphNode_PawnPrioritization_ForConnection* PrioritizationNode = Cast<ULyraReplicationGraphNode_PawnPrioritization_ForConnection>(ConnectionNode))
+			{
+				const UNetConnection* NetConnection = ConnManager->NetConnection;
+				PrioritizationNode->LogStats(ConnManager->GetName(), (NetConnection != nullptr) ? NetConnection->OutBytesPerSecond : 0);
+			}
+		}
+	}
+}
+
+FAutoConsoleCommandWithWorldAndArgs LyraPrintPrioritizationStatsCmd(TEXT("Lyra.RepGraph.PrioritizationStats"), TEXT("Prints the pawn prioritization cost and the outgoing bandwidth of each connection"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		for (TObjectIterator<ULyraReplicationGraph> It; It; ++It)
+		{
+			It->PrintPrioritizationStats();
+		}
+	})
+);
+
 FAutoConsoleCommandWithWorldAndArgs LyraPrintRepNodePoliciesCmd(TEXT("Lyra.RepGraph.PrintRouting"),TEXT("Prints how actor classes are routed to RepGraph nodes"),
 	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
 	{
@@ -7,6 +7,8 @@
 #include "LyraReplicationGraph.generated.h"
 
 class AGameplayDebuggerCategoryReplicator;
+class ULyraHealthComponent;
+class ULyraReplicationGraphNode_PlayerStateFrequencyLimiter;
 
 DECLARE_LOG_CATEGORY_EXTERN(LogLyraRepGraph, Display, All);
 
@@ -26,6 +28,7 @@ public:
 	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
 	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
 	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
 
 	UPROPERTY()
 	TArray<TObjectPtr<UClass>>	AlwaysRelevantClasses;
@@ -36,13 +39,23 @@ public:
 	UPROPERTY()
 	TObjectPtr<UReplicationGraphNode_ActorList> AlwaysRelevantNode;
 
+	UPROPERTY()
+	TObjectPtr<ULyraReplicationGraphNode_PlayerStateFrequencyLimiter> PlayerStateNode;
+
 	TMap<FName, FActorRepListRefView> AlwaysRelevantStreamingLevelActors;
 
+	/** Every replicated Lyra character, used by the per connection pawn prioritization nodes */
+	FActorRepListRefView PrioritizedPawns;
+
+	/** Appends the pawns that recently damaged (or were damaged by) the pawn */
+	void GetRecentDamagePartners(const AActor* Pawn, double Now, TArray<const AActor*, TInlineAllocator<8>>& OutPartners) const;
+
 #if WITH_GAMEPLAY_DEBUGGER
 	void OnGameplayDebuggerOwnerChange(AGameplayDebuggerCategoryReplicator* Debugger, APlayerController* OldOwner);
 #endif
 
 	void PrintRepNodePolicies();
+	void PrintPrioritizationStats();
 
 private:
 	void AddClassRepInfo(UClass* Class, EClassRepNodeMapping Mapping);
@@ -61,6 +74,20 @@ private:
 
 	/** Classes that had their replication settings explictly set by code in ULyraReplicationGraph::InitGlobalActorClassSettings */
 	TArray<UClass*> ExplicitlySetClasses;
+
+	UFUNCTION()
+	void OnPawnHealthChanged(ULyraHealthComponent* HealthComponent, float OldValue, float NewValue, AActor* Instigator);
+
+	struct FRecentDamageInteraction
+	{
+		TWeakObjectPtr<const AActor> Victim;
+		TWeakObjectPtr<const AActor> Instigator;
+		double Time = 0.0;
+	};
+
+	/** Ring buffer of the most recent damage events between pawns */
+	TArray<FRecentDamageInteraction> RecentDamageInteractions;
+	int32 NextRecentDamageInteraction = 0;
 };
 
 UCLASS()
@@ -101,10 +128,13 @@ class ULyraReplicationGraphNode_PlayerStateFrequencyLimiter : public UReplicatio
 {
 	GENERATED_BODY()
 
+public:
 	ULyraReplicationGraphNode_PlayerStateFrequencyLimiter();
 
-	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& Actor) override { }
-	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound=true) override { return false; }
+	/** ULyraReplicationGraph forwards every player state here, regardless of how the class is routed */
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& Actor) override;
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound=true) override;
+	virtual void NotifyResetAllNetworkActors() override;
 
 	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
 
@@ -117,6 +147,47 @@ class ULyraReplicationGraphNode_PlayerStateFrequencyLimiter : public UReplicatio
 
 private:
 	
+	/** All known player states, kept up to date by add/remove notifications */
+	TArray<FActorRepListType> PlayerStates;
+
+	/** The rolling batches are only rebuilt when a player state is added or removed */
+	bool bListsDirty = true;
+
 	TArray<FActorRepListRefView> ReplicationActorLists;
 	FActorRepListRefView ForceNetUpdateReplicationActorList;
+};
+
+/**
+	Per connection node that scales how often pawns replicate to the connection by how relevant they are to its viewers: distance, whether
+	they are in the view cone, and whether they recently damaged (or were damaged by) the viewer's pawn. It doesn't gather any actors
+	itself, it only adjusts the connection's ReplicationPeriodFrame for the pawns the grid gathers.
+*/
+UCLASS()
+class ULyraReplicationGraphNode_PawnPrioritization_ForConnection : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+public:
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& Actor) override { }
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound=true) override { return false; }
+	virtual void NotifyResetAllNetworkActors() override { }
+
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+	virtual void LogNode(FReplicationGraphDebugInfo& DebugInfo, const FString& NodeName) const override;
+
+	void LogStats(const FString& ConnectionName, int32 OutBytesPerSecond) const;
+
+private:
+	void UpdatePawnPeriods(const FConnectionGatherActorListParameters& Params, bool bEnabled);
+
+	/** True if periods were changed from the class defaults (so they can be restored when prioritization is disabled) */
+	bool bPeriodsModified = false;
+
+	/** Stats for Lyra.RepGraph.PrioritizationStats */
+	double TotalUpdateSeconds = 0.0;
+	double MaxUpdateSeconds = 0.0;
+	int32 NumUpdates = 0;
+	int32 NumFullRatePawns = 0;
+	int32 NumThrottledPawns = 0;
 };
\ No newline at end of file
@@ -2,5 +2,421 @@
 
 #include "LyraSignificanceManager.h"
 
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/MovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "LyraLogChannels.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraSignificanceManager)
 
+CSV_DEFINE_CATEGORY(LyraSignificance, true);
+
+namespace LyraConsoleVariables
+{
+	static bool bEnableSignificance = true;
+	static FAutoConsoleVariableRef CVarEnableSignificance(
+		TEXT("Lyra.Significance.Enable"),
+		bEnableSignificance,
+		TEXT("Should registered actors be throttled based on their significance to the local viewers? When disabled everything runs at full rate."),
+		ECVF_Default);
+
+	static float SignificanceHighDistance = 2000.0f;
+	static FAutoConsoleVariableRef CVarSignificanceHighDistance(
+		TEXT("Lyra.Significance.HighDistance"),
+		SignificanceHighDistance,
+		TEXT("Rendered actors closer than this (in cm) to a viewer are in the High bucket"),
+		ECVF_Default);
+
+	static float SignificanceMediumDistance = 5000.0f;
+	static FAutoConsoleVariableRef CVarSignificanceMediumDistance(
+		TEXT("Lyra.Significance.MediumDistance"),
+		SignificanceMediumDistance,
+		TEXT("Rendered actors closer than this (in cm) to a viewer are in the Medium bucket, further ones are Low"),
+		ECVF_Default);
+
+	static float SignificanceMediumTickInterval = 1.0f / 30.0f;
+	static FAutoConsoleVariableRef CVarSignificanceMediumTickInterval(
+		TEXT("Lyra.Significance.TickInterval.Medium"),
+		SignificanceMediumTickInterval,
+		TEXT("Tick interval (in seconds) for actors and meshes in the Medium bucket"),
+		ECVF_Default);
+
+	static float SignificanceLowTickInterval = 1.0f / 10.0f;
+	static FAutoConsoleVariableRef CVarSignificanceLowTickInterval(
+		TEXT("Lyra.Significance.TickInterval.Low"),
+		SignificanceLowTickInterval,
+		TEXT("Tick interval (in seconds) for actors and meshes in the Low bucket"),
+		ECVF_Default);
+
+	static float SignificanceCulledTickInterval = 1.0f / 4.0f;
+	static FAutoConsoleVariableRef CVarSignificanceCulledTickInterval(
+		TEXT("Lyra.Significance.TickInterval.Culled"),
+		SignificanceCulledTickInterval,
+		TEXT("Tick interval (in seconds) for actors and meshes in the Culled bucket"),
+		ECVF_Default);
+
+	static int32 ContextEffectMinBucket = (int32)ELyraSignificanceBucket::Medium;
+	static FAutoConsoleVariableRef CVarContextEffectMinBucket(
+		TEXT("Lyra.Significance.ContextEffectMinBucket"),
+		ContextEffectMinBucket,
+		TEXT("Context effects (footsteps, etc.) are only spawned for actors in this bucket or above (0=Culled, 1=Low, 2=Medium, 3=High, 4=Highest)"),
+		ECVF_Default);
+
+	static int32 NumberPopMinBucket = (int32)ELyraSignificanceBucket::Low;
+	static FAutoConsoleVariableRef CVarNumberPopMinBucket(
+		TEXT("Lyra.Significance.NumberPopMinBucket"),
+		NumberPopMinBucket,
+		TEXT("Number pops are only shown at locations in this bucket or above (0=Culled, 1=Low, 2=Medium, 3=High, 4=Highest)"),
+		ECVF_Default);
+
+	static float GetTickIntervalForBucket(ELyraSignificanceBucket Bucket)
+	{
+		switch (Bucket)
+		{
+		case ELyraSignificanceBucket::Culled:
+			return SignificanceCulledTickInterval;
+		case ELyraSignificanceBucket::Low:
+			return SignificanceLowTickInterval;
+		case ELyraSignificanceBucket::Medium:
+			return SignificanceMediumTickInterval;
+		default:
+			return 0.0f;
+		}
+	}
+}
+
+static FAutoConsoleCommandWithWorld GLyraSignificanceStatsCmd(
+	TEXT("Lyra.Significance.Stats"),
+	TEXT("Prints how many registered actors are in each significance bucket"),
+	FConsoleCommandWithWorldDelegate::CreateStatic([](UWorld* World)
+	{
+		const ULyraSignificanceManager* SignificanceManager = USignificanceManager::Get<ULyraSignificanceManager>(World);
+		if (SignificanceManager == nullptr)
+		{
+			UE_LOG(LogLyra, Display, TEXT("No significance manager in this world"));
+			return;
+		}
+
+		const UEnum* BucketEnum = StaticEnum<ELyraSignificanceBucket>();
+		for (int32 Bucket = 0; Bucket < (int32)ELyraSignificanceBucket::Count; ++Bucket)
+		{
+			UE_LOG(LogLyra, Display, TEXT("%-8s %d"), *BucketEnum->GetNameStringByValue(Bucket), SignificanceManager->GetNumInBucket((ELyraSignificanceBucket)Bucket));
+		}
+	}));
+
+//////////////////////////////////////////////////////////////////////
+
+const FName ULyraSignificanceManager::PawnTag(TEXT("LyraPawn"));
+const FName ULyraSignificanceManager::CosmeticTag(TEXT("LyraCosmetic"));
+
+void ULyraSignificanceManager::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	if (!HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject))
+	{
+		PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &ThisClass::OnWorldPostActorTick);
+	}
+}
+
+void ULyraSignificanceManager::BeginDestroy()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	PostActorTickHandle.Reset();
+
+	Super::BeginDestroy();
+}
+
+void ULyraSignificanceManager::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if ((World != GetWorld()) || !World->IsGameWorld())
+	{
+		return;
+	}
+
+	if (!LyraConsoleVariables::bEnableSignificance)
+	{
+		if (bWasEnabled)
+		{
+			RestoreAll();
+			bWasEnabled = false;
+		}
+		return;
+	}
+	bWasEnabled = true;
+
+	// Every local player is a viewer, an actor gets the best bucket of any of them
+	TArray<FTransform, TInlineAllocator<4>> Viewpoints;
+	for (FConstPlayerControllerIterator Iterator = World->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PC = Iterator->Get();
+		if ((PC != nullptr) && PC->IsLocalController())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PC->GetPlayerViewPoint(/*out*/ ViewLocation, /*out*/ ViewRotation);
+			Viewpoints.Emplace(ViewRotation, ViewLocation);
+		}
+	}
+
+	if (Viewpoints.Num() > 0)
+	{
+		Update(Viewpoints);
+	}
+}
+
+void ULyraSignificanceManager::Update(TArrayView<const FTransform> Viewpoints)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(ULyraSignificanceManager::Update);
+
+	Super::Update(Viewpoints);
+
+	FMemory::Memzero(BucketCounts);
+	for (const TPair<TObjectKey<AActor>, ELyraSignificanceBucket>& Pair : AppliedBuckets)
+	{
+		++BucketCounts[(int32)Pair.Value];
+	}
+
+	CSV_CUSTOM_STAT(LyraSignificance, NumHighest, BucketCounts[(int32)ELyraSignificanceBucket::Highest], ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(LyraSignificance, NumHigh, BucketCounts[(int32)ELyraSignificanceBucket::High], ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(LyraSignificance, NumMedium, BucketCounts[(int32)ELyraSignificanceBucket::Medium], ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(LyraSignificance, NumLow, BucketCounts[(int32)ELyraSignificanceBucket::Low], ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(LyraSignificance, NumCulled, BucketCounts[(int32)ELyraSignificanceBucket::Culled], ECsvCustomStatOp::Set);
+}
+
+void ULyraSignificanceManager::RegisterPawn(AActor* Pawn)
+{
+	RegisterActorWithTag(Pawn, PawnTag);
+}
+
+void ULyraSignificanceManager::RegisterCosmeticActor(AActor* Actor)
+{
+	RegisterActorWithTag(Actor, CosmeticTag);
+}
+
+void ULyraSignificanceManager::RegisterActorWithTag(AActor* Actor, FName Tag)
+{
+	if (Actor == nullptr)
+	{
+		return;
+	}
+
+	const bool bCosmetic = (Tag == CosmeticTag);
+
+	// Runs in parallel for all registered objects, so it must only read from the actor
+	auto SignificanceFunction = [bCosmetic](USignificanceManager::FManagedObjectInfo* ObjectInfo, const FTransform& Viewpoint) -> float
+	{
+		const AActor* Actor = CastChecked<AActor>(ObjectInfo->GetObject());
+		return (float)CalculateBucket(Actor, Actor->GetActorLocation(), Actor->WasRecentlyRendered(0.2f), Viewpoint, bCosmetic);
+	};
+
+	// Runs on the game thread, only touches the actor when its bucket changes
+	auto PostSignificanceFunction = [this, bCosmetic](USignificanceManager::FManagedObjectInfo* ObjectInfo, float OldSignificance, float Significance, bool bFinal)
+	{
+		AActor* Actor = CastChecked<AActor>(ObjectInfo->GetObject());
+		const bool bRestore = bFinal || !LyraConsoleVariables::bEnableSignificance;
+		const ELyraSignificanceBucket NewBucket = bRestore ? ELyraSignificanceBucket::Highest : (ELyraSignificanceBucket)FMath::Clamp(FMath::RoundToInt(Significance), 0, (int32)ELyraSignificanceBucket::Highest);
+
+		ELyraSignificanceBucket& AppliedBucket = AppliedBuckets.FindOrAdd(Actor, ELyraSignificanceBucket::Highest);
+		if (AppliedBucket != NewBucket)
+		{
+			AppliedBucket = NewBucket;
+			ApplyBucket(Actor, NewBucket, bCosmetic);
+		}
+	};
+
+	AppliedBuckets.Add(Actor, ELyraSignificanceBucket::Highest);
+	RegisterObject(Actor, Tag, SignificanceFunction, USignificanceManager::EPostSignificanceType::Sequential, PostSignificanceFunction);
+}
+
+void ULyraSignificanceManager::UnregisterActor(AActor* Actor)
+{
+	if (Actor == nullptr)
+	{
+		return;
+	}
+
+	// Unregistering calls the post significance function with bFinal set, which restores the actor to full rate
+	UnregisterObject(Actor);
+	AppliedBuckets.Remove(Actor);
+}
+
+void ULyraSignificanceManager::RestoreAll()
+{
+	for (TPair<TObjectKey<AActor>, ELyraSignificanceBucket>& Pair : AppliedBuckets)
+	{
+		if (Pair.Value != ELyraSignificanceBucket::Highest)
+		{
+			if (AActor* Actor = Pair.Key.ResolveObjectPtr())
+			{
+				const FManagedObjectInfo* ObjectInfo = GetManagedObject(Actor);
+				ApplyBucket(Actor, ELyraSignificanceBucket::Highest, (ObjectInfo != nullptr) && (ObjectInfo->GetTag() == CosmeticTag));
+			}
+			Pair.Value = ELyraSignificanceBucket::Highest;
+		}
+	}
+
+	FMemory::Memzero(BucketCounts);
+}
+
+ELyraSignificanceBucket ULyraSignificanceManager::CalculateBucket(const AActor* Actor, const FVector& Location, bool bRecentlyRendered, const FTransform& Viewpoint, bool bCosmetic)
+{
+	// Never throttle what the local players are controlling (bots on a listen server are locally controlled too, but not player controlled)
+	if (const APawn* Pawn = Cast<APawn>(Actor))
+	{
+		if (Pawn->IsLocallyControlled() && Pawn->IsPlayerControlled())
+		{
+			return ELyraSignificanceBucket::Highest;
+		}
+	}
+
+	const float DistanceSq = FVector::DistSquared(Location, Viewpoint.GetLocation());
+
+	if (!bRecentlyRendered)
+	{
+		// Keep nearby pawns that are just off screen animating so they don't pop when the camera turns
+		const bool bNearby = (DistanceSq <= FMath::Square(LyraConsoleVariables::SignificanceHighDistance));
+		return (bNearby && !bCosmetic) ? ELyraSignificanceBucket::Medium : ELyraSignificanceBucket::Culled;
+	}
+
+	if (DistanceSq <= FMath::Square(LyraConsoleVariables::SignificanceHighDistance))
+	{
+		return ELyraSignificanceBucket::High;
+	}
+	if (DistanceSq <= FMath::Square(LyraConsoleVariables::SignificanceMediumDistance))
+	{
+		return ELyraSignificanceBucket::Medium;
+	}
+	return ELyraSignificanceBucket::Low;
+}
+
+void ULyraSignificanceManager::ApplyBucket(AActor* Actor, ELyraSignificanceBucket Bucket, bool bCosmetic)
+{
+	// On the authority (e.g., the pawns of a listen server host) the pose and movement feed gameplay such as hit validation,
+	// so only the attached cosmetic actors follow the bucket there
+	if (bCosmetic || !Actor->HasAuthority())
+	{
+		// Movement of simulated proxies is only smoothing, the owning client always ticks it at full rate
+		const bool bIncludeMovement = bCosmetic || (Actor->GetLocalRole() == ROLE_SimulatedProxy);
+		ApplyBucketToActor(Actor, Bucket, bCosmetic, bIncludeMovement);
+	}
+
+	// Weapons and other cosmetic actors attached to the pawn follow its bucket
+	TArray<AActor*> AttachedActors;
+	Actor->GetAttachedActors(/*out*/ AttachedActors, /*bResetArray=*/ true, /*bRecursivelyIncludeAttachedActors=*/ true);
+	for (AActor* AttachedActor : AttachedActors)
+	{
+		ApplyBucketToActor(AttachedActor, Bucket, /*bCosmetic=*/ true, /*bIncludeMovement=*/ false);
+	}
+}
+
+void ULyraSignificanceManager::ApplyBucketToActor(AActor* Actor, ELyraSignificanceBucket Bucket, bool bCosmetic, bool bIncludeMovement)
+{
+	const float TickInterval = LyraConsoleVariables::GetTickIntervalForBucket(Bucket);
+
+	// Never go below the interval the actor or component was authored with
+	if (Actor->PrimaryActorTick.bCanEverTick)
+	{
+		const AActor* DefaultActor = Actor->GetClass()->GetDefaultObject<AActor>();
+		Actor->SetActorTickInterval(FMath::Max(DefaultActor->PrimaryActorTick.TickInterval, TickInterval));
+	}
+
+	TInlineComponentArray<UActorComponent*> Components(Actor);
+	for (UActorComponent* Component : Components)
+	{
+		if (!Component->PrimaryComponentTick.bCanEverTick)
+		{
+			continue;
+		}
+
+		USkeletalMeshComponent* MeshComponent = Cast<USkeletalMeshComponent>(Component);
+		const bool bIsMovement = Component->IsA<UMovementComponent>();
+		if ((MeshComponent == nullptr) && !(bIsMovement && bIncludeMovement))
+		{
+			continue;
+		}
+
+		// Movement only slows down once the pawn is hard to see
+		const float ComponentInterval = (bIsMovement && (Bucket > ELyraSignificanceBucket::Low)) ? 0.0f : TickInterval;
+
+		const UActorComponent* Archetype = Cast<UActorComponent>(Component->GetArchetype());
+		const float DefaultInterval = (Archetype != nullptr) ? Archetype->PrimaryComponentTick.TickInterval : 0.0f;
+		Component->SetComponentTickInterval(FMath::Max(DefaultInterval, ComponentInterval));
+
+		if (MeshComponent != nullptr)
+		{
+			const USkeletalMeshComponent* MeshArchetype = Cast<USkeletalMeshComponent>(Archetype);
+			EVisibilityBasedAnimTickOption TickOption = (MeshArchetype != nullptr) ? MeshArchetype->VisibilityBasedAnimTickOption : EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+			if (Bucket == ELyraSignificanceBucket::Culled)
+			{
+				TickOption = FMath::Max(TickOption, EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered);
+			}
+			else if (Bucket == ELyraSignificanceBucket::Low)
+			{
+				TickOption = FMath::Max(TickOption, EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered);
+			}
+			MeshComponent->VisibilityBasedAnimTickOption = TickOption;
+		}
+	}
+}
+
+ELyraSignificanceBucket ULyraSignificanceManager::GetActorBucket(const AActor* Actor) const
+{
+	// Cosmetic actors that aren't registered themselves (e.g., weapons) use the bucket of what they're attached to
+	for (const AActor* Current = Actor; Current != nullptr; Current = Current->GetAttachParentActor())
+	{
+		if (const ELyraSignificanceBucket* Bucket = AppliedBuckets.Find(Current))
+		{
+			return *Bucket;
+		}
+	}
+
+	return ELyraSignificanceBucket::Highest;
+}
+
+ELyraSignificanceBucket ULyraSignificanceManager::GetLocationBucket(const FVector& Location) const
+{
+	if (!LyraConsoleVariables::bEnableSignificance || (GetViewpoints().Num() == 0))
+	{
+		return ELyraSignificanceBucket::Highest;
+	}
+
+	ELyraSignificanceBucket BestBucket = ELyraSignificanceBucket::Culled;
+	for (const FTransform& Viewpoint : GetViewpoints())
+	{
+		// Treat anything in front of the viewer as on screen
+		const bool bInFront = (FVector::DotProduct(Location - Viewpoint.GetLocation(), Viewpoint.GetRotation().GetForwardVector()) > 0.0);
+		BestBucket = FMath::Max(BestBucket, CalculateBucket(nullptr, Location, bInFront, Viewpoint, /*bCosmetic=*/ true));
+	}
+	return BestBucket;
+}
+
+ELyraSignificanceBucket ULyraSignificanceManager::GetActorBucket(const UWorld* World, const AActor* Actor)
+{
+	const ULyraSignificanceManager* SignificanceManager = USignificanceManager::Get<ULyraSignificanceManager>(World);
+	return (SignificanceManager != nullptr) ? SignificanceManager->GetActorBucket(Actor) : ELyraSignificanceBucket::Highest;
+}
+
+ELyraSignificanceBucket ULyraSignificanceManager::GetLocationBucket(const UWorld* World, const FVector& Location)
+{
+	const ULyraSignificanceManager* SignificanceManager = USignificanceManager::Get<ULyraSignificanceManager>(World);
+	return (SignificanceManager != nullptr) ? SignificanceManager->GetLocationBucket(Location) : ELyraSignificanceBucket::Highest;
+}
+
+bool ULyraSignificanceManager::ShouldSpawnContextEffects(const AActor* Actor)
+{
+	if (Actor == nullptr)
+	{
+		return true;
+	}
+	return (int32)GetActorBucket(Actor->GetWorld(), Actor) >= LyraConsoleVariables::ContextEffectMinBucket;
+}
+
+bool ULyraSignificanceManager::ShouldShowNumberPop(const UWorld* World, const FVector& Location)
+{
+	return (int32)GetLocationBucket(World, Location) >= LyraConsoleVariables::NumberPopMinBucket;
+}
@@ -3,14 +3,103 @@
 #pragma once
 
 #include "SignificanceManager.h"
+#include "UObject/ObjectKey.h"
 
 #include "LyraSignificanceManager.generated.h"
 
+class AActor;
 class UObject;
+class UWorld;
+enum class ELevelTick : uint8;
 
+// How much an actor matters to the local viewers, from least to most
+UENUM(BlueprintType)
+enum class ELyraSignificanceBucket : uint8
+{
+	// Far away and not rendered
+	Culled,
+	Low,
+	Medium,
+	High,
+	// Locally controlled (or significance is disabled)
+	Highest,
+	Count UMETA(Hidden)
+};
+
+/**
+ * ULyraSignificanceManager
+ *
+ *	Buckets registered actors by distance and visibility to all local viewers (split screen included) once per frame.
+ *	Changing bucket adjusts the tick interval and animation tick option of the actor (and the cosmetic actors attached
+ *	to it, such as weapons), and the bucket is used to skip context effects and number pops nobody will notice.
+ *	Only created on clients, dedicated servers don't register anything.
+ */
 UCLASS()
 class ULyraSignificanceManager : public USignificanceManager
 {
 	GENERATED_BODY()
 
+public:
+	static const FName PawnTag;
+	static const FName CosmeticTag;
+
+	//~UObject interface
+	virtual void PostInitProperties() override;
+	virtual void BeginDestroy() override;
+	//~End of UObject interface
+
+	//~USignificanceManager interface
+	virtual void Update(TArrayView<const FTransform> Viewpoints) override;
+	//~End of USignificanceManager interface
+
+	// Registers a pawn (tick and animation are throttled, including attached actors)
+	UFUNCTION(BlueprintCallable, Category = "Lyra|Significance")
+	void RegisterPawn(AActor* Pawn);
+
+	// Registers a purely cosmetic actor (e.g., crowd NPCs or ambient props), which can be throttled harder than pawns
+	UFUNCTION(BlueprintCallable, Category = "Lyra|Significance")
+	void RegisterCosmeticActor(AActor* Actor);
+
+	UFUNCTION(BlueprintCallable, Category = "Lyra|Significance")
+	void UnregisterActor(AActor* Actor);
+
+	// Returns the bucket of the actor, or of the closest registered actor it is attached to (Highest if there is none)
+	ELyraSignificanceBucket GetActorBucket(const AActor* Actor) const;
+
+	// Returns the bucket an unregistered actor at this location would be in (assuming it is rendered if on screen)
+	ELyraSignificanceBucket GetLocationBucket(const FVector& Location) const;
+
+	// Helpers that return Highest when there is no significance manager
+	static ELyraSignificanceBucket GetActorBucket(const UWorld* World, const AActor* Actor);
+	static ELyraSignificanceBucket GetLocationBucket(const UWorld* World, const FVector& Location);
+
+	// Returns true if context effects for this actor should be spawned
+	static bool ShouldSpawnContextEffects(const AActor* Actor);
+
+	// Returns true if a number pop at this location should be shown
+	static bool ShouldShowNumberPop(const UWorld* World, const FVector& Location);
+
+	int32 GetNumInBucket(ELyraSignificanceBucket Bucket) const { return BucketCounts[(int32)Bucket]; }
+
+private:
+	void RegisterActorWithTag(AActor* Actor, FName Tag);
+
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	// Restores every registered actor to full rate (when significance is disabled)
+	void RestoreAll();
+
+	static ELyraSignificanceBucket CalculateBucket(const AActor* Actor, const FVector& Location, bool bRecentlyRendered, const FTransform& Viewpoint, bool bCosmetic);
+	static void ApplyBucket(AActor* Actor, ELyraSignificanceBucket Bucket, bool bCosmetic);
+	static void ApplyBucketToActor(AActor* Actor, ELyraSignificanceBucket Bucket, bool bCosmetic, bool bIncludeMovement);
+
+private:
+	FDelegateHandle PostActorTickHandle;
+
+	// The bucket last applied to each registered actor
+	TMap<TObjectKey<AActor>, ELyraSignificanceBucket> AppliedBuckets;
+
+	int32 BucketCounts[(int32)ELyraSignificanceBucket::Count] = {};
+
+	bool bWasEnabled = true;
 };
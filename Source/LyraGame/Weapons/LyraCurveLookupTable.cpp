@@ -0,0 +1,45 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "LyraCurveLookupTable.h"
+
+#include "Curves/RichCurve.h"
+
+bool FLyraCurveLookupTable::Bake(const FRichCurve& Curve, int32 NumSamples)
+{
+	Reset();
+
+	if (!Curve.HasAnyData() || (Curve.PreInfinityExtrap != RCCE_Constant) || (Curve.PostInfinityExtrap != RCCE_Constant))
+	{
+		return false;
+	}
+
+	float MaxTime = 0.0f;
+	Curve.GetTimeRange(/*out*/ MinTime, /*out*/ MaxTime);
+
+	const float TimeRange = MaxTime - MinTime;
+	if (TimeRange <= UE_SMALL_NUMBER)
+	{
+		// A single key (or keys stacked on the same time) is a constant
+		Samples.Add(Curve.Eval(MinTime));
+		return true;
+	}
+
+	NumSamples = FMath::Max(NumSamples, 2);
+	const float SampleSpacing = TimeRange / (float)(NumSamples - 1);
+	InvSampleSpacing = 1.0f / SampleSpacing;
+
+	Samples.SetNumUninitialized(NumSamples);
+	for (int32 SampleIndex = 0; SampleIndex < NumSamples; ++SampleIndex)
+	{
+		Samples[SampleIndex] = Curve.Eval(MinTime + SampleSpacing * (float)SampleIndex);
+	}
+
+	return true;
+}
+
+void FLyraCurveLookupTable::Reset()
+{
+	Samples.Reset();
+	MinTime = 0.0f;
+	InvSampleSpacing = 0.0f;
+}
@@ -0,0 +1,51 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Containers/Array.h"
+#include "Math/UnrealMathUtility.h"
+
+struct FRichCurve;
+
+/**
+ * FLyraCurveLookupTable
+ *
+ *	A float curve sampled at evenly spaced times over its key range, evaluated with a linear blend between the two
+ *	closest samples instead of searching the keys and evaluating the tangents.
+ *	Only curves with constant extrapolation can be baked (outside the key range they hold the first or last value).
+ */
+struct LYRAGAME_API FLyraCurveLookupTable
+{
+public:
+	// Samples the curve, returns false (leaving the table empty) if it has no keys or does not use constant extrapolation
+	bool Bake(const FRichCurve& Curve, int32 NumSamples);
+
+	void Reset();
+
+	bool IsBaked() const { return Samples.Num() > 0; }
+
+	float Eval(float Time) const
+	{
+		checkSlow(IsBaked());
+
+		const float Position = (Time - MinTime) * InvSampleSpacing;
+		if (!(Position > 0.0f))
+		{
+			return Samples[0];
+		}
+
+		const int32 LastIndex = Samples.Num() - 1;
+		const int32 Index = FMath::FloorToInt32(Position);
+		if (Index >= LastIndex)
+		{
+			return Samples[LastIndex];
+		}
+
+		return FMath::Lerp(Samples[Index], Samples[Index + 1], Position - (float)Index);
+	}
+
+private:
+	TArray<float> Samples;
+	float MinTime = 0.0f;
+	float InvSampleSpacing = 0.0f;
+};
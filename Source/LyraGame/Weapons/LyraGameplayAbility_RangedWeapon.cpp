@@ -6,13 +6,18 @@
 #include "LyraLogChannels.h"
 #include "AIController.h"
 #include "NativeGameplayTags.h"
+#include "Weapons/LyraLagCompensationSubsystem.h"
 #include "Weapons/LyraWeaponStateComponent.h"
 #include "AbilitySystemComponent.h"
 #include "AbilitySystem/LyraGameplayAbilityTargetData_SingleTargetHit.h"
 #include "DrawDebugHelpers.h"
+#include "Engine/OverlapResult.h"
+#include "ProfilingDebugging/CsvProfiler.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraGameplayAbility_RangedWeapon)
 
+CSV_DEFINE_CATEGORY(LyraWeapon, true);
+
 namespace LyraConsoleVariables
 {
 	static float DrawBulletTracesDuration = 0.0f;
@@ -35,6 +40,20 @@ namespace LyraConsoleVariables
 		DrawBulletHitRadius,
 		TEXT("When bullet hit debug drawing is enabled (see DrawBulletHitDuration), how big should the hit radius be? (in uu)"),
 		ECVF_Default);
+
+	static bool bCullCartridgeSweeps = true;
+	static FAutoConsoleVariableRef CVarCullCartridgeSweeps(
+		TEXT("lyra.Weapon.CullCartridgeSweeps"),
+		bCullCartridgeSweeps,
+		TEXT("Should multi-bullet cartridges use a single broad-phase query to skip sweep traces for bullets that cannot reach a pawn?"),
+		ECVF_Default);
+
+	static float MaxTraceStartDistance = 300.0f;
+	static FAutoConsoleVariableRef CVarMaxTraceStartDistance(
+		TEXT("lyra.Weapon.LagCompensation.MaxTraceStartDistance"),
+		MaxTraceStartDistance,
+		TEXT("How far (in uu) a client-reported trace start may be from the shooter on the server before all of its pawn hits are rejected"),
+		ECVF_Default);
 }
 
 // Weapon fire will be blocked/canceled if the player has this tag
@@ -43,6 +62,20 @@ UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_WeaponFireBlocked, "Ability.Weapon.NoFiring");
 //////////////////////////////////////////////////////////////////////
 
 FVector VRandConeNormalDistribution(const FVector& Dir, const float ConeHalfAngleRad, const float Exponent)
+{
+	if (ConeHalfAngleRad > 0.f)
+	{
+		const float FromCenterAlpha = FMath::FRand();
+		const float AroundAlpha = FMath::FRand();
+		return ULyraGameplayAbility_RangedWeapon::GetBulletDirectionInCone(Dir, ConeHalfAngleRad, Exponent, FromCenterAlpha, AroundAlpha);
+	}
+	else
+	{
+		return Dir.GetSafeNormal();
+	}
+}
+
+FVector ULyraGameplayAbility_RangedWeapon::GetBulletDirectionInCone(const FVector& Dir, float ConeHalfAngleRad, float Exponent, float FromCenterAlpha, float AroundAlpha)
 {
 	if (ConeHalfAngleRad > 0.f)
 	{
@@ -50,9 +83,9 @@ FVector VRandConeNormalDistribution(const FVector& Dir, const float ConeHalfAngl
 
 		// consider the cone a concatenation of two rotations. one "away" from the center line, and another "around" the circle
 		// apply the exponent to the away-from-center rotation. a larger exponent will cluster points more tightly around the center
-		const float FromCenter = FMath::Pow(FMath::FRand(), Exponent);
+		const float FromCenter = FMath::Pow(FromCenterAlpha, Exponent);
 		const float AngleFromCenter = FromCenter * ConeHalfAngleDegrees;
-		const float AngleAround = FMath::FRand() * 360.0f;
+		const float AngleAround = AroundAlpha * 360.0f;
 
 		FRotator Rot = Dir.Rotation();
 		FQuat DirQuat(Rot);
@@ -142,8 +175,10 @@ ECollisionChannel ULyraGameplayAbility_RangedWeapon::DetermineTraceChannel(FColl
 
 FHitResult ULyraGameplayAbility_RangedWeapon::WeaponTrace(const FVector& StartTrace, const FVector& EndTrace, float SweepRadius, bool bIsSimulated, OUT TArray<FHitResult>& OutHitResults) const
 {
-	TArray<FHitResult> HitResults;
-	
+	TArray<FHitResult>& HitResults = ScratchHitResults;
+	HitResults.Reset();
+	++NumSceneQueriesThisCartridge;
+
 	FCollisionQueryParams TraceParams(SCENE_QUERY_STAT(WeaponTrace), /*bTraceComplex=*/ true, /*IgnoreActor=*/ GetAvatarActorFromActorInfo());
 	TraceParams.bReturnPhysicalMaterial = true;
 	AddAdditionalTraceIgnoreActors(TraceParams);
@@ -379,29 +414,92 @@ void ULyraGameplayAbility_RangedWeapon::PerformLocalTargeting(OUT TArray<FHitRes
 	}
 }
 
+void ULyraGameplayAbility_RangedWeapon::GatherCandidatePawnBounds(const FVector& StartTrace, TArrayView<const FVector> EndTraces, float SweepRadius, OUT TArray<FBoxSphereBounds>& OutCandidateBounds) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(ULyraGameplayAbility_RangedWeapon::GatherCandidatePawnBounds);
+
+	FBox CartridgeBounds(StartTrace, StartTrace);
+	for (const FVector& EndTrace : EndTraces)
+	{
+		CartridgeBounds += EndTrace;
+	}
+	CartridgeBounds = CartridgeBounds.ExpandBy(SweepRadius);
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(WeaponCartridgeBroadPhase), /*bTraceComplex=*/ false, /*IgnoreActor=*/ GetAvatarActorFromActorInfo());
+	AddAdditionalTraceIgnoreActors(QueryParams);
+
+	TArray<FOverlapResult> Overlaps;
+	++NumSceneQueriesThisCartridge;
+	GetWorld()->OverlapMultiByObjectType(Overlaps, CartridgeBounds.GetCenter(), FQuat::Identity, FCollisionObjectQueryParams(ECC_Pawn), FCollisionShape::MakeBox(CartridgeBounds.GetExtent()), QueryParams);
+
+	for (const FOverlapResult& Overlap : Overlaps)
+	{
+		if (const UPrimitiveComponent* Component = Overlap.GetComponent())
+		{
+			OutCandidateBounds.Add(Component->Bounds);
+		}
+	}
+}
+
 void ULyraGameplayAbility_RangedWeapon::TraceBulletsInCartridge(const FRangedWeaponFiringInput& InputData, OUT TArray<FHitResult>& OutHits)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(ULyraGameplayAbility_RangedWeapon::TraceBulletsInCartridge);
+
 	ULyraRangedWeaponInstance* WeaponData = InputData.WeaponData;
 	check(WeaponData);
 
+	NumSceneQueriesThisCartridge = 0;
+
 	const int32 BulletsPerCartridge = WeaponData->GetBulletsPerCartridge();
+	const float SweepRadius = WeaponData->GetBulletTraceSweepRadius();
 
-	for (int32 BulletIndex = 0; BulletIndex < BulletsPerCartridge; ++BulletIndex)
-	{
-		const float BaseSpreadAngle = WeaponData->GetCalculatedSpreadAngle();
-		const float SpreadAngleMultiplier = WeaponData->GetCalculatedSpreadAngleMultiplier();
-		const float ActualSpreadAngle = BaseSpreadAngle * SpreadAngleMultiplier;
+	const float BaseSpreadAngle = WeaponData->GetCalculatedSpreadAngle();
+	const float SpreadAngleMultiplier = WeaponData->GetCalculatedSpreadAngleMultiplier();
+	const float ActualSpreadAngle = BaseSpreadAngle * SpreadAngleMultiplier;
 
-		const float HalfSpreadAngleInRadians = FMath::DegreesToRadians(ActualSpreadAngle * 0.5f);
+	const float HalfSpreadAngleInRadians = FMath::DegreesToRadians(ActualSpreadAngle * 0.5f);
 
+	// Work out where every bullet is going first, so the whole cartridge can be culled with a single query
+	TArray<FVector, TInlineAllocator<16>> EndTraces;
+	EndTraces.Reserve(BulletsPerCartridge);
+	for (int32 BulletIndex = 0; BulletIndex < BulletsPerCartridge; ++BulletIndex)
+	{
 		const FVector BulletDir = VRandConeNormalDistribution(InputData.AimDir, HalfSpreadAngleInRadians, WeaponData->GetSpreadExponent());
+		EndTraces.Add(InputData.StartTrace + (BulletDir * WeaponData->GetMaxDamageRange()));
+	}
+
+	// Sweeps only matter for finding pawns, so bullets that cannot pass near one skip them. The pawns hit are the same either way,
+	// but the world impact of a culled bullet comes from its line trace instead of the sweep, so it sits on the bullet's path (up
+	// to the sweep radius further along than the sphere's first contact), and a sweep that would only have grazed geometry is a miss.
+	const bool bCullSweeps = LyraConsoleVariables::bCullCartridgeSweeps && (SweepRadius > 0.0f) && (BulletsPerCartridge > 1);
+	TArray<FBoxSphereBounds> CandidatePawnBounds;
+	if (bCullSweeps)
+	{
+		GatherCandidatePawnBounds(InputData.StartTrace, EndTraces, SweepRadius, /*out*/ CandidatePawnBounds);
+	}
 
-		const FVector EndTrace = InputData.StartTrace + (BulletDir * WeaponData->GetMaxDamageRange());
+	TArray<FHitResult> AllImpacts;
+	for (const FVector& EndTrace : EndTraces)
+	{
 		FVector HitLocation = EndTrace;
 
-		TArray<FHitResult> AllImpacts;
+		float BulletSweepRadius = SweepRadius;
+		if (bCullSweeps)
+		{
+			const bool bPassesNearPawn = CandidatePawnBounds.ContainsByPredicate([&InputData, &EndTrace, SweepRadius](const FBoxSphereBounds& Bounds)
+			{
+				return FMath::PointDistToSegmentSquared(Bounds.Origin, InputData.StartTrace, EndTrace) <= FMath::Square(Bounds.SphereRadius + SweepRadius);
+			});
 
-		FHitResult Impact = DoSingleBulletTrace(InputData.StartTrace, EndTrace, WeaponData->GetBulletTraceSweepRadius(), /*bIsSimulated=*/ false, /*out*/ AllImpacts);
+			if (!bPassesNearPawn)
+			{
+				BulletSweepRadius = 0.0f;
+			}
+		}
+
+		AllImpacts.Reset();
+
+		FHitResult Impact = DoSingleBulletTrace(InputData.StartTrace, EndTrace, BulletSweepRadius, /*bIsSimulated=*/ false, /*out*/ AllImpacts);
 
 		const AActor* HitActor = Impact.GetActor();
 
@@ -435,6 +533,9 @@ void ULyraGameplayAbility_RangedWeapon::TraceBulletsInCartridge(const FRangedWea
 			OutHits.Add(Impact);
 		}
 	}
+
+	CSV_CUSTOM_STAT(LyraWeapon, SceneQueriesPerCartridge, NumSceneQueriesThisCartridge, ECsvCustomStatOp::Accumulate);
+	UE_LOG(LogLyraAbilitySystem, VeryVerbose, TEXT("%s traced %d bullets with %d scene queries"), *GetName(), BulletsPerCartridge, NumSceneQueriesThisCartridge);
 }
 
 void ULyraGameplayAbility_RangedWeapon::ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData)
@@ -503,6 +604,12 @@ void ULyraGameplayAbility_RangedWeapon::OnTargetDataReadyCallback(const FGamepla
 			{
 				if (Controller->GetLocalRole() == ROLE_Authority)
 				{
+					// Check remote clients' hits against where the targets were when they fired
+					if (!Controller->IsLocalController())
+					{
+						ValidateTargetDataOnServer(Controller, LocalTargetDataHandle);
+					}
+
 					// Confirm hit markers
 					if (ULyraWeaponStateComponent* WeaponStateComponent = Controller->FindComponentByClass<ULyraWeaponStateComponent>())
 					{
@@ -518,7 +625,7 @@ void ULyraGameplayAbility_RangedWeapon::OnTargetDataReadyCallback(const FGamepla
 							}
 						}
 
-						WeaponStateComponent->ClientConfirmTargetData(LocalTargetDataHandle.UniqueId, bIsTargetDataValid, HitReplaces);
+						WeaponStateComponent->ConfirmServerSideHitMarkers(LocalTargetDataHandle.UniqueId, bIsTargetDataValid, HitReplaces);
 					}
 
 				}
@@ -549,6 +656,81 @@ void ULyraGameplayAbility_RangedWeapon::OnTargetDataReadyCallback(const FGamepla
 	MyAbilityComponent->ConsumeClientReplicatedTargetData(CurrentSpecHandle, CurrentActivationInfo.GetActivationPredictionKey());
 }
 
+void ULyraGameplayAbility_RangedWeapon::ValidateTargetDataOnServer(const AController* Shooter, FGameplayAbilityTargetDataHandle& TargetData) const
+{
+	const ULyraLagCompensationSubsystem* LagCompensation = UWorld::GetSubsystem<ULyraLagCompensationSubsystem>(GetWorld());
+	const ULyraRangedWeaponInstance* WeaponData = GetWeaponInstance();
+	const AActor* AvatarActor = GetAvatarActorFromActorInfo();
+	if ((LagCompensation == nullptr) || (WeaponData == nullptr) || (AvatarActor == nullptr))
+	{
+		return;
+	}
+
+	auto GetHitPawn = [](const FHitResult& Hit) -> const APawn*
+	{
+		AActor* HitActor = Hit.HitObjectHandle.FetchActor();
+		if (const APawn* HitPawn = Cast<APawn>(HitActor))
+		{
+			return HitPawn;
+		}
+		return (HitActor != nullptr) ? Cast<APawn>(HitActor->GetAttachParentActor()) : nullptr;
+	};
+
+	const double ViewTime = LagCompensation->EstimateViewTime(Shooter);
+	const FVector ShooterLocation = AvatarActor->GetActorLocation();
+
+	for (int32 Index = 0; Index < TargetData.Num(); ++Index)
+	{
+		FGameplayAbilityTargetData_SingleTargetHit* SingleTargetHit = static_cast<FGameplayAbilityTargetData_SingleTargetHit*>(TargetData.Get(Index));
+		if ((SingleTargetHit == nullptr) || SingleTargetHit->bHitReplaced)
+		{
+			continue;
+		}
+
+		FHitResult& Hit = SingleTargetHit->HitResult;
+		const APawn* HitPawn = GetHitPawn(Hit);
+		if ((HitPawn == nullptr) || (HitPawn == AvatarActor))
+		{
+			continue;
+		}
+
+		bool bRejected = FVector::DistSquared(Hit.TraceStart, ShooterLocation) > FMath::Square(LyraConsoleVariables::MaxTraceStartDistance);
+		if (!bRejected)
+		{
+			bRejected = (LagCompensation->ValidateHit(HitPawn, Hit, ViewTime, WeaponData->GetBulletTraceSweepRadius()) == ELyraHitValidationResult::Rejected);
+		}
+
+		if (bRejected)
+		{
+			// Re-trace the bullet against the present world and keep whatever it would have hit other than a pawn,
+			// so impacts still land on geometry but no damage is applied to the claimed target
+			TArray<FHitResult> WorldHits;
+			DoSingleBulletTrace(Hit.TraceStart, Hit.TraceEnd, /*SweepRadius=*/ 0.0f, /*bIsSimulated=*/ false, /*out*/ WorldHits);
+
+			const FHitResult* WorldImpact = WorldHits.FindByPredicate([&GetHitPawn](const FHitResult& Other)
+			{
+				return Other.bBlockingHit && (GetHitPawn(Other) == nullptr);
+			});
+
+			FHitResult ReplacementHit(ForceInit);
+			if (WorldImpact != nullptr)
+			{
+				ReplacementHit = *WorldImpact;
+			}
+			else
+			{
+				ReplacementHit.TraceStart = Hit.TraceStart;
+				ReplacementHit.TraceEnd = Hit.TraceEnd;
+				ReplacementHit.Location = Hit.TraceEnd;
+				ReplacementHit.ImpactPoint = Hit.TraceEnd;
+			}
+
+			Hit = ReplacementHit;
+			SingleTargetHit->bHitReplaced = true;
+		}
+	}
+}
+
 void ULyraGameplayAbility_RangedWeapon::StartRangedWeaponTargeting()
 {
 	check(CurrentActorInfo);
@@ -570,7 +752,7 @@ void ULyraGameplayAbility_RangedWeapon::StartRangedWeaponTargeting()
 
 	// Fill out the target data from the hit results
 	FGameplayAbilityTargetDataHandle TargetData;
-	TargetData.UniqueId = WeaponStateComponent ? WeaponStateComponent->GetUnconfirmedServerSideHitMarkerCount() : 0;
+	TargetData.UniqueId = WeaponStateComponent ? WeaponStateComponent->AllocateHitMarkerSequenceId() : 0;
 
 	if (FoundHits.Num() > 0)
 	{
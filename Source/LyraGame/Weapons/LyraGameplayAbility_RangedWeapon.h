@@ -8,12 +8,14 @@
 
 enum ECollisionChannel : int;
 
+class AController;
 class APawn;
 class ULyraRangedWeaponInstance;
 class UObject;
 struct FCollisionQueryParams;
 struct FFrame;
 struct FGameplayAbilityActorInfo;
+struct FGameplayAbilityTargetDataHandle;
 struct FGameplayEventData;
 struct FGameplayTag;
 struct FGameplayTagContainer;
@@ -61,6 +63,9 @@ public:
 	virtual void EndAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, bool bReplicateEndAbility, bool bWasCancelled) override;
 	//~End of UGameplayAbility interface
 
+	// Returns the direction of a bullet within the spread cone around Dir, given two random values in [0, 1) (one for the distance from the center, one for the angle around it)
+	static FVector GetBulletDirectionInCone(const FVector& Dir, float ConeHalfAngleRad, float Exponent, float FromCenterAlpha, float AroundAlpha);
+
 protected:
 	struct FRangedWeaponFiringInput
 	{
@@ -99,6 +104,9 @@ protected:
 	// Traces all of the bullets in a single cartridge
 	void TraceBulletsInCartridge(const FRangedWeaponFiringInput& InputData, OUT TArray<FHitResult>& OutHits);
 
+	// Does a single broad-phase query over the bounds of all bullet paths in a cartridge, returning the bounds of any pawn shapes that could be hit
+	void GatherCandidatePawnBounds(const FVector& StartTrace, TArrayView<const FVector> EndTraces, float SweepRadius, OUT TArray<FBoxSphereBounds>& OutCandidateBounds) const;
+
 	virtual void AddAdditionalTraceIgnoreActors(FCollisionQueryParams& TraceParams) const;
 
 	// Determine the trace channel to use for the weapon trace(s)
@@ -111,6 +119,9 @@ protected:
 
 	void OnTargetDataReadyCallback(const FGameplayAbilityTargetDataHandle& InData, FGameplayTag ApplicationTag);
 
+	// Checks client-reported pawn hits against the lag compensated hitbox history, replacing any that are rejected
+	void ValidateTargetDataOnServer(const AController* Shooter, FGameplayAbilityTargetDataHandle& TargetData) const;
+
 	UFUNCTION(BlueprintCallable)
 	void StartRangedWeaponTargeting();
 
@@ -120,4 +131,10 @@ protected:
 
 private:
 	FDelegateHandle OnTargetDataReadyCallbackDelegateHandle;
+
+	// Reused by WeaponTrace to avoid allocating a new hit buffer for every query
+	mutable TArray<FHitResult> ScratchHitResults;
+
+	// Number of scene queries issued for the cartridge currently being traced
+	mutable int32 NumSceneQueriesThisCartridge = 0;
 };
@@ -0,0 +1,509 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "LyraLagCompensationSubsystem.h"
+
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "DrawDebugHelpers.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/PlayerState.h"
+#include "LyraLogChannels.h"
+#include "Performance/LyraServerTickBudget.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+#include "PhysicsEngine/SkeletalBodySetup.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LyraLagCompensationSubsystem)
+
+namespace LyraConsoleVariables
+{
+	static bool bEnableLagCompensation = true;
+	static FAutoConsoleVariableRef CVarEnableLagCompensation(
+		TEXT("lyra.Weapon.LagCompensation.Enable"),
+		bEnableLagCompensation,
+		TEXT("Should the server record hitbox history and validate client-reported weapon hits against it?"),
+		ECVF_Default);
+
+	static float MaxRewindTime = 0.5f;
+	static FAutoConsoleVariableRef CVarMaxRewindTime(
+		TEXT("lyra.Weapon.LagCompensation.MaxRewindTime"),
+		MaxRewindTime,
+		TEXT("The furthest back in time (in seconds) the server will rewind hitboxes to validate a hit. The history kept per pawn is sized by MaxHistoryFrames, which should cover this time at the server tick rate."),
+		ECVF_Default);
+
+	static int32 MaxHistoryFrames = 32;
+	static FAutoConsoleVariableRef CVarMaxHistoryFrames(
+		TEXT("lyra.Weapon.LagCompensation.MaxHistoryFrames"),
+		MaxHistoryFrames,
+		TEXT("The number of hitbox snapshots kept per pawn, one per server frame (applies to pawns registered after the change). Rewinds further back than the oldest snapshot use the oldest one."),
+		ECVF_Default);
+
+	static int32 MaxCapsulesPerPawn = 24;
+	static FAutoConsoleVariableRef CVarMaxCapsulesPerPawn(
+		TEXT("lyra.Weapon.LagCompensation.MaxCapsulesPerPawn"),
+		MaxCapsulesPerPawn,
+		TEXT("The maximum number of physics asset shapes recorded per pawn (applies to pawns registered after the change)"),
+		ECVF_Default);
+
+	static float InterpolationDelay = 0.05f;
+	static FAutoConsoleVariableRef CVarInterpolationDelay(
+		TEXT("lyra.Weapon.LagCompensation.InterpolationDelay"),
+		InterpolationDelay,
+		TEXT("Additional time (in seconds) that clients render simulated proxies behind the server, added to the round trip time when rewinding"),
+		ECVF_Default);
+
+	static float HitTolerance = 20.0f;
+	static FAutoConsoleVariableRef CVarHitTolerance(
+		TEXT("lyra.Weapon.LagCompensation.HitTolerance"),
+		HitTolerance,
+		TEXT("How far (in uu) a reported hit may miss the rewound hitboxes and still be accepted"),
+		ECVF_Default);
+
+	static float DrawRewoundHitboxDuration = 0.0f;
+	static FAutoConsoleVariableRef CVarDrawRewoundHitboxDuration(
+		TEXT("lyra.Weapon.LagCompensation.DrawRewoundHitboxDuration"),
+		DrawRewoundHitboxDuration,
+		TEXT("Should we do debug drawing for rewound hitboxes when validating hits (if above zero, sets how long (in seconds))"),
+		ECVF_Default);
+}
+
+//////////////////////////////////////////////////////////////////////
+// FLyraRewoundHitbox
+
+void FLyraRewoundHitbox::SetNum(int32 InNumCapsules)
+{
+	NumCapsules = InNumCapsules;
+	StartX.SetNumUninitialized(NumCapsules, /*bAllowShrinking=*/ false);
+	StartY.SetNumUninitialized(NumCapsules, /*bAllowShrinking=*/ false);
+	StartZ.SetNumUninitialized(NumCapsules, /*bAllowShrinking=*/ false);
+	EndX.SetNumUninitialized(NumCapsules, /*bAllowShrinking=*/ false);
+	EndY.SetNumUninitialized(NumCapsules, /*bAllowShrinking=*/ false);
+	EndZ.SetNumUninitialized(NumCapsules, /*bAllowShrinking=*/ false);
+	Radius.SetNumUninitialized(NumCapsules, /*bAllowShrinking=*/ false);
+}
+
+float FLyraRewoundHitbox::GetClosestSurfaceDistance(const FVector& SegmentStart, const FVector& SegmentEnd) const
+{
+	float BestDistance = UE_BIG_NUMBER;
+
+	for (int32 Index = 0; Index < NumCapsules; ++Index)
+	{
+		if (Radius[Index] < 0.0f)
+		{
+			// Padding
+			continue;
+		}
+
+		FVector ClosestOnSegment;
+		FVector ClosestOnCapsule;
+		FMath::SegmentDistToSegmentSafe(
+			SegmentStart, SegmentEnd,
+			FVector(StartX[Index], StartY[Index], StartZ[Index]), FVector(EndX[Index], EndY[Index], EndZ[Index]),
+			/*out*/ ClosestOnSegment, /*out*/ ClosestOnCapsule);
+
+		const float SurfaceDistance = FVector::Dist(ClosestOnSegment, ClosestOnCapsule) - Radius[Index];
+		BestDistance = FMath::Min(BestDistance, SurfaceDistance);
+	}
+
+	return BestDistance;
+}
+
+//////////////////////////////////////////////////////////////////////
+// FLyraHitboxHistory
+
+void FLyraHitboxHistory::Init(APawn* InPawn, int32 InMaxFrames)
+{
+	Pawn = InPawn;
+	MaxFrames = FMath::Max(InMaxFrames, 2);
+
+	BuildShapes();
+	AllocateFrames();
+}
+
+void FLyraHitboxHistory::BuildShapes()
+{
+	Shapes.Reset();
+	ShapeSourceAsset.Reset();
+
+	ACharacter* Character = Cast<ACharacter>(Pawn.Get());
+	if (Character == nullptr)
+	{
+		return;
+	}
+
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+	ShapeSourceAsset = (Mesh != nullptr) ? Mesh->GetSkinnedAsset() : nullptr;
+
+	// Prefer the physics asset shapes, since those are what the client traced against
+	if (const UPhysicsAsset* PhysicsAsset = (Mesh != nullptr) ? Mesh->GetPhysicsAsset() : nullptr)
+	{
+		const int32 MaxShapes = FMath::Max(LyraConsoleVariables::MaxCapsulesPerPawn, 1);
+		for (const USkeletalBodySetup* BodySetup : PhysicsAsset->SkeletalBodySetups)
+		{
+			if ((BodySetup == nullptr) || (BodySetup->PhysicsType == PhysType_Simulated))
+			{
+				continue;
+			}
+
+			const int32 BoneIndex = Mesh->GetBoneIndex(BodySetup->BoneName);
+			if (BoneIndex == INDEX_NONE)
+			{
+				continue;
+			}
+
+			for (const FKSphylElem& Sphyl : BodySetup->AggGeom.SphylElems)
+			{
+				if (Shapes.Num() < MaxShapes)
+				{
+					FLyraHitboxShapeDesc& Shape = Shapes.AddDefaulted_GetRef();
+					Shape.BoneName = BodySetup->BoneName;
+					Shape.BoneIndex = BoneIndex;
+					Shape.LocalTransform = Sphyl.GetTransform();
+					Shape.HalfLength = Sphyl.Length * 0.5f;
+					Shape.Radius = Sphyl.Radius;
+				}
+			}
+
+			for (const FKSphereElem& Sphere : BodySetup->AggGeom.SphereElems)
+			{
+				if (Shapes.Num() < MaxShapes)
+				{
+					FLyraHitboxShapeDesc& Shape = Shapes.AddDefaulted_GetRef();
+					Shape.BoneName = BodySetup->BoneName;
+					Shape.BoneIndex = BoneIndex;
+					Shape.LocalTransform = FTransform(Sphere.Center);
+					Shape.HalfLength = 0.0f;
+					Shape.Radius = Sphere.Radius;
+				}
+			}
+		}
+	}
+
+	// Fall back to the movement capsule if the mesh has no usable physics shapes
+	if (Shapes.Num() == 0)
+	{
+		if (const UCapsuleComponent* Capsule = Character->GetCapsuleComponent())
+		{
+			FLyraHitboxShapeDesc& Shape = Shapes.AddDefaulted_GetRef();
+			Shape.BoneName = NAME_None;
+			Shape.LocalTransform = FTransform::Identity;
+			Shape.HalfLength = Capsule->GetUnscaledCapsuleHalfHeight_WithoutHemisphere();
+			Shape.Radius = Capsule->GetUnscaledCapsuleRadius();
+		}
+	}
+}
+
+void FLyraHitboxHistory::AllocateFrames()
+{
+	// Pad to a multiple of 4 so each stream can be processed in full SIMD lanes
+	NumCapsules = Align(FMath::Max(Shapes.Num(), 1), 4);
+
+	FrameTimes.SetNumZeroed(MaxFrames);
+	CapsuleData.SetNumZeroed(MaxFrames * Stream_MAX * NumCapsules);
+
+	Head = INDEX_NONE;
+	NumValidFrames = 0;
+}
+
+void FLyraHitboxHistory::Record(double Timestamp)
+{
+	ACharacter* Character = Cast<ACharacter>(Pawn.Get());
+	if (Character == nullptr)
+	{
+		return;
+	}
+
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+
+	// Cosmetics can swap the mesh at runtime, rebuild the shapes (and drop the old history) if that happens
+	const UObject* CurrentSourceAsset = (Mesh != nullptr) ? Mesh->GetSkinnedAsset() : nullptr;
+	if (ShapeSourceAsset.Get() != CurrentSourceAsset)
+	{
+		const int32 OldNumCapsules = NumCapsules;
+		BuildShapes();
+		if (Align(FMath::Max(Shapes.Num(), 1), 4) != OldNumCapsules)
+		{
+			AllocateFrames();
+		}
+		else
+		{
+			NumValidFrames = 0;
+		}
+	}
+
+	Head = (Head + 1) % MaxFrames;
+	NumValidFrames = FMath::Min(NumValidFrames + 1, MaxFrames);
+	FrameTimes[Head] = Timestamp;
+
+	float* StartX = GetStream(Head, Stream_StartX);
+	float* StartY = GetStream(Head, Stream_StartY);
+	float* StartZ = GetStream(Head, Stream_StartZ);
+	float* EndX = GetStream(Head, Stream_EndX);
+	float* EndY = GetStream(Head, Stream_EndY);
+	float* EndZ = GetStream(Head, Stream_EndZ);
+	float* Radius = GetStream(Head, Stream_Radius);
+
+	const UCapsuleComponent* RootCapsule = Character->GetCapsuleComponent();
+
+	for (int32 Index = 0; Index < NumCapsules; ++Index)
+	{
+		if (!Shapes.IsValidIndex(Index))
+		{
+			StartX[Index] = StartY[Index] = StartZ[Index] = 0.0f;
+			EndX[Index] = EndY[Index] = EndZ[Index] = 0.0f;
+			Radius[Index] = -1.0f;
+			continue;
+		}
+
+		const FLyraHitboxShapeDesc& Shape = Shapes[Index];
+
+		FTransform ParentTransform = FTransform::Identity;
+		if ((Shape.BoneIndex != INDEX_NONE) && (Mesh != nullptr))
+		{
+			ParentTransform = Mesh->GetBoneTransform(Shape.BoneIndex);
+		}
+		else if (RootCapsule != nullptr)
+		{
+			ParentTransform = RootCapsule->GetComponentTransform();
+		}
+
+		const FTransform ShapeTransform = Shape.LocalTransform * ParentTransform;
+		const FVector Start = ShapeTransform.TransformPosition(FVector(0.0, 0.0, Shape.HalfLength));
+		const FVector End = ShapeTransform.TransformPosition(FVector(0.0, 0.0, -Shape.HalfLength));
+
+		StartX[Index] = (float)Start.X;
+		StartY[Index] = (float)Start.Y;
+		StartZ[Index] = (float)Start.Z;
+		EndX[Index] = (float)End.X;
+		EndY[Index] = (float)End.Y;
+		EndZ[Index] = (float)End.Z;
+		Radius[Index] = Shape.Radius * (float)ShapeTransform.GetMaximumAxisScale();
+	}
+}
+
+bool FLyraHitboxHistory::Rewind(double Timestamp, FLyraRewoundHitbox& OutHitbox) const
+{
+	if (NumValidFrames == 0)
+	{
+		return false;
+	}
+
+	// Find the pair of frames bracketing the requested time, clamping to the ends of the history
+	int32 NewerFrame = GetFrameIndex(0);
+	int32 OlderFrame = NewerFrame;
+	for (int32 Age = 1; Age < NumValidFrames; ++Age)
+	{
+		if (FrameTimes[OlderFrame] <= Timestamp)
+		{
+			break;
+		}
+
+		NewerFrame = OlderFrame;
+		OlderFrame = GetFrameIndex(Age);
+	}
+
+	const double FrameDelta = FrameTimes[NewerFrame] - FrameTimes[OlderFrame];
+	const float Alpha = (FrameDelta > UE_DOUBLE_KINDA_SMALL_NUMBER) ? (float)FMath::Clamp((Timestamp - FrameTimes[OlderFrame]) / FrameDelta, 0.0, 1.0) : 1.0f;
+
+	OutHitbox.SetNum(NumCapsules);
+
+	auto LerpStream = [this, NewerFrame, OlderFrame, Alpha](EStream Stream, float* RESTRICT Out)
+	{
+		const float* RESTRICT Older = GetStream(OlderFrame, Stream);
+		const float* RESTRICT Newer = GetStream(NewerFrame, Stream);
+		for (int32 Index = 0; Index < NumCapsules; ++Index)
+		{
+			Out[Index] = Older[Index] + (Newer[Index] - Older[Index]) * Alpha;
+		}
+	};
+
+	LerpStream(Stream_StartX, OutHitbox.StartX.GetData());
+	LerpStream(Stream_StartY, OutHitbox.StartY.GetData());
+	LerpStream(Stream_StartZ, OutHitbox.StartZ.GetData());
+	LerpStream(Stream_EndX, OutHitbox.EndX.GetData());
+	LerpStream(Stream_EndY, OutHitbox.EndY.GetData());
+	LerpStream(Stream_EndZ, OutHitbox.EndZ.GetData());
+	LerpStream(Stream_Radius, OutHitbox.Radius.GetData());
+
+	return true;
+}
+
+int32 FLyraHitboxHistory::GetAllocatedSize() const
+{
+	return (int32)(FrameTimes.GetAllocatedSize() + CapsuleData.GetAllocatedSize() + Shapes.GetAllocatedSize());
+}
+
+//////////////////////////////////////////////////////////////////////
+// ULyraLagCompensationSubsystem
+
+ULyraLagCompensationSubsystem::ULyraLagCompensationSubsystem()
+{
+}
+
+void ULyraLagCompensationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+}
+
+void ULyraLagCompensationSubsystem::Deinitialize()
+{
+	Histories.Empty();
+
+	Super::Deinitialize();
+}
+
+bool ULyraLagCompensationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId ULyraLagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULyraLagCompensationSubsystem, STATGROUP_Tickables);
+}
+
+void ULyraLagCompensationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(ULyraLagCompensationSubsystem::Tick);
+	LYRA_SERVER_BUDGET_SCOPE(LagCompensation);
+
+	if (!LyraConsoleVariables::bEnableLagCompensation || (Histories.Num() == 0))
+	{
+		return;
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	if (Now == LastRecordTime)
+	{
+		return;
+	}
+	LastRecordTime = Now;
+
+	for (auto It = Histories.CreateIterator(); It; ++It)
+	{
+		if (It.Value().Pawn.IsValid())
+		{
+			It.Value().Record(Now);
+		}
+		else
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void ULyraLagCompensationSubsystem::RegisterPawn(APawn* Pawn)
+{
+	if ((Pawn != nullptr) && Pawn->HasAuthority() && (GetWorld()->GetNetMode() != NM_Standalone))
+	{
+		FLyraHitboxHistory& History = Histories.FindOrAdd(Pawn);
+		History.Init(Pawn, LyraConsoleVariables::MaxHistoryFrames);
+	}
+}
+
+void ULyraLagCompensationSubsystem::UnregisterPawn(APawn* Pawn)
+{
+	Histories.Remove(Pawn);
+}
+
+double ULyraLagCompensationSubsystem::EstimateViewTime(const AController* Shooter) const
+{
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	// Bots and the listen server host see the present
+	if ((Shooter == nullptr) || Shooter->IsLocalController())
+	{
+		return Now;
+	}
+
+	// The shot was fired one half trip before we received it, against proxies that were already one half trip
+	// (plus interpolation) behind us when they were sent
+	double RewindTime = LyraConsoleVariables::InterpolationDelay;
+	if (const APlayerState* PlayerState = Shooter->GetPlayerState<APlayerState>())
+	{
+		RewindTime += PlayerState->GetPingInMilliseconds() * 0.001;
+	}
+
+	return Now - FMath::Clamp(RewindTime, 0.0, (double)LyraConsoleVariables::MaxRewindTime);
+}
+
+ELyraHitValidationResult ULyraLagCompensationSubsystem::ValidateHit(const APawn* HitPawn, const FHitResult& Hit, double ViewTime, float ExtraTolerance) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(ULyraLagCompensationSubsystem::ValidateHit);
+	LYRA_SERVER_BUDGET_SCOPE(LagCompensation);
+
+	const FLyraHitboxHistory* History = Histories.Find(HitPawn);
+
+	FLyraRewoundHitbox Hitbox;
+	if (!LyraConsoleVariables::bEnableLagCompensation || (History == nullptr) || !History->Rewind(ViewTime, /*out*/ Hitbox))
+	{
+		++NumHitsUntracked;
+		return ELyraHitValidationResult::NotTracked;
+	}
+
+	// Test the part of the bullet path that leads up to the reported impact (allowing for a little overshoot)
+	const float Tolerance = LyraConsoleVariables::HitTolerance + ExtraTolerance;
+	const FVector TraceDir = (Hit.TraceEnd - Hit.TraceStart).GetSafeNormal();
+	const FVector SegmentEnd = Hit.Location + (TraceDir * Tolerance);
+	const float SurfaceDistance = Hitbox.GetClosestSurfaceDistance(Hit.TraceStart, SegmentEnd);
+
+	const bool bAccepted = (SurfaceDistance <= Tolerance);
+
+#if ENABLE_DRAW_DEBUG
+	if (LyraConsoleVariables::DrawRewoundHitboxDuration > 0.0f)
+	{
+		const FColor Color = bAccepted ? FColor::Green : FColor::Red;
+		for (int32 Index = 0; Index < Hitbox.NumCapsules; ++Index)
+		{
+			if (Hitbox.Radius[Index] >= 0.0f)
+			{
+				const FVector Start(Hitbox.StartX[Index], Hitbox.StartY[Index], Hitbox.StartZ[Index]);
+				const FVector End(Hitbox.EndX[Index], Hitbox.EndY[Index], Hitbox.EndZ[Index]);
+				const FVector Axis = Start - End;
+				const float HalfHeight = (Axis.Size() * 0.5f) + Hitbox.Radius[Index];
+				const FQuat Rotation = Axis.IsNearlyZero() ? FQuat::Identity : FRotationMatrix::MakeFromZ(Axis).ToQuat();
+				DrawDebugCapsule(GetWorld(), (Start + End) * 0.5, HalfHeight, Hitbox.Radius[Index], Rotation, Color, false, LyraConsoleVariables::DrawRewoundHitboxDuration);
+			}
+		}
+		DrawDebugLine(GetWorld(), Hit.TraceStart, SegmentEnd, Color, false, LyraConsoleVariables::DrawRewoundHitboxDuration);
+	}
+#endif // ENABLE_DRAW_DEBUG
+
+	if (bAccepted)
+	{
+		++NumHitsValidated;
+		return ELyraHitValidationResult::Accepted;
+	}
+
+	++NumHitsRejected;
+	UE_LOG(LogLyraAbilitySystem, Verbose, TEXT("Rejected hit on %s: missed rewound hitbox by %.1f uu (rewound %.3f s)"),
+		*GetNameSafe(HitPawn), SurfaceDistance, GetWorld()->GetTimeSeconds() - ViewTime);
+
+	return ELyraHitValidationResult::Rejected;
+}
+
+void ULyraLagCompensationSubsystem::DumpStats() const
+{
+	int32 TotalBytes = (int32)Histories.GetAllocatedSize();
+	for (const auto& KVP : Histories)
+	{
+		TotalBytes += KVP.Value.GetAllocatedSize();
+	}
+
+	UE_LOG(LogLyraAbilitySystem, Log, TEXT("Lag compensation: %d tracked pawns, %d KB of history, %d hits accepted, %d rejected, %d untracked"),
+		Histories.Num(), TotalBytes / 1024, NumHitsValidated, NumHitsRejected, NumHitsUntracked);
+}
+
+static FAutoConsoleCommandWithWorld GLyraLagCompensationStatsCmd(
+	TEXT("lyra.Weapon.LagCompensation.DumpStats"),
+	TEXT("Logs hit validation counters and the memory used by the hitbox history"),
+	FConsoleCommandWithWorldDelegate::CreateStatic([](UWorld* World)
+	{
+		if (const ULyraLagCompensationSubsystem* LagCompensation = UWorld::GetSubsystem<ULyraLagCompensationSubsystem>(World))
+		{
+			LagCompensation->DumpStats();
+		}
+	}));
@@ -0,0 +1,180 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+
+#include "LyraLagCompensationSubsystem.generated.h"
+
+class AController;
+class APawn;
+class UObject;
+class UWorld;
+struct FHitResult;
+
+/** Describes one hitbox capsule relative to the bone (or component) it is attached to */
+struct FLyraHitboxShapeDesc
+{
+	// Bone to follow, or NAME_None to follow the pawn's root component
+	FName BoneName;
+
+	// Index of BoneName in the mesh the shapes were built from
+	int32 BoneIndex = INDEX_NONE;
+
+	// Transform of the shape relative to the bone
+	FTransform LocalTransform;
+
+	// Half of the distance between the two sphere centers of the capsule (zero for spheres)
+	float HalfLength = 0.0f;
+
+	float Radius = 0.0f;
+};
+
+/** A set of capsules evaluated at a single point in time, stored as structure-of-arrays */
+struct FLyraRewoundHitbox
+{
+	// Capsule count, padded up to a multiple of 4 (padding entries have a negative radius)
+	int32 NumCapsules = 0;
+
+	TArray<float, TInlineAllocator<64>> StartX;
+	TArray<float, TInlineAllocator<64>> StartY;
+	TArray<float, TInlineAllocator<64>> StartZ;
+	TArray<float, TInlineAllocator<64>> EndX;
+	TArray<float, TInlineAllocator<64>> EndY;
+	TArray<float, TInlineAllocator<64>> EndZ;
+	TArray<float, TInlineAllocator<64>> Radius;
+
+	void SetNum(int32 InNumCapsules);
+
+	/** Returns the distance from the segment to the surface of the closest capsule (zero or less means it intersects) */
+	float GetClosestSurfaceDistance(const FVector& SegmentStart, const FVector& SegmentEnd) const;
+};
+
+/**
+ * FLyraHitboxHistory
+ *
+ * A fixed-capacity ring of hitbox snapshots for a single pawn.
+ * Each frame is stored as seven contiguous float streams (start xyz, end xyz, radius) so rewinding and
+ * ray testing a frame are straight loops over packed data. Memory is allocated once at registration.
+ */
+struct FLyraHitboxHistory
+{
+	void Init(APawn* InPawn, int32 InMaxFrames);
+
+	/** Records the current pose of the pawn at the specified server time */
+	void Record(double Timestamp);
+
+	/** Interpolates the hitbox at the specified server time, returns false if there is no history */
+	bool Rewind(double Timestamp, FLyraRewoundHitbox& OutHitbox) const;
+
+	int32 GetAllocatedSize() const;
+
+	TWeakObjectPtr<APawn> Pawn;
+
+	TArray<FLyraHitboxShapeDesc> Shapes;
+
+	// The mesh asset the shapes were built from, the shapes are rebuilt if the pawn's mesh is swapped
+	TWeakObjectPtr<const UObject> ShapeSourceAsset;
+
+private:
+	enum EStream : int32
+	{
+		Stream_StartX,
+		Stream_StartY,
+		Stream_StartZ,
+		Stream_EndX,
+		Stream_EndY,
+		Stream_EndZ,
+		Stream_Radius,
+		Stream_MAX
+	};
+
+	float* GetStream(int32 Frame, EStream Stream) { return CapsuleData.GetData() + ((Frame * Stream_MAX + Stream) * NumCapsules); }
+	const float* GetStream(int32 Frame, EStream Stream) const { return CapsuleData.GetData() + ((Frame * Stream_MAX + Stream) * NumCapsules); }
+
+	// Returns the ring index of the N-th most recent frame
+	int32 GetFrameIndex(int32 Age) const { return (Head - Age + MaxFrames) % MaxFrames; }
+
+	void BuildShapes();
+	void AllocateFrames();
+
+private:
+	TArray<double> FrameTimes;
+	TArray<float> CapsuleData;
+
+	int32 MaxFrames = 0;
+	int32 NumCapsules = 0;
+	int32 Head = INDEX_NONE;
+	int32 NumValidFrames = 0;
+};
+
+/** Outcome of validating a single client-reported pawn hit */
+enum class ELyraHitValidationResult : uint8
+{
+	// The hit was consistent with the rewound hitboxes
+	Accepted,
+
+	// The hit pawn has no history (not registered or no frames yet), so it could not be validated
+	NotTracked,
+
+	// The hit did not intersect any rewound hitbox within tolerance
+	Rejected
+};
+
+/**
+ * ULyraLagCompensationSubsystem
+ *
+ * Server-side hitbox history for pawns, used to validate client-reported weapon hits against
+ * where the targets were when the shooter saw them rather than where they are now.
+ */
+UCLASS()
+class ULyraLagCompensationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	ULyraLagCompensationSubsystem();
+
+	//~USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	//~End of USubsystem interface
+
+	//~FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End of FTickableGameObject interface
+
+	/** Starts recording hitbox history for the pawn (authority only) */
+	void RegisterPawn(APawn* Pawn);
+
+	/** Stops recording hitbox history for the pawn */
+	void UnregisterPawn(APawn* Pawn);
+
+	/** Returns the server time that the specified controller was most likely looking at when it fired */
+	double EstimateViewTime(const AController* Shooter) const;
+
+	/**
+	 * Checks the hit against the rewound hitboxes of the pawn it claims to have hit
+	 * ExtraTolerance is added to the configured tolerance (e.g., the sweep radius of the weapon that made the hit)
+	 */
+	ELyraHitValidationResult ValidateHit(const APawn* HitPawn, const FHitResult& Hit, double ViewTime, float ExtraTolerance = 0.0f) const;
+
+	int32 GetNumTrackedPawns() const { return Histories.Num(); }
+
+	/** Logs validation counters and the memory used by the history */
+	void DumpStats() const;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	TMap<TObjectKey<APawn>, FLyraHitboxHistory> Histories;
+
+	double LastRecordTime = -1.0;
+
+	mutable int32 NumHitsValidated = 0;
+	mutable int32 NumHitsRejected = 0;
+	mutable int32 NumHitsUntracked = 0;
+};
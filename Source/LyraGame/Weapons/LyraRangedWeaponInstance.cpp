@@ -5,13 +5,51 @@
 #include "GameFramework/Pawn.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Camera/LyraCameraComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "LyraLogChannels.h"
+#include "Math/RandomStream.h"
 #include "Physics/PhysicalMaterialWithTags.h"
+#include "UObject/UObjectIterator.h"
+#include "Weapons/LyraRangedWeaponUpdateSubsystem.h"
 #include "Weapons/LyraWeaponInstance.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraRangedWeaponInstance)
 
 UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_Lyra_Weapon_SteadyAimingCamera, "Lyra.Weapon.SteadyAimingCamera");
 
+namespace LyraConsoleVariables
+{
+	static bool bUseSpreadLookupTables = true;
+	static FAutoConsoleVariableRef CVarUseSpreadLookupTables(
+		TEXT("Lyra.Weapon.UseSpreadLookupTables"),
+		bUseSpreadLookupTables,
+		TEXT("If true, ranged weapons evaluate the heat and spread curves from tables baked per weapon class."),
+		ECVF_Default);
+
+	static bool bBatchServerWeaponUpdates = false;
+	static FAutoConsoleVariableRef CVarBatchServerWeaponUpdates(
+		TEXT("Lyra.Weapon.BatchServerUpdates"),
+		bBatchServerWeaponUpdates,
+		TEXT("If true, the server updates the heat and spread of every equipped ranged weapon in one pass at the end of the frame instead of from each weapon state component. Applies to weapons equipped afterwards."),
+		ECVF_Default);
+
+	static bool bUseDamageLookupTables = true;
+	static FAutoConsoleVariableRef CVarUseDamageLookupTables(
+		TEXT("Lyra.Weapon.UseDamageLookupTables"),
+		bUseDamageLookupTables,
+		TEXT("If true, ranged weapons resolve distance falloff and physical material multipliers from tables baked per weapon class instead of evaluating the curve and the material tags on every hit."),
+		ECVF_Default);
+}
+
+namespace LyraRangedWeaponInstance_Statics
+{
+	// Number of samples in the baked distance falloff curve
+	static constexpr int32 DistanceDamageFalloffTableSize = 256;
+
+	// Number of samples in the baked heat curves
+	static constexpr int32 HeatTableSize = 128;
+}
+
 ULyraRangedWeaponInstance::ULyraRangedWeaponInstance(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
@@ -23,6 +61,12 @@ void ULyraRangedWeaponInstance::PostLoad()
 {
 	Super::PostLoad();
 
+	// Instances are created from the class defaults, so only those need the tables
+	if (HasAnyFlags(RF_ClassDefaultObject))
+	{
+		BakeCurveTables();
+	}
+
 #if WITH_EDITOR
 	UpdateDebugVisualization();
 #endif
@@ -33,6 +77,9 @@ void ULyraRangedWeaponInstance::PostEditChangeProperty(struct FPropertyChangedEv
 {
 	Super::PostEditChangeProperty(PropertyChangedEvent);
 	UpdateDebugVisualization();
+
+	// Rebake the tables on next use
+	bCurveTablesBaked = false;
 }
 
 void ULyraRangedWeaponInstance::UpdateDebugVisualization()
@@ -49,25 +96,40 @@ void ULyraRangedWeaponInstance::OnEquipped()
 {
 	Super::OnEquipped();
 
-	// Start heat in the middle
-	float MinHeatRange;
-	float MaxHeatRange;
-	ComputeHeatRange(/*out*/ MinHeatRange, /*out*/ MaxHeatRange);
-	CurrentHeat = (MinHeatRange + MaxHeatRange) * 0.5f;
+	CurrentHeat = GetInitialHeat();
 
 	// Derive spread
-	CurrentSpreadAngle = HeatToSpreadCurve.GetRichCurveConst()->Eval(CurrentHeat);
+	CurrentSpreadAngle = EvalHeatToSpread(CurrentHeat);
 
 	// Default the multipliers to 1x
 	CurrentSpreadAngleMultiplier = 1.0f;
 	StandingStillMultiplier = 1.0f;
 	JumpFallMultiplier = 1.0f;
 	CrouchingMultiplier = 1.0f;
+
+	UWorld* World = GetWorld();
+	if (LyraConsoleVariables::bBatchServerWeaponUpdates && (World != nullptr) && (World->GetNetMode() != NM_Client))
+	{
+		if (ULyraRangedWeaponUpdateSubsystem* UpdateSubsystem = World->GetSubsystem<ULyraRangedWeaponUpdateSubsystem>())
+		{
+			UpdateSubsystem->RegisterWeapon(this);
+			bUpdatedInBatch = true;
+		}
+	}
 }
 
 void ULyraRangedWeaponInstance::OnUnequipped()
 {
 	Super::OnUnequipped();
+
+	if (bUpdatedInBatch)
+	{
+		if (ULyraRangedWeaponUpdateSubsystem* UpdateSubsystem = UWorld::GetSubsystem<ULyraRangedWeaponUpdateSubsystem>(GetWorld()))
+		{
+			UpdateSubsystem->UnregisterWeapon(this);
+		}
+		bUpdatedInBatch = false;
+	}
 }
 
 void ULyraRangedWeaponInstance::Tick(float DeltaSeconds)
@@ -85,7 +147,7 @@ void ULyraRangedWeaponInstance::Tick(float DeltaSeconds)
 #endif
 }
 
-void ULyraRangedWeaponInstance::ComputeHeatRange(float& MinHeat, float& MaxHeat)
+void ULyraRangedWeaponInstance::ComputeHeatRange(float& MinHeat, float& MaxHeat) const
 {
 	float Min1;
 	float Max1;
@@ -103,32 +165,115 @@ void ULyraRangedWeaponInstance::ComputeHeatRange(float& MinHeat, float& MaxHeat)
 	MaxHeat = FMath::Max(FMath::Max(Max1, Max2), Max3);
 }
 
-void ULyraRangedWeaponInstance::ComputeSpreadRange(float& MinSpread, float& MaxSpread)
+void ULyraRangedWeaponInstance::ComputeSpreadRange(float& MinSpread, float& MaxSpread) const
 {
 	HeatToSpreadCurve.GetRichCurveConst()->GetValueRange(/*out*/ MinSpread, /*out*/ MaxSpread);
 }
 
 void ULyraRangedWeaponInstance::AddSpread()
 {
-	// Sample the heat up curve
-	const float HeatPerShot = HeatToHeatPerShotCurve.GetRichCurveConst()->Eval(CurrentHeat);
-	CurrentHeat = ClampHeat(CurrentHeat + HeatPerShot);
+	CurrentHeat = ComputeHeatAfterShot(CurrentHeat);
 
 	// Map the heat to the spread angle
-	CurrentSpreadAngle = HeatToSpreadCurve.GetRichCurveConst()->Eval(CurrentHeat);
+	CurrentSpreadAngle = EvalHeatToSpread(CurrentHeat);
 
 #if WITH_EDITOR
 	UpdateDebugVisualization();
 #endif
 }
 
+float ULyraRangedWeaponInstance::GetInitialHeat() const
+{
+	// Start heat in the middle
+	const ULyraRangedWeaponInstance* TablesOwner = GetCurveTablesOwner();
+	return (TablesOwner->BakedMinHeat + TablesOwner->BakedMaxHeat) * 0.5f;
+}
+
+float ULyraRangedWeaponInstance::ComputeHeatAfterShot(float Heat) const
+{
+	// Sample the heat up curve
+	const ULyraRangedWeaponInstance* TablesOwner = GetCurveTablesOwner();
+	const float HeatPerShot = EvalHeatToHeatPerShot(Heat);
+	return FMath::Clamp(Heat + HeatPerShot, TablesOwner->BakedMinHeat, TablesOwner->BakedMaxHeat);
+}
+
+float ULyraRangedWeaponInstance::ComputeHeatAfterIdle(float Heat, float IdleSeconds, float TickSeconds) const
+{
+	const ULyraRangedWeaponInstance* TablesOwner = GetCurveTablesOwner();
+
+	float CooldownSeconds = IdleSeconds - SpreadRecoveryCooldownDelay;
+	while ((CooldownSeconds > 0.0f) && (Heat > TablesOwner->BakedMinHeat))
+	{
+		const float DeltaSeconds = FMath::Min(CooldownSeconds, TickSeconds);
+		Heat = FMath::Clamp(Heat - (EvalHeatToCoolDownPerSecond(Heat) * DeltaSeconds), TablesOwner->BakedMinHeat, TablesOwner->BakedMaxHeat);
+		CooldownSeconds -= DeltaSeconds;
+	}
+
+	return Heat;
+}
+
+float ULyraRangedWeaponInstance::GetSpreadAngleAtHeat(float Heat) const
+{
+	return EvalHeatToSpread(Heat);
+}
+
+bool ULyraRangedWeaponInstance::IsMinSpreadAngle(float SpreadAngle) const
+{
+	return FMath::IsNearlyEqual(SpreadAngle, GetCurveTablesOwner()->BakedMinSpread, KINDA_SMALL_NUMBER);
+}
+
+float ULyraRangedWeaponInstance::GetSpreadAngleMultiplierForStance(bool bAiming, bool bMoving, bool bCrouching, bool bJumpingOrFalling, bool& bOutAtMin) const
+{
+	// The values UpdateMultipliers settles on, with the same thresholds
+	const float MultiplierNearlyEqualThreshold = 0.05f;
+
+	const float StandingStill = bMoving ? 1.0f : SpreadAngleMultiplier_StandingStill;
+	const float Crouching = bCrouching ? SpreadAngleMultiplier_Crouching : 1.0f;
+	const float JumpFall = bJumpingOrFalling ? SpreadAngleMultiplier_JumpingOrFalling : 1.0f;
+	const float Aiming = bAiming ? SpreadAngleMultiplier_Aiming : 1.0f;
+
+	bOutAtMin = FMath::IsNearlyEqual(StandingStill, SpreadAngleMultiplier_StandingStill, SpreadAngleMultiplier_StandingStill*0.1f)
+		&& FMath::IsNearlyEqual(JumpFall, 1.0f, MultiplierNearlyEqualThreshold)
+		&& FMath::IsNearlyEqual(Aiming, SpreadAngleMultiplier_Aiming, KINDA_SMALL_NUMBER);
+
+	return Aiming * StandingStill * Crouching * JumpFall;
+}
+
 float ULyraRangedWeaponInstance::GetDistanceAttenuation(float Distance, const FGameplayTagContainer* SourceTags, const FGameplayTagContainer* TargetTags) const
 {
+	if (LyraConsoleVariables::bUseDamageLookupTables)
+	{
+		const ULyraRangedWeaponInstance* TablesOwner = GetCurveTablesOwner();
+		if (TablesOwner->DistanceDamageFalloffTable.IsBaked())
+		{
+			return TablesOwner->DistanceDamageFalloffTable.Eval(Distance);
+		}
+	}
+
 	const FRichCurve* Curve = DistanceDamageFalloff.GetRichCurveConst();
 	return Curve->HasAnyData() ? Curve->Eval(Distance) : 1.0f;
 }
 
 float ULyraRangedWeaponInstance::GetPhysicalMaterialAttenuation(const UPhysicalMaterial* PhysicalMaterial, const FGameplayTagContainer* SourceTags, const FGameplayTagContainer* TargetTags) const
+{
+	if (LyraConsoleVariables::bUseDamageLookupTables && (PhysicalMaterial != nullptr))
+	{
+		const ULyraRangedWeaponInstance* TablesOwner = GetCurveTablesOwner();
+		if (const float* CombinedMultiplier = TablesOwner->MaterialDamageMultiplierTable.Find(PhysicalMaterial))
+		{
+			return *CombinedMultiplier;
+		}
+
+		// Materials are added as they are hit, there are only a handful of them in a map
+		const float CombinedMultiplier = TablesOwner->CombineMaterialDamageMultipliers(PhysicalMaterial);
+		TablesOwner->MaterialDamageMultiplierTable.Add(PhysicalMaterial, CombinedMultiplier);
+		return CombinedMultiplier;
+	}
+
+	return CombineMaterialDamageMultipliers(PhysicalMaterial);
+}
+
+float ULyraRangedWeaponInstance::CombineMaterialDamageMultipliers(const UPhysicalMaterial* PhysicalMaterial) const
 {
 	float CombinedMultiplier = 1.0f;
 	if (const UPhysicalMaterialWithTags* PhysMatWithTags = Cast<const UPhysicalMaterialWithTags>(PhysicalMaterial))
@@ -145,22 +290,265 @@ float ULyraRangedWeaponInstance::GetPhysicalMaterialAttenuation(const UPhysicalM
 	return CombinedMultiplier;
 }
 
+const ULyraRangedWeaponInstance* ULyraRangedWeaponInstance::GetCurveTablesOwner() const
+{
+	const ULyraRangedWeaponInstance* ClassDefaults = GetClass()->GetDefaultObject<ULyraRangedWeaponInstance>();
+	if (!ClassDefaults->bCurveTablesBaked)
+	{
+		ClassDefaults->BakeCurveTables();
+	}
+
+	return ClassDefaults;
+}
+
+void ULyraRangedWeaponInstance::BakeCurveTables() const
+{
+	using namespace LyraRangedWeaponInstance_Statics;
+
+	// Curves that cannot be baked (e.g., with linear extrapolation) leave their table empty and keep evaluating the curve
+	DistanceDamageFalloffTable.Bake(*DistanceDamageFalloff.GetRichCurveConst(), DistanceDamageFalloffTableSize);
+	MaterialDamageMultiplierTable.Reset();
+
+	HeatToSpreadTable.Bake(*HeatToSpreadCurve.GetRichCurveConst(), HeatTableSize);
+	HeatToHeatPerShotTable.Bake(*HeatToHeatPerShotCurve.GetRichCurveConst(), HeatTableSize);
+	HeatToCoolDownPerSecondTable.Bake(*HeatToCoolDownPerSecondCurve.GetRichCurveConst(), HeatTableSize);
+
+	// The ranges walk every key of the curves, and were needed every tick to clamp the heat
+	ComputeHeatRange(/*out*/ BakedMinHeat, /*out*/ BakedMaxHeat);
+	float BakedMaxSpread;
+	ComputeSpreadRange(/*out*/ BakedMinSpread, /*out*/ BakedMaxSpread);
+
+	BakedMinSpreadHeats.Reset();
+	for (const FRichCurveKey& Key : HeatToSpreadCurve.GetRichCurveConst()->GetConstRefOfKeys())
+	{
+		if (Key.Value == BakedMinSpread)
+		{
+			BakedMinSpreadHeats.Add(Key.Time);
+		}
+	}
+
+	bCurveTablesBaked = true;
+}
+
+float ULyraRangedWeaponInstance::EvalHeatToSpread(float Heat) const
+{
+	if (LyraConsoleVariables::bUseSpreadLookupTables)
+	{
+		const ULyraRangedWeaponInstance* TablesOwner = GetCurveTablesOwner();
+		const FLyraCurveLookupTable& Table = TablesOwner->HeatToSpreadTable;
+		if (Table.IsBaked())
+		{
+			// Return the minimum spread at the same heats as the curve does, or first shot accuracy would depend on the sample spacing
+			for (const float MinSpreadHeat : TablesOwner->BakedMinSpreadHeats)
+			{
+				if (Heat == MinSpreadHeat)
+				{
+					return TablesOwner->BakedMinSpread;
+				}
+			}
+
+			return Table.Eval(Heat);
+		}
+	}
+
+	return HeatToSpreadCurve.GetRichCurveConst()->Eval(Heat);
+}
+
+float ULyraRangedWeaponInstance::EvalHeatToHeatPerShot(float Heat) const
+{
+	if (LyraConsoleVariables::bUseSpreadLookupTables)
+	{
+		const FLyraCurveLookupTable& Table = GetCurveTablesOwner()->HeatToHeatPerShotTable;
+		if (Table.IsBaked())
+		{
+			return Table.Eval(Heat);
+		}
+	}
+
+	return HeatToHeatPerShotCurve.GetRichCurveConst()->Eval(Heat);
+}
+
+float ULyraRangedWeaponInstance::EvalHeatToCoolDownPerSecond(float Heat) const
+{
+	if (LyraConsoleVariables::bUseSpreadLookupTables)
+	{
+		const FLyraCurveLookupTable& Table = GetCurveTablesOwner()->HeatToCoolDownPerSecondTable;
+		if (Table.IsBaked())
+		{
+			return Table.Eval(Heat);
+		}
+	}
+
+	return HeatToCoolDownPerSecondCurve.GetRichCurveConst()->Eval(Heat);
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommand GLyraWeaponBenchmarkDamageTablesCmd(
+	TEXT("Lyra.Weapon.BenchmarkDamageTables"),
+	TEXT("Resolves the distance falloff and physical material multipliers of every loaded ranged weapon class with the curves and with the baked tables, and reports the time spent and the largest difference. Usage: Lyra.Weapon.BenchmarkDamageTables [HitsPerClass=10000]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+	{
+		const int32 NumHits = (Args.Num() > 0) ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 10000;
+
+		TArray<const UPhysicalMaterial*> PhysicalMaterials;
+		PhysicalMaterials.Add(nullptr);
+		for (TObjectIterator<UPhysicalMaterialWithTags> It; It; ++It)
+		{
+			PhysicalMaterials.Add(*It);
+		}
+
+		const bool bWasUsingTables = LyraConsoleVariables::bUseDamageLookupTables;
+
+		for (TObjectIterator<UClass> ClassIt; ClassIt; ++ClassIt)
+		{
+			const UClass* WeaponClass = *ClassIt;
+			if (!WeaponClass->IsChildOf(ULyraRangedWeaponInstance::StaticClass()) || WeaponClass->HasAnyClassFlags(CLASS_Abstract | CLASS_NewerVersionExists | CLASS_Deprecated))
+			{
+				continue;
+			}
+
+			const ULyraRangedWeaponInstance* Weapon = WeaponClass->GetDefaultObject<ULyraRangedWeaponInstance>();
+
+			// Both passes see the same hits
+			TArray<float> Distances;
+			TArray<const UPhysicalMaterial*> HitMaterials;
+			Distances.SetNumUninitialized(NumHits);
+			HitMaterials.SetNumUninitialized(NumHits);
+			FRandomStream Stream(NumHits);
+			for (int32 HitIndex = 0; HitIndex < NumHits; ++HitIndex)
+			{
+				Distances[HitIndex] = Stream.FRandRange(0.0f, Weapon->GetMaxDamageRange() * 1.1f);
+				HitMaterials[HitIndex] = PhysicalMaterials[Stream.RandHelper(PhysicalMaterials.Num())];
+			}
+
+			TArray<float> CurveResults;
+			TArray<float> TableResults;
+			CurveResults.SetNumUninitialized(NumHits);
+			TableResults.SetNumUninitialized(NumHits);
+
+			LyraConsoleVariables::bUseDamageLookupTables = false;
+			const double CurveStart = FPlatformTime::Seconds();
+			for (int32 HitIndex = 0; HitIndex < NumHits; ++HitIndex)
+			{
+				CurveResults[HitIndex] = Weapon->GetDistanceAttenuation(Distances[HitIndex]) * Weapon->GetPhysicalMaterialAttenuation(HitMaterials[HitIndex]);
+			}
+			const double CurveSeconds = FPlatformTime::Seconds() - CurveStart;
+
+			// Bake the tables (and add every material to them) before timing
+			LyraConsoleVariables::bUseDamageLookupTables = true;
+			for (const UPhysicalMaterial* PhysicalMaterial : PhysicalMaterials)
+			{
+				Weapon->GetPhysicalMaterialAttenuation(PhysicalMaterial);
+			}
+
+			const double TableStart = FPlatformTime::Seconds();
+			for (int32 HitIndex = 0; HitIndex < NumHits; ++HitIndex)
+			{
+				TableResults[HitIndex] = Weapon->GetDistanceAttenuation(Distances[HitIndex]) * Weapon->GetPhysicalMaterialAttenuation(HitMaterials[HitIndex]);
+			}
+			const double TableSeconds = FPlatformTime::Seconds() - TableStart;
+
+			float MaxDifference = 0.0f;
+			for (int32 HitIndex = 0; HitIndex < NumHits; ++HitIndex)
+			{
+				MaxDifference = FMath::Max(MaxDifference, FMath::Abs(CurveResults[HitIndex] - TableResults[HitIndex]));
+			}
+
+			UE_LOG(LogLyra, Display, TEXT("%s: %d hits, curves %.3f ms, tables %.3f ms, max difference %.5f"),
+				*WeaponClass->GetName(), NumHits, CurveSeconds * 1000.0, TableSeconds * 1000.0, MaxDifference);
+		}
+
+		LyraConsoleVariables::bUseDamageLookupTables = bWasUsingTables;
+	}));
+
+void ULyraRangedWeaponInstance::RunSpreadBenchmark(int32 NumSteps, float DeltaSeconds, TArray<float>& OutSpreadAngles) const
+{
+	// Same math as AddSpread and UpdateSpread, on local state so it can run on the class defaults without a world
+	const ULyraRangedWeaponInstance* TablesOwner = GetCurveTablesOwner();
+	float Heat = GetInitialHeat();
+
+	FRandomStream Stream(NumSteps);
+	OutSpreadAngles.SetNumUninitialized(NumSteps);
+	for (int32 Step = 0; Step < NumSteps; ++Step)
+	{
+		// Bursts of fire with cooldown in between
+		if (Stream.FRand() < 0.3f)
+		{
+			Heat = ComputeHeatAfterShot(Heat);
+		}
+		else
+		{
+			Heat = FMath::Clamp(Heat - (EvalHeatToCoolDownPerSecond(Heat) * DeltaSeconds), TablesOwner->BakedMinHeat, TablesOwner->BakedMaxHeat);
+		}
+
+		OutSpreadAngles[Step] = EvalHeatToSpread(Heat);
+	}
+}
+
+static FAutoConsoleCommand GLyraWeaponBenchmarkSpreadTablesCmd(
+	TEXT("Lyra.Weapon.BenchmarkSpreadTables"),
+	TEXT("Runs the same shots and cooldown steps through the heat and spread curves and through the baked tables for every loaded ranged weapon class, and reports the cost per step and the largest spread difference. Usage: Lyra.Weapon.BenchmarkSpreadTables [Steps=100000]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+	{
+		const int32 NumSteps = (Args.Num() > 0) ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 100000;
+		const float DeltaSeconds = 1.0f / 30.0f;
+
+		const bool bWasUsingTables = LyraConsoleVariables::bUseSpreadLookupTables;
+
+		for (TObjectIterator<UClass> ClassIt; ClassIt; ++ClassIt)
+		{
+			const UClass* WeaponClass = *ClassIt;
+			if (!WeaponClass->IsChildOf(ULyraRangedWeaponInstance::StaticClass()) || WeaponClass->HasAnyClassFlags(CLASS_Abstract | CLASS_NewerVersionExists | CLASS_Deprecated))
+			{
+				continue;
+			}
+
+			const ULyraRangedWeaponInstance* Weapon = WeaponClass->GetDefaultObject<ULyraRangedWeaponInstance>();
+
+			TArray<float> CurveSpreadAngles;
+			LyraConsoleVariables::bUseSpreadLookupTables = false;
+			const double CurveStart = FPlatformTime::Seconds();
+			Weapon->RunSpreadBenchmark(NumSteps, DeltaSeconds, CurveSpreadAngles);
+			const double CurveSeconds = FPlatformTime::Seconds() - CurveStart;
+
+			TArray<float> TableSpreadAngles;
+			LyraConsoleVariables::bUseSpreadLookupTables = true;
+			const double TableStart = FPlatformTime::Seconds();
+			Weapon->RunSpreadBenchmark(NumSteps, DeltaSeconds, TableSpreadAngles);
+			const double TableSeconds = FPlatformTime::Seconds() - TableStart;
+
+			float MaxDifference = 0.0f;
+			for (int32 Step = 0; Step < NumSteps; ++Step)
+			{
+				MaxDifference = FMath::Max(MaxDifference, FMath::Abs(CurveSpreadAngles[Step] - TableSpreadAngles[Step]));
+			}
+
+			UE_LOG(LogLyra, Display, TEXT("%s: %d steps, curves %.1f ns/step, tables %.1f ns/step, max spread difference %.5f deg"),
+				*WeaponClass->GetName(), NumSteps, CurveSeconds * 1.0e9 / NumSteps, TableSeconds * 1.0e9 / NumSteps, MaxDifference);
+		}
+
+		LyraConsoleVariables::bUseSpreadLookupTables = bWasUsingTables;
+	}));
+#endif // !UE_BUILD_SHIPPING
+
 bool ULyraRangedWeaponInstance::UpdateSpread(float DeltaSeconds)
 {
 	const float TimeSinceFired = GetWorld()->TimeSince(LastFireTime);
 
 	if (TimeSinceFired > SpreadRecoveryCooldownDelay)
 	{
-		const float CooldownRate = HeatToCoolDownPerSecondCurve.GetRichCurveConst()->Eval(CurrentHeat);
-		CurrentHeat = ClampHeat(CurrentHeat - (CooldownRate * DeltaSeconds));
-		CurrentSpreadAngle = HeatToSpreadCurve.GetRichCurveConst()->Eval(CurrentHeat);
+		const float CooldownRate = EvalHeatToCoolDownPerSecond(CurrentHeat);
+		const float NewHeat = ClampHeat(CurrentHeat - (CooldownRate * DeltaSeconds));
+
+		// Once the weapon has fully cooled down the spread stays where it is
+		if (NewHeat != CurrentHeat)
+		{
+			CurrentHeat = NewHeat;
+			CurrentSpreadAngle = EvalHeatToSpread(CurrentHeat);
+		}
 	}
-	
-	float MinSpread;
-	float MaxSpread;
-	ComputeSpreadRange(/*out*/ MinSpread, /*out*/ MaxSpread);
 
-	return FMath::IsNearlyEqual(CurrentSpreadAngle, MinSpread, KINDA_SMALL_NUMBER);
+	return IsMinSpreadAngle(CurrentSpreadAngle);
 }
 
 bool ULyraRangedWeaponInstance::UpdateMultipliers(float DeltaSeconds)
@@ -194,7 +582,11 @@ bool ULyraRangedWeaponInstance::UpdateMultipliers(float DeltaSeconds)
 
 	// Determine if we are aiming down sights, and apply the bonus based on how far into the camera transition we are
 	float AimingAlpha = 0.0f;
-	if (const ULyraCameraComponent* CameraComponent = ULyraCameraComponent::FindCameraComponent(Pawn))
+	if (!CachedCameraComponent.IsValid())
+	{
+		CachedCameraComponent = ULyraCameraComponent::FindCameraComponent(Pawn);
+	}
+	if (const ULyraCameraComponent* CameraComponent = CachedCameraComponent.Get())
 	{
 		float TopCameraWeight;
 		FGameplayTag TopCameraTag;
@@ -6,9 +6,12 @@
 
 #include "LyraWeaponInstance.h"
 #include "AbilitySystem/LyraAbilitySourceInterface.h"
+#include "UObject/ObjectKey.h"
+#include "Weapons/LyraCurveLookupTable.h"
 
 #include "LyraRangedWeaponInstance.generated.h"
 
+class ULyraCameraComponent;
 class UPhysicalMaterial;
 
 /**
@@ -68,6 +71,31 @@ public:
 		return BulletTraceSweepRadius;
 	}
 
+	bool AllowsFirstShotAccuracy() const
+	{
+		return bAllowFirstShotAccuracy;
+	}
+
+	// The firing model on explicit state instead of the instance's own, so it can be evaluated without a pawn or a world (see FLyraShotSimulator).
+	// These are const and safe to call from several threads at once, once the curve tables have been baked by a first call on the game thread.
+
+	// The heat a weapon starts with when equipped
+	float GetInitialHeat() const;
+
+	// The heat after firing one shot
+	float ComputeHeatAfterShot(float Heat) const;
+
+	// The heat after not firing for IdleSeconds (cooldown starts after the recovery delay, and is stepped like the weapon tick)
+	float ComputeHeatAfterIdle(float Heat, float IdleSeconds, float TickSeconds) const;
+
+	// The spread angle (in degrees, diametrical) at a given heat
+	float GetSpreadAngleAtHeat(float Heat) const;
+
+	bool IsMinSpreadAngle(float SpreadAngle) const;
+
+	// The combined spread multiplier once the player has settled in a stance, and whether it counts as minimum for first shot accuracy
+	float GetSpreadAngleMultiplierForStance(bool bAiming, bool bMoving, bool bCrouching, bool bJumpingOrFalling, bool& bOutAtMin) const;
+
 protected:
 #if WITH_EDITORONLY_DATA
 	UPROPERTY(VisibleAnywhere, Category = "Spread|Fire Params")
@@ -217,6 +245,14 @@ private:
 public:
 	void Tick(float DeltaSeconds);
 
+	// True while the weapon is ticked by ULyraRangedWeaponUpdateSubsystem, the weapon state component skips it then
+	bool IsUpdatedInBatch() const { return bUpdatedInBatch; }
+
+#if !UE_BUILD_SHIPPING
+	// Runs a fixed pattern of shots and cooldown steps from the middle of the heat range, returning the spread after every step
+	void RunSpreadBenchmark(int32 NumSteps, float DeltaSeconds, TArray<float>& OutSpreadAngles) const;
+#endif
+
 	//~ULyraEquipmentInstance interface
 	virtual void OnEquipped();
 	virtual void OnUnequipped();
@@ -230,16 +266,13 @@ public:
 	//~End of ILyraAbilitySourceInterface interface
 
 private:
-	void ComputeSpreadRange(float& MinSpread, float& MaxSpread);
-	void ComputeHeatRange(float& MinHeat, float& MaxHeat);
+	void ComputeSpreadRange(float& MinSpread, float& MaxSpread) const;
+	void ComputeHeatRange(float& MinHeat, float& MaxHeat) const;
 
 	inline float ClampHeat(float NewHeat)
 	{
-		float MinHeat;
-		float MaxHeat;
-		ComputeHeatRange(/*out*/ MinHeat, /*out*/ MaxHeat);
-
-		return FMath::Clamp(NewHeat, MinHeat, MaxHeat);
+		const ULyraRangedWeaponInstance* TablesOwner = GetCurveTablesOwner();
+		return FMath::Clamp(NewHeat, TablesOwner->BakedMinHeat, TablesOwner->BakedMaxHeat);
 	}
 
 	// Updates the spread and returns true if the spread is at minimum
@@ -247,4 +280,34 @@ private:
 
 	// Updates the multipliers and returns true if they are at minimum
 	bool UpdateMultipliers(float DeltaSeconds);
+
+	// Returns the class default object, with its curve lookup tables baked
+	const ULyraRangedWeaponInstance* GetCurveTablesOwner() const;
+
+	// Bakes the curve lookup tables and ranges (on the class default object)
+	void BakeCurveTables() const;
+
+	float EvalHeatToSpread(float Heat) const;
+	float EvalHeatToHeatPerShot(float Heat) const;
+	float EvalHeatToCoolDownPerSecond(float Heat) const;
+
+	float CombineMaterialDamageMultipliers(const UPhysicalMaterial* PhysicalMaterial) const;
+
+	// Curve lookup tables, only used on the class default object (they are baked from the class defaults when it is loaded, or on first use, and shared by every instance)
+	mutable FLyraCurveLookupTable DistanceDamageFalloffTable;
+	mutable TMap<TObjectKey<UPhysicalMaterial>, float> MaterialDamageMultiplierTable;
+	mutable FLyraCurveLookupTable HeatToSpreadTable;
+	mutable FLyraCurveLookupTable HeatToHeatPerShotTable;
+	mutable FLyraCurveLookupTable HeatToCoolDownPerSecondTable;
+	mutable float BakedMinHeat = 0.0f;
+	mutable float BakedMaxHeat = 0.0f;
+	mutable float BakedMinSpread = 0.0f;
+	// Heats of the spread keys holding BakedMinSpread, evaluated exactly since the table only hits them when they land on a sample
+	mutable TArray<float, TInlineAllocator<1>> BakedMinSpreadHeats;
+	mutable bool bCurveTablesBaked = false;
+
+	// Cached on first use, the pawn of an equipment instance never changes
+	TWeakObjectPtr<const ULyraCameraComponent> CachedCameraComponent;
+
+	bool bUpdatedInBatch = false;
 };
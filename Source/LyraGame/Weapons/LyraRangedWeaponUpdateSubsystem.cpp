@@ -0,0 +1,47 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "LyraRangedWeaponUpdateSubsystem.h"
+
+#include "GameFramework/Pawn.h"
+#include "Weapons/LyraRangedWeaponInstance.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LyraRangedWeaponUpdateSubsystem)
+
+void ULyraRangedWeaponUpdateSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (Weapons.Num() > 0)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(ULyraRangedWeaponUpdateSubsystem::Tick);
+
+		for (int32 Index = Weapons.Num() - 1; Index >= 0; --Index)
+		{
+			ULyraRangedWeaponInstance* Weapon = Weapons[Index];
+
+			// Weapons are unregistered when unequipped, this only catches pawns destroyed without unequipping
+			if ((Weapon == nullptr) || !IsValid(Weapon->GetPawn()))
+			{
+				Weapons.RemoveAtSwap(Index, 1, /*bAllowShrinking=*/ false);
+				continue;
+			}
+
+			Weapon->Tick(DeltaTime);
+		}
+	}
+}
+
+TStatId ULyraRangedWeaponUpdateSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULyraRangedWeaponUpdateSubsystem, STATGROUP_Tickables);
+}
+
+void ULyraRangedWeaponUpdateSubsystem::RegisterWeapon(ULyraRangedWeaponInstance* Weapon)
+{
+	Weapons.AddUnique(Weapon);
+}
+
+void ULyraRangedWeaponUpdateSubsystem::UnregisterWeapon(ULyraRangedWeaponInstance* Weapon)
+{
+	Weapons.RemoveSingleSwap(Weapon, /*bAllowShrinking=*/ false);
+}
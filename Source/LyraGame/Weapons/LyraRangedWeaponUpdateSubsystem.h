@@ -0,0 +1,37 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Subsystems/WorldSubsystem.h"
+
+#include "LyraRangedWeaponUpdateSubsystem.generated.h"
+
+class ULyraRangedWeaponInstance;
+class UObject;
+
+/**
+ * ULyraRangedWeaponUpdateSubsystem
+ *
+ *	Updates the heat and spread of every registered ranged weapon in one pass at the end of the frame.
+ *	Used by servers when Lyra.Weapon.BatchServerUpdates is set, instead of each weapon state component ticking its own weapon.
+ */
+UCLASS()
+class ULyraRangedWeaponUpdateSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~FTickableGameObject interface
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//~End of FTickableGameObject interface
+
+	void RegisterWeapon(ULyraRangedWeaponInstance* Weapon);
+	void UnregisterWeapon(ULyraRangedWeaponInstance* Weapon);
+
+	int32 GetNumWeapons() const { return Weapons.Num(); }
+
+private:
+	UPROPERTY()
+	TArray<TObjectPtr<ULyraRangedWeaponInstance>> Weapons;
+};
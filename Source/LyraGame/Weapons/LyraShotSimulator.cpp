@@ -0,0 +1,445 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "LyraShotSimulator.h"
+
+#include "AbilitySystem/Attributes/LyraHealthSet.h"
+#include "AbilitySystem/Executions/LyraDamageExecution.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "LyraLogChannels.h"
+#include "Math/RandomStream.h"
+#include "Physics/PhysicalMaterialWithTags.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectIterator.h"
+#include "Weapons/LyraGameplayAbility_RangedWeapon.h"
+#include "Weapons/LyraRangedWeaponInstance.h"
+
+namespace LyraShotSimulator_Statics
+{
+	// Engagements simulated by each parallel task
+	static constexpr int32 EngagementsPerBatch = 1024;
+
+	// Resolution and range of the bullet deviation histogram (in degrees)
+	static constexpr float DeviationBinSize = 0.05f;
+	static constexpr int32 NumDeviationBins = 1800;
+
+	struct FBatchStats
+	{
+		int32 NumKills = 0;
+		int64 NumShots = 0;
+		int64 NumBullets = 0;
+		int64 NumBulletHits = 0;
+		int64 SumShotsToKill = 0;
+		double SumSpreadAngle = 0.0;
+		float MaxSpreadAngle = 0.0f;
+		double SumDeviation = 0.0;
+		TArray<int64> NumHitsPerZone;
+		TArray<int64> DeviationHistogram;
+		TArray<float> TimesToKill;
+	};
+
+	static float GetPercentile(const TArray<float>& SortedValues, float Percentile)
+	{
+		if (SortedValues.Num() == 0)
+		{
+			return 0.0f;
+		}
+
+		const int32 Index = FMath::Clamp(FMath::CeilToInt32(Percentile * SortedValues.Num()) - 1, 0, SortedValues.Num() - 1);
+		return SortedValues[Index];
+	}
+
+	static float GetHistogramPercentile(const TArray<int64>& Histogram, int64 NumValues, float Percentile)
+	{
+		const int64 Threshold = (int64)FMath::CeilToDouble(Percentile * NumValues);
+		int64 Count = 0;
+		for (int32 BinIndex = 0; BinIndex < Histogram.Num(); ++BinIndex)
+		{
+			Count += Histogram[BinIndex];
+			if (Count >= Threshold)
+			{
+				return (BinIndex + 1) * DeviationBinSize;
+			}
+		}
+
+		return Histogram.Num() * DeviationBinSize;
+	}
+}
+
+FLyraShotSimulator::FLyraShotSimulator(const UClass* WeaponClass)
+{
+	if ((WeaponClass != nullptr) && WeaponClass->IsChildOf(ULyraRangedWeaponInstance::StaticClass()) && !WeaponClass->HasAnyClassFlags(CLASS_Abstract))
+	{
+		Weapon = WeaponClass->GetDefaultObject<ULyraRangedWeaponInstance>();
+		WeaponName = WeaponClass->GetName();
+	}
+}
+
+void FLyraShotSimulator::AddDefaultHitZones()
+{
+	UPhysicalMaterialWithTags* BodyMaterial = NewObject<UPhysicalMaterialWithTags>(GetTransientPackage());
+	OwnedPhysicalMaterials.Emplace(BodyMaterial);
+
+	UPhysicalMaterialWithTags* HeadMaterial = NewObject<UPhysicalMaterialWithTags>(GetTransientPackage());
+	const FGameplayTag WeakSpotTag = FGameplayTag::RequestGameplayTag(TEXT("Gameplay.Zone.WeakSpot"), /*ErrorIfNotFound=*/ false);
+	if (WeakSpotTag.IsValid())
+	{
+		HeadMaterial->Tags.AddTag(WeakSpotTag);
+	}
+	OwnedPhysicalMaterials.Emplace(HeadMaterial);
+
+	// Roughly the default character, centered on its capsule
+	FLyraShotSimulationHitZone Body;
+	Body.Name = TEXT("Body");
+	Body.Bottom = FVector(0.0f, 0.0f, -55.0f);
+	Body.Top = FVector(0.0f, 0.0f, 40.0f);
+	Body.Radius = 28.0f;
+	Body.PhysicalMaterial = BodyMaterial;
+	AddHitZone(Body);
+
+	FLyraShotSimulationHitZone Head;
+	Head.Name = TEXT("Head");
+	Head.Bottom = FVector(0.0f, 0.0f, 72.0f);
+	Head.Top = Head.Bottom;
+	Head.Radius = 12.0f;
+	Head.PhysicalMaterial = HeadMaterial;
+	AddHitZone(Head);
+}
+
+void FLyraShotSimulator::AddHitZone(const FLyraShotSimulationHitZone& HitZone)
+{
+	HitZones.Add(HitZone);
+}
+
+void FLyraShotSimulator::Run(const FLyraShotSimulationSettings& Settings, TArray<FLyraShotSimulationResult>& OutResults) const
+{
+	using namespace LyraShotSimulator_Statics;
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(FLyraShotSimulator::Run);
+	check(IsInGameThread());
+
+	OutResults.Reset();
+
+	if (!IsValid() || (HitZones.Num() == 0))
+	{
+		return;
+	}
+
+	const ILyraAbilitySourceInterface* AbilitySource = Weapon;
+
+	// Bake the weapon's tables (and add the hit zone materials to them) before any worker reads them
+	Weapon->GetInitialHeat();
+	Weapon->GetDistanceAttenuation(0.0f);
+	for (const FLyraShotSimulationHitZone& HitZone : HitZones)
+	{
+		Weapon->GetPhysicalMaterialAttenuation(HitZone.PhysicalMaterial);
+	}
+
+	const float MaxHealth = GetDefault<ULyraHealthSet>()->GetMaxHealth();
+	const float MaxDamageRange = Weapon->GetMaxDamageRange();
+	const float SweepRadius = Weapon->GetBulletTraceSweepRadius();
+	const int32 BulletsPerCartridge = Weapon->GetBulletsPerCartridge();
+	const float SpreadExponent = Weapon->GetSpreadExponent();
+	const float AimErrorHalfAngleRad = FMath::DegreesToRadians(Settings.AimErrorDegrees);
+	const int32 MaxShots = FMath::Max(Settings.MaxShotsPerEngagement, 1);
+
+	bool bStanceMultiplierAtMin = false;
+	const float StanceMultiplier = Weapon->GetSpreadAngleMultiplierForStance(Settings.bAiming, Settings.bMoving, Settings.bCrouching, Settings.bJumpingOrFalling, /*out*/ bStanceMultiplierAtMin);
+
+	// Every engagement starts from the same heat
+	const float StartHeat = Weapon->ComputeHeatAfterIdle(Weapon->GetInitialHeat(), Settings.IdleSecondsBeforeEngagement, Settings.TickSeconds);
+
+	const FLyraShotSimulationHitZone& AimZone = Settings.bAimAtLastZone ? HitZones.Last() : HitZones[0];
+	const FVector AimPointOffset = (AimZone.Bottom + AimZone.Top) * 0.5f;
+
+	const int32 NumEngagements = FMath::Max(Settings.NumEngagements, 1);
+	const int32 NumBatches = FMath::DivideAndRoundUp(NumEngagements, EngagementsPerBatch);
+
+	for (int32 DistanceIndex = 0; DistanceIndex < Settings.Distances.Num(); ++DistanceIndex)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+
+		// The muzzle is at the origin, the target stands on the X axis
+		const float Distance = Settings.Distances[DistanceIndex];
+		const FVector TargetLocation(Distance, 0.0f, 0.0f);
+		const FVector IdealAimDir = (TargetLocation + AimPointOffset).GetSafeNormal();
+
+		TArray<FBatchStats> BatchStats;
+		BatchStats.SetNum(NumBatches);
+
+		ParallelFor(NumBatches, [&](int32 BatchIndex)
+		{
+			FBatchStats& Stats = BatchStats[BatchIndex];
+			Stats.NumHitsPerZone.SetNumZeroed(HitZones.Num());
+			Stats.DeviationHistogram.SetNumZeroed(NumDeviationBins);
+
+			// Each batch has its own stream, so the results do not depend on the scheduling
+			FRandomStream Stream(HashCombine(HashCombine(GetTypeHash(Settings.Seed), GetTypeHash(DistanceIndex)), GetTypeHash(BatchIndex)));
+
+			const int32 FirstEngagement = BatchIndex * EngagementsPerBatch;
+			const int32 LastEngagement = FMath::Min(FirstEngagement + EngagementsPerBatch, NumEngagements);
+			for (int32 Engagement = FirstEngagement; Engagement < LastEngagement; ++Engagement)
+			{
+				float Heat = StartHeat;
+				float Health = MaxHealth;
+
+				for (int32 ShotIndex = 0; ShotIndex < MaxShots; ++ShotIndex)
+				{
+					// Same spread as ULyraGameplayAbility_RangedWeapon::TraceBulletsInCartridge, with the first shot accuracy the weapon tick would grant
+					const float BaseSpreadAngle = Weapon->GetSpreadAngleAtHeat(Heat);
+					const bool bHasFirstShotAccuracy = Weapon->AllowsFirstShotAccuracy() && bStanceMultiplierAtMin && Weapon->IsMinSpreadAngle(BaseSpreadAngle);
+					const float ActualSpreadAngle = BaseSpreadAngle * (bHasFirstShotAccuracy ? 0.0f : StanceMultiplier);
+					const float HalfSpreadAngleInRadians = FMath::DegreesToRadians(ActualSpreadAngle * 0.5f);
+
+					Stats.SumSpreadAngle += ActualSpreadAngle;
+					Stats.MaxSpreadAngle = FMath::Max(Stats.MaxSpreadAngle, ActualSpreadAngle);
+					++Stats.NumShots;
+
+					FVector AimDir = IdealAimDir;
+					if (AimErrorHalfAngleRad > 0.0f)
+					{
+						const float FromCenterAlpha = Stream.FRand();
+						const float AroundAlpha = Stream.FRand();
+						AimDir = ULyraGameplayAbility_RangedWeapon::GetBulletDirectionInCone(IdealAimDir, AimErrorHalfAngleRad, 1.0f, FromCenterAlpha, AroundAlpha);
+					}
+
+					for (int32 BulletIndex = 0; BulletIndex < BulletsPerCartridge; ++BulletIndex)
+					{
+						const float FromCenterAlpha = Stream.FRand();
+						const float AroundAlpha = Stream.FRand();
+						const FVector BulletDir = ULyraGameplayAbility_RangedWeapon::GetBulletDirectionInCone(AimDir, HalfSpreadAngleInRadians, SpreadExponent, FromCenterAlpha, AroundAlpha);
+						const FVector BulletEnd = BulletDir * MaxDamageRange;
+
+						const float Deviation = (float)FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(FVector::DotProduct(BulletDir, IdealAimDir), -1.0, 1.0)));
+						Stats.SumDeviation += Deviation;
+						++Stats.DeviationHistogram[FMath::Min(FMath::FloorToInt32(Deviation / DeviationBinSize), NumDeviationBins - 1)];
+						++Stats.NumBullets;
+
+						// The closest zone along the bullet, entering it where a sphere of the sweep radius first touches it
+						int32 HitZoneIndex = INDEX_NONE;
+						float HitDistance = TNumericLimits<float>::Max();
+						for (int32 ZoneIndex = 0; ZoneIndex < HitZones.Num(); ++ZoneIndex)
+						{
+							const FLyraShotSimulationHitZone& Zone = HitZones[ZoneIndex];
+
+							FVector PointOnBullet;
+							FVector PointOnZone;
+							FMath::SegmentDistToSegmentSafe(FVector::ZeroVector, BulletEnd, TargetLocation + Zone.Bottom, TargetLocation + Zone.Top, /*out*/ PointOnBullet, /*out*/ PointOnZone);
+
+							const float HitRadius = Zone.Radius + SweepRadius;
+							const float DistSquared = (float)FVector::DistSquared(PointOnBullet, PointOnZone);
+							if (DistSquared <= FMath::Square(HitRadius))
+							{
+								const float EntryDistance = (float)PointOnBullet.Size() - FMath::Sqrt(FMath::Square(HitRadius) - DistSquared);
+								if (EntryDistance < HitDistance)
+								{
+									HitDistance = EntryDistance;
+									HitZoneIndex = ZoneIndex;
+								}
+							}
+						}
+
+						if (HitZoneIndex != INDEX_NONE)
+						{
+							++Stats.NumBulletHits;
+							++Stats.NumHitsPerZone[HitZoneIndex];
+
+							const float DamageDone = ULyraDamageExecution::CalculateDamageDone(Settings.BaseDamage, AbilitySource, FMath::Max(HitDistance, 0.0f), HitZones[HitZoneIndex].PhysicalMaterial,
+								/*SourceTags=*/ nullptr, /*TargetTags=*/ nullptr, /*DamageInteractionAllowedMultiplier=*/ 1.0f);
+
+							// Same clamp as ULyraHealthSet
+							Health = FMath::Clamp(Health - DamageDone, 0.0f, MaxHealth);
+						}
+					}
+
+					if (Health <= 0.0f)
+					{
+						++Stats.NumKills;
+						Stats.SumShotsToKill += ShotIndex + 1;
+						Stats.TimesToKill.Add(ShotIndex * Settings.FireInterval);
+						break;
+					}
+
+					Heat = Weapon->ComputeHeatAfterShot(Heat);
+					Heat = Weapon->ComputeHeatAfterIdle(Heat, Settings.FireInterval, Settings.TickSeconds);
+				}
+			}
+		});
+
+		// Merge the batches
+		FLyraShotSimulationResult& Result = OutResults.AddDefaulted_GetRef();
+		Result.Distance = Distance;
+		Result.NumEngagements = NumEngagements;
+		Result.NumHitsPerZone.SetNumZeroed(HitZones.Num());
+
+		TArray<int64> DeviationHistogram;
+		DeviationHistogram.SetNumZeroed(NumDeviationBins);
+		TArray<float> TimesToKill;
+		TimesToKill.Reserve(NumEngagements);
+		int64 SumShotsToKill = 0;
+		double SumSpreadAngle = 0.0;
+		double SumDeviation = 0.0;
+
+		for (const FBatchStats& Stats : BatchStats)
+		{
+			Result.NumKills += Stats.NumKills;
+			Result.NumShots += Stats.NumShots;
+			Result.NumBullets += Stats.NumBullets;
+			Result.NumBulletHits += Stats.NumBulletHits;
+			Result.MaxSpreadAngle = FMath::Max(Result.MaxSpreadAngle, Stats.MaxSpreadAngle);
+			SumShotsToKill += Stats.SumShotsToKill;
+			SumSpreadAngle += Stats.SumSpreadAngle;
+			SumDeviation += Stats.SumDeviation;
+			TimesToKill.Append(Stats.TimesToKill);
+
+			for (int32 ZoneIndex = 0; ZoneIndex < HitZones.Num(); ++ZoneIndex)
+			{
+				Result.NumHitsPerZone[ZoneIndex] += Stats.NumHitsPerZone[ZoneIndex];
+			}
+
+			for (int32 BinIndex = 0; BinIndex < NumDeviationBins; ++BinIndex)
+			{
+				DeviationHistogram[BinIndex] += Stats.DeviationHistogram[BinIndex];
+			}
+		}
+
+		TimesToKill.Sort();
+
+		double SumTimeToKill = 0.0;
+		for (const float TimeToKill : TimesToKill)
+		{
+			SumTimeToKill += TimeToKill;
+		}
+
+		if (Result.NumKills > 0)
+		{
+			Result.MeanTimeToKill = SumTimeToKill / Result.NumKills;
+			Result.MeanShotsToKill = (double)SumShotsToKill / Result.NumKills;
+			Result.MedianTimeToKill = GetPercentile(TimesToKill, 0.5f);
+			Result.P90TimeToKill = GetPercentile(TimesToKill, 0.9f);
+			Result.P99TimeToKill = GetPercentile(TimesToKill, 0.99f);
+			Result.MaxTimeToKill = TimesToKill.Last();
+		}
+
+		if (Result.NumShots > 0)
+		{
+			Result.MeanSpreadAngle = SumSpreadAngle / Result.NumShots;
+		}
+
+		if (Result.NumBullets > 0)
+		{
+			Result.MeanBulletDeviation = SumDeviation / Result.NumBullets;
+			Result.P90BulletDeviation = GetHistogramPercentile(DeviationHistogram, Result.NumBullets, 0.9f);
+		}
+
+		Result.SimulationSeconds = FPlatformTime::Seconds() - StartTime;
+	}
+}
+
+void FLyraShotSimulator::LogResults(const TArray<FLyraShotSimulationResult>& Results) const
+{
+	for (const FLyraShotSimulationResult& Result : Results)
+	{
+		UE_LOG(LogLyra, Display, TEXT("%s at %.0f cm: %d of %d engagements killed, TTK mean %.3f s, median %.3f s, p90 %.3f s, p99 %.3f s, max %.3f s, %.2f shots to kill"),
+			*WeaponName, Result.Distance, Result.NumKills, Result.NumEngagements,
+			Result.MeanTimeToKill, Result.MedianTimeToKill, Result.P90TimeToKill, Result.P99TimeToKill, Result.MaxTimeToKill, Result.MeanShotsToKill);
+
+		FString ZoneHits;
+		for (int32 ZoneIndex = 0; ZoneIndex < HitZones.Num(); ++ZoneIndex)
+		{
+			const double ZoneShare = (Result.NumBullets > 0) ? (100.0 * Result.NumHitsPerZone[ZoneIndex] / Result.NumBullets) : 0.0;
+			ZoneHits += FString::Printf(TEXT(" %s %.1f%%"), *HitZones[ZoneIndex].Name.ToString(), ZoneShare);
+		}
+
+		UE_LOG(LogLyra, Display, TEXT("  %lld shots, %lld bullets, accuracy %.1f%% (%s ), spread mean %.2f deg max %.2f deg, bullet deviation mean %.2f deg p90 %.2f deg, %.1f ms (%.1f M bullets/s)"),
+			Result.NumShots, Result.NumBullets, 100.0 * Result.GetAccuracy(), *ZoneHits,
+			Result.MeanSpreadAngle, Result.MaxSpreadAngle, Result.MeanBulletDeviation, Result.P90BulletDeviation,
+			Result.SimulationSeconds * 1000.0, (Result.SimulationSeconds > 0.0) ? (Result.NumBullets / Result.SimulationSeconds / 1.0e6) : 0.0);
+	}
+}
+
+FString FLyraShotSimulator::ResultsToCsv(const TArray<FLyraShotSimulationResult>& Results) const
+{
+	FString Csv = TEXT("Weapon,Distance,Engagements,Kills,MeanTTK,MedianTTK,P90TTK,P99TTK,MaxTTK,MeanShotsToKill,Shots,Bullets,Accuracy");
+	for (const FLyraShotSimulationHitZone& HitZone : HitZones)
+	{
+		Csv += FString::Printf(TEXT(",%sHits"), *HitZone.Name.ToString());
+	}
+	Csv += TEXT(",MeanSpread,MaxSpread,MeanDeviation,P90Deviation,Seconds\n");
+
+	for (const FLyraShotSimulationResult& Result : Results)
+	{
+		Csv += FString::Printf(TEXT("%s,%.1f,%d,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.3f,%lld,%lld,%.5f"),
+			*WeaponName, Result.Distance, Result.NumEngagements, Result.NumKills,
+			Result.MeanTimeToKill, Result.MedianTimeToKill, Result.P90TimeToKill, Result.P99TimeToKill, Result.MaxTimeToKill, Result.MeanShotsToKill,
+			Result.NumShots, Result.NumBullets, Result.GetAccuracy());
+		for (const int64 NumZoneHits : Result.NumHitsPerZone)
+		{
+			Csv += FString::Printf(TEXT(",%lld"), NumZoneHits);
+		}
+		Csv += FString::Printf(TEXT(",%.4f,%.4f,%.4f,%.4f,%.3f\n"),
+			Result.MeanSpreadAngle, Result.MaxSpreadAngle, Result.MeanBulletDeviation, Result.P90BulletDeviation, Result.SimulationSeconds);
+	}
+
+	return Csv;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommand GLyraWeaponSimulateShotsCmd(
+	TEXT("Lyra.Weapon.SimulateShots"),
+	TEXT("Fires simulated engagements from a ranged weapon instance class (name of a loaded class, or class path) at a synthetic target and reports time to kill and accuracy per distance. Usage: Lyra.Weapon.SimulateShots <WeaponClass> [Engagements=100000] [BaseDamage=20] [FireInterval=0.1]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+	{
+		if (Args.Num() < 1)
+		{
+			UE_LOG(LogLyra, Error, TEXT("Lyra.Weapon.SimulateShots: Missing weapon class."));
+			return;
+		}
+
+		const UClass* WeaponClass = nullptr;
+		if (Args[0].Contains(TEXT("/")))
+		{
+			WeaponClass = LoadObject<UClass>(nullptr, *Args[0]);
+		}
+		else
+		{
+			for (TObjectIterator<UClass> ClassIt; ClassIt; ++ClassIt)
+			{
+				if (ClassIt->GetName() == Args[0])
+				{
+					WeaponClass = *ClassIt;
+					break;
+				}
+			}
+		}
+
+		FLyraShotSimulator Simulator(WeaponClass);
+		if (!Simulator.IsValid())
+		{
+			UE_LOG(LogLyra, Error, TEXT("Lyra.Weapon.SimulateShots: %s is not a ranged weapon instance class."), *Args[0]);
+			return;
+		}
+
+		FLyraShotSimulationSettings Settings;
+		if (Args.Num() > 1)
+		{
+			Settings.NumEngagements = FMath::Max(FCString::Atoi(*Args[1]), 1);
+		}
+		if (Args.Num() > 2)
+		{
+			Settings.BaseDamage = FCString::Atof(*Args[2]);
+		}
+		if (Args.Num() > 3)
+		{
+			Settings.FireInterval = FMath::Max(FCString::Atof(*Args[3]), 0.0f);
+		}
+
+		Simulator.AddDefaultHitZones();
+
+		TArray<FLyraShotSimulationResult> Results;
+		Simulator.Run(Settings, Results);
+		Simulator.LogResults(Results);
+	}));
+#endif // !UE_BUILD_SHIPPING
@@ -0,0 +1,129 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Containers/Array.h"
+#include "Math/Vector.h"
+#include "UObject/StrongObjectPtr.h"
+
+class UClass;
+class ULyraRangedWeaponInstance;
+class UPhysicalMaterial;
+
+// One part of a synthetic target, a capsule from Bottom to Top (a sphere when they are the same)
+struct FLyraShotSimulationHitZone
+{
+	FName Name;
+	FVector Bottom = FVector::ZeroVector;
+	FVector Top = FVector::ZeroVector;
+	float Radius = 0.0f;
+
+	// Drives the weapon's material damage multipliers, like the physical material of the hit body part in game
+	const UPhysicalMaterial* PhysicalMaterial = nullptr;
+};
+
+struct FLyraShotSimulationSettings
+{
+	// Distances (in cm) between the muzzle and the target, each one is simulated separately
+	TArray<float> Distances = { 500.0f, 1000.0f, 2000.0f, 4000.0f };
+
+	// Engagements per distance, each one fires at a fresh target until it dies or MaxShotsPerEngagement is reached
+	int32 NumEngagements = 100000;
+	int32 MaxShotsPerEngagement = 100;
+
+	// Base damage of the weapon's damage effect (it comes from the gameplay effect, not the weapon instance)
+	float BaseDamage = 20.0f;
+
+	// Time between two shots (in seconds)
+	float FireInterval = 0.1f;
+
+	// How long the weapon was idle before the engagement, lets the heat cool down from the value it is equipped with
+	float IdleSecondsBeforeEngagement = 5.0f;
+
+	// Step used for the heat cooldown between shots, matching the weapon tick
+	float TickSeconds = 1.0f / 30.0f;
+
+	// Uniform error (in degrees, half angle) on where the shooter aims, applied per shot before the weapon spread
+	float AimErrorDegrees = 0.0f;
+
+	// Aim at the center of the last hit zone (the head of the default target) instead of the first one
+	bool bAimAtLastZone = false;
+
+	// The shooter's stance, for the weapon's spread multipliers
+	bool bAiming = false;
+	bool bMoving = false;
+	bool bCrouching = false;
+	bool bJumpingOrFalling = false;
+
+	int32 Seed = 0;
+};
+
+struct FLyraShotSimulationResult
+{
+	float Distance = 0.0f;
+
+	int32 NumEngagements = 0;
+	int32 NumKills = 0;
+
+	int64 NumShots = 0;
+	int64 NumBullets = 0;
+	int64 NumBulletHits = 0;
+	TArray<int64> NumHitsPerZone;
+
+	// Time to kill (in seconds, first shot at 0) over the engagements that ended in a kill
+	double MeanTimeToKill = 0.0;
+	float MedianTimeToKill = 0.0f;
+	float P90TimeToKill = 0.0f;
+	float P99TimeToKill = 0.0f;
+	float MaxTimeToKill = 0.0f;
+	double MeanShotsToKill = 0.0;
+
+	// Effective spread angle (in degrees, diametrical, after multipliers) of every shot
+	double MeanSpreadAngle = 0.0;
+	float MaxSpreadAngle = 0.0f;
+
+	// Angle (in degrees) between each bullet and the aim point
+	double MeanBulletDeviation = 0.0;
+	float P90BulletDeviation = 0.0f;
+
+	double SimulationSeconds = 0.0;
+
+	double GetAccuracy() const { return (NumBullets > 0) ? (double)NumBulletHits / (double)NumBullets : 0.0; }
+};
+
+/**
+ * FLyraShotSimulator
+ *
+ *	Fires simulated shots from a ranged weapon class at synthetic capsule targets on worker threads, and gathers time to kill and accuracy statistics.
+ *	The heat, spread, bullet cone, falloff and damage math is the game's own (the weapon instance class defaults, the ranged weapon ability's cone
+ *	and the damage execution), only the collision is analytic. Used by Lyra.Weapon.SimulateShots and the LyraShotSimulation commandlet.
+ */
+class LYRAGAME_API FLyraShotSimulator
+{
+public:
+	explicit FLyraShotSimulator(const UClass* WeaponClass);
+
+	// False if the class is not a ranged weapon instance class
+	bool IsValid() const { return Weapon != nullptr; }
+
+	// Adds a body and a head (tagged as a weak spot) the size of the default characters
+	void AddDefaultHitZones();
+	void AddHitZone(const FLyraShotSimulationHitZone& HitZone);
+
+	const TArray<FLyraShotSimulationHitZone>& GetHitZones() const { return HitZones; }
+
+	// Runs every distance (blocks until done, on the game thread)
+	void Run(const FLyraShotSimulationSettings& Settings, TArray<FLyraShotSimulationResult>& OutResults) const;
+
+	void LogResults(const TArray<FLyraShotSimulationResult>& Results) const;
+	FString ResultsToCsv(const TArray<FLyraShotSimulationResult>& Results) const;
+
+private:
+	const ULyraRangedWeaponInstance* Weapon = nullptr;
+	FString WeaponName;
+
+	TArray<FLyraShotSimulationHitZone> HitZones;
+
+	// Materials created for the default hit zones
+	TArray<TStrongObjectPtr<UPhysicalMaterial>> OwnedPhysicalMaterials;
+};
@@ -6,20 +6,186 @@
 #include "Equipment/LyraEquipmentManagerComponent.h"
 #include "GameFramework/Pawn.h"
 #include "GameplayEffectTypes.h"
+#include "HAL/IConsoleManager.h"
 #include "Kismet/GameplayStatics.h"
+#include "LyraLogChannels.h"
+#include "Math/RandomStream.h"
 #include "NativeGameplayTags.h"
 #include "Physics/PhysicalMaterialWithTags.h"
 #include "Teams/LyraTeamSubsystem.h"
+#include "UObject/CoreNet.h"
 #include "Weapons/LyraRangedWeaponInstance.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraWeaponStateComponent)
 
 UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_Gameplay_Zone, "Gameplay.Zone");
 
+namespace LyraConsoleVariables
+{
+	static int32 HitMarkerConfirmationSends = 3;
+	static FAutoConsoleVariableRef CVarHitMarkerConfirmationSends(
+		TEXT("Lyra.Weapon.HitMarkerConfirmationSends"),
+		HitMarkerConfirmationSends,
+		TEXT("Number of consecutive (unreliable) hit marker confirmation streams each shot's confirmation is included in, to survive packet loss."),
+		ECVF_Default);
+}
+
+//////////////////////////////////////////////////////////////////////
+// FLyraHitMarkerConfirmation
+
+void FLyraHitMarkerConfirmation::GetConfirmedMarkers(const FLyraServerSideHitMarkerBatch& Batch, TArray<FLyraScreenSpaceHitLocation>& OutMarkers) const
+{
+	if (bSuccess && (HitReplaces.Num() != Batch.Markers.Num()))
+	{
+		int32 HitLocationIndex = 0;
+		for (const FLyraScreenSpaceHitLocation& Entry : Batch.Markers)
+		{
+			if (!HitReplaces.Contains(HitLocationIndex) && Entry.bShowAsSuccess)
+			{
+				OutMarkers.Add(Entry);
+			}
+			++HitLocationIndex;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////
+// FLyraHitMarkerConfirmationStream
+
+bool FLyraHitMarkerConfirmationStream::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	uint32 NumConfirmations = Confirmations.Num();
+	Ar.SerializeIntPacked(NumConfirmations);
+
+	if (Ar.IsLoading())
+	{
+		if (NumConfirmations > MaxConfirmations)
+		{
+			Ar.SetError();
+			bOutSuccess = false;
+			return true;
+		}
+
+		Confirmations.SetNum(NumConfirmations);
+	}
+
+	for (FLyraHitMarkerConfirmation& Confirmation : Confirmations)
+	{
+		Ar << Confirmation.SequenceId;
+
+		uint8 bSuccess = Confirmation.bSuccess ? 1 : 0;
+		Ar.SerializeBits(&bSuccess, 1);
+		Confirmation.bSuccess = (bSuccess != 0);
+
+		// Almost every shot has no replaced hits, so that costs a single bit
+		uint8 bHasHitReplaces = (Confirmation.HitReplaces.Num() > 0) ? 1 : 0;
+		Ar.SerializeBits(&bHasHitReplaces, 1);
+		if (bHasHitReplaces)
+		{
+			uint32 NumHitReplaces = Confirmation.HitReplaces.Num();
+			Ar.SerializeIntPacked(NumHitReplaces);
+
+			if (Ar.IsLoading())
+			{
+				if (NumHitReplaces > MAX_uint8)
+				{
+					Ar.SetError();
+					bOutSuccess = false;
+					return true;
+				}
+
+				Confirmation.HitReplaces.SetNum(NumHitReplaces);
+			}
+
+			for (uint8& HitIndex : Confirmation.HitReplaces)
+			{
+				Ar << HitIndex;
+			}
+		}
+		else if (Ar.IsLoading())
+		{
+			Confirmation.HitReplaces.Reset();
+		}
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// FLyraHitMarkerConfirmationQueue
+
+void FLyraHitMarkerConfirmationQueue::Add(FLyraHitMarkerConfirmation&& Confirmation, int32 NumSends)
+{
+	// Drop the oldest confirmation rather than growing, callers flush a full queue first so it has been sent at least once
+	if (IsFull())
+	{
+		Pending.RemoveAt(0, 1, /*bAllowShrinking=*/ false);
+	}
+
+	FPendingConfirmation& NewPending = Pending.AddDefaulted_GetRef();
+	NewPending.Confirmation = MoveTemp(Confirmation);
+	NewPending.SendsRemaining = FMath::Max(NumSends, 1);
+}
+
+bool FLyraHitMarkerConfirmationQueue::BuildStream(FLyraHitMarkerConfirmationStream& OutStream)
+{
+	OutStream.Confirmations.Reset(Pending.Num());
+
+	for (int32 Index = 0; Index < Pending.Num(); )
+	{
+		FPendingConfirmation& Entry = Pending[Index];
+		OutStream.Confirmations.Add(Entry.Confirmation);
+
+		if (--Entry.SendsRemaining <= 0)
+		{
+			Pending.RemoveAt(Index, 1, /*bAllowShrinking=*/ false);
+		}
+		else
+		{
+			++Index;
+		}
+	}
+
+	return OutStream.Confirmations.Num() > 0;
+}
+
+//////////////////////////////////////////////////////////////////////
+// FLyraUnconfirmedHitMarkerRing
+
+FLyraServerSideHitMarkerBatch& FLyraUnconfirmedHitMarkerRing::AddBatch(uint8 SequenceId)
+{
+	FLyraServerSideHitMarkerBatch& Batch = Batches[SequenceId % RingSize];
+	Batch.UniqueId = SequenceId;
+	Batch.Markers.Reset();
+	Batch.bPending = true;
+	return Batch;
+}
+
+FLyraServerSideHitMarkerBatch* FLyraUnconfirmedHitMarkerRing::FindPendingBatch(uint8 SequenceId)
+{
+	FLyraServerSideHitMarkerBatch& Batch = Batches[SequenceId % RingSize];
+	return (Batch.bPending && (Batch.UniqueId == SequenceId)) ? &Batch : nullptr;
+}
+
+int32 FLyraUnconfirmedHitMarkerRing::GetNumPending() const
+{
+	int32 NumPending = 0;
+	for (const FLyraServerSideHitMarkerBatch& Batch : Batches)
+	{
+		NumPending += Batch.bPending ? 1 : 0;
+	}
+	return NumPending;
+}
+
+//////////////////////////////////////////////////////////////////////
+// ULyraWeaponStateComponent
+
 ULyraWeaponStateComponent::ULyraWeaponStateComponent(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
 	SetIsReplicatedByDefault(true);
+	bReplicateUsingRegisteredSubObjectList = true;
 
 	PrimaryComponentTick.bStartWithTickEnabled = true;
 	PrimaryComponentTick.bCanEverTick = true;
@@ -29,13 +195,22 @@ void ULyraWeaponStateComponent::TickComponent(float DeltaTime, enum ELevelTick T
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
+	if (!OutgoingHitMarkerConfirmations.IsEmpty())
+	{
+		FlushHitMarkerConfirmations();
+	}
+
 	if (APawn* Pawn = GetPawn<APawn>())
 	{
 		if (ULyraEquipmentManagerComponent* EquipmentManager = Pawn->FindComponentByClass<ULyraEquipmentManagerComponent>())
 		{
 			if (ULyraRangedWeaponInstance* CurrentWeapon = Cast<ULyraRangedWeaponInstance>(EquipmentManager->GetFirstInstanceOfType(ULyraRangedWeaponInstance::StaticClass())))
 			{
-				CurrentWeapon->Tick(DeltaTime);
+				// Batched weapons are updated by ULyraRangedWeaponUpdateSubsystem
+				if (!CurrentWeapon->IsUpdatedInBatch())
+				{
+					CurrentWeapon->Tick(DeltaTime);
+				}
 			}
 		}
 	}
@@ -63,46 +238,74 @@ bool ULyraWeaponStateComponent::ShouldUpdateDamageInstigatedTime(const FGameplay
 	return EffectContext.GetEffectCauser() != nullptr;
 }
 
-void ULyraWeaponStateComponent::ClientConfirmTargetData_Implementation(uint16 UniqueId, bool bSuccess, const TArray<uint8>& HitReplaces)
+void ULyraWeaponStateComponent::ConfirmServerSideHitMarkers(uint8 SequenceId, bool bSuccess, const TArray<uint8>& HitReplaces)
 {
-	for (int i = 0; i < UnconfirmedServerSideHitMarkers.Num(); i++)
+	FLyraHitMarkerConfirmation Confirmation;
+	Confirmation.SequenceId = SequenceId;
+	Confirmation.bSuccess = bSuccess;
+	Confirmation.HitReplaces = HitReplaces;
+
+	const AController* Controller = GetController<AController>();
+	if ((Controller != nullptr) && Controller->IsLocalController())
 	{
-		FLyraServerSideHitMarkerBatch& Batch = UnconfirmedServerSideHitMarkers[i];
-		if (Batch.UniqueId == UniqueId)
+		// No need to wait for the end of the frame when we are the client
+		ApplyHitMarkerConfirmation(Confirmation);
+	}
+	else
+	{
+		// A burst of target data (e.g., after a hitch) can confirm more shots in one frame than a stream holds, send the oldest now instead of dropping them
+		if (OutgoingHitMarkerConfirmations.IsFull())
 		{
-			if (bSuccess && (HitReplaces.Num() != Batch.Markers.Num()))
-			{
-				UWorld* World = GetWorld();
-				bool bFoundShowAsSuccessHit = false;
+			FlushHitMarkerConfirmations();
+		}
 
-				int32 HitLocationIndex = 0;
-				for (const FLyraScreenSpaceHitLocation& Entry : Batch.Markers)
-				{
-					if (!HitReplaces.Contains(HitLocationIndex) && Entry.bShowAsSuccess)
-					{
-						// Only need to do this once
-						if (!bFoundShowAsSuccessHit)
-						{
-							ActuallyUpdateDamageInstigatedTime();
-						}
+		OutgoingHitMarkerConfirmations.Add(MoveTemp(Confirmation), LyraConsoleVariables::HitMarkerConfirmationSends);
+	}
+}
 
-						bFoundShowAsSuccessHit = true;
+void ULyraWeaponStateComponent::FlushHitMarkerConfirmations()
+{
+	FLyraHitMarkerConfirmationStream Stream;
+	if (OutgoingHitMarkerConfirmations.BuildStream(Stream))
+	{
+		ClientConfirmHitMarkers(Stream);
+	}
+}
 
-						LastWeaponDamageScreenLocations.Add(Entry);
-					}
-					++HitLocationIndex;
-				}
-			}
+void ULyraWeaponStateComponent::ClientConfirmHitMarkers_Implementation(const FLyraHitMarkerConfirmationStream& Stream)
+{
+	for (const FLyraHitMarkerConfirmation& Confirmation : Stream.Confirmations)
+	{
+		ApplyHitMarkerConfirmation(Confirmation);
+	}
+}
 
-			UnconfirmedServerSideHitMarkers.RemoveAt(i);
-			break;
-		}
+void ULyraWeaponStateComponent::ApplyHitMarkerConfirmation(const FLyraHitMarkerConfirmation& Confirmation)
+{
+	// Repeated confirmations find nothing pending and are ignored
+	FLyraServerSideHitMarkerBatch* Batch = UnconfirmedServerSideHitMarkers.FindPendingBatch(Confirmation.SequenceId);
+	if (Batch == nullptr)
+	{
+		return;
 	}
+
+	TArray<FLyraScreenSpaceHitLocation> ConfirmedMarkers;
+	Confirmation.GetConfirmedMarkers(*Batch, ConfirmedMarkers);
+
+	if (ConfirmedMarkers.Num() > 0)
+	{
+		// This may clear the old locations, so it needs to happen before adding the new ones
+		ActuallyUpdateDamageInstigatedTime();
+		LastWeaponDamageScreenLocations.Append(ConfirmedMarkers);
+	}
+
+	Batch->bPending = false;
+	Batch->Markers.Reset();
 }
 
 void ULyraWeaponStateComponent::AddUnconfirmedServerSideHitMarkers(const FGameplayAbilityTargetDataHandle& InTargetData, const TArray<FHitResult>& FoundHits)
 {
-	FLyraServerSideHitMarkerBatch& NewUnconfirmedHitMarker = UnconfirmedServerSideHitMarkers.Emplace_GetRef(InTargetData.UniqueId);
+	FLyraServerSideHitMarkerBatch& NewUnconfirmedHitMarker = UnconfirmedServerSideHitMarkers.AddBatch(InTargetData.UniqueId);
 
 	if (APlayerController* OwnerPC = GetController<APlayerController>())
 	{
@@ -158,3 +361,181 @@ double ULyraWeaponStateComponent::GetTimeSinceLastHitNotification() const
 	return World->TimeSince(LastWeaponDamageInstigatedTime);
 }
 
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommand GLyraWeaponSimulateHitMarkerStreamCmd(
+	TEXT("Lyra.Weapon.SimulateHitMarkerStream"),
+	TEXT("Runs shots through the hit marker confirmation queue, the bit packed stream and the client ring with simulated latency and packet loss, and checks every delivered marker. Usage: Lyra.Weapon.SimulateHitMarkerStream [Frames=3600] [LossPercent=20] [LatencyFrames=4]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+	{
+		const int32 NumFrames = (Args.Num() > 0) ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 3600;
+		const float LossPercent = (Args.Num() > 1) ? FMath::Clamp(FCString::Atof(*Args[1]), 0.0f, 100.0f) : 20.0f;
+		const int32 LatencyFrames = (Args.Num() > 2) ? FMath::Max(FCString::Atoi(*Args[2]), 0) : 4;
+
+		struct FSimulatedShot
+		{
+			int32 ShotFrame = 0;
+			uint8 SequenceId = 0;
+			TArray<FLyraScreenSpaceHitLocation> Markers;
+			FLyraHitMarkerConfirmation Confirmation;
+			TArray<FVector2D> ExpectedMarkers;
+			bool bConfirmed = false;
+		};
+
+		struct FSimulatedPacket
+		{
+			int32 DeliveryFrame = 0;
+			TArray<uint8> Data;
+			int64 NumBits = 0;
+		};
+
+		FRandomStream Stream(NumFrames);
+		FLyraUnconfirmedHitMarkerRing ClientRing;
+		FLyraHitMarkerConfirmationQueue ServerQueue;
+		TArray<FSimulatedShot> Shots;
+		TArray<FSimulatedPacket> InFlight;
+		int32 ShotIndexBySequenceId[MAX_uint8 + 1];
+		FMemory::Memset(ShotIndexBySequenceId, 0xFF, sizeof(ShotIndexBySequenceId));
+
+		int32 NextShotToConfirm = 0;
+		int32 NumStreamsSent = 0;
+		int32 NumStreamsLost = 0;
+		int64 NumBitsSent = 0;
+		int32 NumWrongMarkers = 0;
+		int32 NumUnknownConfirmations = 0;
+
+		// Run a little longer than asked so the last shots have time to be confirmed
+		const int32 TotalFrames = NumFrames + (LatencyFrames * 2) + LyraConsoleVariables::HitMarkerConfirmationSends + 1;
+		for (int32 Frame = 0; Frame < TotalFrames; ++Frame)
+		{
+			// Client: a high rate of fire weapon, up to two shots a frame
+			const int32 NumShotsThisFrame = (Frame < NumFrames) ? Stream.RandRange(0, 2) : 0;
+			for (int32 ShotIndex = 0; ShotIndex < NumShotsThisFrame; ++ShotIndex)
+			{
+				FSimulatedShot& Shot = Shots.AddDefaulted_GetRef();
+				Shot.ShotFrame = Frame;
+				Shot.SequenceId = ClientRing.AllocateSequenceId();
+
+				FLyraServerSideHitMarkerBatch& Batch = ClientRing.AddBatch(Shot.SequenceId);
+				const int32 NumMarkers = Stream.RandRange(0, 8);
+				for (int32 MarkerIndex = 0; MarkerIndex < NumMarkers; ++MarkerIndex)
+				{
+					FLyraScreenSpaceHitLocation& Marker = Batch.Markers.AddDefaulted_GetRef();
+					Marker.Location = FVector2D(Stream.FRand(), Stream.FRand());
+					Marker.bShowAsSuccess = Stream.FRand() < 0.7f;
+				}
+				Shot.Markers = Batch.Markers;
+
+				// What the server will answer
+				Shot.Confirmation.SequenceId = Shot.SequenceId;
+				Shot.Confirmation.bSuccess = true;
+				for (int32 MarkerIndex = 0; MarkerIndex < NumMarkers; ++MarkerIndex)
+				{
+					if (Stream.FRand() < 0.1f)
+					{
+						Shot.Confirmation.HitReplaces.Add((uint8)MarkerIndex);
+					}
+					else if (Shot.Markers[MarkerIndex].bShowAsSuccess)
+					{
+						Shot.ExpectedMarkers.Add(Shot.Markers[MarkerIndex].Location);
+					}
+				}
+				if (Shot.Confirmation.HitReplaces.Num() == NumMarkers)
+				{
+					Shot.ExpectedMarkers.Reset();
+				}
+
+				ShotIndexBySequenceId[Shot.SequenceId] = Shots.Num() - 1;
+			}
+
+			// Server: the shots arrive (reliably, with the target data) after the latency and are confirmed
+			while (Shots.IsValidIndex(NextShotToConfirm) && (Shots[NextShotToConfirm].ShotFrame + LatencyFrames <= Frame))
+			{
+				FLyraHitMarkerConfirmation Confirmation = Shots[NextShotToConfirm].Confirmation;
+				ServerQueue.Add(MoveTemp(Confirmation), LyraConsoleVariables::HitMarkerConfirmationSends);
+				++NextShotToConfirm;
+			}
+
+			// Server: one stream per frame
+			FLyraHitMarkerConfirmationStream OutStream;
+			if (ServerQueue.BuildStream(OutStream))
+			{
+				FNetBitWriter Writer(nullptr, 8192);
+				bool bSerialized = false;
+				OutStream.NetSerialize(Writer, nullptr, bSerialized);
+
+				++NumStreamsSent;
+				NumBitsSent += Writer.GetNumBits();
+
+				if (Stream.FRand() * 100.0f < LossPercent)
+				{
+					++NumStreamsLost;
+				}
+				else
+				{
+					FSimulatedPacket& Packet = InFlight.AddDefaulted_GetRef();
+					Packet.DeliveryFrame = Frame + LatencyFrames;
+					Packet.Data = *Writer.GetBuffer();
+					Packet.NumBits = Writer.GetNumBits();
+				}
+			}
+
+			// Client: receive the streams that arrive this frame
+			for (int32 PacketIndex = 0; PacketIndex < InFlight.Num(); )
+			{
+				if (InFlight[PacketIndex].DeliveryFrame > Frame)
+				{
+					++PacketIndex;
+					continue;
+				}
+
+				FNetBitReader Reader(nullptr, InFlight[PacketIndex].Data.GetData(), InFlight[PacketIndex].NumBits);
+				FLyraHitMarkerConfirmationStream InStream;
+				bool bSerialized = false;
+				InStream.NetSerialize(Reader, nullptr, bSerialized);
+				InFlight.RemoveAtSwap(PacketIndex, 1, /*bAllowShrinking=*/ false);
+
+				for (const FLyraHitMarkerConfirmation& Confirmation : InStream.Confirmations)
+				{
+					FLyraServerSideHitMarkerBatch* Batch = ClientRing.FindPendingBatch(Confirmation.SequenceId);
+					if (Batch == nullptr)
+					{
+						continue;
+					}
+
+					const int32 ShotIndex = ShotIndexBySequenceId[Confirmation.SequenceId];
+					if (!Shots.IsValidIndex(ShotIndex))
+					{
+						++NumUnknownConfirmations;
+						continue;
+					}
+
+					FSimulatedShot& Shot = Shots[ShotIndex];
+					TArray<FLyraScreenSpaceHitLocation> ConfirmedMarkers;
+					Confirmation.GetConfirmedMarkers(*Batch, ConfirmedMarkers);
+					bool bMatches = (ConfirmedMarkers.Num() == Shot.ExpectedMarkers.Num());
+					for (int32 MarkerIndex = 0; bMatches && (MarkerIndex < ConfirmedMarkers.Num()); ++MarkerIndex)
+					{
+						bMatches = (ConfirmedMarkers[MarkerIndex].Location == Shot.ExpectedMarkers[MarkerIndex]);
+					}
+					NumWrongMarkers += bMatches ? 0 : 1;
+
+					Shot.bConfirmed = true;
+					Batch->bPending = false;
+				}
+			}
+		}
+
+		int32 NumConfirmed = 0;
+		for (const FSimulatedShot& Shot : Shots)
+		{
+			NumConfirmed += Shot.bConfirmed ? 1 : 0;
+		}
+
+		UE_LOG(LogLyra, Display, TEXT("Hit marker stream over %d frames (%.0f%% loss, %d frames latency, %d sends per confirmation): %d shots, %d confirmed, %d never confirmed, %d with wrong markers, %d unknown confirmations"),
+			NumFrames, LossPercent, LatencyFrames, LyraConsoleVariables::HitMarkerConfirmationSends,
+			Shots.Num(), NumConfirmed, Shots.Num() - NumConfirmed, NumWrongMarkers, NumUnknownConfirmations);
+		UE_LOG(LogLyra, Display, TEXT("%d unreliable streams sent (%d lost, %.1f bytes on average) instead of %d reliable RPCs"),
+			NumStreamsSent, NumStreamsLost, (NumStreamsSent > 0) ? (NumBitsSent / 8.0) / NumStreamsSent : 0.0, Shots.Num());
+	}));
+#endif // !UE_BUILD_SHIPPING
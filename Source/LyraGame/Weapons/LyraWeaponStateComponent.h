@@ -34,6 +34,91 @@ struct FLyraServerSideHitMarkerBatch
 	TArray<FLyraScreenSpaceHitLocation> Markers;
 
 	uint8 UniqueId = 0;
+
+	// Still waiting for the server to confirm it
+	bool bPending = false;
+};
+
+// The server's verdict on one shot (identified by the sequence id the client put in the target data)
+struct FLyraHitMarkerConfirmation
+{
+	uint8 SequenceId = 0;
+	bool bSuccess = false;
+
+	// Indices of the hits the server replaced
+	TArray<uint8> HitReplaces;
+
+	// Appends the markers of the batch this confirmation shows as successful hits
+	void GetConfirmedMarkers(const FLyraServerSideHitMarkerBatch& Batch, TArray<FLyraScreenSpaceHitLocation>& OutMarkers) const;
+};
+
+// All the confirmations the server sends to one client in a frame, bit packed into a single unreliable RPC
+USTRUCT()
+struct FLyraHitMarkerConfirmationStream
+{
+	GENERATED_BODY()
+
+	static constexpr int32 MaxConfirmations = 32;
+
+	TArray<FLyraHitMarkerConfirmation> Confirmations;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FLyraHitMarkerConfirmationStream> : public TStructOpsTypeTraitsBase2<FLyraHitMarkerConfirmationStream>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+// Server side: confirmations waiting to be sent, each one is repeated in several consecutive streams in case some are lost
+struct FLyraHitMarkerConfirmationQueue
+{
+public:
+	void Add(FLyraHitMarkerConfirmation&& Confirmation, int32 NumSends);
+
+	// Fills the stream with every confirmation that still has sends left, returns false if there is nothing to send
+	bool BuildStream(FLyraHitMarkerConfirmationStream& OutStream);
+
+	bool IsEmpty() const { return Pending.Num() == 0; }
+
+	// If true, the next Add drops the oldest confirmation, so the queue should be flushed first
+	bool IsFull() const { return Pending.Num() >= FLyraHitMarkerConfirmationStream::MaxConfirmations; }
+
+private:
+	struct FPendingConfirmation
+	{
+		FLyraHitMarkerConfirmation Confirmation;
+		int32 SendsRemaining = 0;
+	};
+
+	// Oldest first, never more than FLyraHitMarkerConfirmationStream::MaxConfirmations
+	TArray<FPendingConfirmation> Pending;
+};
+
+// Client side: fixed-size ring of the shots waiting for a confirmation, indexed by sequence id
+struct FLyraUnconfirmedHitMarkerRing
+{
+public:
+	static constexpr int32 RingSize = 64;
+
+	// Returns the sequence id to send with the next shot
+	uint8 AllocateSequenceId() { return NextSequenceId++; }
+
+	// Starts a new batch for the shot (overwriting the oldest one if it was never confirmed)
+	FLyraServerSideHitMarkerBatch& AddBatch(uint8 SequenceId);
+
+	// Returns the pending batch of the shot, or nullptr if it was already confirmed (or overwritten)
+	FLyraServerSideHitMarkerBatch* FindPendingBatch(uint8 SequenceId);
+
+	int32 GetNumPending() const;
+
+private:
+	FLyraServerSideHitMarkerBatch Batches[RingSize];
+	uint8 NextSequenceId = 0;
 };
 
 // Tracks weapon state and recent confirmed hit markers to display on screen
@@ -48,8 +133,11 @@ public:
 
 	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 
-	UFUNCTION(Client, Reliable)
-	void ClientConfirmTargetData(uint16 UniqueId, bool bSuccess, const TArray<uint8>& HitReplaces);
+	// Sends (coalesced with the other confirmations of the frame) the server's verdict on a shot to the owning client
+	void ConfirmServerSideHitMarkers(uint8 SequenceId, bool bSuccess, const TArray<uint8>& HitReplaces);
+
+	// Returns the sequence id to put in the target data of the next shot
+	uint8 AllocateHitMarkerSequenceId() { return UnconfirmedServerSideHitMarkers.AllocateSequenceId(); }
 
 	void AddUnconfirmedServerSideHitMarkers(const FGameplayAbilityTargetDataHandle& InTargetData, const TArray<FHitResult>& FoundHits);
 
@@ -67,10 +155,18 @@ public:
 
 	int32 GetUnconfirmedServerSideHitMarkerCount() const
 	{
-		return UnconfirmedServerSideHitMarkers.Num();
+		return UnconfirmedServerSideHitMarkers.GetNumPending();
 	}
 
 protected:
+	UFUNCTION(Client, Unreliable)
+	void ClientConfirmHitMarkers(const FLyraHitMarkerConfirmationStream& Stream);
+
+	void ApplyHitMarkerConfirmation(const FLyraHitMarkerConfirmation& Confirmation);
+
+	// Sends the confirmations queued since the last frame (and the ones that are still being repeated)
+	void FlushHitMarkerConfirmations();
+
 	// This is called to filter hit results to determine whether they should be considered as a successful hit or not
 	// The default behavior is to treat it as a success if being done to a team actor that belongs to a different team
 	// to the owning controller's pawn
@@ -88,5 +184,8 @@ private:
 	TArray<FLyraScreenSpaceHitLocation> LastWeaponDamageScreenLocations;
 
 	/** The unconfirmed hits */
-	TArray<FLyraServerSideHitMarkerBatch> UnconfirmedServerSideHitMarkers;
+	FLyraUnconfirmedHitMarkerRing UnconfirmedServerSideHitMarkers;
+
+	/** Confirmations waiting to be sent to the owning client (server only) */
+	FLyraHitMarkerConfirmationQueue OutgoingHitMarkerConfirmations;
 };